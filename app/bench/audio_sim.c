@@ -0,0 +1,329 @@
+#include "audio_sim.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavcodec/avcodec.h>
+
+#include "audio_regulator.h"
+#include "util/log.h"
+#include "util/rand.h"
+
+#define SC_AUDIO_SIM_CHANNELS 2
+
+struct sc_audio_sim {
+    const struct sc_audio_sim_params *params;
+    struct sc_audio_regulator ar;
+    AVFrame *frame;
+    uint8_t *out;
+
+    // Device clock speed relative to the local clock
+    double speed;
+
+    struct sc_rand rand;
+
+    // Next frame to receive
+    uint64_t frame_index;
+    double arrival; // in seconds (local clock)
+
+    // Next pull
+    uint64_t pull_index;
+
+    uint64_t underflow;
+    uint32_t underflow_events;
+
+    double latency_sum;
+    uint64_t latency_count;
+    sc_tick latency_min;
+    sc_tick latency_max;
+
+    uint32_t compensations;
+};
+
+static double
+sc_audio_sim_random(struct sc_audio_sim *sim) {
+    // Uniform in [0; 1]
+    return (double) sc_rand_u32(&sim->rand) / UINT32_MAX;
+}
+
+static sc_tick
+sc_audio_sim_to_tick(double seconds) {
+    return (sc_tick) (seconds * SC_TICK_FREQ);
+}
+
+static sc_tick
+sc_audio_sim_samples_to_tick(struct sc_audio_sim *sim, double samples) {
+    return sc_audio_sim_to_tick(samples / sim->params->sample_rate);
+}
+
+static void
+sc_audio_sim_next_arrival(struct sc_audio_sim *sim) {
+    const struct sc_audio_sim_params *params = sim->params;
+
+    // The frame is sent once all its samples are captured (on the device
+    // clock)
+    double captured = (double) (sim->frame_index + 1) * params->frame_samples
+                    / params->sample_rate / sim->speed;
+    double transport = (double) params->delay / SC_TICK_FREQ
+                     + sc_audio_sim_random(sim) * params->jitter / SC_TICK_FREQ;
+
+    // The frames are received in order (like over TCP)
+    double arrival = captured + transport;
+    if (arrival > sim->arrival) {
+        sim->arrival = arrival;
+    }
+}
+
+static bool
+sc_audio_sim_push(struct sc_audio_sim *sim) {
+    const struct sc_audio_sim_params *params = sim->params;
+
+    // Device PTS of the first sample, in microseconds
+    sim->frame->pts = sim->frame_index * params->frame_samples * SC_TICK_FREQ
+                    / params->sample_rate;
+
+    bool ok = sc_audio_regulator_push_at(&sim->ar, sim->frame,
+                                         sc_audio_sim_to_tick(sim->arrival));
+    if (!ok) {
+        return false;
+    }
+
+    bool played = atomic_load_explicit(&sim->ar.played, memory_order_relaxed);
+    if (played && !sim->ar.samples_since_resync && sim->ar.compensation) {
+        // The compensation has just been recomputed
+        ++sim->compensations;
+    }
+
+    ++sim->frame_index;
+    sc_audio_sim_next_arrival(sim);
+    return true;
+}
+
+static void
+sc_audio_sim_pull(struct sc_audio_sim *sim, double now, sc_tick *latency) {
+    const struct sc_audio_sim_params *params = sim->params;
+    struct sc_audio_regulator *ar = &sim->ar;
+
+    // The underflow counter is only reset by push(), which is not called
+    // concurrently
+    uint32_t underflow_before =
+        atomic_load_explicit(&ar->underflow, memory_order_relaxed);
+
+    sc_tick pts;
+    bool has_pts = sc_audio_regulator_get_pts(ar, &pts);
+
+    sc_audio_regulator_pull(ar, sim->out, params->pull_samples);
+
+    uint32_t underflow =
+        atomic_load_explicit(&ar->underflow, memory_order_relaxed)
+            - underflow_before;
+    if (underflow) {
+        sim->underflow += underflow;
+        ++sim->underflow_events;
+    }
+
+    if (has_pts) {
+        // Local date of the capture of the next sample to play
+        double captured = (double) pts / SC_TICK_FREQ / sim->speed;
+        *latency = sc_audio_sim_to_tick(now - captured);
+    } else {
+        *latency = -1;
+    }
+}
+
+static bool
+sc_audio_sim_init(struct sc_audio_sim *sim,
+                  const struct sc_audio_sim_params *params) {
+    assert(params->sample_rate);
+    assert(params->frame_samples);
+    assert(params->pull_samples);
+
+    sim->params = params;
+
+    AVCodecContext *ctx = avcodec_alloc_context3(NULL);
+    if (!ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    ctx->sample_rate = params->sample_rate;
+    ctx->sample_fmt = SC_AV_SAMPLE_FMT;
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    av_channel_layout_default(&ctx->ch_layout, SC_AUDIO_SIM_CHANNELS);
+#else
+    ctx->channel_layout = av_get_default_channel_layout(SC_AUDIO_SIM_CHANNELS);
+    ctx->channels = SC_AUDIO_SIM_CHANNELS;
+#endif
+
+    sim->frame = av_frame_alloc();
+    if (!sim->frame) {
+        LOG_OOM();
+        goto error_free_ctx;
+    }
+
+    sim->frame->format = SC_AV_SAMPLE_FMT;
+    sim->frame->nb_samples = params->frame_samples;
+    sim->frame->sample_rate = params->sample_rate;
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    int ret = av_channel_layout_copy(&sim->frame->ch_layout, &ctx->ch_layout);
+    if (ret < 0) {
+        LOG_OOM();
+        goto error_free_frame;
+    }
+#else
+    sim->frame->channel_layout = ctx->channel_layout;
+    sim->frame->channels = ctx->channels;
+#endif
+
+    if (av_frame_get_buffer(sim->frame, 0) < 0) {
+        LOG_OOM();
+        goto error_free_frame;
+    }
+
+    size_t sample_size = SC_AUDIO_SIM_CHANNELS
+                       * av_get_bytes_per_sample(SC_AV_SAMPLE_FMT);
+
+    // Only the timing matters, play silence
+    memset(sim->frame->data[0], 0, params->frame_samples * sample_size);
+
+    sim->out = malloc(params->pull_samples * sample_size);
+    if (!sim->out) {
+        LOG_OOM();
+        goto error_free_frame;
+    }
+
+    uint32_t rate = params->sample_rate;
+    uint32_t target = params->audio_buffer * rate / SC_TICK_FREQ;
+    uint32_t min = params->audio_buffer_min * rate / SC_TICK_FREQ;
+    uint32_t max = params->audio_buffer_max * rate / SC_TICK_FREQ;
+    bool ok = sc_audio_regulator_init(&sim->ar, sample_size, ctx, target, min,
+                                      max);
+    if (!ok) {
+        goto error_free_out;
+    }
+
+    // The codec context is only used for initialization
+    avcodec_free_context(&ctx);
+
+    sim->speed = 1 + params->drift_ppm / 1e6;
+
+    // Deterministic for a given seed
+    sim->rand.xsubi[0] = params->seed >> 32;
+    sim->rand.xsubi[1] = params->seed >> 16;
+    sim->rand.xsubi[2] = params->seed;
+
+    sim->frame_index = 0;
+    sim->arrival = 0;
+    sim->pull_index = 0;
+    sim->underflow = 0;
+    sim->underflow_events = 0;
+    sim->latency_sum = 0;
+    sim->latency_count = 0;
+    sim->latency_min = INT64_MAX;
+    sim->latency_max = INT64_MIN;
+    sim->compensations = 0;
+
+    sc_audio_sim_next_arrival(sim);
+
+    return true;
+
+error_free_out:
+    free(sim->out);
+error_free_frame:
+    av_frame_free(&sim->frame);
+error_free_ctx:
+    avcodec_free_context(&ctx);
+
+    return false;
+}
+
+static void
+sc_audio_sim_destroy(struct sc_audio_sim *sim) {
+    sc_audio_regulator_destroy(&sim->ar);
+    free(sim->out);
+    av_frame_free(&sim->frame);
+}
+
+bool
+sc_audio_sim_run(const struct sc_audio_sim_params *params,
+                 sc_audio_sim_report_fn report_fn, void *userdata,
+                 struct sc_audio_sim_stats *stats) {
+    struct sc_audio_sim sim;
+    if (!sc_audio_sim_init(&sim, params)) {
+        return false;
+    }
+
+    double duration = (double) params->duration / SC_TICK_FREQ;
+    double steady = duration / 2;
+    double report_interval = (double) params->report_interval / SC_TICK_FREQ;
+    double next_report = 0;
+
+    bool ok = true;
+    for (;;) {
+        double pull_time = (double) sim.pull_index * params->pull_samples
+                         / params->sample_rate;
+        if (pull_time >= duration) {
+            break;
+        }
+
+        // On the same date, receive before playing
+        if (sim.arrival <= pull_time) {
+            ok = sc_audio_sim_push(&sim);
+            if (!ok) {
+                break;
+            }
+            continue;
+        }
+
+        sc_tick latency;
+        sc_audio_sim_pull(&sim, pull_time, &latency);
+        ++sim.pull_index;
+
+        if (latency >= 0 && pull_time >= steady) {
+            sim.latency_sum += latency;
+            ++sim.latency_count;
+            sim.latency_min = MIN(sim.latency_min, latency);
+            sim.latency_max = MAX(sim.latency_max, latency);
+        }
+
+        if (report_fn && report_interval > 0 && pull_time >= next_report) {
+            struct sc_audio_regulator *ar = &sim.ar;
+            bool played = atomic_load_explicit(&ar->played,
+                                               memory_order_relaxed);
+            // The average is only computed once playback has started
+            float avg = played && ar->avg_buffering.count
+                      ? sc_average_get(&ar->avg_buffering) : 0;
+            struct sc_audio_sim_report report = {
+                .time = sc_audio_sim_to_tick(pull_time),
+                .target = sc_audio_sim_samples_to_tick(&sim,
+                                                       ar->target_buffering),
+                .buffered = sc_audio_sim_samples_to_tick(&sim,
+                                            sc_audiobuf_can_read(&ar->buf)),
+                .avg_buffered = sc_audio_sim_samples_to_tick(&sim, avg),
+                .latency = latency,
+                .underflow = sim.underflow,
+                .compensation = ar->compensation,
+            };
+            report_fn(&report, userdata);
+            next_report += report_interval;
+        }
+    }
+
+    if (ok && stats) {
+        stats->underflow_samples = sim.underflow;
+        stats->underflow_events = sim.underflow_events;
+        stats->compensations = sim.compensations;
+        if (sim.latency_count) {
+            stats->latency_avg = sim.latency_sum / sim.latency_count;
+            stats->latency_min = sim.latency_min;
+            stats->latency_max = sim.latency_max;
+        } else {
+            stats->latency_avg = -1;
+            stats->latency_min = -1;
+            stats->latency_max = -1;
+        }
+    }
+
+    sc_audio_sim_destroy(&sim);
+    return ok;
+}
@@ -0,0 +1,86 @@
+#ifndef SC_AUDIO_SIM_H
+#define SC_AUDIO_SIM_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+/**
+ * Audio regulator simulation
+ *
+ * Run an audio regulator on a simulated clock (much faster than real time, and
+ * deterministic for a given seed):
+ *  - the device produces frames of synthetic samples, according to its own
+ *    clock (which may drift from the local clock);
+ *  - each frame is received after a transport delay plus a random jitter (in
+ *    order, like over TCP);
+ *  - the audio output pulls blocks of samples at the (local) sample rate.
+ *
+ * The state of the regulator is reported regularly.
+ */
+
+struct sc_audio_sim_params {
+    uint32_t sample_rate;
+    uint32_t frame_samples; // samples per received frame
+    uint32_t pull_samples; // samples per pull (audio output period)
+    sc_tick audio_buffer; // target buffering (--audio-buffer)
+    sc_tick audio_buffer_min; // adaptive buffering bounds (0 if disabled)
+    sc_tick audio_buffer_max;
+    sc_tick delay; // constant transport delay
+    sc_tick jitter; // max additional random transport delay (uniform)
+    int32_t drift_ppm; // device clock drift (positive if faster)
+    sc_tick duration;
+    sc_tick report_interval; // 0 to disable reports
+    uint64_t seed;
+};
+
+#define SC_AUDIO_SIM_PARAMS_DEFAULT { \
+    .sample_rate = 48000, \
+    .frame_samples = 960, /* 20ms, like OPUS */ \
+    .pull_samples = 240, /* 5ms, like --audio-output-buffer default */ \
+    .audio_buffer = SC_TICK_FROM_MS(50), \
+    .audio_buffer_min = 0, \
+    .audio_buffer_max = 0, \
+    .delay = SC_TICK_FROM_MS(5), \
+    .jitter = 0, \
+    .drift_ppm = 0, \
+    .duration = SC_TICK_FROM_SEC(60), \
+    .report_interval = SC_TICK_FROM_MS(100), \
+    .seed = 42, \
+}
+
+struct sc_audio_sim_report {
+    sc_tick time;
+    sc_tick target; // current target buffering
+    sc_tick buffered; // instant buffering
+    sc_tick avg_buffered; // smoothed buffering, used for compensation
+    sc_tick latency; // from capture to output pull (-1 if unknown)
+    uint64_t underflow; // total silence samples inserted after start
+    int compensation; // in samples over 4 seconds
+};
+
+struct sc_audio_sim_stats {
+    // Silence samples inserted after playback started
+    uint64_t underflow_samples;
+    // Number of pulls with inserted silence
+    uint32_t underflow_events;
+    // Latency over the second half of the simulation (steady state)
+    sc_tick latency_avg;
+    sc_tick latency_min;
+    sc_tick latency_max;
+    // Number of recomputations with a non-zero compensation
+    uint32_t compensations;
+};
+
+typedef void (*sc_audio_sim_report_fn)(const struct sc_audio_sim_report *report,
+                                       void *userdata);
+
+bool
+sc_audio_sim_run(const struct sc_audio_sim_params *params,
+                 sc_audio_sim_report_fn report_fn, void *userdata,
+                 struct sc_audio_sim_stats *stats);
+
+#endif
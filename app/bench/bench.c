@@ -0,0 +1,111 @@
+#include "bench.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/tick.h"
+
+// A measurement must last at least this duration to be reported
+#define SC_BENCH_MIN_DURATION SC_TICK_FROM_MS(200)
+#define SC_BENCH_MAX_ITERATIONS (UINT64_C(1) << 32)
+
+#ifdef SC_BENCH_COUNT_ALLOCS
+// Linked with -Wl,--wrap=malloc (and calloc, realloc, reallocarray): calls
+// from the benchmarked code are redirected to these wrappers
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+# ifdef HAVE_REALLOCARRAY
+void *__real_reallocarray(void *ptr, size_t nmemb, size_t size);
+void *__wrap_reallocarray(void *ptr, size_t nmemb, size_t size);
+# endif
+
+// The benchmarks are single-threaded
+static uint64_t sc_bench_allocs;
+
+void *
+__wrap_malloc(size_t size) {
+    ++sc_bench_allocs;
+    return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size) {
+    ++sc_bench_allocs;
+    return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size) {
+    ++sc_bench_allocs;
+    return __real_realloc(ptr, size);
+}
+
+# ifdef HAVE_REALLOCARRAY
+void *
+__wrap_reallocarray(void *ptr, size_t nmemb, size_t size) {
+    ++sc_bench_allocs;
+    return __real_reallocarray(ptr, nmemb, size);
+}
+# endif
+#endif
+
+void
+sc_bench_run(const char *suite, const char *name, sc_bench_fn fn,
+             void *userdata) {
+    // Warm up (caches, lazy allocations)
+    fn(1, userdata);
+
+    uint64_t iterations = 1;
+    sc_tick duration;
+#ifdef SC_BENCH_COUNT_ALLOCS
+    uint64_t allocs;
+#endif
+    for (;;) {
+#ifdef SC_BENCH_COUNT_ALLOCS
+        uint64_t allocs_start = sc_bench_allocs;
+#endif
+        sc_tick start = sc_tick_now();
+        fn(iterations, userdata);
+        duration = sc_tick_now() - start;
+#ifdef SC_BENCH_COUNT_ALLOCS
+        allocs = sc_bench_allocs - allocs_start;
+#endif
+
+        if (duration >= SC_BENCH_MIN_DURATION
+                || iterations >= SC_BENCH_MAX_ITERATIONS) {
+            break;
+        }
+
+        // Estimate the number of iterations required to reach the minimal
+        // duration (with some margin), but grow at most by a factor of 100
+        uint64_t next;
+        if (duration > 0) {
+            next = iterations * SC_BENCH_MIN_DURATION * 6 / 5 / duration;
+            if (next > iterations * 100) {
+                next = iterations * 100;
+            }
+        } else {
+            next = iterations * 100;
+        }
+        iterations = next > iterations ? next : iterations + 1;
+    }
+
+    double ns_per_op = (double) SC_TICK_TO_US(duration) * 1000 / iterations;
+
+    printf("{\"suite\":\"%s\",\"name\":\"%s\",\"iterations\":%" PRIu64
+           ",\"ns_per_op\":%.2f,", suite, name, iterations, ns_per_op);
+#ifdef SC_BENCH_COUNT_ALLOCS
+    printf("\"allocs_per_op\":%.2f}\n", (double) allocs / iterations);
+#else
+    printf("\"allocs_per_op\":null}\n");
+#endif
+    fflush(stdout);
+}
@@ -0,0 +1,39 @@
+#ifndef SC_BENCH_H
+#define SC_BENCH_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Minimal microbenchmark harness
+ *
+ * Each benchmark function must execute its operation `iterations` times. The
+ * harness calibrates the number of iterations so that a run lasts long enough
+ * to be measured, then prints one JSON object per line on stdout:
+ *
+ *     {"suite":"vecdeque","name":"push_pop","iterations":16777216,
+ *      "ns_per_op":3.12,"allocs_per_op":0}
+ *
+ * "allocs_per_op" counts the calls to malloc(), calloc(), realloc() and
+ * reallocarray() made by the benchmarked code (not by the libc itself). It is
+ * null if allocation counting is not supported by the linker.
+ */
+
+typedef void (*sc_bench_fn)(uint64_t iterations, void *userdata);
+
+void
+sc_bench_run(const char *suite, const char *name, sc_bench_fn fn,
+             void *userdata);
+
+/**
+ * Prevent the compiler from optimizing away the computation of the value
+ * pointed by p
+ */
+static inline void
+sc_bench_use(const void *p) {
+    __asm__ volatile("" : : "g"(p) : "memory");
+}
+
+#endif
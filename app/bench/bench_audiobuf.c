@@ -0,0 +1,232 @@
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "util/audiobuf.h"
+#include "util/thread.h"
+
+// 48kHz stereo float (8 bytes per sample)
+#define BENCH_SAMPLE_SIZE 8
+// 10ms packets
+#define BENCH_PACKET_SAMPLES 480
+
+/**
+ * Reference implementation (the previous sc_audiobuf), to measure the gain of
+ * the power-of-two capacity and the cache-line separated cursors
+ *
+ * The cursors are wrapped by a modulo on every update, and they share the same
+ * cache line.
+ */
+struct bench_modbuf {
+    uint8_t *data;
+    uint32_t alloc_size; // in samples
+    size_t sample_size;
+
+    atomic_uint_least32_t head;
+    atomic_uint_least32_t tail;
+};
+
+static bool
+bench_modbuf_init(struct bench_modbuf *buf, size_t sample_size,
+                  uint32_t capacity) {
+    buf->alloc_size = capacity + 1;
+    buf->data = malloc((size_t) buf->alloc_size * sample_size);
+    if (!buf->data) {
+        return false;
+    }
+    buf->sample_size = sample_size;
+    atomic_init(&buf->head, 0);
+    atomic_init(&buf->tail, 0);
+    return true;
+}
+
+static void
+bench_modbuf_destroy(struct bench_modbuf *buf) {
+    free(buf->data);
+}
+
+static uint32_t
+bench_modbuf_read(struct bench_modbuf *buf, void *to_,
+                  uint32_t samples_count) {
+    uint8_t *to = to_;
+    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+
+    uint32_t can_read = (buf->alloc_size + head - tail) % buf->alloc_size;
+    if (samples_count > can_read) {
+        samples_count = can_read;
+    }
+    if (!samples_count) {
+        return 0;
+    }
+
+    uint32_t right_count = MIN(buf->alloc_size - tail, samples_count);
+    memcpy(to, buf->data + tail * buf->sample_size,
+           right_count * buf->sample_size);
+    if (samples_count > right_count) {
+        memcpy(to + right_count * buf->sample_size, buf->data,
+               (samples_count - right_count) * buf->sample_size);
+    }
+
+    uint32_t new_tail = (tail + samples_count) % buf->alloc_size;
+    atomic_store_explicit(&buf->tail, new_tail, memory_order_release);
+    return samples_count;
+}
+
+static uint32_t
+bench_modbuf_write(struct bench_modbuf *buf, const void *from_,
+                   uint32_t samples_count) {
+    const uint8_t *from = from_;
+    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+
+    uint32_t can_write = (buf->alloc_size + tail - head - 1) % buf->alloc_size;
+    if (samples_count > can_write) {
+        samples_count = can_write;
+    }
+    if (!samples_count) {
+        return 0;
+    }
+
+    uint32_t right_count = MIN(buf->alloc_size - head, samples_count);
+    memcpy(buf->data + head * buf->sample_size, from,
+           right_count * buf->sample_size);
+    if (samples_count > right_count) {
+        memcpy(buf->data, from + right_count * buf->sample_size,
+               (samples_count - right_count) * buf->sample_size);
+    }
+
+    uint32_t new_head = (head + samples_count) % buf->alloc_size;
+    atomic_store_explicit(&buf->head, new_head, memory_order_release);
+    return samples_count;
+}
+
+// Generate the benchmarks for both implementations (without indirect calls,
+// which would dominate the measurements)
+#define BENCH_DEFINE(PREFIX, TYPE, INIT, DESTROY, READ, WRITE) \
+    static void \
+    PREFIX##_write_read(uint64_t iterations, void *userdata) { \
+        const struct bench_params *params = userdata; \
+        TYPE buf; \
+        if (!INIT(&buf, BENCH_SAMPLE_SIZE, params->capacity)) { \
+            abort(); \
+        } \
+        size_t size = (size_t) params->samples * BENCH_SAMPLE_SIZE; \
+        uint8_t *in = malloc(size); \
+        uint8_t *out = malloc(size); \
+        if (!in || !out) { \
+            abort(); \
+        } \
+        memset(in, 0x42, size); \
+        for (uint64_t i = 0; i < iterations; ++i) { \
+            uint32_t w = WRITE(&buf, in, params->samples); \
+            uint32_t r = READ(&buf, out, params->samples); \
+            sc_bench_use(&w); \
+            sc_bench_use(&r); \
+            sc_bench_use(out); \
+        } \
+        free(in); \
+        free(out); \
+        DESTROY(&buf); \
+    } \
+    \
+    struct PREFIX##_reader { \
+        TYPE *buf; \
+        uint32_t samples; \
+        uint64_t total; \
+    }; \
+    \
+    static int \
+    PREFIX##_run_reader(void *data) { \
+        struct PREFIX##_reader *reader = data; \
+        uint8_t out[BENCH_PACKET_SAMPLES * BENCH_SAMPLE_SIZE]; \
+        uint64_t read = 0; \
+        while (read < reader->total) { \
+            read += READ(reader->buf, out, reader->samples); \
+            sc_bench_use(out); \
+        } \
+        return 0; \
+    } \
+    \
+    static void \
+    PREFIX##_spsc(uint64_t iterations, void *userdata) { \
+        const struct bench_params *params = userdata; \
+        TYPE buf; \
+        if (!INIT(&buf, BENCH_SAMPLE_SIZE, params->capacity)) { \
+            abort(); \
+        } \
+        struct PREFIX##_reader reader = { \
+            .buf = &buf, \
+            .samples = params->read_samples, \
+            .total = iterations * params->samples, \
+        }; \
+        sc_thread thread; \
+        if (!sc_thread_create(&thread, PREFIX##_run_reader, "bench-reader", \
+                              &reader)) { \
+            abort(); \
+        } \
+        uint8_t in[BENCH_PACKET_SAMPLES * BENCH_SAMPLE_SIZE]; \
+        memset(in, 0x42, sizeof(in)); \
+        for (uint64_t i = 0; i < iterations; ++i) { \
+            uint32_t written = 0; \
+            while (written < params->samples) { \
+                written += WRITE(&buf, in + written * BENCH_SAMPLE_SIZE, \
+                                 params->samples - written); \
+            } \
+        } \
+        sc_thread_join(&thread, NULL); \
+        DESTROY(&buf); \
+    }
+
+struct bench_params {
+    uint32_t capacity; // in samples
+    uint32_t samples; // samples per write (and per read if single-threaded)
+    uint32_t read_samples; // samples per read by the reader thread
+};
+
+BENCH_DEFINE(bench_audiobuf, struct sc_audiobuf, sc_audiobuf_init,
+             sc_audiobuf_destroy, sc_audiobuf_read, sc_audiobuf_write)
+BENCH_DEFINE(bench_modbuf, struct bench_modbuf, bench_modbuf_init,
+             bench_modbuf_destroy, bench_modbuf_read, bench_modbuf_write)
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    // The capacity is not a multiple of the packet size, so the cursors wrap
+    // around at various positions
+    struct bench_params packet = {
+        .capacity = 4801,
+        .samples = BENCH_PACKET_SAMPLES,
+    };
+    sc_bench_run("audiobuf", "write_read_480", bench_audiobuf_write_read,
+                 &packet);
+    sc_bench_run("audiobuf", "write_read_480_modulo", bench_modbuf_write_read,
+                 &packet);
+
+    // Small reads, as requested by the audio output callback
+    struct bench_params small = {
+        .capacity = 4801,
+        .samples = 64,
+    };
+    sc_bench_run("audiobuf", "write_read_64", bench_audiobuf_write_read,
+                 &small);
+    sc_bench_run("audiobuf", "write_read_64_modulo", bench_modbuf_write_read,
+                 &small);
+
+    // Producer and consumer on separate threads (decoder and audio callback),
+    // where false sharing between the cursors matters (both threads spin, so
+    // this is only meaningful with at least 2 CPUs)
+    struct bench_params spsc = {
+        .capacity = 4801,
+        .samples = BENCH_PACKET_SAMPLES,
+        .read_samples = 64,
+    };
+    sc_bench_run("audiobuf", "spsc_480_64", bench_audiobuf_spsc, &spsc);
+    sc_bench_run("audiobuf", "spsc_480_64_modulo", bench_modbuf_spsc, &spsc);
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "common.h"
+
+#include <string.h>
+
+#include "bench.h"
+#include "control_msg.h"
+
+static uint8_t buf[SC_CONTROL_MSG_MAX_SIZE];
+
+static void
+bench_serialize(uint64_t iterations, void *userdata) {
+    const struct sc_control_msg *msg = userdata;
+    for (uint64_t i = 0; i < iterations; ++i) {
+        size_t size = sc_control_msg_serialize(msg, buf);
+        sc_bench_use(&size);
+        sc_bench_use(buf);
+    }
+}
+
+static void
+bench_serialize_bulk(uint64_t iterations, void *userdata) {
+    const struct sc_control_msg *msg = userdata;
+    uint8_t header[SC_CONTROL_MSG_BULK_HEADER_MAX_SIZE];
+    for (uint64_t i = 0; i < iterations; ++i) {
+        const uint8_t *payload;
+        size_t payload_len;
+        size_t size = sc_control_msg_serialize_bulk(msg, header, &payload,
+                                                    &payload_len);
+        sc_bench_use(&size);
+        sc_bench_use(&payload);
+        sc_bench_use(header);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    struct sc_control_msg keycode = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_KEYCODE,
+        .inject_keycode = {
+            .action = AKEY_EVENT_ACTION_DOWN,
+            .keycode = AKEYCODE_ENTER,
+            .metastate = AMETA_SHIFT_ON,
+        },
+    };
+    sc_bench_run("control_msg", "serialize_inject_keycode", bench_serialize,
+                 &keycode);
+
+    struct sc_control_msg touch = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = AMOTION_EVENT_ACTION_MOVE,
+            .pointer_id = 0,
+            .position = {
+                .point = {.x = 100, .y = 200},
+                .screen_size = {.width = 1080, .height = 1920},
+            },
+            .pressure = 1.0f,
+            .action_button = AMOTION_EVENT_BUTTON_PRIMARY,
+            .buttons = AMOTION_EVENT_BUTTON_PRIMARY,
+        },
+    };
+    sc_bench_run("control_msg", "serialize_inject_touch_event",
+                 bench_serialize, &touch);
+
+    char text[] = "hello, world!";
+    struct sc_control_msg inject_text = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_TEXT,
+        .inject_text = {
+            .text = text,
+        },
+    };
+    sc_bench_run("control_msg", "serialize_inject_text", bench_serialize,
+                 &inject_text);
+
+    static char clipboard[64 * 1024 + 1];
+    memset(clipboard, 'a', sizeof(clipboard) - 1);
+    struct sc_control_msg set_clipboard = {
+        .type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        .set_clipboard = {
+            .sequence = 42,
+            .text = clipboard,
+            .paste = false,
+        },
+    };
+    sc_bench_run("control_msg", "serialize_set_clipboard_64k",
+                 bench_serialize, &set_clipboard);
+    sc_bench_run("control_msg", "serialize_bulk_set_clipboard_64k",
+                 bench_serialize_bulk, &set_clipboard);
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "common.h"
+
+#include <string.h>
+
+#include "bench.h"
+#include "device_msg.h"
+
+struct bench_input {
+    const uint8_t *data;
+    size_t len;
+};
+
+static void
+bench_deserialize(uint64_t iterations, void *userdata) {
+    const struct bench_input *input = userdata;
+    for (uint64_t i = 0; i < iterations; ++i) {
+        struct sc_device_msg msg;
+        ssize_t r = sc_device_msg_deserialize(input->data, input->len, &msg);
+        sc_bench_use(&r);
+        sc_bench_use(&msg);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    static const uint8_t ack[] = {
+        DEVICE_MSG_TYPE_ACK_CLIPBOARD,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // sequence
+    };
+    struct bench_input input = {ack, sizeof(ack)};
+    sc_bench_run("device_msg", "deserialize_ack_clipboard", bench_deserialize,
+                 &input);
+
+    static const uint8_t pong[] = {
+        DEVICE_MSG_TYPE_PONG,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // push date
+        0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, // send date
+        0x00, 0x00, 0x01, 0x02, // device delay
+    };
+    input = (struct bench_input) {pong, sizeof(pong)};
+    sc_bench_run("device_msg", "deserialize_pong", bench_deserialize, &input);
+
+    static uint8_t uhid[5 + 64] = {
+        DEVICE_MSG_TYPE_UHID_OUTPUT,
+        0, 42, // id
+        0, 64, // size
+    };
+    input = (struct bench_input) {uhid, sizeof(uhid)};
+    sc_bench_run("device_msg", "deserialize_uhid_output_64", bench_deserialize,
+                 &input);
+
+    static uint8_t clipboard[5 + 64 * 1024] = {
+        DEVICE_MSG_TYPE_CLIPBOARD,
+        0x00, 0x01, 0x00, 0x00, // text length
+    };
+    memset(&clipboard[5], 'a', sizeof(clipboard) - 5);
+    input = (struct bench_input) {clipboard, sizeof(clipboard)};
+    sc_bench_run("device_msg", "deserialize_clipboard_64k", bench_deserialize,
+                 &input);
+
+    static uint8_t chunk[4 + 4096] = {
+        DEVICE_MSG_TYPE_CHUNK,
+        0x00, // last
+        0x10, 0x00, // size
+    };
+    input = (struct bench_input) {chunk, sizeof(chunk)};
+    sc_bench_run("device_msg", "deserialize_chunk_4k", bench_deserialize,
+                 &input);
+
+    return 0;
+}
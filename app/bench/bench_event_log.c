@@ -0,0 +1,62 @@
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "event_log.h"
+
+#define BENCH_EVENT_LOG_FILENAME "bench_event_log.txt"
+
+static void
+bench_record(uint64_t iterations, void *userdata) {
+    (void) userdata;
+
+    struct event_logger logger;
+    bool ok = event_logger_init(&logger, BENCH_EVENT_LOG_FILENAME);
+    if (!ok) {
+        abort();
+    }
+
+    // Move by 2 pixels each time, so that no event is filtered out
+    for (uint64_t i = 0; i < iterations; ++i) {
+        SDL_Event event = {
+            .motion = {
+                .type = SDL_MOUSEMOTION,
+                .x = (int) (i * 2 % 2000),
+                .y = (int) (i % 2 ? 100 : 200),
+            },
+        };
+        event_logger_record(&logger, &event);
+    }
+
+    event_logger_close(&logger);
+}
+
+static void
+bench_parse(uint64_t iterations, void *userdata) {
+    const char *line = userdata;
+    for (uint64_t i = 0; i < iterations; ++i) {
+        SDL_Event event;
+        Uint64 timestamp;
+        bool ok = event_log_parse_line(line, &event, &timestamp);
+        sc_bench_use(&ok);
+        sc_bench_use(&event);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_bench_run("event_log", "record_mouse_motion", bench_record, NULL);
+    remove(BENCH_EVENT_LOG_FILENAME);
+
+    char motion[] = "123456 MOUSE_MOTION 540 960 0 0x0\n";
+    sc_bench_run("event_log", "parse_mouse_motion", bench_parse, motion);
+
+    char button[] = "123456 MOUSE_DOWN 540 960 1 0x1\n";
+    sc_bench_run("event_log", "parse_mouse_down", bench_parse, button);
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "common.h"
+
+#include <stdlib.h>
+
+#include "bench.h"
+#include "util/strbuf.h"
+
+static void
+bench_append_str(uint64_t iterations, void *userdata) {
+    (void) userdata;
+
+    // Build a 4k string from small pieces, as done to format a help message
+    for (uint64_t i = 0; i < iterations; ++i) {
+        struct sc_strbuf buf;
+        bool ok = sc_strbuf_init(&buf, 64);
+        if (!ok) {
+            abort();
+        }
+        for (int j = 0; j < 256; ++j) {
+            ok = sc_strbuf_append_staticstr(&buf, "0123456789abcde");
+            if (!ok) {
+                abort();
+            }
+        }
+        sc_bench_use(buf.s);
+        free(buf.s);
+    }
+}
+
+static void
+bench_append_char(uint64_t iterations, void *userdata) {
+    (void) userdata;
+
+    for (uint64_t i = 0; i < iterations; ++i) {
+        struct sc_strbuf buf;
+        bool ok = sc_strbuf_init(&buf, 64);
+        if (!ok) {
+            abort();
+        }
+        for (int j = 0; j < 4096; ++j) {
+            ok = sc_strbuf_append_char(&buf, 'a');
+            if (!ok) {
+                abort();
+            }
+        }
+        sc_bench_use(buf.s);
+        free(buf.s);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_bench_run("strbuf", "append_str_4k", bench_append_str, NULL);
+    sc_bench_run("strbuf", "append_char_4k", bench_append_char, NULL);
+
+    return 0;
+}
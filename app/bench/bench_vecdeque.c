@@ -0,0 +1,69 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "util/vecdeque.h"
+
+struct bench_item {
+    uint64_t a;
+    uint64_t b;
+};
+
+struct bench_deque SC_VECDEQUE(struct bench_item);
+
+static void
+bench_push_pop(uint64_t iterations, void *userdata) {
+    (void) userdata;
+
+    struct bench_deque deque = SC_VECDEQUE_INITIALIZER;
+    bool ok = sc_vecdeque_reserve(&deque, 64);
+    if (!ok) {
+        abort();
+    }
+
+    // Steady state: the deque never grows, the cursors wrap around
+    for (uint64_t i = 0; i < iterations; ++i) {
+        struct bench_item item = {i, i};
+        sc_vecdeque_push_noresize(&deque, item);
+        if (sc_vecdeque_size(&deque) == 32) {
+            struct bench_item *p = sc_vecdeque_popref(&deque);
+            sc_bench_use(p);
+        }
+    }
+
+    sc_vecdeque_destroy(&deque);
+}
+
+static void
+bench_push_grow(uint64_t iterations, void *userdata) {
+    (void) userdata;
+
+    // Measure the amortized cost of growing from empty to 1024 items
+    for (uint64_t i = 0; i < iterations; ++i) {
+        struct bench_deque deque = SC_VECDEQUE_INITIALIZER;
+        for (uint64_t j = 0; j < 1024; ++j) {
+            struct bench_item item = {i, j};
+            bool ok = sc_vecdeque_push(&deque, item);
+            if (!ok) {
+                abort();
+            }
+        }
+        while (!sc_vecdeque_is_empty(&deque)) {
+            struct bench_item item = sc_vecdeque_pop(&deque);
+            sc_bench_use(&item);
+        }
+        sc_vecdeque_destroy(&deque);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_bench_run("vecdeque", "push_pop", bench_push_pop, NULL);
+    sc_bench_run("vecdeque", "push_grow_1024", bench_push_grow, NULL);
+
+    return 0;
+}
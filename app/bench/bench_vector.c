@@ -0,0 +1,61 @@
+#include "common.h"
+
+#include <stdlib.h>
+
+#include "bench.h"
+#include "util/vector.h"
+
+struct bench_vec SC_VECTOR(int);
+
+static void
+bench_push(uint64_t iterations, void *userdata) {
+    (void) userdata;
+
+    // Measure the amortized cost of growing from empty to 1024 items
+    for (uint64_t i = 0; i < iterations; ++i) {
+        struct bench_vec vec = SC_VECTOR_INITIALIZER;
+        for (int j = 0; j < 1024; ++j) {
+            bool ok = sc_vector_push(&vec, j);
+            if (!ok) {
+                abort();
+            }
+        }
+        sc_bench_use(vec.data);
+        sc_vector_destroy(&vec);
+    }
+}
+
+static void
+bench_insert_remove(uint64_t iterations, void *userdata) {
+    (void) userdata;
+
+    struct bench_vec vec = SC_VECTOR_INITIALIZER;
+    for (int j = 0; j < 256; ++j) {
+        bool ok = sc_vector_push(&vec, j);
+        if (!ok) {
+            abort();
+        }
+    }
+
+    // Insert and remove in the middle (memmove of half the items)
+    for (uint64_t i = 0; i < iterations; ++i) {
+        bool ok = sc_vector_insert(&vec, 128, (int) i);
+        if (!ok) {
+            abort();
+        }
+        sc_vector_remove(&vec, 128);
+        sc_bench_use(vec.data);
+    }
+
+    sc_vector_destroy(&vec);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    sc_bench_run("vector", "push_grow_1024", bench_push, NULL);
+    sc_bench_run("vector", "insert_remove_256", bench_insert_remove, NULL);
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "common.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_sim.h"
+
+/**
+ * Simulate the audio regulator and print its state over time as CSV
+ *
+ * Usage:
+ *
+ *     sim_audio_regulator [key=value...] > out.csv
+ *
+ * Keys (durations in milliseconds unless specified):
+ *     rate=<hz>          sample rate (48000)
+ *     frame=<samples>    samples per received frame (960)
+ *     pull=<samples>     samples per audio output pull (240)
+ *     buffer=<ms>        target buffering, like --audio-buffer (50)
+ *     adaptive=<min:max> adaptive buffering, like --audio-buffer-adaptive
+ *     delay=<ms>         constant transport delay (5)
+ *     jitter=<ms>        max random additional transport delay (0)
+ *     drift=<ppm>        device clock drift, positive if faster (0)
+ *     duration=<s>       simulated duration (60)
+ *     interval=<ms>      interval between CSV rows (100)
+ *     seed=<n>           random seed (42)
+ *
+ * A summary is printed on stderr.
+ */
+
+static bool
+parse_ms(const char *s, sc_tick *tick) {
+    char *end;
+    long value = strtol(s, &end, 10);
+    if (end == s || *end || value < 0) {
+        return false;
+    }
+    *tick = SC_TICK_FROM_MS(value);
+    return true;
+}
+
+static bool
+parse_u32(const char *s, uint32_t *value) {
+    char *end;
+    unsigned long v = strtoul(s, &end, 10);
+    if (end == s || *end || !v || v > UINT32_MAX) {
+        return false;
+    }
+    *value = v;
+    return true;
+}
+
+static bool
+parse_arg(const char *arg, struct sc_audio_sim_params *params) {
+    const char *eq = strchr(arg, '=');
+    if (!eq) {
+        return false;
+    }
+
+    size_t len = eq - arg;
+    const char *value = eq + 1;
+
+#define KEY(K) (len == sizeof(K) - 1 && !strncmp(arg, K, len))
+    if (KEY("rate")) {
+        return parse_u32(value, &params->sample_rate);
+    }
+    if (KEY("frame")) {
+        return parse_u32(value, &params->frame_samples);
+    }
+    if (KEY("pull")) {
+        return parse_u32(value, &params->pull_samples);
+    }
+    if (KEY("buffer")) {
+        return parse_ms(value, &params->audio_buffer);
+    }
+    if (KEY("adaptive")) {
+        char min[16];
+        const char *colon = strchr(value, ':');
+        if (!colon || (size_t) (colon - value) >= sizeof(min)) {
+            return false;
+        }
+        memcpy(min, value, colon - value);
+        min[colon - value] = '\0';
+        return parse_ms(min, &params->audio_buffer_min)
+            && parse_ms(colon + 1, &params->audio_buffer_max)
+            && params->audio_buffer_min <= params->audio_buffer_max
+            && params->audio_buffer_max;
+    }
+    if (KEY("delay")) {
+        return parse_ms(value, &params->delay);
+    }
+    if (KEY("jitter")) {
+        return parse_ms(value, &params->jitter);
+    }
+    if (KEY("drift")) {
+        char *end;
+        long v = strtol(value, &end, 10);
+        if (end == value || *end || v <= -100000 || v >= 100000) {
+            return false;
+        }
+        params->drift_ppm = v;
+        return true;
+    }
+    if (KEY("duration")) {
+        uint32_t sec;
+        if (!parse_u32(value, &sec)) {
+            return false;
+        }
+        params->duration = SC_TICK_FROM_SEC(sec);
+        return true;
+    }
+    if (KEY("interval")) {
+        return parse_ms(value, &params->report_interval);
+    }
+    if (KEY("seed")) {
+        char *end;
+        unsigned long long v = strtoull(value, &end, 10);
+        if (end == value || *end) {
+            return false;
+        }
+        params->seed = v;
+        return true;
+    }
+#undef KEY
+
+    return false;
+}
+
+static double
+to_ms(sc_tick tick) {
+    return (double) tick / 1000;
+}
+
+static void
+print_report(const struct sc_audio_sim_report *report, void *userdata) {
+    (void) userdata;
+
+    printf("%.1f,%.2f,%.2f,%.2f,", to_ms(report->time), to_ms(report->target),
+           to_ms(report->buffered), to_ms(report->avg_buffered));
+    if (report->latency >= 0) {
+        printf("%.2f", to_ms(report->latency));
+    }
+    printf(",%" PRIu64 ",%d\n", report->underflow, report->compensation);
+}
+
+int main(int argc, char *argv[]) {
+    struct sc_audio_sim_params params = SC_AUDIO_SIM_PARAMS_DEFAULT;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!parse_arg(argv[i], &params)) {
+            fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    printf("time_ms,target_ms,buffered_ms,avg_buffered_ms,latency_ms,"
+           "underflow_samples,compensation\n");
+
+    struct sc_audio_sim_stats stats;
+    bool ok = sc_audio_sim_run(&params, print_report, NULL, &stats);
+    if (!ok) {
+        fprintf(stderr, "Simulation failed\n");
+        return 1;
+    }
+
+    fprintf(stderr, "underflow: %" PRIu64 " samples (%.1f ms) in %" PRIu32
+            " events\n", stats.underflow_samples,
+            (double) stats.underflow_samples * 1000 / params.sample_rate,
+            stats.underflow_events);
+    fprintf(stderr, "latency (steady state): avg %.2f ms (min %.2f, max "
+            "%.2f)\n", to_ms(stats.latency_avg), to_ms(stats.latency_min),
+            to_ms(stats.latency_max));
+    fprintf(stderr, "compensations: %" PRIu32 "\n", stats.compensations);
+
+    return 0;
+}
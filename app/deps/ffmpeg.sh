@@ -70,6 +70,7 @@ else
         --enable-decoder=aac
         --enable-decoder=flac
         --enable-decoder=png
+        --enable-encoder=png
         --enable-protocol=file
         --enable-demuxer=image2
         --enable-parser=png
@@ -81,19 +82,10 @@ else
         --enable-muxer=wav
     )
 
-    if [[ "$HOST" == linux ]]
-    then
-        conf+=(
-            --enable-libv4l2
-            --enable-outdev=v4l2
-            --enable-encoder=rawvideo
-        )
-    else
-        # libavdevice is only used for V4L2 on Linux
-        conf+=(
-            --disable-avdevice
-        )
-    fi
+    # V4L2 frames are written directly to the device, libavdevice is not used
+    conf+=(
+        --disable-avdevice
+    )
 
     if [[ "$LINK_TYPE" == static ]]
     then
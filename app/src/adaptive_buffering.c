@@ -0,0 +1,122 @@
+#include "adaptive_buffering.h"
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include "util/log.h"
+
+// Margin added to the jitter: the samples are consumed by blocks, so the
+// buffering must not reach 0 right before the next packet arrives
+#define SC_ADAPTIVE_BUFFERING_MARGIN_MS 10
+// Increase step on underflow
+#define SC_ADAPTIVE_BUFFERING_STEP_UP_MS 10
+// Decrease step once the link is stable
+#define SC_ADAPTIVE_BUFFERING_STEP_DOWN_MS 5
+// Number of windows (seconds) without underflow before decreasing the target
+#define SC_ADAPTIVE_BUFFERING_STABLE_WINDOWS 5
+
+#define TO_SAMPLES(MS) \
+    ((uint32_t) ((uint64_t) (MS) * ab->sample_rate / 1000))
+#define TO_MS(SAMPLES) \
+    ((uint32_t) ((uint64_t) (SAMPLES) * 1000 / ab->sample_rate))
+
+static uint32_t
+sc_adaptive_buffering_clamp(struct sc_adaptive_buffering *ab,
+                            uint32_t target) {
+    return CLAMP(target, ab->min_target, ab->max_target);
+}
+
+static void
+sc_adaptive_buffering_reset_window(struct sc_adaptive_buffering *ab) {
+    ab->has_transit = false;
+    ab->min_transit = 0;
+    ab->max_transit = 0;
+    ab->underflow = 0;
+}
+
+void
+sc_adaptive_buffering_init(struct sc_adaptive_buffering *ab,
+                           uint32_t sample_rate, uint32_t min_target,
+                           uint32_t max_target, uint32_t initial_target) {
+    assert(sample_rate);
+    assert(min_target <= max_target);
+
+    ab->sample_rate = sample_rate;
+    ab->min_target = min_target;
+    ab->max_target = max_target;
+    ab->target = sc_adaptive_buffering_clamp(ab, initial_target);
+    ab->jitter = 0;
+    ab->stable_windows = 0;
+
+    sc_adaptive_buffering_reset_window(ab);
+}
+
+void
+sc_adaptive_buffering_on_packet(struct sc_adaptive_buffering *ab, sc_tick now,
+                                sc_tick pts) {
+    sc_tick transit = now - pts;
+    if (!ab->has_transit) {
+        ab->min_transit = transit;
+        ab->max_transit = transit;
+        ab->has_transit = true;
+    } else if (transit < ab->min_transit) {
+        ab->min_transit = transit;
+    } else if (transit > ab->max_transit) {
+        ab->max_transit = transit;
+    }
+}
+
+void
+sc_adaptive_buffering_on_underflow(struct sc_adaptive_buffering *ab,
+                                   uint32_t samples) {
+    ab->underflow += samples;
+}
+
+bool
+sc_adaptive_buffering_update(struct sc_adaptive_buffering *ab) {
+    if (ab->has_transit) {
+        sc_tick spread = ab->max_transit - ab->min_transit;
+        uint64_t spread_samples = (uint64_t) spread * ab->sample_rate
+                                / SC_TICK_FREQ;
+        uint32_t jitter = MIN(spread_samples, UINT32_MAX);
+
+        if (jitter > ab->jitter) {
+            // Fast attack
+            ab->jitter = jitter;
+        } else {
+            // Slow release
+            ab->jitter = ((uint64_t) ab->jitter * 7 + jitter) / 8;
+        }
+    }
+
+    uint32_t needed = ab->jitter + TO_SAMPLES(SC_ADAPTIVE_BUFFERING_MARGIN_MS);
+
+    uint32_t target = ab->target;
+    if (ab->underflow) {
+        ab->stable_windows = 0;
+        target = MAX(target + TO_SAMPLES(SC_ADAPTIVE_BUFFERING_STEP_UP_MS),
+                     needed);
+    } else if (++ab->stable_windows >= SC_ADAPTIVE_BUFFERING_STABLE_WINDOWS) {
+        ab->stable_windows = 0;
+        uint32_t step = TO_SAMPLES(SC_ADAPTIVE_BUFFERING_STEP_DOWN_MS);
+        if (target > needed + step) {
+            target -= step;
+        } else if (target > needed) {
+            target = needed;
+        }
+    }
+
+    target = sc_adaptive_buffering_clamp(ab, target);
+    bool changed = target != ab->target;
+    if (changed) {
+        LOGI("[Audio] Adaptive buffering: target %" PRIu32 " -> %" PRIu32
+             " ms (jitter %" PRIu32 " ms, underflow %" PRIu32 " ms)",
+             TO_MS(ab->target), TO_MS(target), TO_MS(ab->jitter),
+             TO_MS(ab->underflow));
+        ab->target = target;
+    }
+
+    sc_adaptive_buffering_reset_window(ab);
+
+    return changed;
+}
@@ -0,0 +1,73 @@
+#ifndef SC_ADAPTIVE_BUFFERING_H
+#define SC_ADAPTIVE_BUFFERING_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+/**
+ * Estimator of the audio target buffering, adapted to the link
+ *
+ * The arrival jitter of the packets is measured as the spread of their transit
+ * time (system date of arrival minus device PTS) over windows of 1 second.
+ * The clock offset between the device and the computer is unknown, but it is
+ * the same for all packets, so the spread is not affected.
+ *
+ * At the end of each window:
+ *  - if an underflow occurred, the target is increased immediately;
+ *  - if the link has been stable for several windows, the target is
+ *    decreased slowly, but never below the smoothed jitter plus a margin.
+ *
+ * The target always stays within the configured bounds.
+ *
+ * All values are expressed in samples.
+ */
+struct sc_adaptive_buffering {
+    uint32_t sample_rate;
+    uint32_t min_target;
+    uint32_t max_target;
+    uint32_t target;
+
+    // Smoothed jitter (peak-to-peak), fast attack and slow release
+    uint32_t jitter;
+    // Number of consecutive windows without underflow
+    unsigned stable_windows;
+
+    // Current window
+    bool has_transit;
+    sc_tick min_transit;
+    sc_tick max_transit;
+    uint32_t underflow;
+};
+
+void
+sc_adaptive_buffering_init(struct sc_adaptive_buffering *ab,
+                           uint32_t sample_rate, uint32_t min_target,
+                           uint32_t max_target, uint32_t initial_target);
+
+/**
+ * Record the arrival of a packet at the system date `now`
+ */
+void
+sc_adaptive_buffering_on_packet(struct sc_adaptive_buffering *ab, sc_tick now,
+                                sc_tick pts);
+
+/**
+ * Record silence inserted because of a buffer underflow
+ */
+void
+sc_adaptive_buffering_on_underflow(struct sc_adaptive_buffering *ab,
+                                   uint32_t samples);
+
+/**
+ * End the current window (to be called every second)
+ *
+ * Return true if the target changed.
+ */
+bool
+sc_adaptive_buffering_update(struct sc_adaptive_buffering *ab);
+
+#endif
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "adb_client.h"
 #include "adb_device.h"
 #include "adb_parser.h"
 #include "util/env.h"
@@ -27,8 +28,43 @@
 
 static char *adb_executable;
 
+// Port of the adb server to send requests to directly, or 0 to always execute
+// the adb executable
+static uint16_t adb_server_port;
+
+static void
+sc_adb_init_server_port(void) {
+    adb_server_port = 0;
+
+    char *server_socket = sc_get_env("ADB_SERVER_SOCKET");
+    if (server_socket) {
+        // Custom adb server address, let the adb executable handle it
+        LOGD("ADB_SERVER_SOCKET is set, always execute adb");
+        free(server_socket);
+        return;
+    }
+
+    char *port = sc_get_env("ANDROID_ADB_SERVER_PORT");
+    if (!port) {
+        adb_server_port = SC_ADB_SERVER_PORT_DEFAULT;
+        return;
+    }
+
+    long value;
+    bool ok = sc_str_parse_integer(port, &value);
+    free(port);
+    if (!ok || value <= 0 || value > 0xFFFF) {
+        LOGD("Invalid ANDROID_ADB_SERVER_PORT, always execute adb");
+        return;
+    }
+
+    adb_server_port = value;
+}
+
 bool
 sc_adb_init(void) {
+    sc_adb_init_server_port();
+
     adb_executable = sc_get_env("ADB");
     if (adb_executable) {
         LOGD("Using adb: %s", adb_executable);
@@ -228,12 +264,57 @@ sc_adb_execute(const char *const argv[], unsigned flags) {
     return sc_adb_execute_p(argv, flags, NULL);
 }
 
+// Called when a request sent directly to the adb server failed. Return true if
+// the adb executable must be executed instead (the errors will be reported to
+// the user this way).
+static bool
+sc_adb_fallback(struct sc_intr *intr, const char *name) {
+    if (intr && sc_intr_is_interrupted(intr)) {
+        return false;
+    }
+
+    LOGD("Request to the adb server failed, executing \"%s\"", name);
+    return true;
+}
+
 bool
 sc_adb_start_server(struct sc_intr *intr, unsigned flags) {
+    uint32_t version;
+    if (adb_server_port
+            && sc_adb_client_get_version(intr, adb_server_port, &version)) {
+        // The adb server is already running, do not fork a process (this is
+        // most of the cold start time)
+        LOGD("adb server (version %" PRIu32 ") is running", version);
+        return true;
+    }
+
+    if (intr && sc_intr_is_interrupted(intr)) {
+        return false;
+    }
+
+    // The connection to the adb server was refused (or direct requests are
+    // disabled)
     const char *const argv[] = SC_ADB_COMMAND("start-server");
 
     sc_pid pid = sc_adb_execute(argv, flags);
-    return process_check_success_intr(intr, pid, "adb start-server", flags);
+    bool ok = process_check_success_intr(intr, pid, "adb start-server", flags);
+    if (!ok) {
+        return false;
+    }
+
+    if (adb_server_port) {
+        if (sc_adb_client_get_version(intr, adb_server_port, &version)) {
+            LOGD("adb server (version %" PRIu32 ") started", version);
+        } else if (!intr || !sc_intr_is_interrupted(intr)) {
+            // The server is not reachable on this port, do not try again for
+            // every request
+            LOGD("adb server not reachable on port %" PRIu16
+                 ", always execute adb", adb_server_port);
+            adb_server_port = 0;
+        }
+    }
+
+    return true;
 }
 
 bool
@@ -261,6 +342,15 @@ sc_adb_forward(struct sc_intr *intr, const char *serial, uint16_t local_port,
     }
 
     assert(serial);
+
+    if (adb_server_port) {
+        bool ok = sc_adb_client_forward(intr, adb_server_port, serial, local,
+                                        remote);
+        if (ok || !sc_adb_fallback(intr, "adb forward")) {
+            return ok;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "forward", local, remote);
 
@@ -277,6 +367,15 @@ sc_adb_forward_remove(struct sc_intr *intr, const char *serial,
     (void) r;
 
     assert(serial);
+
+    if (adb_server_port) {
+        bool ok = sc_adb_client_forward_remove(intr, adb_server_port, serial,
+                                               local);
+        if (ok || !sc_adb_fallback(intr, "adb forward --remove")) {
+            return ok;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "forward", "--remove", local);
 
@@ -301,6 +400,15 @@ sc_adb_reverse(struct sc_intr *intr, const char *serial,
     }
 
     assert(serial);
+
+    if (adb_server_port) {
+        bool ok = sc_adb_client_reverse(intr, adb_server_port, serial, remote,
+                                        local);
+        if (ok || !sc_adb_fallback(intr, "adb reverse")) {
+            return ok;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "reverse", remote, local);
 
@@ -320,6 +428,15 @@ sc_adb_reverse_remove(struct sc_intr *intr, const char *serial,
     }
 
     assert(serial);
+
+    if (adb_server_port) {
+        bool ok = sc_adb_client_reverse_remove(intr, adb_server_port, serial,
+                                               remote);
+        if (ok || !sc_adb_fallback(intr, "adb reverse --remove")) {
+            return ok;
+        }
+    }
+
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "reverse", "--remove", remote);
 
@@ -330,6 +447,17 @@ sc_adb_reverse_remove(struct sc_intr *intr, const char *serial,
 bool
 sc_adb_push(struct sc_intr *intr, const char *serial, const char *local,
             const char *remote, unsigned flags) {
+    assert(serial);
+
+    // Only single files are pushed directly (not directories)
+    if (adb_server_port && sc_file_is_regular(local)) {
+        bool ok = sc_adb_client_push(intr, adb_server_port, serial, local,
+                                     remote);
+        if (ok || !sc_adb_fallback(intr, "adb push")) {
+            return ok;
+        }
+    }
+
 #ifdef __WINDOWS__
     // Windows will parse the string, so the paths must be quoted
     // (see sys/win/command.c)
@@ -344,7 +472,6 @@ sc_adb_push(struct sc_intr *intr, const char *serial, const char *local,
     }
 #endif
 
-    assert(serial);
     const char *const argv[] =
         SC_ADB_COMMAND("-s", serial, "push", local, remote);
 
@@ -453,6 +580,19 @@ sc_adb_disconnect(struct sc_intr *intr, const char *ip_port, unsigned flags) {
 static bool
 sc_adb_list_devices(struct sc_intr *intr, unsigned flags,
                     struct sc_vec_adb_devices *out_vec) {
+    if (adb_server_port) {
+        char *list = sc_adb_client_list_devices(intr, adb_server_port);
+        if (list) {
+            bool ok = sc_adb_parse_device_list(list, out_vec);
+            free(list);
+            return ok;
+        }
+
+        if (!sc_adb_fallback(intr, "adb devices -l")) {
+            return false;
+        }
+    }
+
     const char *const argv[] = SC_ADB_COMMAND("devices", "-l");
 
 #define BUFSIZE 65536
@@ -699,27 +839,44 @@ char *
 sc_adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
                unsigned flags) {
     assert(serial);
-    const char *const argv[] =
-        SC_ADB_COMMAND("-s", serial, "shell", "getprop", prop);
-
-    sc_pipe pout;
-    sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
-    if (pid == SC_PROCESS_NONE) {
-        LOGE("Could not execute \"adb getprop\"");
-        return NULL;
-    }
 
     char buf[128];
-    ssize_t r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
-    sc_pipe_close(pout);
-
-    bool ok = process_check_success_intr(intr, pid, "adb getprop", flags);
-    if (!ok) {
-        return NULL;
+    ssize_t r = -1;
+
+    if (adb_server_port) {
+        char command[128];
+        int ret = snprintf(command, sizeof(command), "getprop %s", prop);
+        if (ret >= 0 && (size_t) ret < sizeof(command)) {
+            r = sc_adb_client_shell(intr, adb_server_port, serial, command,
+                                    buf, sizeof(buf) - 1);
+            if (r == -1 && !sc_adb_fallback(intr, "adb getprop")) {
+                return NULL;
+            }
+        }
     }
 
     if (r == -1) {
-        return NULL;
+        const char *const argv[] =
+            SC_ADB_COMMAND("-s", serial, "shell", "getprop", prop);
+
+        sc_pipe pout;
+        sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
+        if (pid == SC_PROCESS_NONE) {
+            LOGE("Could not execute \"adb getprop\"");
+            return NULL;
+        }
+
+        r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
+        sc_pipe_close(pout);
+
+        bool ok = process_check_success_intr(intr, pid, "adb getprop", flags);
+        if (!ok) {
+            return NULL;
+        }
+
+        if (r == -1) {
+            return NULL;
+        }
     }
 
     assert((size_t) r < sizeof(buf));
@@ -733,28 +890,41 @@ sc_adb_getprop(struct sc_intr *intr, const char *serial, const char *prop,
 char *
 sc_adb_get_device_ip(struct sc_intr *intr, const char *serial, unsigned flags) {
     assert(serial);
-    const char *const argv[] =
-        SC_ADB_COMMAND("-s", serial, "shell", "ip", "route");
-
-    sc_pipe pout;
-    sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
-    if (pid == SC_PROCESS_NONE) {
-        LOGD("Could not execute \"ip route\"");
-        return NULL;
-    }
 
     // "adb shell ip route" output should contain only a few lines
     char buf[1024];
-    ssize_t r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
-    sc_pipe_close(pout);
+    ssize_t r = -1;
 
-    bool ok = process_check_success_intr(intr, pid, "ip route", flags);
-    if (!ok) {
-        return NULL;
+    if (adb_server_port) {
+        r = sc_adb_client_shell(intr, adb_server_port, serial, "ip route", buf,
+                                sizeof(buf) - 1);
+        if (r == -1 && !sc_adb_fallback(intr, "ip route")) {
+            return NULL;
+        }
     }
 
     if (r == -1) {
-        return NULL;
+        const char *const argv[] =
+            SC_ADB_COMMAND("-s", serial, "shell", "ip", "route");
+
+        sc_pipe pout;
+        sc_pid pid = sc_adb_execute_p(argv, flags, &pout);
+        if (pid == SC_PROCESS_NONE) {
+            LOGD("Could not execute \"ip route\"");
+            return NULL;
+        }
+
+        r = sc_pipe_read_all_intr(intr, pid, pout, buf, sizeof(buf) - 1);
+        sc_pipe_close(pout);
+
+        bool ok = process_check_success_intr(intr, pid, "ip route", flags);
+        if (!ok) {
+            return NULL;
+        }
+
+        if (r == -1) {
+            return NULL;
+        }
     }
 
     assert((size_t) r < sizeof(buf));
@@ -0,0 +1,510 @@
+#include "adb_client.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+#include "util/net_intr.h"
+
+// Max length of a request (the adb server accepts up to 4096 bytes)
+#define SC_ADB_CLIENT_MAX_REQUEST 1024
+
+// Max size of a DATA chunk in the sync protocol
+#define SC_ADB_SYNC_DATA_MAX (64 * 1024)
+
+// Regular file with permissions 0644
+#define SC_ADB_SYNC_PUSH_MODE 0100644
+
+static ssize_t
+sc_adb_client_send_all(struct sc_intr *intr, sc_socket socket, const void *buf,
+                       size_t len) {
+    return intr ? net_send_all_intr(intr, socket, buf, len)
+                : net_send_all(socket, buf, len);
+}
+
+static bool
+sc_adb_client_recv_all(struct sc_intr *intr, sc_socket socket, void *buf,
+                       size_t len) {
+    ssize_t r = intr ? net_recv_all_intr(intr, socket, buf, len)
+                     : net_recv_all(socket, buf, len);
+    return r == (ssize_t) len;
+}
+
+static sc_socket
+sc_adb_client_connect(uint16_t port) {
+    sc_socket socket = net_socket();
+    if (socket == SC_SOCKET_NONE) {
+        return SC_SOCKET_NONE;
+    }
+
+    // The adb server may not be running, this is not an error
+    bool ok = net_try_connect(socket, IPV4_LOCALHOST, port);
+    if (!ok) {
+        LOGD("Could not connect to the adb server on port %" PRIu16, port);
+        net_close(socket);
+        return SC_SOCKET_NONE;
+    }
+
+    return socket;
+}
+
+static bool
+sc_adb_client_send_request(struct sc_intr *intr, sc_socket socket,
+                           const char *request) {
+    size_t len = strlen(request);
+    assert(len < SC_ADB_CLIENT_MAX_REQUEST);
+
+    char buf[4 + SC_ADB_CLIENT_MAX_REQUEST];
+    int r = snprintf(buf, sizeof(buf), "%04x%s", (unsigned) len, request);
+    assert(r == (int) (4 + len));
+    (void) r;
+
+    return sc_adb_client_send_all(intr, socket, buf, 4 + len)
+            == (ssize_t) (4 + len);
+}
+
+static bool
+sc_adb_client_parse_hex4(const char *s, uint16_t *out) {
+    uint16_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = s[i];
+        unsigned digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+
+    *out = value;
+    return true;
+}
+
+// Read a string prefixed by its length (4 hexadecimal digits)
+static char *
+sc_adb_client_read_string(struct sc_intr *intr, sc_socket socket) {
+    char hex[4];
+    uint16_t len;
+    if (!sc_adb_client_recv_all(intr, socket, hex, sizeof(hex))
+            || !sc_adb_client_parse_hex4(hex, &len)) {
+        return NULL;
+    }
+
+    char *s = malloc(len + 1);
+    if (!s) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    if (len && !sc_adb_client_recv_all(intr, socket, s, len)) {
+        free(s);
+        return NULL;
+    }
+
+    s[len] = '\0';
+    return s;
+}
+
+// Read "OKAY" or "FAIL" (followed by the error message)
+static bool
+sc_adb_client_read_status(struct sc_intr *intr, sc_socket socket) {
+    char status[4];
+    if (!sc_adb_client_recv_all(intr, socket, status, sizeof(status))) {
+        return false;
+    }
+
+    if (!memcmp(status, "OKAY", 4)) {
+        return true;
+    }
+
+    if (!memcmp(status, "FAIL", 4)) {
+        char *msg = sc_adb_client_read_string(intr, socket);
+        if (msg) {
+            LOGD("adb server error: %s", msg);
+            free(msg);
+        }
+    } else {
+        LOGD("Unexpected adb server status: %.4s", status);
+    }
+
+    return false;
+}
+
+// Send the request and read its status
+static bool
+sc_adb_client_request(struct sc_intr *intr, sc_socket socket,
+                      const char *request) {
+    return sc_adb_client_send_request(intr, socket, request)
+        && sc_adb_client_read_status(intr, socket);
+}
+
+// Connect and execute a request on the adb server, which replies twice: once
+// when the request is accepted, once when it is executed
+static bool
+sc_adb_client_execute(struct sc_intr *intr, uint16_t port,
+                      const char *request) {
+    sc_socket socket = sc_adb_client_connect(port);
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    bool ok = sc_adb_client_request(intr, socket, request)
+           && sc_adb_client_read_status(intr, socket);
+
+    net_close(socket);
+    return ok;
+}
+
+// Connect and redirect the connection to the device `serial`, so that the
+// next requests are sent to the device (adbd)
+static sc_socket
+sc_adb_client_open_transport(struct sc_intr *intr, uint16_t port,
+                             const char *serial) {
+    char request[SC_ADB_CLIENT_MAX_REQUEST];
+    int r = snprintf(request, sizeof(request), "host:transport:%s", serial);
+    if (r < 0 || (size_t) r >= sizeof(request)) {
+        return SC_SOCKET_NONE;
+    }
+
+    sc_socket socket = sc_adb_client_connect(port);
+    if (socket == SC_SOCKET_NONE) {
+        return SC_SOCKET_NONE;
+    }
+
+    if (!sc_adb_client_request(intr, socket, request)) {
+        net_close(socket);
+        return SC_SOCKET_NONE;
+    }
+
+    return socket;
+}
+
+bool
+sc_adb_client_get_version(struct sc_intr *intr, uint16_t port,
+                          uint32_t *version) {
+    sc_socket socket = sc_adb_client_connect(port);
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    char *result = NULL;
+    if (sc_adb_client_request(intr, socket, "host:version")) {
+        result = sc_adb_client_read_string(intr, socket);
+    }
+
+    net_close(socket);
+
+    if (!result) {
+        return false;
+    }
+
+    uint16_t value;
+    bool ok = strlen(result) == 4 && sc_adb_client_parse_hex4(result, &value);
+    free(result);
+    if (!ok) {
+        return false;
+    }
+
+    *version = value;
+    return true;
+}
+
+char *
+sc_adb_client_list_devices(struct sc_intr *intr, uint16_t port) {
+    sc_socket socket = sc_adb_client_connect(port);
+    if (socket == SC_SOCKET_NONE) {
+        return NULL;
+    }
+
+    char *result = NULL;
+    if (sc_adb_client_request(intr, socket, "host:devices-l")) {
+        result = sc_adb_client_read_string(intr, socket);
+    }
+
+    net_close(socket);
+    return result;
+}
+
+bool
+sc_adb_client_forward(struct sc_intr *intr, uint16_t port, const char *serial,
+                      const char *local, const char *remote) {
+    char request[SC_ADB_CLIENT_MAX_REQUEST];
+    int r = snprintf(request, sizeof(request), "host-serial:%s:forward:%s;%s",
+                     serial, local, remote);
+    if (r < 0 || (size_t) r >= sizeof(request)) {
+        return false;
+    }
+
+    return sc_adb_client_execute(intr, port, request);
+}
+
+bool
+sc_adb_client_forward_remove(struct sc_intr *intr, uint16_t port,
+                             const char *serial, const char *local) {
+    char request[SC_ADB_CLIENT_MAX_REQUEST];
+    int r = snprintf(request, sizeof(request), "host-serial:%s:killforward:%s",
+                     serial, local);
+    if (r < 0 || (size_t) r >= sizeof(request)) {
+        return false;
+    }
+
+    return sc_adb_client_execute(intr, port, request);
+}
+
+// Execute a "reverse:" request on the device
+static bool
+sc_adb_client_reverse_request(struct sc_intr *intr, uint16_t port,
+                              const char *serial, const char *request) {
+    sc_socket socket = sc_adb_client_open_transport(intr, port, serial);
+    if (socket == SC_SOCKET_NONE) {
+        return false;
+    }
+
+    // Like the host requests, the reverse service replies twice
+    bool ok = sc_adb_client_request(intr, socket, request)
+           && sc_adb_client_read_status(intr, socket);
+
+    net_close(socket);
+    return ok;
+}
+
+bool
+sc_adb_client_reverse(struct sc_intr *intr, uint16_t port, const char *serial,
+                      const char *remote, const char *local) {
+    char request[SC_ADB_CLIENT_MAX_REQUEST];
+    int r = snprintf(request, sizeof(request), "reverse:forward:%s;%s", remote,
+                     local);
+    if (r < 0 || (size_t) r >= sizeof(request)) {
+        return false;
+    }
+
+    return sc_adb_client_reverse_request(intr, port, serial, request);
+}
+
+bool
+sc_adb_client_reverse_remove(struct sc_intr *intr, uint16_t port,
+                             const char *serial, const char *remote) {
+    char request[SC_ADB_CLIENT_MAX_REQUEST];
+    int r = snprintf(request, sizeof(request), "reverse:killforward:%s",
+                     remote);
+    if (r < 0 || (size_t) r >= sizeof(request)) {
+        return false;
+    }
+
+    return sc_adb_client_reverse_request(intr, port, serial, request);
+}
+
+// Send a sync request: id (4 bytes), value (32-bit little-endian, the data
+// length or the modification time), then `len` bytes of data (which must
+// already be written at buf + 8)
+static bool
+sc_adb_client_sync_send(struct sc_intr *intr, sc_socket socket, uint8_t *buf,
+                        const char *id, uint32_t value, size_t len) {
+    memcpy(buf, id, 4);
+    sc_write32le(&buf[4], value);
+    return sc_adb_client_send_all(intr, socket, buf, 8 + len)
+            == (ssize_t) (8 + len);
+}
+
+static const char *
+sc_adb_client_basename(const char *path) {
+    const char *name = strrchr(path, '/');
+#ifdef __WINDOWS__
+    const char *name2 = strrchr(path, '\\');
+    if (name2 && (!name || name2 > name)) {
+        name = name2;
+    }
+#endif
+    return name ? name + 1 : path;
+}
+
+static bool
+sc_adb_client_sync_push(struct sc_intr *intr, sc_socket socket, FILE *file,
+                        const char *local, const char *remote, uint8_t *buf) {
+    // Like "adb push", push into the directory if the remote path ends with
+    // '/'
+    size_t remote_len = strlen(remote);
+    bool dir = remote_len && remote[remote_len - 1] == '/';
+    const char *name = dir ? sc_adb_client_basename(local) : "";
+
+    // SEND <remote>,<mode>
+    int r = snprintf((char *) &buf[8], SC_ADB_CLIENT_MAX_REQUEST, "%s%s,%d",
+                     remote, name, SC_ADB_SYNC_PUSH_MODE);
+    if (r < 0 || r >= SC_ADB_CLIENT_MAX_REQUEST) {
+        return false;
+    }
+    if (!sc_adb_client_sync_send(intr, socket, buf, "SEND", r, r)) {
+        return false;
+    }
+
+    for (;;) {
+        size_t n = fread(&buf[8], 1, SC_ADB_SYNC_DATA_MAX, file);
+        if (n) {
+            if (!sc_adb_client_sync_send(intr, socket, buf, "DATA", n, n)) {
+                return false;
+            }
+        }
+        if (n < SC_ADB_SYNC_DATA_MAX) {
+            if (ferror(file)) {
+                LOGD("Could not read file to push");
+                return false;
+            }
+            // EOF
+            break;
+        }
+    }
+
+    // DONE <mtime>
+    uint32_t mtime = time(NULL);
+    if (!sc_adb_client_sync_send(intr, socket, buf, "DONE", mtime, 0)) {
+        return false;
+    }
+
+    uint8_t resp[8];
+    if (!sc_adb_client_recv_all(intr, socket, resp, sizeof(resp))) {
+        return false;
+    }
+
+    uint32_t len = sc_read32le(&resp[4]);
+    if (!memcmp(resp, "OKAY", 4)) {
+        // QUIT
+        return sc_adb_client_sync_send(intr, socket, buf, "QUIT", 0, 0);
+    }
+
+    if (!memcmp(resp, "FAIL", 4) && len < SC_ADB_SYNC_DATA_MAX
+            && sc_adb_client_recv_all(intr, socket, buf, len)) {
+        LOGD("adb sync error: %.*s", (int) len, (char *) buf);
+    }
+
+    return false;
+}
+
+bool
+sc_adb_client_push(struct sc_intr *intr, uint16_t port, const char *serial,
+                   const char *local, const char *remote) {
+    FILE *file = fopen(local, "rb");
+    if (!file) {
+        LOGD("Could not open %s", local);
+        return false;
+    }
+
+    uint8_t *buf = malloc(8 + SC_ADB_SYNC_DATA_MAX);
+    if (!buf) {
+        LOG_OOM();
+        fclose(file);
+        return false;
+    }
+
+    bool ok = false;
+
+    sc_socket socket = sc_adb_client_open_transport(intr, port, serial);
+    if (socket == SC_SOCKET_NONE) {
+        goto end;
+    }
+
+    if (sc_adb_client_request(intr, socket, "sync:")) {
+        ok = sc_adb_client_sync_push(intr, socket, file, local, remote, buf);
+    }
+
+    net_close(socket);
+
+end:
+    free(buf);
+    fclose(file);
+    return ok;
+}
+
+// Packet ids of the shell v2 protocol
+#define SC_ADB_SHELL_ID_STDOUT 1
+#define SC_ADB_SHELL_ID_STDERR 2
+#define SC_ADB_SHELL_ID_EXIT 3
+
+ssize_t
+sc_adb_client_shell(struct sc_intr *intr, uint16_t port, const char *serial,
+                    const char *command, char *buf, size_t len) {
+    // Use the shell v2 protocol, to separate stdout from stderr and to get the
+    // exit status (the legacy "shell:" service provides neither)
+    char request[SC_ADB_CLIENT_MAX_REQUEST];
+    int r = snprintf(request, sizeof(request), "shell,v2,raw:%s", command);
+    if (r < 0 || (size_t) r >= sizeof(request)) {
+        return -1;
+    }
+
+    sc_socket socket = sc_adb_client_open_transport(intr, port, serial);
+    if (socket == SC_SOCKET_NONE) {
+        return -1;
+    }
+
+    if (!sc_adb_client_request(intr, socket, request)) {
+        net_close(socket);
+        return -1;
+    }
+
+    // Each packet is an id (1 byte), a length (32-bit little-endian), then the
+    // data. The output beyond `len` bytes is discarded.
+    size_t total = 0;
+    for (;;) {
+        uint8_t header[5];
+        if (!sc_adb_client_recv_all(intr, socket, header, sizeof(header))) {
+            // The exit packet was not received
+            goto error;
+        }
+
+        uint8_t id = header[0];
+        uint32_t packet_len = sc_read32le(&header[1]);
+
+        if (id == SC_ADB_SHELL_ID_EXIT) {
+            uint8_t status;
+            if (packet_len != 1
+                    || !sc_adb_client_recv_all(intr, socket, &status, 1)) {
+                goto error;
+            }
+            if (status) {
+                LOGD("\"%s\" returned with value %" PRIu8, command, status);
+                goto error;
+            }
+            break;
+        }
+
+        while (packet_len) {
+            char discard[256];
+            char *dst;
+            size_t chunk;
+            if (id == SC_ADB_SHELL_ID_STDOUT && total < len) {
+                dst = buf + total;
+                chunk = MIN(packet_len, len - total);
+            } else {
+                // stderr, other packets, or output which does not fit
+                dst = discard;
+                chunk = MIN(packet_len, sizeof(discard));
+            }
+
+            if (!sc_adb_client_recv_all(intr, socket, dst, chunk)) {
+                goto error;
+            }
+
+            if (dst != discard) {
+                total += chunk;
+            } else if (id == SC_ADB_SHELL_ID_STDERR) {
+                LOGD("\"%s\" stderr: %.*s", command, (int) chunk, dst);
+            }
+            packet_len -= chunk;
+        }
+    }
+
+    net_close(socket);
+    return total;
+
+error:
+    net_close(socket);
+    return -1;
+}
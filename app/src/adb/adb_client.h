@@ -0,0 +1,97 @@
+#ifndef SC_ADB_CLIENT_H
+#define SC_ADB_CLIENT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/intr.h"
+
+#define SC_ADB_SERVER_PORT_DEFAULT 5037
+
+/**
+ * Client for the adb server
+ *
+ * Send requests directly to the adb server (on localhost) using its "smart
+ * socket" protocol, instead of executing the adb executable (which is itself a
+ * client of the adb server). This avoids to spawn a process for each request.
+ *
+ * A request is sent as its length (4 hexadecimal digits) followed by its
+ * content. The server replies "OKAY", or "FAIL" followed by a length-prefixed
+ * error message.
+ *
+ * These functions do not log errors (except at debug level): on failure, the
+ * caller is expected to execute the equivalent adb command, which reports the
+ * errors to the user.
+ *
+ * Blocking calls may be interrupted asynchronously via `intr` (which may be
+ * NULL).
+ */
+
+/**
+ * Request the adb server version (`host:version`)
+ *
+ * This succeeds only if the adb server is running.
+ */
+bool
+sc_adb_client_get_version(struct sc_intr *intr, uint16_t port,
+                          uint32_t *version);
+
+/**
+ * Request the devices list (`host:devices-l`)
+ *
+ * The result has the same format as the output of `adb devices -l`, without
+ * the header line. It is a NUL-terminated string, to be freed by the caller.
+ */
+char *
+sc_adb_client_list_devices(struct sc_intr *intr, uint16_t port);
+
+/**
+ * Equivalent to `adb -s <serial> forward <local> <remote>`
+ */
+bool
+sc_adb_client_forward(struct sc_intr *intr, uint16_t port, const char *serial,
+                      const char *local, const char *remote);
+
+/**
+ * Equivalent to `adb -s <serial> forward --remove <local>`
+ */
+bool
+sc_adb_client_forward_remove(struct sc_intr *intr, uint16_t port,
+                             const char *serial, const char *local);
+
+/**
+ * Equivalent to `adb -s <serial> reverse <remote> <local>`
+ */
+bool
+sc_adb_client_reverse(struct sc_intr *intr, uint16_t port, const char *serial,
+                      const char *remote, const char *local);
+
+/**
+ * Equivalent to `adb -s <serial> reverse --remove <remote>`
+ */
+bool
+sc_adb_client_reverse_remove(struct sc_intr *intr, uint16_t port,
+                             const char *serial, const char *remote);
+
+/**
+ * Equivalent to `adb -s <serial> push <local> <remote>` for a single file
+ */
+bool
+sc_adb_client_push(struct sc_intr *intr, uint16_t port, const char *serial,
+                   const char *local, const char *remote);
+
+/**
+ * Equivalent to `adb -s <serial> shell <command>`, reading at most `len` bytes
+ * of the output (stdout only) into `buf`
+ *
+ * Return the number of bytes read, or -1 on error (including if the command
+ * returned a non-zero exit status, or if the device does not support the shell
+ * v2 protocol).
+ */
+ssize_t
+sc_adb_client_shell(struct sc_intr *intr, uint16_t port, const char *serial,
+                    const char *command, char *buf, size_t len);
+
+#endif
@@ -109,11 +109,12 @@ sc_adb_parse_device(char *line, struct sc_adb_device *device) {
     return true;
 }
 
-bool
-sc_adb_parse_devices(char *str, struct sc_vec_adb_devices *out_vec) {
+static bool
+sc_adb_parse_devices_internal(char *str, bool expect_header,
+                              struct sc_vec_adb_devices *out_vec) {
 #define HEADER "List of devices attached"
 #define HEADER_LEN (sizeof(HEADER) - 1)
-    bool header_found = false;
+    bool header_found = !expect_header;
 
     size_t idx_line = 0;
     while (str[idx_line] != '\0') {
@@ -161,6 +162,16 @@ sc_adb_parse_devices(char *str, struct sc_vec_adb_devices *out_vec) {
     return header_found;
 }
 
+bool
+sc_adb_parse_devices(char *str, struct sc_vec_adb_devices *out_vec) {
+    return sc_adb_parse_devices_internal(str, true, out_vec);
+}
+
+bool
+sc_adb_parse_device_list(char *str, struct sc_vec_adb_devices *out_vec) {
+    return sc_adb_parse_devices_internal(str, false, out_vec);
+}
+
 static char *
 sc_adb_parse_device_ip_from_line(char *line) {
     // One line from "ip route" looks like:
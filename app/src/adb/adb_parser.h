@@ -17,6 +17,17 @@
 bool
 sc_adb_parse_devices(char *str, struct sc_vec_adb_devices *out_vec);
 
+/**
+ * Parse the available devices from the result of a `host:devices-l` request
+ * to the adb server (same as `adb devices -l`, without header)
+ *
+ * The parameter must be a NUL-terminated string.
+ *
+ * Warning: this function modifies the buffer for optimization purposes.
+ */
+bool
+sc_adb_parse_device_list(char *str, struct sc_vec_adb_devices *out_vec);
+
 /**
  * Parse the ip from the output of `adb shell ip route`
  *
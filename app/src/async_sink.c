@@ -0,0 +1,478 @@
+#include "async_sink.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <libavcodec/avcodec.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_async_frame_sink */
+#define DOWNCAST_FRAME(SINK) \
+    container_of(SINK, struct sc_async_frame_sink, frame_sink)
+/** Downcast packet_sink to sc_async_packet_sink */
+#define DOWNCAST_PACKET(SINK) \
+    container_of(SINK, struct sc_async_packet_sink, packet_sink)
+
+static void
+sc_async_sink_stats_reset(struct sc_async_sink_stats *stats) {
+    stats->pushed = 0;
+    stats->dropped = 0;
+    stats->queue_time_total = 0;
+    stats->queue_time_max = 0;
+    stats->max_queued = 0;
+}
+
+static void
+sc_async_sink_stats_on_pop(struct sc_async_sink_stats *stats,
+                           sc_tick queue_time) {
+    stats->queue_time_total += queue_time;
+    if (queue_time > stats->queue_time_max) {
+        stats->queue_time_max = queue_time;
+    }
+}
+
+static void
+sc_async_sink_stats_log(struct sc_async_sink_stats *stats, const char *name) {
+    uint64_t popped = stats->pushed - stats->dropped;
+    sc_tick avg = popped ? stats->queue_time_total / (sc_tick) popped : 0;
+    LOGD("Async sink %s: %" PRIu64 " pushed, %" PRIu64 " dropped, "
+         "max queued %u, queue time avg %" PRItick " us, max %" PRItick " us",
+         name, stats->pushed, stats->dropped, stats->max_queued,
+         SC_TICK_TO_US(avg), SC_TICK_TO_US(stats->queue_time_max));
+}
+
+static int
+run_async_frame_sink(void *data) {
+    struct sc_async_frame_sink *afs = data;
+
+    for (;;) {
+        sc_mutex_lock(&afs->mutex);
+
+        while (!afs->stopped && !afs->count) {
+            sc_cond_wait(&afs->cond, &afs->mutex);
+        }
+
+        if (afs->stopped) {
+            sc_mutex_unlock(&afs->mutex);
+            break;
+        }
+
+        unsigned index = afs->head;
+        av_frame_move_ref(afs->frame, afs->frames[index]);
+        sc_async_sink_stats_on_pop(&afs->stats,
+                                   sc_tick_now() - afs->push_dates[index]);
+        afs->head = (afs->head + 1) % afs->capacity;
+        --afs->count;
+
+        sc_mutex_unlock(&afs->mutex);
+
+        bool ok = sc_frame_source_sinks_push(&afs->frame_source, afs->frame);
+        av_frame_unref(afs->frame);
+        if (!ok) {
+            LOGE("Async sink %s: could not push frame", afs->name);
+            sc_mutex_lock(&afs->mutex);
+            afs->failed = true;
+            sc_mutex_unlock(&afs->mutex);
+            break;
+        }
+    }
+
+    LOGD("Async sink %s: thread ended", afs->name);
+
+    return 0;
+}
+
+static void
+sc_async_frame_sink_free_frames(struct sc_async_frame_sink *afs,
+                                unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+        av_frame_free(&afs->frames[i]);
+    }
+}
+
+static bool
+sc_async_frame_sink_open(struct sc_frame_sink *sink,
+                         const AVCodecContext *ctx) {
+    struct sc_async_frame_sink *afs = DOWNCAST_FRAME(sink);
+
+    for (unsigned i = 0; i < afs->capacity; ++i) {
+        afs->frames[i] = av_frame_alloc();
+        if (!afs->frames[i]) {
+            LOG_OOM();
+            sc_async_frame_sink_free_frames(afs, i);
+            return false;
+        }
+    }
+
+    afs->frame = av_frame_alloc();
+    if (!afs->frame) {
+        LOG_OOM();
+        goto error_free_frames;
+    }
+
+    bool ok = sc_mutex_init(&afs->mutex);
+    if (!ok) {
+        goto error_free_frame;
+    }
+
+    ok = sc_cond_init(&afs->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    ok = sc_frame_source_sinks_open(&afs->frame_source, ctx);
+    if (!ok) {
+        goto error_cond_destroy;
+    }
+
+    afs->head = 0;
+    afs->count = 0;
+    afs->stopped = false;
+    afs->failed = false;
+    sc_async_sink_stats_reset(&afs->stats);
+
+    ok = sc_thread_create(&afs->thread, run_async_frame_sink, "scrcpy-async",
+                          afs);
+    if (!ok) {
+        LOGE("Could not start async sink thread");
+        goto error_close_sinks;
+    }
+
+    return true;
+
+error_close_sinks:
+    sc_frame_source_sinks_close(&afs->frame_source);
+error_cond_destroy:
+    sc_cond_destroy(&afs->cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&afs->mutex);
+error_free_frame:
+    av_frame_free(&afs->frame);
+error_free_frames:
+    sc_async_frame_sink_free_frames(afs, afs->capacity);
+
+    return false;
+}
+
+static void
+sc_async_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_async_frame_sink *afs = DOWNCAST_FRAME(sink);
+
+    sc_mutex_lock(&afs->mutex);
+    afs->stopped = true;
+    sc_cond_signal(&afs->cond);
+    sc_mutex_unlock(&afs->mutex);
+
+    sc_thread_join(&afs->thread, NULL);
+
+    sc_frame_source_sinks_close(&afs->frame_source);
+
+    sc_async_sink_stats_log(&afs->stats, afs->name);
+
+    // Unreference the frames which have not been consumed
+    while (afs->count) {
+        av_frame_unref(afs->frames[afs->head]);
+        afs->head = (afs->head + 1) % afs->capacity;
+        --afs->count;
+    }
+
+    sc_cond_destroy(&afs->cond);
+    sc_mutex_destroy(&afs->mutex);
+    av_frame_free(&afs->frame);
+    sc_async_frame_sink_free_frames(afs, afs->capacity);
+}
+
+static bool
+sc_async_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct sc_async_frame_sink *afs = DOWNCAST_FRAME(sink);
+
+    sc_mutex_lock(&afs->mutex);
+
+    if (afs->failed) {
+        sc_mutex_unlock(&afs->mutex);
+        return false;
+    }
+
+    if (afs->count == afs->capacity) {
+        // The sink is too slow, drop the oldest frame
+        av_frame_unref(afs->frames[afs->head]);
+        afs->head = (afs->head + 1) % afs->capacity;
+        --afs->count;
+        ++afs->stats.dropped;
+    }
+
+    unsigned index = (afs->head + afs->count) % afs->capacity;
+    if (av_frame_ref(afs->frames[index], frame)) {
+        sc_mutex_unlock(&afs->mutex);
+        LOG_OOM();
+        return false;
+    }
+
+    afs->push_dates[index] = sc_tick_now();
+    ++afs->count;
+    ++afs->stats.pushed;
+    if (afs->count > afs->stats.max_queued) {
+        afs->stats.max_queued = afs->count;
+    }
+
+    sc_cond_signal(&afs->cond);
+    sc_mutex_unlock(&afs->mutex);
+
+    return true;
+}
+
+static struct sc_frame_source *
+sc_async_frame_sink_get_frame_source(struct sc_frame_sink *sink) {
+    struct sc_async_frame_sink *afs = DOWNCAST_FRAME(sink);
+    return &afs->frame_source;
+}
+
+void
+sc_async_frame_sink_init(struct sc_async_frame_sink *afs, const char *name,
+                         unsigned capacity) {
+    assert(capacity && capacity <= SC_ASYNC_SINK_MAX_CAPACITY);
+
+    afs->name = name;
+    afs->capacity = capacity;
+
+    sc_frame_source_init(&afs->frame_source);
+
+    static const struct sc_frame_sink_ops ops = {
+        .name = "async",
+        .get_frame_source = sc_async_frame_sink_get_frame_source,
+        .open = sc_async_frame_sink_open,
+        .close = sc_async_frame_sink_close,
+        .push = sc_async_frame_sink_push,
+    };
+
+    afs->frame_sink.ops = &ops;
+}
+
+static int
+run_async_packet_sink(void *data) {
+    struct sc_async_packet_sink *aps = data;
+
+    for (;;) {
+        sc_mutex_lock(&aps->mutex);
+
+        while (!aps->stopped && !aps->count) {
+            sc_cond_wait(&aps->queue_cond, &aps->mutex);
+        }
+
+        if (aps->stopped) {
+            sc_mutex_unlock(&aps->mutex);
+            break;
+        }
+
+        unsigned index = aps->head;
+        av_packet_move_ref(aps->packet, aps->packets[index]);
+        sc_async_sink_stats_on_pop(&aps->stats,
+                                   sc_tick_now() - aps->push_dates[index]);
+        aps->head = (aps->head + 1) % aps->capacity;
+        --aps->count;
+        sc_cond_signal(&aps->space_cond);
+
+        sc_mutex_unlock(&aps->mutex);
+
+        bool ok = sc_packet_source_sinks_push(&aps->packet_source,
+                                              aps->packet);
+        av_packet_unref(aps->packet);
+        if (!ok) {
+            LOGE("Async sink %s: could not push packet", aps->name);
+            sc_mutex_lock(&aps->mutex);
+            aps->failed = true;
+            // Wake up a producer waiting for space
+            sc_cond_signal(&aps->space_cond);
+            sc_mutex_unlock(&aps->mutex);
+            break;
+        }
+    }
+
+    LOGD("Async sink %s: thread ended", aps->name);
+
+    return 0;
+}
+
+static void
+sc_async_packet_sink_free_packets(struct sc_async_packet_sink *aps,
+                                  unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+        av_packet_free(&aps->packets[i]);
+    }
+}
+
+static bool
+sc_async_packet_sink_open(struct sc_packet_sink *sink, AVCodecContext *ctx) {
+    struct sc_async_packet_sink *aps = DOWNCAST_PACKET(sink);
+
+    for (unsigned i = 0; i < aps->capacity; ++i) {
+        aps->packets[i] = av_packet_alloc();
+        if (!aps->packets[i]) {
+            LOG_OOM();
+            sc_async_packet_sink_free_packets(aps, i);
+            return false;
+        }
+    }
+
+    aps->packet = av_packet_alloc();
+    if (!aps->packet) {
+        LOG_OOM();
+        goto error_free_packets;
+    }
+
+    bool ok = sc_mutex_init(&aps->mutex);
+    if (!ok) {
+        goto error_free_packet;
+    }
+
+    ok = sc_cond_init(&aps->queue_cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    ok = sc_cond_init(&aps->space_cond);
+    if (!ok) {
+        goto error_queue_cond_destroy;
+    }
+
+    ok = sc_packet_source_sinks_open(&aps->packet_source, ctx);
+    if (!ok) {
+        goto error_space_cond_destroy;
+    }
+
+    aps->head = 0;
+    aps->count = 0;
+    aps->stopped = false;
+    aps->failed = false;
+    sc_async_sink_stats_reset(&aps->stats);
+
+    ok = sc_thread_create(&aps->thread, run_async_packet_sink, "scrcpy-async",
+                          aps);
+    if (!ok) {
+        LOGE("Could not start async sink thread");
+        goto error_close_sinks;
+    }
+
+    return true;
+
+error_close_sinks:
+    sc_packet_source_sinks_close(&aps->packet_source);
+error_space_cond_destroy:
+    sc_cond_destroy(&aps->space_cond);
+error_queue_cond_destroy:
+    sc_cond_destroy(&aps->queue_cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&aps->mutex);
+error_free_packet:
+    av_packet_free(&aps->packet);
+error_free_packets:
+    sc_async_packet_sink_free_packets(aps, aps->capacity);
+
+    return false;
+}
+
+static void
+sc_async_packet_sink_close(struct sc_packet_sink *sink) {
+    struct sc_async_packet_sink *aps = DOWNCAST_PACKET(sink);
+
+    // Let the sink consume the remaining packets (a recorder must not lose
+    // the end of the stream)
+    sc_mutex_lock(&aps->mutex);
+    while (aps->count && !aps->failed) {
+        sc_cond_wait(&aps->space_cond, &aps->mutex);
+    }
+    aps->stopped = true;
+    sc_cond_signal(&aps->queue_cond);
+    sc_mutex_unlock(&aps->mutex);
+
+    sc_thread_join(&aps->thread, NULL);
+
+    sc_packet_source_sinks_close(&aps->packet_source);
+
+    sc_async_sink_stats_log(&aps->stats, aps->name);
+
+    while (aps->count) {
+        av_packet_unref(aps->packets[aps->head]);
+        aps->head = (aps->head + 1) % aps->capacity;
+        --aps->count;
+    }
+
+    sc_cond_destroy(&aps->space_cond);
+    sc_cond_destroy(&aps->queue_cond);
+    sc_mutex_destroy(&aps->mutex);
+    av_packet_free(&aps->packet);
+    sc_async_packet_sink_free_packets(aps, aps->capacity);
+}
+
+static bool
+sc_async_packet_sink_push(struct sc_packet_sink *sink,
+                          const AVPacket *packet) {
+    struct sc_async_packet_sink *aps = DOWNCAST_PACKET(sink);
+
+    sc_mutex_lock(&aps->mutex);
+
+    // Packets must not be dropped, wait for the sink to consume
+    while (!aps->failed && aps->count == aps->capacity) {
+        sc_cond_wait(&aps->space_cond, &aps->mutex);
+    }
+
+    if (aps->failed) {
+        sc_mutex_unlock(&aps->mutex);
+        return false;
+    }
+
+    unsigned index = (aps->head + aps->count) % aps->capacity;
+    if (av_packet_ref(aps->packets[index], packet)) {
+        sc_mutex_unlock(&aps->mutex);
+        LOG_OOM();
+        return false;
+    }
+
+    aps->push_dates[index] = sc_tick_now();
+    ++aps->count;
+    ++aps->stats.pushed;
+    if (aps->count > aps->stats.max_queued) {
+        aps->stats.max_queued = aps->count;
+    }
+
+    sc_cond_signal(&aps->queue_cond);
+    sc_mutex_unlock(&aps->mutex);
+
+    return true;
+}
+
+static void
+sc_async_packet_sink_disable(struct sc_packet_sink *sink) {
+    struct sc_async_packet_sink *aps = DOWNCAST_PACKET(sink);
+
+    // Never opened, forward synchronously
+    sc_packet_source_sinks_disable(&aps->packet_source);
+}
+
+static struct sc_packet_source *
+sc_async_packet_sink_get_packet_source(struct sc_packet_sink *sink) {
+    struct sc_async_packet_sink *aps = DOWNCAST_PACKET(sink);
+    return &aps->packet_source;
+}
+
+void
+sc_async_packet_sink_init(struct sc_async_packet_sink *aps, const char *name,
+                          unsigned capacity) {
+    assert(capacity && capacity <= SC_ASYNC_SINK_MAX_CAPACITY);
+
+    aps->name = name;
+    aps->capacity = capacity;
+
+    sc_packet_source_init(&aps->packet_source);
+
+    static const struct sc_packet_sink_ops ops = {
+        .name = "async",
+        .get_packet_source = sc_async_packet_sink_get_packet_source,
+        .open = sc_async_packet_sink_open,
+        .close = sc_async_packet_sink_close,
+        .push = sc_async_packet_sink_push,
+        .disable = sc_async_packet_sink_disable,
+    };
+
+    aps->packet_sink.ops = &ops;
+}
@@ -0,0 +1,127 @@
+#ifndef SC_ASYNC_SINK_H
+#define SC_ASYNC_SINK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "trait/frame_sink.h"
+#include "trait/frame_source.h"
+#include "trait/packet_sink.h"
+#include "trait/packet_source.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+typedef struct AVPacket AVPacket;
+
+#define SC_ASYNC_SINK_MAX_CAPACITY 64
+
+// Default capacities
+#define SC_ASYNC_FRAME_SINK_CAPACITY 4
+#define SC_ASYNC_PACKET_SINK_CAPACITY 32
+
+/**
+ * Statistics of an async adapter, logged on close
+ */
+struct sc_async_sink_stats {
+    uint64_t pushed;
+    uint64_t dropped;
+    sc_tick queue_time_total; // time spent in the queue
+    sc_tick queue_time_max;
+    unsigned max_queued;
+};
+
+/**
+ * Asynchronous frame sink adapter
+ *
+ * Forward frames to its sink from a separate thread, so that a slow sink does
+ * not delay the other sinks of the source.
+ *
+ * The queue is bounded: if the sink is too slow, the oldest frames are
+ * dropped.
+ */
+struct sc_async_frame_sink {
+    struct sc_frame_source frame_source; // frame source trait
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    const char *name;
+    unsigned capacity;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+
+    // Circular queue of preallocated frames
+    AVFrame *frames[SC_ASYNC_SINK_MAX_CAPACITY];
+    sc_tick push_dates[SC_ASYNC_SINK_MAX_CAPACITY];
+    unsigned head;
+    unsigned count;
+
+    AVFrame *frame; // frame being pushed by the adapter thread
+
+    bool stopped;
+    bool failed;
+
+    struct sc_async_sink_stats stats;
+};
+
+/**
+ * Asynchronous packet sink adapter
+ *
+ * Forward packets to its sink from a separate thread.
+ *
+ * Packets cannot be dropped (they depend on each other): if the queue is full,
+ * push() blocks until the sink consumes a packet.
+ */
+struct sc_async_packet_sink {
+    struct sc_packet_source packet_source; // packet source trait
+    struct sc_packet_sink packet_sink; // packet sink trait
+
+    const char *name;
+    unsigned capacity;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond queue_cond;
+    sc_cond space_cond;
+
+    // Circular queue of preallocated packets
+    AVPacket *packets[SC_ASYNC_SINK_MAX_CAPACITY];
+    sc_tick push_dates[SC_ASYNC_SINK_MAX_CAPACITY];
+    unsigned head;
+    unsigned count;
+
+    AVPacket *packet; // packet being pushed by the adapter thread
+
+    bool stopped;
+    bool failed;
+
+    struct sc_async_sink_stats stats;
+};
+
+/**
+ * Initialize an asynchronous frame sink adapter
+ *
+ * \param name a name for logs (must be valid until destruction)
+ * \param capacity the max number of queued frames
+ *                 (at most SC_ASYNC_SINK_MAX_CAPACITY)
+ */
+void
+sc_async_frame_sink_init(struct sc_async_frame_sink *afs, const char *name,
+                         unsigned capacity);
+
+/**
+ * Initialize an asynchronous packet sink adapter
+ *
+ * \param name a name for logs (must be valid until destruction)
+ * \param capacity the max number of queued packets
+ *                 (at most SC_ASYNC_SINK_MAX_CAPACITY)
+ */
+void
+sc_async_packet_sink_init(struct sc_async_packet_sink *aps, const char *name,
+                          unsigned capacity);
+
+#endif
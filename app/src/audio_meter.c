@@ -0,0 +1,455 @@
+#include "audio_meter.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_audio_meter */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_audio_meter, frame_sink)
+
+// Number of independent accumulators: float additions are not associative, so
+// the compiler cannot vectorize a reduction into a single accumulator. With 8
+// accumulators, the inner loop maps to SIMD registers, and for interleaved
+// samples of 1, 2, 4 or 8 channels, each accumulator always receives the
+// samples of the same channel.
+#define SC_AUDIO_METER_LANES 8
+
+// Number of values converted at once from integer formats
+#define SC_AUDIO_METER_CONVERT_SIZE 1024
+
+// Below this level, log -inf
+#define SC_AUDIO_METER_MIN_DB -120.f
+
+static void
+sc_audio_level_reset(struct sc_audio_level *level) {
+    level->sum_squares = 0;
+    level->peak = 0;
+    level->clipped = 0;
+}
+
+static void
+sc_audio_level_add(struct sc_audio_level *level,
+                   const struct sc_audio_level *other) {
+    level->sum_squares += other->sum_squares;
+    if (other->peak > level->peak) {
+        level->peak = other->peak;
+    }
+    level->clipped += other->clipped;
+}
+
+// Accumulate `count` interleaved values of `channels` channels, where
+// `channels` divides SC_AUDIO_METER_LANES (and `count`)
+static void
+sc_audio_meter_accumulate_lanes(struct sc_audio_level *levels,
+                                unsigned channels, const float *data,
+                                size_t count) {
+    assert(!(SC_AUDIO_METER_LANES % channels));
+    assert(!(count % channels));
+
+    float sum[SC_AUDIO_METER_LANES] = {0};
+    float peak[SC_AUDIO_METER_LANES] = {0};
+    uint32_t clipped[SC_AUDIO_METER_LANES] = {0};
+
+    size_t i = 0;
+    for (; i + SC_AUDIO_METER_LANES <= count; i += SC_AUDIO_METER_LANES) {
+        for (unsigned k = 0; k < SC_AUDIO_METER_LANES; ++k) {
+            float x = data[i + k];
+            float a = fabsf(x);
+            sum[k] += x * x;
+            peak[k] = a > peak[k] ? a : peak[k];
+            clipped[k] += a >= SC_AUDIO_METER_CLIP_LEVEL;
+        }
+    }
+
+    // Remaining values, still on the lane of their channel
+    for (unsigned k = 0; i + k < count; ++k) {
+        float x = data[i + k];
+        float a = fabsf(x);
+        sum[k] += x * x;
+        peak[k] = a > peak[k] ? a : peak[k];
+        clipped[k] += a >= SC_AUDIO_METER_CLIP_LEVEL;
+    }
+
+    for (unsigned k = 0; k < SC_AUDIO_METER_LANES; ++k) {
+        struct sc_audio_level *level = &levels[k % channels];
+        level->sum_squares += sum[k];
+        if (peak[k] > level->peak) {
+            level->peak = peak[k];
+        }
+        level->clipped += clipped[k];
+    }
+}
+
+// Accumulate interleaved samples of any number of channels (slow path, for
+// unusual channel counts)
+static void
+sc_audio_meter_accumulate_strided(struct sc_audio_level *levels,
+                                  unsigned channels, unsigned metered_channels,
+                                  const float *data, unsigned samples) {
+    for (unsigned c = 0; c < metered_channels; ++c) {
+        struct sc_audio_level *level = &levels[c];
+        float sum = 0;
+        float peak = level->peak;
+        uint32_t clipped = 0;
+        for (unsigned i = 0; i < samples; ++i) {
+            float x = data[i * channels + c];
+            float a = fabsf(x);
+            sum += x * x;
+            peak = a > peak ? a : peak;
+            clipped += a >= SC_AUDIO_METER_CLIP_LEVEL;
+        }
+        level->sum_squares += sum;
+        level->peak = peak;
+        level->clipped += clipped;
+    }
+}
+
+static void
+sc_audio_meter_accumulate_packed(struct sc_audio_meter *meter,
+                                 struct sc_audio_level *levels,
+                                 const float *data, unsigned samples) {
+    unsigned channels = meter->channels;
+    if (!(SC_AUDIO_METER_LANES % channels)) {
+        sc_audio_meter_accumulate_lanes(levels, channels, data,
+                                        (size_t) samples * channels);
+    } else {
+        sc_audio_meter_accumulate_strided(levels, channels,
+                                          meter->metered_channels, data,
+                                          samples);
+    }
+}
+
+static void
+sc_audio_meter_convert(float *dst, const uint8_t *src, size_t count,
+                       enum AVSampleFormat format) {
+    if (format == AV_SAMPLE_FMT_S16 || format == AV_SAMPLE_FMT_S16P) {
+        const int16_t *s = (const int16_t *) src;
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = s[i] * (1.f / 32768);
+        }
+    } else {
+        assert(format == AV_SAMPLE_FMT_S32 || format == AV_SAMPLE_FMT_S32P);
+        const int32_t *s = (const int32_t *) src;
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = s[i] * (1.f / 2147483648.f);
+        }
+    }
+}
+
+static void
+sc_audio_meter_accumulate(struct sc_audio_meter *meter,
+                          struct sc_audio_level *levels,
+                          const uint8_t *const *data, unsigned samples) {
+    enum AVSampleFormat format = meter->format;
+    unsigned channels = meter->channels;
+
+    if (format == AV_SAMPLE_FMT_FLT) {
+        sc_audio_meter_accumulate_packed(meter, levels, (const float *) data[0],
+                                         samples);
+        return;
+    }
+
+    if (format == AV_SAMPLE_FMT_FLTP) {
+        for (unsigned c = 0; c < meter->metered_channels; ++c) {
+            sc_audio_meter_accumulate_lanes(&levels[c], 1,
+                                            (const float *) data[c], samples);
+        }
+        return;
+    }
+
+    // Integer formats: convert to float by chunks
+    float buf[SC_AUDIO_METER_CONVERT_SIZE];
+    size_t bytes_per_sample = av_get_bytes_per_sample(format);
+
+    if (av_sample_fmt_is_planar(format)) {
+        for (unsigned c = 0; c < meter->metered_channels; ++c) {
+            for (unsigned i = 0; i < samples;) {
+                unsigned n = MIN(samples - i, SC_AUDIO_METER_CONVERT_SIZE);
+                sc_audio_meter_convert(buf, data[c] + i * bytes_per_sample, n,
+                                       format);
+                sc_audio_meter_accumulate_lanes(&levels[c], 1, buf, n);
+                i += n;
+            }
+        }
+    } else {
+        // Whole samples (for all channels) per chunk
+        unsigned chunk = SC_AUDIO_METER_CONVERT_SIZE / channels;
+        for (unsigned i = 0; i < samples;) {
+            unsigned n = MIN(samples - i, chunk);
+            sc_audio_meter_convert(buf,
+                                   data[0] + i * channels * bytes_per_sample,
+                                   (size_t) n * channels, format);
+            sc_audio_meter_accumulate_packed(meter, levels, buf, n);
+            i += n;
+        }
+    }
+}
+
+static float
+sc_audio_meter_to_db(float value) {
+    if (value <= 0) {
+        return -INFINITY;
+    }
+    return 20 * log10f(value);
+}
+
+// Append the levels in dBFS, separated by '/', to `buf`
+static void
+sc_audio_meter_format_db(char *buf, size_t size, const float *values,
+                         unsigned count) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (unsigned i = 0; i < count && len < size; ++i) {
+        const char *sep = i ? "/" : "";
+        float db = sc_audio_meter_to_db(values[i]);
+        int r;
+        if (db < SC_AUDIO_METER_MIN_DB) {
+            r = snprintf(buf + len, size - len, "%s-inf", sep);
+        } else {
+            r = snprintf(buf + len, size - len, "%s%.1f", sep, db);
+        }
+        if (r < 0) {
+            return;
+        }
+        len += r;
+    }
+}
+
+static void
+sc_audio_meter_log_levels(const char *prefix,
+                          const struct sc_audio_level *levels,
+                          unsigned channels, uint64_t samples) {
+    assert(samples);
+
+    float rms[SC_AUDIO_METER_MAX_CHANNELS];
+    float peak[SC_AUDIO_METER_MAX_CHANNELS];
+    for (unsigned c = 0; c < channels; ++c) {
+        rms[c] = sqrt(levels[c].sum_squares / samples);
+        peak[c] = levels[c].peak;
+    }
+
+    // Up to "-120.0/" per channel
+    char rms_str[SC_AUDIO_METER_MAX_CHANNELS * 8];
+    char peak_str[SC_AUDIO_METER_MAX_CHANNELS * 8];
+    sc_audio_meter_format_db(rms_str, sizeof(rms_str), rms, channels);
+    sc_audio_meter_format_db(peak_str, sizeof(peak_str), peak, channels);
+
+    LOGI("%s: RMS %s dBFS, peak %s dBFS", prefix, rms_str, peak_str);
+}
+
+static void
+sc_audio_meter_end_interval(struct sc_audio_meter *meter) {
+    unsigned channels = meter->metered_channels;
+    struct sc_audio_meter_stats *stats = &meter->stats;
+
+    uint64_t clipped = 0;
+    for (unsigned c = 0; c < channels; ++c) {
+        clipped += meter->interval[c].clipped;
+    }
+
+    // Do not repeat the levels of a silence already reported
+    if (!meter->silent) {
+        sc_audio_meter_log_levels("Audio level", meter->interval, channels,
+                                  meter->interval_samples);
+    }
+
+    if (clipped) {
+        LOGW("Audio clipping: %" PRIu64 " samples", clipped);
+        ++stats->clipping_events;
+    }
+
+    for (unsigned c = 0; c < channels; ++c) {
+        sc_audio_level_add(&stats->levels[c], &meter->interval[c]);
+        sc_audio_level_reset(&meter->interval[c]);
+    }
+    stats->samples += meter->interval_samples;
+    meter->interval_samples = 0;
+}
+
+static void
+sc_audio_meter_update_silence(struct sc_audio_meter *meter, bool silent,
+                              unsigned samples) {
+    if (silent) {
+        meter->silence_samples += samples;
+        meter->stats.silent_samples += samples;
+        // Report a silence of at least 1 second
+        if (!meter->silent && meter->silence_samples >= meter->sample_rate) {
+            LOGI("Audio silence detected");
+            meter->silent = true;
+            ++meter->stats.silence_events;
+        }
+    } else {
+        if (meter->silent) {
+            LOGI("Audio signal detected after %" PRIu64 " ms of silence",
+                 meter->silence_samples * 1000 / meter->sample_rate);
+            meter->silent = false;
+        }
+        meter->silence_samples = 0;
+    }
+}
+
+void
+sc_audio_meter_process(struct sc_audio_meter *meter,
+                       const uint8_t *const *data, unsigned samples) {
+    assert(meter->format != AV_SAMPLE_FMT_NONE);
+
+    unsigned channels = meter->metered_channels;
+
+    struct sc_audio_level levels[SC_AUDIO_METER_MAX_CHANNELS];
+    for (unsigned c = 0; c < channels; ++c) {
+        sc_audio_level_reset(&levels[c]);
+    }
+
+    sc_audio_meter_accumulate(meter, levels, data, samples);
+
+    bool silent = true;
+    for (unsigned c = 0; c < channels; ++c) {
+        if (levels[c].peak >= SC_AUDIO_METER_SILENCE_LEVEL) {
+            silent = false;
+        }
+        sc_audio_level_add(&meter->interval[c], &levels[c]);
+    }
+
+    sc_audio_meter_update_silence(meter, silent, samples);
+
+    meter->interval_samples += samples;
+    if (meter->interval_samples >= meter->sample_rate) {
+        // 1 second
+        sc_audio_meter_end_interval(meter);
+    }
+}
+
+bool
+sc_audio_meter_configure(struct sc_audio_meter *meter,
+                         enum AVSampleFormat format, unsigned channels,
+                         uint32_t sample_rate) {
+    assert(channels);
+    assert(sample_rate);
+
+    switch (format) {
+        case AV_SAMPLE_FMT_FLT:
+        case AV_SAMPLE_FMT_FLTP:
+        case AV_SAMPLE_FMT_S16:
+        case AV_SAMPLE_FMT_S16P:
+        case AV_SAMPLE_FMT_S32:
+        case AV_SAMPLE_FMT_S32P:
+            break;
+        default:
+            meter->format = AV_SAMPLE_FMT_NONE;
+            return false;
+    }
+
+    if (channels > SC_AUDIO_METER_CONVERT_SIZE) {
+        meter->format = AV_SAMPLE_FMT_NONE;
+        return false;
+    }
+
+    meter->format = format;
+    meter->channels = channels;
+    meter->metered_channels = MIN(channels, SC_AUDIO_METER_MAX_CHANNELS);
+    meter->sample_rate = sample_rate;
+
+    meter->interval_samples = 0;
+    for (unsigned c = 0; c < SC_AUDIO_METER_MAX_CHANNELS; ++c) {
+        sc_audio_level_reset(&meter->interval[c]);
+    }
+    meter->silence_samples = 0;
+    meter->silent = false;
+    memset(&meter->stats, 0, sizeof(meter->stats));
+
+    return true;
+}
+
+static bool
+sc_audio_meter_frame_sink_open(struct sc_frame_sink *sink,
+                               const AVCodecContext *ctx) {
+    struct sc_audio_meter *meter = DOWNCAST(sink);
+
+#ifdef SCRCPY_LAVU_HAS_CHLAYOUT
+    int channels = ctx->ch_layout.nb_channels;
+#else
+    int channels = av_get_channel_layout_nb_channels(ctx->channel_layout);
+#endif
+    assert(channels > 0);
+    assert(ctx->sample_rate > 0);
+
+    bool ok = sc_audio_meter_configure(meter, ctx->sample_fmt, channels,
+                                       ctx->sample_rate);
+    if (!ok) {
+        // Do not fail the whole audio pipeline for a diagnostic tool
+        const char *name = av_get_sample_fmt_name(ctx->sample_fmt);
+        LOGW("Audio meter: unsupported sample format %s, disabled",
+             name ? name : "unknown");
+        return true;
+    }
+
+    if (channels > SC_AUDIO_METER_MAX_CHANNELS) {
+        LOGW("Audio meter: only the first %d channels (out of %d) are "
+             "measured", SC_AUDIO_METER_MAX_CHANNELS, channels);
+    }
+
+    return true;
+}
+
+static void
+sc_audio_meter_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_audio_meter *meter = DOWNCAST(sink);
+
+    if (meter->format == AV_SAMPLE_FMT_NONE) {
+        return;
+    }
+
+    if (meter->interval_samples) {
+        // Include the last partial interval in the stats
+        sc_audio_meter_end_interval(meter);
+    }
+
+    const struct sc_audio_meter_stats *stats = &meter->stats;
+    if (!stats->samples) {
+        LOGI("Audio meter: no audio decoded");
+        return;
+    }
+
+    uint32_t rate = meter->sample_rate;
+    LOGI("Audio meter: %" PRIu64 " ms decoded, %" PRIu64 " ms silent, %"
+         PRIu32 " silence events, %" PRIu32 " clipping events",
+         stats->samples * 1000 / rate, stats->silent_samples * 1000 / rate,
+         stats->silence_events, stats->clipping_events);
+    sc_audio_meter_log_levels("Audio meter (whole session)", stats->levels,
+                              meter->metered_channels, stats->samples);
+}
+
+static bool
+sc_audio_meter_frame_sink_push(struct sc_frame_sink *sink,
+                               const AVFrame *frame) {
+    struct sc_audio_meter *meter = DOWNCAST(sink);
+
+    if (meter->format == AV_SAMPLE_FMT_NONE) {
+        // Unsupported format
+        return true;
+    }
+
+    assert(frame->format == meter->format);
+    sc_audio_meter_process(meter, (const uint8_t *const *) frame->extended_data,
+                           frame->nb_samples);
+
+    return true;
+}
+
+void
+sc_audio_meter_init(struct sc_audio_meter *meter) {
+    meter->format = AV_SAMPLE_FMT_NONE;
+
+    static const struct sc_frame_sink_ops ops = {
+        .name = "meter",
+        .open = sc_audio_meter_frame_sink_open,
+        .close = sc_audio_meter_frame_sink_close,
+        .push = sc_audio_meter_frame_sink_push,
+    };
+
+    meter->frame_sink.ops = &ops;
+}
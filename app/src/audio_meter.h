@@ -0,0 +1,92 @@
+#ifndef SC_AUDIO_METER_H
+#define SC_AUDIO_METER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libavutil/samplefmt.h>
+
+#include "trait/frame_sink.h"
+
+// Additional channels are not measured
+#define SC_AUDIO_METER_MAX_CHANNELS 8
+
+// A frame is silent if all its samples are below -60 dBFS
+#define SC_AUDIO_METER_SILENCE_LEVEL 0.001f
+// A sample is clipped if it reaches full scale (-0.01 dBFS)
+#define SC_AUDIO_METER_CLIP_LEVEL 0.999f
+
+/**
+ * Audio level of one channel, over some samples
+ */
+struct sc_audio_level {
+    double sum_squares; // divide by the number of samples to get the mean
+    float peak; // max absolute value, 1.0 is full scale
+    uint64_t clipped;
+};
+
+struct sc_audio_meter_stats {
+    uint64_t samples; // per channel
+    uint64_t silent_samples;
+    uint32_t silence_events;
+    uint32_t clipping_events; // intervals containing clipped samples
+    struct sc_audio_level levels[SC_AUDIO_METER_MAX_CHANNELS];
+};
+
+/**
+ * Audio level meter
+ *
+ * It is a frame sink (to be attached to the audio decoder) measuring the RMS
+ * and peak levels of each channel, logged every second, and detecting silence
+ * and clipping.
+ *
+ * It runs on the decoder thread, so the measurement must be cheap: the samples
+ * are read once, without conversion for float formats.
+ */
+struct sc_audio_meter {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    enum AVSampleFormat format;
+    unsigned channels; // total number of channels in the frames
+    unsigned metered_channels; // min(channels, SC_AUDIO_METER_MAX_CHANNELS)
+    uint32_t sample_rate;
+
+    // Current interval
+    uint64_t interval_samples;
+    struct sc_audio_level interval[SC_AUDIO_METER_MAX_CHANNELS];
+
+    // Consecutive silent samples
+    uint64_t silence_samples;
+    // Set once the silence lasts long enough to be reported
+    bool silent;
+
+    // Whole session
+    struct sc_audio_meter_stats stats;
+};
+
+void
+sc_audio_meter_init(struct sc_audio_meter *meter);
+
+/**
+ * Configure the sample format (called on open(), exposed for testing)
+ *
+ * Return false if the format is not supported.
+ */
+bool
+sc_audio_meter_configure(struct sc_audio_meter *meter,
+                         enum AVSampleFormat format, unsigned channels,
+                         uint32_t sample_rate);
+
+/**
+ * Measure `samples` samples (per channel) (called on push(), exposed for
+ * testing)
+ *
+ * The data layout is the one of AVFrame.extended_data: one pointer per channel
+ * for planar formats, a single pointer otherwise.
+ */
+void
+sc_audio_meter_process(struct sc_audio_meter *meter,
+                       const uint8_t *const *data, unsigned samples);
+
+#endif
@@ -0,0 +1,328 @@
+#include "audio_output_alsa.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/log.h"
+
+/** Downcast audio_output to sc_audio_output_alsa */
+#define DOWNCAST(AOUT) \
+    container_of(AOUT, struct sc_audio_output_alsa, audio_output)
+
+#define SC_ALSA_DEFAULT_DEVICE "default"
+
+// Double buffering: the next period is written while the current one is
+// played
+#define SC_ALSA_PERIODS 2
+
+// Sample formats, by order of preference (most hardware devices do not support
+// float samples)
+static const snd_pcm_format_t sc_alsa_formats[] = {
+    SND_PCM_FORMAT_FLOAT, // no conversion
+    SND_PCM_FORMAT_S32,
+    SND_PCM_FORMAT_S16,
+};
+
+static bool
+sc_audio_output_alsa_set_format(struct sc_audio_output_alsa *aout,
+                                snd_pcm_hw_params_t *hw_params) {
+    for (size_t i = 0; i < ARRAY_LEN(sc_alsa_formats); ++i) {
+        snd_pcm_format_t format = sc_alsa_formats[i];
+        if (!snd_pcm_hw_params_test_format(aout->pcm, hw_params, format)
+                && !snd_pcm_hw_params_set_format(aout->pcm, hw_params,
+                                                 format)) {
+            aout->format = format;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool
+sc_audio_output_alsa_set_params(struct sc_audio_output_alsa *aout,
+                                const struct sc_audio_output_params *params) {
+    snd_pcm_hw_params_t *hw_params;
+    snd_pcm_hw_params_alloca(&hw_params);
+
+    snd_pcm_t *pcm = aout->pcm;
+    const char *step;
+    int r = snd_pcm_hw_params_any(pcm, hw_params);
+    if (r < 0) {
+        step = "configure";
+        goto error;
+    }
+
+    r = snd_pcm_hw_params_set_access(pcm, hw_params,
+                                     SND_PCM_ACCESS_RW_INTERLEAVED);
+    if (r < 0) {
+        step = "set access";
+        goto error;
+    }
+
+    if (!sc_audio_output_alsa_set_format(aout, hw_params)) {
+        LOGE("ALSA audio output: no supported sample format (float, s32 or "
+             "s16)");
+        return false;
+    }
+
+    r = snd_pcm_hw_params_set_channels(pcm, hw_params, params->channels);
+    if (r < 0) {
+        step = "set channels";
+        goto error;
+    }
+
+    unsigned rate = params->sample_rate;
+    r = snd_pcm_hw_params_set_rate(pcm, hw_params, rate, 0);
+    if (r < 0) {
+        step = "set sample rate";
+        goto error;
+    }
+
+    snd_pcm_uframes_t period = params->period;
+    if (period) {
+        r = snd_pcm_hw_params_set_period_size_near(pcm, hw_params, &period,
+                                                   NULL);
+        if (r < 0) {
+            step = "set period size";
+            goto error;
+        }
+    }
+
+    unsigned periods = SC_ALSA_PERIODS;
+    r = snd_pcm_hw_params_set_periods_near(pcm, hw_params, &periods, NULL);
+    if (r < 0) {
+        step = "set periods";
+        goto error;
+    }
+
+    r = snd_pcm_hw_params(pcm, hw_params);
+    if (r < 0) {
+        step = "apply hw params";
+        goto error;
+    }
+
+    snd_pcm_uframes_t buffer_size;
+    r = snd_pcm_hw_params_get_period_size(hw_params, &period, NULL);
+    if (r < 0) {
+        step = "get period size";
+        goto error;
+    }
+    r = snd_pcm_hw_params_get_buffer_size(hw_params, &buffer_size);
+    if (r < 0) {
+        step = "get buffer size";
+        goto error;
+    }
+
+    snd_pcm_sw_params_t *sw_params;
+    snd_pcm_sw_params_alloca(&sw_params);
+
+    r = snd_pcm_sw_params_current(pcm, sw_params);
+    if (r < 0) {
+        step = "get sw params";
+        goto error;
+    }
+
+    // Start playing as soon as the first period is written
+    r = snd_pcm_sw_params_set_start_threshold(pcm, sw_params, period);
+    if (r < 0) {
+        step = "set start threshold";
+        goto error;
+    }
+
+    r = snd_pcm_sw_params_set_avail_min(pcm, sw_params, period);
+    if (r < 0) {
+        step = "set avail min";
+        goto error;
+    }
+
+    r = snd_pcm_sw_params(pcm, sw_params);
+    if (r < 0) {
+        step = "apply sw params";
+        goto error;
+    }
+
+    aout->period = period;
+    aout->audio_output.latency = buffer_size;
+
+    LOGD("ALSA audio output: format=%s period=%lu buffer=%lu samples",
+         snd_pcm_format_name(aout->format), (unsigned long) period,
+         (unsigned long) buffer_size);
+
+    return true;
+
+error:
+    LOGE("ALSA audio output: could not %s: %s", step, snd_strerror(r));
+    if (params->device && !strncmp(params->device, "hw:", 3)) {
+        LOGE("A \"hw:\" device does not convert the sample rate nor the "
+             "channels, try \"plug%s\"", params->device);
+    }
+    return false;
+}
+
+// Convert the float samples pulled into aout->buf to the device format
+static void
+sc_audio_output_alsa_convert(struct sc_audio_output_alsa *aout) {
+    const float *in = (const float *) aout->buf;
+    size_t count = aout->period * aout->channels;
+
+    if (aout->format == SND_PCM_FORMAT_S32) {
+        int32_t *out = (int32_t *) aout->out;
+        for (size_t i = 0; i < count; ++i) {
+            float v = CLAMP(in[i], -1.0f, 1.0f);
+            out[i] = (int32_t) (v * (double) INT32_MAX);
+        }
+    } else {
+        assert(aout->format == SND_PCM_FORMAT_S16);
+        int16_t *out = (int16_t *) aout->out;
+        for (size_t i = 0; i < count; ++i) {
+            float v = CLAMP(in[i], -1.0f, 1.0f);
+            out[i] = (int16_t) (v * INT16_MAX);
+        }
+    }
+}
+
+static int
+run_audio_output_alsa(void *data) {
+    struct sc_audio_output_alsa *aout = data;
+
+    bool ok = sc_thread_set_priority(SC_THREAD_PRIORITY_TIME_CRITICAL);
+    if (!ok) {
+        ok = sc_thread_set_priority(SC_THREAD_PRIORITY_HIGH);
+        (void) ok; // We don't care if it worked, at least we tried
+    }
+
+    while (!atomic_load_explicit(&aout->stopped, memory_order_relaxed)) {
+        aout->cbs->on_pull(&aout->audio_output, aout->buf, aout->period,
+                           aout->cbs_userdata);
+
+        uint8_t *data = aout->buf;
+        if (aout->out) {
+            sc_audio_output_alsa_convert(aout);
+            data = aout->out;
+        }
+
+        // Blocks until there is room for the period in the device buffer
+        snd_pcm_uframes_t remaining = aout->period;
+        while (remaining) {
+            snd_pcm_sframes_t w = snd_pcm_writei(aout->pcm, data, remaining);
+            if (w < 0) {
+                // Recover from underruns (or suspends) silently
+                int r = snd_pcm_recover(aout->pcm, (int) w, 1);
+                if (r < 0) {
+                    LOGE("ALSA audio output: could not write: %s",
+                         snd_strerror(r));
+                    return 1;
+                }
+                LOGD("ALSA audio output: recovered from %s",
+                     snd_strerror((int) w));
+                continue;
+            }
+
+            assert((snd_pcm_uframes_t) w <= remaining);
+            data += w * aout->out_sample_size;
+            remaining -= w;
+        }
+    }
+
+    return 0;
+}
+
+static bool
+sc_audio_output_alsa_open(struct sc_audio_output *aout_,
+                          const struct sc_audio_output_params *params,
+                          const struct sc_audio_output_callbacks *cbs,
+                          void *cbs_userdata) {
+    struct sc_audio_output_alsa *aout = DOWNCAST(aout_);
+
+    assert(cbs && cbs->on_pull);
+    aout->cbs = cbs;
+    aout->cbs_userdata = cbs_userdata;
+    aout->channels = params->channels;
+    aout->sample_size = params->channels * sizeof(float);
+
+    const char *device = params->device ? params->device
+                                        : SC_ALSA_DEFAULT_DEVICE;
+    int r = snd_pcm_open(&aout->pcm, device, SND_PCM_STREAM_PLAYBACK, 0);
+    if (r < 0) {
+        LOGE("Could not open ALSA device \"%s\": %s", device, snd_strerror(r));
+        return false;
+    }
+
+    if (!sc_audio_output_alsa_set_params(aout, params)) {
+        goto error_close_pcm;
+    }
+
+    aout->buf = malloc(aout->period * aout->sample_size);
+    if (!aout->buf) {
+        LOG_OOM();
+        goto error_close_pcm;
+    }
+
+    aout->out_sample_size =
+        params->channels * snd_pcm_format_physical_width(aout->format) / 8;
+    if (aout->format != SND_PCM_FORMAT_FLOAT) {
+        aout->out = malloc(aout->period * aout->out_sample_size);
+        if (!aout->out) {
+            LOG_OOM();
+            goto error_free_buf;
+        }
+    } else {
+        aout->out = NULL;
+    }
+
+    atomic_init(&aout->stopped, false);
+    aout->started = false;
+
+    return true;
+
+error_free_buf:
+    free(aout->buf);
+error_close_pcm:
+    snd_pcm_close(aout->pcm);
+
+    return false;
+}
+
+static bool
+sc_audio_output_alsa_start(struct sc_audio_output *aout_) {
+    struct sc_audio_output_alsa *aout = DOWNCAST(aout_);
+
+    bool ok = sc_thread_create(&aout->thread, run_audio_output_alsa,
+                               "scrcpy-alsa", aout);
+    if (!ok) {
+        LOGE("ALSA audio output: could not start thread");
+        return false;
+    }
+
+    aout->started = true;
+    return true;
+}
+
+static void
+sc_audio_output_alsa_close(struct sc_audio_output *aout_) {
+    struct sc_audio_output_alsa *aout = DOWNCAST(aout_);
+
+    if (aout->started) {
+        // The thread blocks at most for one period in snd_pcm_writei()
+        atomic_store_explicit(&aout->stopped, true, memory_order_relaxed);
+        sc_thread_join(&aout->thread, NULL);
+    }
+
+    snd_pcm_drop(aout->pcm);
+    snd_pcm_close(aout->pcm);
+    free(aout->out);
+    free(aout->buf);
+}
+
+void
+sc_audio_output_alsa_init(struct sc_audio_output_alsa *aout) {
+    static const struct sc_audio_output_ops ops = {
+        .open = sc_audio_output_alsa_open,
+        .start = sc_audio_output_alsa_start,
+        .close = sc_audio_output_alsa_close,
+    };
+
+    aout->audio_output.ops = &ops;
+}
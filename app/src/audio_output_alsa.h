@@ -0,0 +1,50 @@
+#ifndef SC_AUDIO_OUTPUT_ALSA_H
+#define SC_AUDIO_OUTPUT_ALSA_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <alsa/asoundlib.h>
+
+#include "trait/audio_output.h"
+#include "util/thread.h"
+
+/**
+ * Audio output writing directly to an ALSA PCM (Linux only)
+ *
+ * Contrary to the SDL output, the period size and the number of periods are
+ * configured explicitly. With a "hw:" device, the mixer is bypassed (the
+ * device is then used exclusively).
+ *
+ * The samples are written as 32-bit floats if the device supports it,
+ * otherwise they are converted to 32-bit or 16-bit integers. A "hw:" device
+ * must support the stream sample rate and channels as is ("plughw:" converts
+ * them).
+ */
+struct sc_audio_output_alsa {
+    struct sc_audio_output audio_output; // audio output trait
+
+    snd_pcm_t *pcm;
+    snd_pcm_format_t format;
+    uint8_t *buf; // one period (float)
+    uint8_t *out; // one period converted to the device format (or NULL)
+    snd_pcm_uframes_t period;
+    uint8_t channels;
+    size_t sample_size; // size of a float sample (for all channels)
+    size_t out_sample_size; // size of a device sample (for all channels)
+
+    sc_thread thread;
+    atomic_bool stopped;
+    bool started;
+
+    const struct sc_audio_output_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+void
+sc_audio_output_alsa_init(struct sc_audio_output_alsa *aout);
+
+#endif
@@ -0,0 +1,235 @@
+#include "audio_output_null.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/binary.h"
+#include "util/log.h"
+
+/** Downcast audio_output to sc_audio_output_null */
+#define DOWNCAST(AOUT) \
+    container_of(AOUT, struct sc_audio_output_null, audio_output)
+
+// RIFF header (12) + fmt chunk (8 + 18) + fact chunk (8 + 4) + data header (8)
+#define SC_WAV_HEADER_SIZE 58
+#define SC_WAV_FORMAT_IEEE_FLOAT 3
+
+static void
+sc_wav_write_header(uint8_t *buf, uint8_t channels, uint32_t sample_rate,
+                    uint32_t samples) {
+    uint16_t block_align = channels * sizeof(float);
+    uint32_t data_size = samples * block_align;
+
+    memcpy(buf, "RIFF", 4);
+    sc_write32le(&buf[4], SC_WAV_HEADER_SIZE - 8 + data_size);
+    memcpy(&buf[8], "WAVE", 4);
+
+    memcpy(&buf[12], "fmt ", 4);
+    sc_write32le(&buf[16], 18);
+    sc_write16le(&buf[20], SC_WAV_FORMAT_IEEE_FLOAT);
+    sc_write16le(&buf[22], channels);
+    sc_write32le(&buf[24], sample_rate);
+    sc_write32le(&buf[28], sample_rate * block_align); // byte rate
+    sc_write16le(&buf[32], block_align);
+    sc_write16le(&buf[34], 32); // bits per sample
+    sc_write16le(&buf[36], 0); // extension size
+
+    // The fact chunk is required for non-PCM formats
+    memcpy(&buf[38], "fact", 4);
+    sc_write32le(&buf[42], 4);
+    sc_write32le(&buf[46], samples);
+
+    memcpy(&buf[50], "data", 4);
+    sc_write32le(&buf[54], data_size);
+}
+
+static void
+sc_audio_output_null_write(struct sc_audio_output_null *aout) {
+    if (!aout->file || aout->file_error) {
+        return;
+    }
+
+    size_t w = fwrite(aout->buf, aout->sample_size, aout->period, aout->file);
+    aout->written += w;
+    if (w != aout->period) {
+        LOGE("Null audio output: could not write to file");
+        aout->file_error = true;
+    }
+}
+
+static int
+run_audio_output_null(void *data) {
+    struct sc_audio_output_null *aout = data;
+
+    // Compute the deadlines from the start date, so that the errors do not
+    // accumulate
+    sc_tick start = sc_tick_now();
+    uint64_t pulled = 0;
+
+    sc_mutex_lock(&aout->mutex);
+    while (!aout->stopped) {
+        sc_mutex_unlock(&aout->mutex);
+
+        aout->cbs->on_pull(&aout->audio_output, aout->buf, aout->period,
+                           aout->cbs_userdata);
+        sc_audio_output_null_write(aout);
+        pulled += aout->period;
+
+        sc_tick deadline = start
+                         + (sc_tick) (pulled * SC_TICK_FREQ / aout->sample_rate);
+
+        sc_mutex_lock(&aout->mutex);
+        bool timed_out = false;
+        while (!aout->stopped && !timed_out) {
+            timed_out = !sc_cond_timedwait(&aout->cond, &aout->mutex,
+                                           deadline);
+        }
+    }
+    sc_mutex_unlock(&aout->mutex);
+
+    return 0;
+}
+
+static bool
+sc_audio_output_null_open(struct sc_audio_output *aout_,
+                          const struct sc_audio_output_params *params,
+                          const struct sc_audio_output_callbacks *cbs,
+                          void *cbs_userdata) {
+    struct sc_audio_output_null *aout = DOWNCAST(aout_);
+
+    assert(cbs && cbs->on_pull);
+    assert(params->sample_rate);
+    aout->cbs = cbs;
+    aout->cbs_userdata = cbs_userdata;
+    // Without explicit period, consume the samples every 10ms
+    aout->period = params->period ? params->period
+                                  : params->sample_rate / 100;
+    aout->sample_rate = params->sample_rate;
+    aout->channels = params->channels;
+    aout->sample_size = params->channels * sizeof(float);
+    aout->written = 0;
+    aout->file_error = false;
+    aout->stopped = false;
+    aout->started = false;
+
+    // The samples are consumed one period at a time
+    aout->audio_output.latency = aout->period;
+
+    aout->buf = malloc(aout->period * aout->sample_size);
+    if (!aout->buf) {
+        LOG_OOM();
+        return false;
+    }
+
+    bool ok = sc_mutex_init(&aout->mutex);
+    if (!ok) {
+        goto error_free_buf;
+    }
+
+    ok = sc_cond_init(&aout->cond);
+    if (!ok) {
+        goto error_mutex_destroy;
+    }
+
+    if (params->device) {
+        aout->file = fopen(params->device, "wb");
+        if (!aout->file) {
+            LOGE("Could not open file: %s", params->device);
+            goto error_cond_destroy;
+        }
+
+        // Write a header with empty sizes, updated on close
+        uint8_t header[SC_WAV_HEADER_SIZE];
+        sc_wav_write_header(header, aout->channels, aout->sample_rate, 0);
+        if (fwrite(header, sizeof(header), 1, aout->file) != 1) {
+            LOGE("Could not write WAV header: %s", params->device);
+            goto error_close_file;
+        }
+    } else {
+        aout->file = NULL;
+    }
+
+    return true;
+
+error_close_file:
+    fclose(aout->file);
+error_cond_destroy:
+    sc_cond_destroy(&aout->cond);
+error_mutex_destroy:
+    sc_mutex_destroy(&aout->mutex);
+error_free_buf:
+    free(aout->buf);
+
+    return false;
+}
+
+static bool
+sc_audio_output_null_start(struct sc_audio_output *aout_) {
+    struct sc_audio_output_null *aout = DOWNCAST(aout_);
+
+    bool ok = sc_thread_create(&aout->thread, run_audio_output_null,
+                               "scrcpy-aout", aout);
+    if (!ok) {
+        LOGE("Null audio output: could not start thread");
+        return false;
+    }
+
+    aout->started = true;
+    return true;
+}
+
+static void
+sc_audio_output_null_close_file(struct sc_audio_output_null *aout) {
+    assert(aout->file);
+
+    uint64_t written = aout->written;
+    if (written > UINT32_MAX / aout->sample_size) {
+        LOGW("Null audio output: WAV file too large, sizes truncated");
+        written = UINT32_MAX / aout->sample_size;
+    }
+
+    uint8_t header[SC_WAV_HEADER_SIZE];
+    sc_wav_write_header(header, aout->channels, aout->sample_rate, written);
+    if (fseek(aout->file, 0, SEEK_SET)
+            || fwrite(header, sizeof(header), 1, aout->file) != 1) {
+        LOGW("Null audio output: could not update WAV header");
+    }
+
+    if (fclose(aout->file)) {
+        LOGE("Null audio output: could not close file");
+    }
+}
+
+static void
+sc_audio_output_null_close(struct sc_audio_output *aout_) {
+    struct sc_audio_output_null *aout = DOWNCAST(aout_);
+
+    if (aout->started) {
+        sc_mutex_lock(&aout->mutex);
+        aout->stopped = true;
+        sc_cond_signal(&aout->cond);
+        sc_mutex_unlock(&aout->mutex);
+
+        sc_thread_join(&aout->thread, NULL);
+    }
+
+    if (aout->file) {
+        sc_audio_output_null_close_file(aout);
+    }
+
+    sc_cond_destroy(&aout->cond);
+    sc_mutex_destroy(&aout->mutex);
+    free(aout->buf);
+}
+
+void
+sc_audio_output_null_init(struct sc_audio_output_null *aout) {
+    static const struct sc_audio_output_ops ops = {
+        .open = sc_audio_output_null_open,
+        .start = sc_audio_output_null_start,
+        .close = sc_audio_output_null_close,
+    };
+
+    aout->audio_output.ops = &ops;
+}
@@ -0,0 +1,47 @@
+#ifndef SC_AUDIO_OUTPUT_NULL_H
+#define SC_AUDIO_OUTPUT_NULL_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "trait/audio_output.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+/**
+ * Audio output consuming the samples in real time without any sound card
+ *
+ * If a file path is provided as the device, the consumed samples are written
+ * to a WAV file (32-bit float).
+ */
+struct sc_audio_output_null {
+    struct sc_audio_output audio_output; // audio output trait
+
+    FILE *file; // NULL if the samples are discarded
+    bool file_error;
+    uint64_t written; // samples written to the file
+
+    uint8_t *buf; // one period
+    uint32_t period;
+    uint32_t sample_rate;
+    uint8_t channels;
+    size_t sample_size;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+    bool stopped;
+    bool started;
+
+    const struct sc_audio_output_callbacks *cbs;
+    void *cbs_userdata;
+};
+
+void
+sc_audio_output_null_init(struct sc_audio_output_null *aout);
+
+#endif
@@ -0,0 +1,88 @@
+#include "audio_output_sdl.h"
+
+#include <assert.h>
+
+#include "util/log.h"
+
+/** Downcast audio_output to sc_audio_output_sdl */
+#define DOWNCAST(AOUT) \
+    container_of(AOUT, struct sc_audio_output_sdl, audio_output)
+
+#define SC_SDL_SAMPLE_FMT AUDIO_F32
+
+static void SDLCALL
+sc_audio_output_sdl_callback(void *userdata, uint8_t *stream, int len_int) {
+    struct sc_audio_output_sdl *aout = userdata;
+
+    assert(len_int > 0);
+    size_t len = len_int;
+
+    assert(len % aout->sample_size == 0);
+    uint32_t samples = len / aout->sample_size;
+
+    aout->cbs->on_pull(&aout->audio_output, stream, samples,
+                       aout->cbs_userdata);
+}
+
+static bool
+sc_audio_output_sdl_open(struct sc_audio_output *aout_,
+                         const struct sc_audio_output_params *params,
+                         const struct sc_audio_output_callbacks *cbs,
+                         void *cbs_userdata) {
+    struct sc_audio_output_sdl *aout = DOWNCAST(aout_);
+
+    assert(cbs && cbs->on_pull);
+    aout->cbs = cbs;
+    aout->cbs_userdata = cbs_userdata;
+    aout->sample_size = params->channels * sizeof(float);
+
+    SDL_AudioSpec desired = {
+        .freq = params->sample_rate,
+        .format = SC_SDL_SAMPLE_FMT,
+        .channels = params->channels,
+        .samples = params->period,
+        .callback = sc_audio_output_sdl_callback,
+        .userdata = aout,
+    };
+    SDL_AudioSpec obtained;
+
+    // The device is initially paused
+    aout->device = SDL_OpenAudioDevice(params->device, 0, &desired, &obtained,
+                                       0);
+    if (!aout->device) {
+        LOGE("Could not open audio device: %s", SDL_GetError());
+        return false;
+    }
+
+    aout->audio_output.latency = obtained.samples;
+
+    return true;
+}
+
+static bool
+sc_audio_output_sdl_start(struct sc_audio_output *aout_) {
+    struct sc_audio_output_sdl *aout = DOWNCAST(aout_);
+
+    SDL_PauseAudioDevice(aout->device, 0);
+    return true;
+}
+
+static void
+sc_audio_output_sdl_close(struct sc_audio_output *aout_) {
+    struct sc_audio_output_sdl *aout = DOWNCAST(aout_);
+
+    assert(aout->device);
+    SDL_PauseAudioDevice(aout->device, 1);
+    SDL_CloseAudioDevice(aout->device);
+}
+
+void
+sc_audio_output_sdl_init(struct sc_audio_output_sdl *aout) {
+    static const struct sc_audio_output_ops ops = {
+        .open = sc_audio_output_sdl_open,
+        .start = sc_audio_output_sdl_start,
+        .close = sc_audio_output_sdl_close,
+    };
+
+    aout->audio_output.ops = &ops;
+}
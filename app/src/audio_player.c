@@ -5,19 +5,25 @@
 /** Downcast frame_sink to sc_audio_player */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_audio_player, frame_sink)
 
-#define SC_SDL_SAMPLE_FMT AUDIO_F32
+static void
+sc_audio_player_on_pull(struct sc_audio_output *output, uint8_t *data,
+                        uint32_t samples, void *userdata) {
+    (void) output;
 
-static void SDLCALL
-sc_audio_player_sdl_callback(void *userdata, uint8_t *stream, int len_int) {
+    // Called from the audio output thread
     struct sc_audio_player *ap = userdata;
 
-    assert(len_int > 0);
-    size_t len = len_int;
-
-    assert(len % ap->audioreg.sample_size == 0);
-    uint32_t out_samples = len / ap->audioreg.sample_size;
+    if (ap->av_sync) {
+        sc_tick pts;
+        if (sc_audio_regulator_get_pts(&ap->audioreg, &pts)) {
+            // The samples requested now will be heard once the samples
+            // already in the output buffer are played
+            sc_tick date = sc_tick_now() + ap->output_latency;
+            sc_av_sync_update_audio(ap->av_sync, date, pts);
+        }
+    }
 
-    sc_audio_regulator_pull(&ap->audioreg, stream, out_samples);
+    sc_audio_regulator_pull(&ap->audioreg, data, samples);
 }
 
 static bool
@@ -49,10 +55,16 @@ sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
 
     uint32_t target_buffering_samples =
         ap->target_buffering_delay * ctx->sample_rate / SC_TICK_FREQ;
+    uint32_t min_buffering_samples =
+        ap->min_buffering_delay * ctx->sample_rate / SC_TICK_FREQ;
+    uint32_t max_buffering_samples =
+        ap->max_buffering_delay * ctx->sample_rate / SC_TICK_FREQ;
 
     size_t sample_size = nb_channels * out_bytes_per_sample;
     bool ok = sc_audio_regulator_init(&ap->audioreg, sample_size, ctx,
-                                      target_buffering_samples);
+                                      target_buffering_samples,
+                                      min_buffering_samples,
+                                      max_buffering_samples);
     if (!ok) {
         return false;
     }
@@ -61,32 +73,40 @@ sc_audio_player_frame_sink_open(struct sc_frame_sink *sink,
                                                        / SC_TICK_FREQ;
     assert(aout_samples <= 0xFFFF);
 
-    SDL_AudioSpec desired = {
-        .freq = ctx->sample_rate,
-        .format = SC_SDL_SAMPLE_FMT,
+    const struct sc_audio_output_params params = {
+        .device = ap->output_device,
+        .sample_rate = ctx->sample_rate,
         .channels = nb_channels,
-        .samples = aout_samples,
-        .callback = sc_audio_player_sdl_callback,
-        .userdata = ap,
+        .period = aout_samples,
     };
-    SDL_AudioSpec obtained;
 
-    ap->device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
-    if (!ap->device) {
-        LOGE("Could not open audio device: %s", SDL_GetError());
+    static const struct sc_audio_output_callbacks cbs = {
+        .on_pull = sc_audio_player_on_pull,
+    };
+
+    ok = ap->output->ops->open(ap->output, &params, &cbs, ap);
+    if (!ok) {
         sc_audio_regulator_destroy(&ap->audioreg);
         return false;
     }
 
+    ap->output_latency = (sc_tick) ap->output->latency * SC_TICK_FREQ
+                                                       / ctx->sample_rate;
+
     // The thread calling open() is the thread calling push(), which fills the
-    // audio buffer consumed by the SDL audio thread.
+    // audio buffer consumed by the audio output thread.
     ok = sc_thread_set_priority(SC_THREAD_PRIORITY_TIME_CRITICAL);
     if (!ok) {
         ok = sc_thread_set_priority(SC_THREAD_PRIORITY_HIGH);
         (void) ok; // We don't care if it worked, at least we tried
     }
 
-    SDL_PauseAudioDevice(ap->device, 0);
+    ok = ap->output->ops->start(ap->output);
+    if (!ok) {
+        ap->output->ops->close(ap->output);
+        sc_audio_regulator_destroy(&ap->audioreg);
+        return false;
+    }
 
     return true;
 }
@@ -95,20 +115,44 @@ static void
 sc_audio_player_frame_sink_close(struct sc_frame_sink *sink) {
     struct sc_audio_player *ap = DOWNCAST(sink);
 
-    assert(ap->device);
-    SDL_PauseAudioDevice(ap->device, 1);
-    SDL_CloseAudioDevice(ap->device);
+    ap->output->ops->close(ap->output);
 
     sc_audio_regulator_destroy(&ap->audioreg);
 }
 
 void
 sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick output_buffer_duration) {
+                     sc_tick min_buffering, sc_tick max_buffering,
+                     sc_tick output_buffer_duration,
+                     enum sc_audio_output_backend output_backend,
+                     const char *output_device, struct sc_av_sync *av_sync) {
     ap->target_buffering_delay = target_buffering;
+    ap->min_buffering_delay = min_buffering;
+    ap->max_buffering_delay = max_buffering;
     ap->output_buffer_duration = output_buffer_duration;
+    ap->av_sync = av_sync;
+    ap->output_device = output_device;
+
+    switch (output_backend) {
+#ifdef HAVE_ALSA
+        case SC_AUDIO_OUTPUT_BACKEND_ALSA:
+            sc_audio_output_alsa_init(&ap->output_alsa);
+            ap->output = &ap->output_alsa.audio_output;
+            break;
+#endif
+        case SC_AUDIO_OUTPUT_BACKEND_NULL:
+            sc_audio_output_null_init(&ap->output_null);
+            ap->output = &ap->output_null.audio_output;
+            break;
+        default:
+            assert(output_backend == SC_AUDIO_OUTPUT_BACKEND_SDL);
+            sc_audio_output_sdl_init(&ap->output_sdl);
+            ap->output = &ap->output_sdl.audio_output;
+            break;
+    }
 
     static const struct sc_frame_sink_ops ops = {
+        .name = "player",
         .open = sc_audio_player_frame_sink_open,
         .close = sc_audio_player_frame_sink_close,
         .push = sc_audio_player_frame_sink_push,
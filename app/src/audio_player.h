@@ -5,9 +5,16 @@
 
 #include <stdatomic.h>
 #include <stdbool.h>
-#include <SDL2/SDL.h>
 
+#ifdef HAVE_ALSA
+# include "audio_output_alsa.h"
+#endif
+#include "audio_output_null.h"
+#include "audio_output_sdl.h"
 #include "audio_regulator.h"
+#include "av_sync.h"
+#include "options.h"
+#include "trait/audio_output.h"
 #include "trait/frame_sink.h"
 #include "util/tick.h"
 
@@ -21,15 +28,38 @@ struct sc_audio_player {
     // value should be higher.
     sc_tick target_buffering_delay;
 
-    // SDL audio output buffer size
+    // Bounds of the target buffering in adaptive mode (0 if not adaptive)
+    sc_tick min_buffering_delay;
+    sc_tick max_buffering_delay;
+
+    // Audio output buffer (period) size
     sc_tick output_buffer_duration;
 
-    SDL_AudioDeviceID device;
+    // Duration of the audio output buffer actually obtained
+    sc_tick output_latency;
+
+    // Audio clock to report to (may be NULL)
+    struct sc_av_sync *av_sync;
+
+    const char *output_device; // may be NULL
+
+    union {
+        struct sc_audio_output_sdl output_sdl;
+#ifdef HAVE_ALSA
+        struct sc_audio_output_alsa output_alsa;
+#endif
+        struct sc_audio_output_null output_null;
+    };
+    struct sc_audio_output *output;
+
     struct sc_audio_regulator audioreg;
 };
 
 void
 sc_audio_player_init(struct sc_audio_player *ap, sc_tick target_buffering,
-                     sc_tick audio_output_buffer);
+                     sc_tick min_buffering, sc_tick max_buffering,
+                     sc_tick audio_output_buffer,
+                     enum sc_audio_output_backend output_backend,
+                     const char *output_device, struct sc_av_sync *av_sync);
 
 #endif
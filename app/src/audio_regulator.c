@@ -110,93 +110,143 @@ sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
     atomic_store_explicit(&ar->played, true, memory_order_relaxed);
 }
 
-static uint8_t *
-sc_audio_regulator_get_swr_buf(struct sc_audio_regulator *ar,
-                               uint32_t min_samples) {
-    size_t min_buf_size = TO_BYTES(min_samples);
-    if (min_buf_size > ar->swr_buf_alloc_size) {
-        size_t new_size = min_buf_size + 4096;
-        uint8_t *buf = realloc(ar->swr_buf, new_size);
-        if (!buf) {
-            LOG_OOM();
-            // Could not realloc to the requested size
-            return NULL;
-        }
-        ar->swr_buf = buf;
-        ar->swr_buf_alloc_size = new_size;
+// PTS of the next sample to be played (called from the audio thread)
+bool
+sc_audio_regulator_get_pts(struct sc_audio_regulator *ar, sc_tick *pts) {
+    bool played = atomic_load_explicit(&ar->played, memory_order_relaxed);
+    if (!played
+            || !atomic_load_explicit(&ar->has_pts_end, memory_order_acquire)) {
+        return false;
+    }
+
+    // Load the PTS before the buffered samples count (it is published after
+    // the samples are committed)
+    sc_tick pts_end = atomic_load_explicit(&ar->pts_end, memory_order_acquire);
+    // The samples of a frame being pushed concurrently may already be counted
+    // (the error is at most one frame, it is smoothed by the caller)
+    uint32_t buffered = sc_audiobuf_can_read(&ar->buf);
+    if (!buffered) {
+        // Underflow, the next samples will be silence
+        return false;
     }
 
-    return ar->swr_buf;
+    *pts = pts_end - (sc_tick) buffered * SC_TICK_FREQ / ar->sample_rate;
+    return true;
 }
 
-bool
-sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
+// Resample the frame directly into the ring buffer, without intermediate
+// copy. Return the number of samples written, or -1 on error.
+static int64_t
+sc_audio_regulator_convert(struct sc_audio_regulator *ar, const AVFrame *frame,
+                           uint32_t *skipped_samples) {
     SwrContext *swr_ctx = ar->swr_ctx;
 
-    int64_t swr_delay = swr_get_delay(swr_ctx, ar->sample_rate);
-    // No need to av_rescale_rnd(), input and output sample rates are the same.
-    // Add more space (256) for clock compensation.
-    int dst_nb_samples = swr_delay + frame->nb_samples + 256;
+    // Once the input is consumed, keep a non-NULL input with a zero count to
+    // drain the samples buffered by swr_convert(): a NULL input would flush
+    // the resampler as if the stream ended.
+    const uint8_t **in = (const uint8_t **) frame->data;
+    int in_count = frame->nb_samples;
+
+    uint32_t written = 0;
+    *skipped_samples = 0;
+
+    for (;;) {
+        // Upper bound of the number of samples to output
+        int pending = swr_get_out_samples(swr_ctx, in_count);
+
+        struct sc_audiobuf_region regions[2];
+        uint32_t can_write =
+            sc_audiobuf_write_reserve(&ar->buf, MAX(pending, 0), regions);
+        if (!can_write) {
+            // Very unlikely: the buffer is far larger than the target
+            // buffering. Drop old samples to make space.
+            if (pending <= 0) {
+                // Nothing more to output
+                break;
+            }
 
-    uint8_t *swr_buf = sc_audio_regulator_get_swr_buf(ar, dst_nb_samples);
-    if (!swr_buf) {
-        return false;
-    }
+            sc_mutex_lock(&ar->mutex);
+            uint32_t can_read = sc_audiobuf_can_read(&ar->buf);
+            uint32_t drop = MIN((uint32_t) pending, can_read);
+            uint32_t r = sc_audiobuf_read(&ar->buf, NULL, drop);
+            assert(r == drop);
+            (void) r;
+            sc_mutex_unlock(&ar->mutex);
 
-    int ret = swr_convert(swr_ctx, &swr_buf, dst_nb_samples,
-                          (const uint8_t **) frame->data, frame->nb_samples);
-    if (ret < 0) {
-        LOGE("Resampling failed: %d", ret);
-        return false;
+            *skipped_samples += drop;
+            continue;
+        }
+
+        uint32_t converted = 0;
+        bool drained = false;
+        for (int i = 0; i < 2 && !drained; ++i) {
+            struct sc_audiobuf_region *region = &regions[i];
+            if (!region->samples_count) {
+                // No space left in this region, so not drained yet
+                continue;
+            }
+
+            uint8_t *out = region->data;
+            int ret = swr_convert(swr_ctx, &out, region->samples_count,
+                                  in, in_count);
+            if (ret < 0) {
+                LOGE("Resampling failed: %d", ret);
+                // Publish the samples already converted
+                sc_audiobuf_write_commit(&ar->buf, converted);
+                return -1;
+            }
+
+            // The input not output yet is buffered by the resampler
+            in_count = 0;
+
+            uint32_t samples = MIN((uint32_t) ret, region->samples_count);
+            converted += samples;
+            // If the region is not filled, then there is nothing more to
+            // output
+            drained = samples < region->samples_count;
+        }
+
+        sc_audiobuf_write_commit(&ar->buf, converted);
+        written += converted;
+
+        if (drained) {
+            break;
+        }
     }
 
-    // swr_convert() returns the number of samples which would have been
-    // written if the buffer was big enough.
-    uint32_t samples = MIN(ret, dst_nb_samples);
 #ifdef SC_AUDIO_REGULATOR_DEBUG
-    LOGD("[Audio] %" PRIu32 " samples written to buffer", samples);
+    LOGD("[Audio] %" PRIu32 " samples written to buffer", written);
 #endif
 
-    uint32_t cap = sc_audiobuf_capacity(&ar->buf);
-    if (samples > cap) {
-        // Very very unlikely: a single resampled frame should never
-        // exceed the audio buffer size (or something is very wrong).
-        // Ignore the first bytes in swr_buf to avoid memory corruption anyway.
-        swr_buf += TO_BYTES(samples - cap);
-        samples = cap;
-    }
-
-    uint32_t skipped_samples = 0;
+    return written;
+}
 
-    uint32_t written = sc_audiobuf_write(&ar->buf, swr_buf, samples);
-    if (written < samples) {
-        uint32_t remaining = samples - written;
+bool
+sc_audio_regulator_push_at(struct sc_audio_regulator *ar, const AVFrame *frame,
+                           sc_tick now) {
+    SwrContext *swr_ctx = ar->swr_ctx;
 
-        // All samples that could be written without locking have been written,
-        // now we need to lock to drop/consume old samples
-        sc_mutex_lock(&ar->mutex);
+    if (ar->adaptive && frame->pts != AV_NOPTS_VALUE) {
+        sc_adaptive_buffering_on_packet(&ar->adaptive_buffering, now,
+                                        SC_TICK_FROM_US(frame->pts));
+    }
 
-        // Retry with the lock
-        written += sc_audiobuf_write(&ar->buf,
-                                     swr_buf + TO_BYTES(written),
-                                     remaining);
-        if (written < samples) {
-            remaining = samples - written;
-            // Still insufficient, drop old samples to make space
-            skipped_samples = sc_audiobuf_read(&ar->buf, NULL, remaining);
-            assert(skipped_samples == remaining);
-        }
+    uint32_t skipped_samples;
+    int64_t ret = sc_audio_regulator_convert(ar, frame, &skipped_samples);
+    if (ret < 0) {
+        return false;
+    }
 
-        sc_mutex_unlock(&ar->mutex);
+    uint32_t written = ret;
 
-        if (written < samples) {
-            // Now there is enough space
-            uint32_t w = sc_audiobuf_write(&ar->buf,
-                                           swr_buf + TO_BYTES(written),
-                                           remaining);
-            assert(w == remaining);
-            (void) w;
-        }
+    if (frame->pts != AV_NOPTS_VALUE) {
+        // Published after the samples are committed, so the reader never sees
+        // a PTS for samples not in the buffer yet
+        sc_tick pts_end = SC_TICK_FROM_US(frame->pts)
+                        + (sc_tick) frame->nb_samples * SC_TICK_FREQ
+                                                      / ar->sample_rate;
+        atomic_store_explicit(&ar->pts_end, pts_end, memory_order_release);
+        atomic_store_explicit(&ar->has_pts_end, true, memory_order_release);
     }
 
     uint32_t underflow = 0;
@@ -205,6 +255,10 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
     if (played) {
         underflow = atomic_exchange_explicit(&ar->underflow, 0,
                                              memory_order_relaxed);
+        if (ar->adaptive && underflow) {
+            sc_adaptive_buffering_on_underflow(&ar->adaptive_buffering,
+                                               underflow);
+        }
 
         max_buffered_samples = ar->target_buffering * 11 / 10
                              + 60 * ar->sample_rate / 1000 /* 60 ms */;
@@ -283,6 +337,12 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
         // Recompute compensation every second
         ar->samples_since_resync = 0;
 
+        if (ar->adaptive
+                && sc_adaptive_buffering_update(&ar->adaptive_buffering)) {
+            // The compensation will progressively reach the new target
+            ar->target_buffering = ar->adaptive_buffering.target;
+        }
+
         float avg = sc_average_get(&ar->avg_buffering);
         int diff = ar->target_buffering - avg;
 
@@ -315,15 +375,22 @@ sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
             // not fatal
         } else {
             ar->compensation_active = diff != 0;
+            ar->compensation = diff;
         }
     }
 
     return true;
 }
 
+bool
+sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame) {
+    return sc_audio_regulator_push_at(ar, frame, sc_tick_now());
+}
+
 bool
 sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
-                        const AVCodecContext *ctx, uint32_t target_buffering) {
+                        const AVCodecContext *ctx, uint32_t target_buffering,
+                        uint32_t min_buffering, uint32_t max_buffering) {
     SwrContext *swr_ctx = swr_alloc();
     if (!swr_ctx) {
         LOG_OOM();
@@ -358,29 +425,31 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
         goto error_free_swr_ctx;
     }
 
-    ar->target_buffering = target_buffering;
     ar->sample_size = sample_size;
     ar->sample_rate = ctx->sample_rate;
 
-    // Use a ring-buffer of the target buffering size plus 1 second between the
-    // producer and the consumer. It's too big on purpose, to guarantee that
-    // the producer and the consumer will be able to access it in parallel
-    // without locking.
-    uint32_t audiobuf_samples = target_buffering + ar->sample_rate;
+    ar->adaptive = max_buffering != 0;
+    if (ar->adaptive) {
+        sc_adaptive_buffering_init(&ar->adaptive_buffering, ar->sample_rate,
+                                   min_buffering, max_buffering,
+                                   target_buffering);
+        // The initial target is clamped to the bounds
+        target_buffering = ar->adaptive_buffering.target;
+    }
+    ar->target_buffering = target_buffering;
+
+    // Use a ring-buffer of the (max) target buffering size plus 1 second
+    // between the producer and the consumer. It's too big on purpose, to
+    // guarantee that the producer and the consumer will be able to access it
+    // in parallel without locking.
+    uint32_t max_target = MAX(target_buffering, max_buffering);
+    uint32_t audiobuf_samples = max_target + ar->sample_rate;
 
     ok = sc_audiobuf_init(&ar->buf, sample_size, audiobuf_samples);
     if (!ok) {
         goto error_destroy_mutex;
     }
 
-    size_t initial_swr_buf_size = TO_BYTES(4096);
-    ar->swr_buf = malloc(initial_swr_buf_size);
-    if (!ar->swr_buf) {
-        LOG_OOM();
-        goto error_destroy_audiobuf;
-    }
-    ar->swr_buf_alloc_size = initial_swr_buf_size;
-
     // Samples are produced and consumed by blocks, so the buffering must be
     // smoothed to get a relatively stable value.
     sc_average_init(&ar->avg_buffering, 128);
@@ -390,12 +459,13 @@ sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
     atomic_init(&ar->played, false);
     atomic_init(&ar->received, false);
     atomic_init(&ar->underflow, 0);
+    atomic_init(&ar->pts_end, 0);
+    atomic_init(&ar->has_pts_end, false);
     ar->compensation_active = false;
+    ar->compensation = 0;
 
     return true;
 
-error_destroy_audiobuf:
-    sc_audiobuf_destroy(&ar->buf);
 error_destroy_mutex:
     sc_mutex_destroy(&ar->mutex);
 error_free_swr_ctx:
@@ -406,7 +476,6 @@ error_free_swr_ctx:
 
 void
 sc_audio_regulator_destroy(struct sc_audio_regulator *ar) {
-    free(ar->swr_buf);
     sc_audiobuf_destroy(&ar->buf);
     sc_mutex_destroy(&ar->mutex);
     swr_free(&ar->swr_ctx);
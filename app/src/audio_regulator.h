@@ -7,9 +7,11 @@
 #include <stdbool.h>
 #include <libavcodec/avcodec.h>
 #include <libswresample/swresample.h>
+#include "adaptive_buffering.h"
 #include "util/audiobuf.h"
 #include "util/average.h"
 #include "util/thread.h"
+#include "util/tick.h"
 
 #define SC_AV_SAMPLE_FMT AV_SAMPLE_FMT_FLT
 
@@ -17,8 +19,15 @@ struct sc_audio_regulator {
     sc_mutex mutex;
 
     // Target buffering between the producer and the consumer (in samples)
+    // In adaptive mode, it is only updated once playback has started, so it
+    // is only read by the consumer before (no data race)
     uint32_t target_buffering;
 
+    // Adapt the target buffering to the link (only used by the receiver
+    // thread)
+    bool adaptive;
+    struct sc_adaptive_buffering adaptive_buffering;
+
     // Audio buffer to communicate between the receiver and the player
     struct sc_audiobuf buf;
 
@@ -30,10 +39,6 @@ struct sc_audio_regulator {
     // The number of bytes per sample (for all channels)
     size_t sample_size;
 
-    // Target buffer for resampling (only used by the receiver thread)
-    uint8_t *swr_buf;
-    size_t swr_buf_alloc_size;
-
     // Number of buffered samples (may be negative on underflow) (only used by
     // the receiver thread)
     struct sc_average avg_buffering;
@@ -46,17 +51,32 @@ struct sc_audio_regulator {
 
     // Non-zero compensation applied (only used by the receiver thread)
     bool compensation_active;
+    // Last compensation applied, in samples over 4 seconds (only used by the
+    // receiver thread)
+    int compensation;
 
     // Set to true the first time a sample is received
     atomic_bool received;
 
     // Set to true the first time samples are pulled by the player
     atomic_bool played;
+
+    // Device PTS of the end of the last samples written to the buffer (only
+    // valid if has_pts_end is set)
+    atomic_int_least64_t pts_end;
+    atomic_bool has_pts_end;
 };
 
+/**
+ * Initialize an audio regulator
+ *
+ * If max_buffering is not 0, then the target buffering is adapted to the
+ * observed jitter and underflows, within [min_buffering; max_buffering].
+ */
 bool
 sc_audio_regulator_init(struct sc_audio_regulator *ar, size_t sample_size,
-                        const AVCodecContext *ctx, uint32_t target_buffering);
+                        const AVCodecContext *ctx, uint32_t target_buffering,
+                        uint32_t min_buffering, uint32_t max_buffering);
 
 void
 sc_audio_regulator_destroy(struct sc_audio_regulator *ar);
@@ -64,8 +84,28 @@ sc_audio_regulator_destroy(struct sc_audio_regulator *ar);
 bool
 sc_audio_regulator_push(struct sc_audio_regulator *ar, const AVFrame *frame);
 
+/**
+ * Push a frame received at the given date
+ *
+ * sc_audio_regulator_push() calls this function with the current date. It is
+ * exposed to run the regulator on a simulated clock.
+ */
+bool
+sc_audio_regulator_push_at(struct sc_audio_regulator *ar, const AVFrame *frame,
+                           sc_tick now);
+
 void
 sc_audio_regulator_pull(struct sc_audio_regulator *ar, uint8_t *out,
                         uint32_t samples);
 
+/**
+ * Get the device PTS of the next sample to be pulled
+ *
+ * Return false if it is unknown (playback not started or buffer underflow).
+ *
+ * Must be called from the thread calling sc_audio_regulator_pull().
+ */
+bool
+sc_audio_regulator_get_pts(struct sc_audio_regulator *ar, sc_tick *pts);
+
 #endif
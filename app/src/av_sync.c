@@ -0,0 +1,62 @@
+#include "av_sync.h"
+
+void
+sc_av_sync_init(struct sc_av_sync *sync) {
+    sc_clock_init(&sync->audio_clock);
+    atomic_init(&sync->audio_offset, 0);
+    atomic_init(&sync->audio_raw_offset, 0);
+    atomic_init(&sync->audio_date, 0);
+    atomic_init(&sync->has_audio_clock, false);
+}
+
+void
+sc_av_sync_update_audio(struct sc_av_sync *sync, sc_tick date, sc_tick pts) {
+    // The audio callback is not called at a perfectly regular rate, smooth the
+    // offset
+    sc_clock_update(&sync->audio_clock, date, pts);
+
+    atomic_store_explicit(&sync->audio_offset, sync->audio_clock.offset,
+                          memory_order_relaxed);
+    atomic_store_explicit(&sync->audio_raw_offset, date - pts,
+                          memory_order_relaxed);
+    atomic_store_explicit(&sync->audio_date, date, memory_order_relaxed);
+    atomic_store_explicit(&sync->has_audio_clock, true, memory_order_release);
+}
+
+static bool
+sc_av_sync_is_running(struct sc_av_sync *sync, sc_tick now) {
+    if (!atomic_load_explicit(&sync->has_audio_clock, memory_order_acquire)) {
+        return false;
+    }
+
+    // The audio clock is not updated while the audio is stalled (buffer
+    // underflow)
+    sc_tick audio_date = atomic_load_explicit(&sync->audio_date,
+                                              memory_order_relaxed);
+    return now - audio_date < SC_AV_SYNC_STALL_DELAY;
+}
+
+bool
+sc_av_sync_to_system_time(struct sc_av_sync *sync, sc_tick pts, sc_tick now,
+                          sc_tick *date) {
+    if (!sc_av_sync_is_running(sync, now)) {
+        return false;
+    }
+
+    sc_tick offset = atomic_load_explicit(&sync->audio_offset,
+                                          memory_order_relaxed);
+    *date = pts + offset;
+    return true;
+}
+
+bool
+sc_av_sync_get_audio_pts(struct sc_av_sync *sync, sc_tick now, sc_tick *pts) {
+    if (!sc_av_sync_is_running(sync, now)) {
+        return false;
+    }
+
+    sc_tick offset = atomic_load_explicit(&sync->audio_raw_offset,
+                                          memory_order_relaxed);
+    *pts = now - offset;
+    return true;
+}
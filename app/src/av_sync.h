@@ -0,0 +1,84 @@
+#ifndef SC_AV_SYNC_H
+#define SC_AV_SYNC_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "clock.h"
+#include "util/tick.h"
+
+// In sync mode, video frames are never delayed by more than the audio
+// buffering plus this margin (to absorb the additional audio latency on the
+// device side)
+#define SC_AV_SYNC_MAX_DELAY_MARGIN SC_TICK_FROM_MS(200)
+
+// If the audio clock is not updated for this duration (after the date the last
+// reported samples were heard), the audio is considered stalled
+#define SC_AV_SYNC_STALL_DELAY SC_TICK_FROM_MS(200)
+
+/**
+ * Audio clock, to present the video frames in sync with the audio
+ *
+ * Audio and video PTS are both produced from the device monotonic clock, so
+ * they can be compared directly.
+ *
+ * The audio player regularly reports the device PTS of the samples it is about
+ * to play, along with the (system) date at which they will be heard. The
+ * video delay buffer uses this relation to present each frame at the date the
+ * audio with the same PTS is heard.
+ *
+ * While there is no audio clock (the audio is not started yet, or stalled),
+ * the video frames are not synchronized.
+ */
+struct sc_av_sync {
+    // Only accessed by the audio thread
+    struct sc_clock audio_clock;
+
+    // Published estimation of (system time - device time) for the audio
+    atomic_int_least64_t audio_offset;
+    // Offset of the last report, not smoothed
+    atomic_int_least64_t audio_raw_offset;
+    // System date at which the last reported samples are heard
+    atomic_int_least64_t audio_date;
+    atomic_bool has_audio_clock;
+};
+
+void
+sc_av_sync_init(struct sc_av_sync *sync);
+
+/**
+ * Report that the audio sample with the device PTS `pts` will be played at
+ * the system date `date`
+ *
+ * Must be called from the audio thread.
+ */
+void
+sc_av_sync_update_audio(struct sc_av_sync *sync, sc_tick date, sc_tick pts);
+
+/**
+ * Get the system date at which the audio with the device PTS `pts` is played
+ *
+ * Return false if the audio clock is not known yet, or if the audio is stalled
+ * at the system date `now`.
+ *
+ * May be called from any thread.
+ */
+bool
+sc_av_sync_to_system_time(struct sc_av_sync *sync, sc_tick pts, sc_tick now,
+                          sc_tick *date);
+
+/**
+ * Get the device PTS of the audio heard at the system date `now`, from the last
+ * report (without smoothing)
+ *
+ * Return false if the audio clock is not known yet, or if the audio is stalled.
+ *
+ * May be called from any thread.
+ */
+bool
+sc_av_sync_get_audio_pts(struct sc_av_sync *sync, sc_tick now, sc_tick *pts);
+
+#endif
@@ -0,0 +1,264 @@
+#include "benchmark.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <time.h>
+#ifdef _WIN32
+# include <windows.h>
+#endif
+
+#include "util/log.h"
+
+/** Downcast packet_sink to sc_benchmark */
+#define DOWNCAST_PACKET(SINK) \
+    container_of(SINK, struct sc_benchmark, packet_sink)
+/** Downcast frame_sink to sc_benchmark */
+#define DOWNCAST_FRAME(SINK) container_of(SINK, struct sc_benchmark, frame_sink)
+
+#define SC_BENCHMARK_INTERVAL SC_TICK_FROM_SEC(1)
+
+#ifdef _WIN32
+static sc_tick
+filetime_to_tick(const FILETIME *ft) {
+    // FILETIME is expressed in 100-nanosecond intervals
+    uint64_t t = ((uint64_t) ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+    return SC_TICK_FROM_NS(t * 100);
+}
+#endif
+
+static sc_tick
+get_process_cpu_time(void) {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel,
+                         &user)) {
+        return 0;
+    }
+    return filetime_to_tick(&kernel) + filetime_to_tick(&user);
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts)) {
+        return 0;
+    }
+    return SC_TICK_FROM_SEC(ts.tv_sec) + SC_TICK_FROM_NS(ts.tv_nsec);
+#endif
+}
+
+// CPU time of the current thread (the demuxer/decoder thread)
+static sc_tick
+get_thread_cpu_time(void) {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel,
+                        &user)) {
+        return 0;
+    }
+    return filetime_to_tick(&kernel) + filetime_to_tick(&user);
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) {
+        return 0;
+    }
+    return SC_TICK_FROM_SEC(ts.tv_sec) + SC_TICK_FROM_NS(ts.tv_nsec);
+#endif
+}
+
+static inline unsigned
+percent(sc_tick part, sc_tick total) {
+    return total > 0 ? (unsigned) (part * 100 / total) : 0;
+}
+
+static void
+sc_benchmark_start_interval(struct sc_benchmark *bench, sc_tick now) {
+    bench->interval_start = now;
+    bench->interval_process_cpu = get_process_cpu_time();
+    bench->interval_thread_cpu = get_thread_cpu_time();
+    bench->interval_frames = 0;
+    bench->interval_measured = 0;
+    bench->interval_latency_total = 0;
+    bench->interval_latency_max = 0;
+}
+
+static void
+sc_benchmark_check_interval(struct sc_benchmark *bench, sc_tick now) {
+    sc_tick elapsed = now - bench->interval_start;
+    if (elapsed < SC_BENCHMARK_INTERVAL) {
+        return;
+    }
+
+    sc_tick process_cpu = get_process_cpu_time() - bench->interval_process_cpu;
+    sc_tick thread_cpu = get_thread_cpu_time() - bench->interval_thread_cpu;
+
+    unsigned fps = bench->interval_frames * SC_TICK_FREQ / elapsed;
+    sc_tick avg = bench->interval_measured
+                ? bench->interval_latency_total / bench->interval_measured
+                : 0;
+    LOGI("Benchmark: %u fps, decode latency avg %" PRItick ".%03" PRItick
+         " ms, max %" PRItick ".%03" PRItick " ms, CPU %u%% (decoder "
+         "thread %u%%)", fps,
+         SC_TICK_TO_MS(avg), SC_TICK_TO_US(avg) % 1000,
+         SC_TICK_TO_MS(bench->interval_latency_max),
+         SC_TICK_TO_US(bench->interval_latency_max) % 1000,
+         percent(process_cpu, elapsed), percent(thread_cpu, elapsed));
+
+    sc_benchmark_start_interval(bench, now);
+}
+
+static bool
+sc_benchmark_packet_sink_open(struct sc_packet_sink *sink,
+                              AVCodecContext *ctx) {
+    struct sc_benchmark *bench = DOWNCAST_PACKET(sink);
+    (void) ctx;
+
+    for (unsigned i = 0; i < SC_BENCHMARK_PENDING_PACKETS; ++i) {
+        bench->pending[i].pts = AV_NOPTS_VALUE;
+    }
+    bench->pending_index = 0;
+
+    bench->packets = 0;
+    bench->frames = 0;
+    bench->frames_without_latency = 0;
+    bench->latency_total = 0;
+    bench->latency_min = 0;
+    bench->latency_max = 0;
+
+    sc_tick now = sc_tick_now();
+    bench->start_date = now;
+    bench->start_process_cpu = get_process_cpu_time();
+    bench->start_thread_cpu = get_thread_cpu_time();
+    sc_benchmark_start_interval(bench, now);
+
+    return true;
+}
+
+static void
+sc_benchmark_packet_sink_close(struct sc_packet_sink *sink) {
+    struct sc_benchmark *bench = DOWNCAST_PACKET(sink);
+
+    sc_tick elapsed = sc_tick_now() - bench->start_date;
+    if (!elapsed || !bench->frames) {
+        LOGI("Benchmark: no frame decoded");
+        return;
+    }
+
+    sc_tick process_cpu = get_process_cpu_time() - bench->start_process_cpu;
+    sc_tick thread_cpu = get_thread_cpu_time() - bench->start_thread_cpu;
+
+    uint64_t measured = bench->frames - bench->frames_without_latency;
+    sc_tick avg = measured ? bench->latency_total / (sc_tick) measured : 0;
+
+    LOGI("Benchmark: %" PRIu64 " packets, %" PRIu64 " frames decoded in %"
+         PRItick " ms (%" PRIu64 " fps)", bench->packets, bench->frames,
+         SC_TICK_TO_MS(elapsed),
+         bench->frames * SC_TICK_FREQ / (uint64_t) elapsed);
+    LOGI("Benchmark: decode latency avg %" PRItick " us, min %" PRItick
+         " us, max %" PRItick " us", SC_TICK_TO_US(avg),
+         SC_TICK_TO_US(bench->latency_min), SC_TICK_TO_US(bench->latency_max));
+    LOGI("Benchmark: CPU time %" PRItick " ms (%u%%), decoder thread %"
+         PRItick " ms (%u%%)", SC_TICK_TO_MS(process_cpu),
+         percent(process_cpu, elapsed), SC_TICK_TO_MS(thread_cpu),
+         percent(thread_cpu, elapsed));
+}
+
+static bool
+sc_benchmark_packet_sink_push(struct sc_packet_sink *sink,
+                              const AVPacket *packet) {
+    struct sc_benchmark *bench = DOWNCAST_PACKET(sink);
+
+    ++bench->packets;
+
+    if (packet->pts != AV_NOPTS_VALUE) {
+        bench->pending[bench->pending_index].pts = packet->pts;
+        bench->pending[bench->pending_index].date = sc_tick_now();
+        bench->pending_index =
+            (bench->pending_index + 1) % SC_BENCHMARK_PENDING_PACKETS;
+    }
+
+    return true;
+}
+
+static bool
+sc_benchmark_frame_sink_open(struct sc_frame_sink *sink,
+                             const AVCodecContext *ctx) {
+    (void) sink;
+    (void) ctx;
+    // Everything is initialized by the packet sink
+    return true;
+}
+
+static void
+sc_benchmark_frame_sink_close(struct sc_frame_sink *sink) {
+    (void) sink;
+    // The summary is logged by the packet sink
+}
+
+static bool
+sc_benchmark_frame_sink_push(struct sc_frame_sink *sink,
+                             const AVFrame *frame) {
+    struct sc_benchmark *bench = DOWNCAST_FRAME(sink);
+
+    sc_tick now = sc_tick_now();
+
+    ++bench->frames;
+    ++bench->interval_frames;
+
+    // Search the most recent packet first
+    bool found = false;
+    unsigned index = bench->pending_index;
+    for (unsigned i = 0; i < SC_BENCHMARK_PENDING_PACKETS; ++i) {
+        index = (index + SC_BENCHMARK_PENDING_PACKETS - 1)
+              % SC_BENCHMARK_PENDING_PACKETS;
+        if (bench->pending[index].pts == frame->pts) {
+            found = true;
+            break;
+        }
+    }
+
+    if (found) {
+        sc_tick latency = now - bench->pending[index].date;
+        // Consume the entry
+        bench->pending[index].pts = AV_NOPTS_VALUE;
+
+        ++bench->interval_measured;
+        bench->interval_latency_total += latency;
+        if (latency > bench->interval_latency_max) {
+            bench->interval_latency_max = latency;
+        }
+
+        uint64_t measured = bench->frames - bench->frames_without_latency;
+        if (measured == 1 || latency < bench->latency_min) {
+            bench->latency_min = latency;
+        }
+        if (latency > bench->latency_max) {
+            bench->latency_max = latency;
+        }
+        bench->latency_total += latency;
+    } else {
+        ++bench->frames_without_latency;
+    }
+
+    sc_benchmark_check_interval(bench, now);
+
+    // The frame is discarded
+    return true;
+}
+
+void
+sc_benchmark_init(struct sc_benchmark *bench) {
+    static const struct sc_packet_sink_ops packet_ops = {
+        .name = "benchmark",
+        .open = sc_benchmark_packet_sink_open,
+        .close = sc_benchmark_packet_sink_close,
+        .push = sc_benchmark_packet_sink_push,
+    };
+
+    static const struct sc_frame_sink_ops frame_ops = {
+        .name = "benchmark",
+        .open = sc_benchmark_frame_sink_open,
+        .close = sc_benchmark_frame_sink_close,
+        .push = sc_benchmark_frame_sink_push,
+    };
+
+    bench->packet_sink.ops = &packet_ops;
+    bench->frame_sink.ops = &frame_ops;
+}
@@ -0,0 +1,62 @@
+#ifndef SC_BENCHMARK_H
+#define SC_BENCHMARK_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "trait/frame_sink.h"
+#include "trait/packet_sink.h"
+#include "util/tick.h"
+
+#define SC_BENCHMARK_PENDING_PACKETS 64
+
+/**
+ * Decoding benchmark
+ *
+ * It is both a packet sink (to be attached to the demuxer, before the
+ * decoder) and a frame sink (to be attached to the decoder). Frames are
+ * discarded.
+ *
+ * The packet sink records the date when each packet is received, so that the
+ * frame sink can measure the decoding latency (the decoder runs on the
+ * demuxer thread, so no synchronization is needed).
+ */
+struct sc_benchmark {
+    struct sc_packet_sink packet_sink; // packet sink trait
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    // Receive dates of the last packets, indexed by PTS
+    struct {
+        int64_t pts;
+        sc_tick date;
+    } pending[SC_BENCHMARK_PENDING_PACKETS];
+    unsigned pending_index;
+
+    sc_tick start_date;
+    sc_tick start_process_cpu;
+    sc_tick start_thread_cpu;
+
+    // Current interval
+    sc_tick interval_start;
+    sc_tick interval_process_cpu;
+    sc_tick interval_thread_cpu;
+    unsigned interval_frames;
+    unsigned interval_measured; // frames with a known latency
+    sc_tick interval_latency_total;
+    sc_tick interval_latency_max;
+
+    // Whole session
+    uint64_t packets;
+    uint64_t frames;
+    uint64_t frames_without_latency;
+    sc_tick latency_total;
+    sc_tick latency_min;
+    sc_tick latency_max;
+};
+
+void
+sc_benchmark_init(struct sc_benchmark *bench);
+
+#endif
@@ -113,6 +113,22 @@ enum {
     OPT_NO_VD_DESTROY_CONTENT,
     OPT_RECORD_EVENTS,
     OPT_REPLAY,
+    OPT_SHM_SINK,
+    OPT_ASYNC_SINKS,
+    OPT_VIDEO_BUFFER_MAX_MEMORY,
+    OPT_BENCHMARK,
+    OPT_SCREENSHOT_DIR,
+    OPT_SCREENSHOT_FORMAT,
+    OPT_SCREENSHOT_BURST,
+    OPT_PING_INTERVAL,
+    OPT_INPUT_PREDICTION,
+    OPT_MOUSE_SAMPLING_RATE,
+    OPT_NO_MOUSE_HID_SAMPLING,
+    OPT_AV_SYNC,
+    OPT_AUDIO_BUFFER_ADAPTIVE,
+    OPT_AUDIO_OUTPUT,
+    OPT_AUDIO_OUTPUT_DEVICE,
+    OPT_AUDIO_METER,
 };
 
 struct sc_option {
@@ -161,6 +177,17 @@ static const struct sc_option options[] = {
         .text = "Rotate the video content by a custom angle, in degrees "
                 "(clockwise).",
     },
+    {
+        .longopt_id = OPT_ASYNC_SINKS,
+        .longopt = "async-sinks",
+        .argdesc = "sink[,...]",
+        .text = "Feed the given secondary sinks from their own thread, through "
+                "a bounded queue, so that they never delay the video "
+                "playback.\n"
+                "Possible values are \"recorder\", \"v4l2\" and \"shm\".\n"
+                "A slow asynchronous V4L2 or shared memory sink drops the "
+                "oldest frames; the recorder never drops packets.",
+    },
     {
         .longopt_id = OPT_AUDIO_BIT_RATE,
         .longopt = "audio-bit-rate",
@@ -178,6 +205,18 @@ static const struct sc_option options[] = {
                 "likelihood of buffer underrun (causing audio glitches).\n"
                 "Default is 50.",
     },
+    {
+        .longopt_id = OPT_AUDIO_BUFFER_ADAPTIVE,
+        .longopt = "audio-buffer-adaptive",
+        .argdesc = "min:max",
+        .text = "Adapt the audio buffering delay to the link, within the "
+                "given bounds (in milliseconds).\n"
+                "The target buffering is increased on buffer underrun, and "
+                "slowly decreased while the packet arrival jitter allows it. "
+                "Each adjustment is logged.\n"
+                "The initial value is the --audio-buffer value (clamped to "
+                "the bounds).",
+    },
     {
         .longopt_id = OPT_AUDIO_CODEC,
         .longopt = "audio-codec",
@@ -212,6 +251,16 @@ static const struct sc_option options[] = {
                 "codec provided by --audio-codec).\n"
                 "The available encoders can be listed by --list-encoders.",
     },
+    {
+        .longopt_id = OPT_AUDIO_METER,
+        .longopt = "audio-meter",
+        .text = "Measure the level of the decoded audio, and log the RMS and "
+                "peak levels (in dBFS) of each channel every second, along "
+                "with silence (below -60 dBFS for at least 1 second) and "
+                "clipping events.\n"
+                "A summary is logged on exit.\n"
+                "It also works with --no-audio-playback.",
+    },
     {
         .longopt_id = OPT_AUDIO_SOURCE,
         .longopt = "audio-source",
@@ -225,16 +274,61 @@ static const struct sc_option options[] = {
                 "The \"mic\" source captures the microphone.\n"
                 "Default is output.",
     },
+    {
+        .longopt_id = OPT_AUDIO_OUTPUT,
+        .longopt = "audio-output",
+        .argdesc = "backend",
+        .text = "Select the audio output backend (sdl, alsa or null).\n"
+                "The \"alsa\" backend (Linux only) writes directly to an "
+                "ALSA device, with a period size configured by "
+                "--audio-output-buffer (use a \"hw:\" device to bypass the "
+                "mixer, or \"plughw:\" if the device does not support the "
+                "stream sample rate or channels).\n"
+                "The \"null\" backend consumes the samples in real time "
+                "without any sound card, and writes them to a WAV file if "
+                "--audio-output-device is set.\n"
+                "Default is sdl.",
+    },
     {
         .longopt_id = OPT_AUDIO_OUTPUT_BUFFER,
         .longopt = "audio-output-buffer",
         .argdesc = "ms",
-        .text = "Configure the size of the SDL audio output buffer (in "
+        .text = "Configure the size of the audio output buffer (in "
                 "milliseconds).\n"
                 "If you get \"robotic\" audio playback, you should test with "
                 "a higher value (10). Do not change this setting otherwise.\n"
                 "Default is 5.",
     },
+    {
+        .longopt_id = OPT_AUDIO_OUTPUT_DEVICE,
+        .longopt = "audio-output-device",
+        .argdesc = "name",
+        .text = "Select the audio output device, depending on the audio "
+                "output backend (--audio-output): the SDL device name, the "
+                "ALSA PCM name (e.g. \"hw:0,0\"), or the path of the WAV "
+                "file to write for the null backend.\n"
+                "By default, the system default device is used (and nothing "
+                "is written for the null backend).",
+    },
+    {
+        .longopt_id = OPT_AV_SYNC,
+        .longopt = "av-sync",
+        .text = "Present the video frames in sync with the audio playback, "
+                "using the device timestamps of both streams (it increases "
+                "the video latency to match the audio latency).\n"
+                "A video frame is never delayed by more than the audio "
+                "buffering plus 200ms (or --video-buffer if it is greater).\n"
+                "The measured A/V offset is logged on exit.",
+    },
+    {
+        .longopt_id = OPT_BENCHMARK,
+        .longopt = "benchmark",
+        .text = "Decode the video stream and discard the frames, while "
+                "logging the decoding throughput (fps), the decoding latency "
+                "and the CPU usage every second.\n"
+                "Use it with --no-window to benchmark the decoding "
+                "independently of the display.",
+    },
     {
         .shortopt = 'b',
         .longopt = "video-bit-rate",
@@ -431,6 +525,15 @@ static const struct sc_option options[] = {
         .shortopt = 'K',
         .text = "Same as --keyboard=uhid, or --keyboard=aoa if --otg is set.",
     },
+    {
+        .longopt_id = OPT_INPUT_PREDICTION,
+        .longopt = "input-prediction",
+        .text = "Draw the mouse pointer (or touch) positions and drag trail "
+                "locally over the device screen, until they are visible on "
+                "the frames received from the device.\n"
+                "This reduces the perceived input latency over a slow link "
+                "(e.g. Wi-Fi).",
+    },
     {
         .longopt_id = OPT_KEYBOARD,
         .longopt = "keyboard",
@@ -575,6 +678,17 @@ static const struct sc_option options[] = {
                 "Default is 'bhsn:++++' for SDK mouse, and '++++:bhsn' for AOA "
                 "and UHID.",
     },
+    {
+        .longopt_id = OPT_MOUSE_SAMPLING_RATE,
+        .longopt = "mouse-sampling-rate",
+        .argdesc = "hz",
+        .text = "Limit the rate of mouse motion and scroll events sent to the "
+                "device. The relative motion and scroll deltas received in "
+                "between are accumulated.\n"
+                "This avoids flooding the device with high-rate mice "
+                "(1000 Hz or more).\n"
+                "Default is 0 (forward every event).",
+    },
     {
         .shortopt = 'n',
         .longopt = "no-control",
@@ -651,6 +765,12 @@ static const struct sc_option options[] = {
                 "mipmaps are automatically generated to improve downscaling "
                 "quality. This option disables the generation of mipmaps.",
     },
+    {
+        .longopt_id = OPT_NO_MOUSE_HID_SAMPLING,
+        .longopt = "no-mouse-hid-sampling",
+        .text = "Do not apply --mouse-sampling-rate to the UHID and AOA mice, "
+                "to keep the full precision of the relative motion.",
+    },
     {
         .longopt_id = OPT_NO_MOUSE_HOVER,
         .longopt = "no-mouse-hover",
@@ -714,6 +834,15 @@ static const struct sc_option options[] = {
                 "It may only work over USB.\n"
                 "See --keyboard, --mouse and --gamepad.",
     },
+    {
+        .longopt_id = OPT_PING_INTERVAL,
+        .longopt = "ping-interval",
+        .argdesc = "ms",
+        .text = "Periodically send a ping message over the control channel, "
+                "and report the round-trip time and queueing delay "
+                "percentiles.\n"
+                "Default is 0 (disabled).",
+    },
     {
         .shortopt = 'p',
         .longopt = "port",
@@ -835,6 +964,44 @@ static const struct sc_option options[] = {
         .text = "Set the screen off timeout while scrcpy is running (restore "
                 "the initial value on exit).",
     },
+    {
+        .longopt_id = OPT_SCREENSHOT_BURST,
+        .longopt = "screenshot-burst",
+        .argdesc = "seconds",
+        .text = "Set the duration of a burst capture (MOD+Shift+b): every "
+                "frame received during this duration is kept in memory, then "
+                "written to disk once the burst is complete.\n"
+                "Default is 3.",
+    },
+    {
+        .longopt_id = OPT_SCREENSHOT_DIR,
+        .longopt = "screenshot-dir",
+        .argdesc = "path",
+        .text = "Set the directory where screenshots (MOD+Shift+s) and burst "
+                "captures (MOD+Shift+b) are written.\n"
+                "Default is the current directory.",
+    },
+    {
+        .longopt_id = OPT_SCREENSHOT_FORMAT,
+        .longopt = "screenshot-format",
+        .argdesc = "format",
+        .text = "Set the screenshot file format, either \"png\" or \"raw\" "
+                "(planar YUV 4:2:0, I420, without header; the frame size is "
+                "part of the file name).\n"
+                "Screenshots are captured at the device resolution, "
+                "independently of the window size.\n"
+                "Default is png.",
+    },
+    {
+        .longopt_id = OPT_SHM_SINK,
+        .longopt = "shm-sink",
+        .argdesc = "name",
+        .text = "Publish decoded video frames to a POSIX shared memory object "
+                "(/dev/shm/<name> on Linux), so that local processes can read "
+                "the latest frames without copy.\n"
+                "See doc/shm.md for the memory layout.\n"
+                "This feature is not available on Windows.",
+    },
     {
         .longopt_id = OPT_SHORTCUT_MOD,
         .longopt = "shortcut-mod",
@@ -952,6 +1119,15 @@ static const struct sc_option options[] = {
                 "This increases latency to compensate for jitter.\n"
                 "Default is 0 (no buffering).",
     },
+    {
+        .longopt_id = OPT_VIDEO_BUFFER_MAX_MEMORY,
+        .longopt = "video-buffer-max-memory",
+        .argdesc = "MiB",
+        .text = "Limit the memory used to store the frames delayed by "
+                "--video-buffer or --v4l2-buffer (in MiB). If the limit is "
+                "reached, the oldest frames are dropped.\n"
+                "Default is 512.",
+    },
     {
         .longopt_id = OPT_VIDEO_CODEC,
         .longopt = "video-codec",
@@ -1167,6 +1343,15 @@ static const struct sc_shortcut shortcuts[] = {
         .shortcuts = { "MOD+i" },
         .text = "Enable/disable FPS counter (print frames/second in logs)",
     },
+    {
+        .shortcuts = { "MOD+Shift+s" },
+        .text = "Save a screenshot (see --screenshot-dir)",
+    },
+    {
+        .shortcuts = { "MOD+Shift+b" },
+        .text = "Capture every frame for a few seconds, then save them (see "
+                "--screenshot-burst)",
+    },
     {
         .shortcuts = { "Ctrl+click-and-move" },
         .text = "Pinch-to-zoom and rotate from the center of the screen",
@@ -1613,6 +1798,45 @@ parse_buffering_time(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_buffering_range(const char *s, sc_tick *min, sc_tick *max) {
+    long values[2];
+    // Same limit as parse_buffering_time()
+    size_t count = parse_integers_arg(s, ':', 2, values, 0, 60 * 60 * 1000,
+                                      "buffering range");
+    if (!count) {
+        return false;
+    }
+
+    if (count != 2) {
+        LOGE("Invalid buffering range (expected min:max): %s", s);
+        return false;
+    }
+
+    if (!values[1] || values[0] > values[1]) {
+        LOGE("Invalid buffering range (min must not exceed max, and max must "
+             "be positive): %s", s);
+        return false;
+    }
+
+    *min = SC_TICK_FROM_MS(values[0]);
+    *max = SC_TICK_FROM_MS(values[1]);
+    return true;
+}
+
+static bool
+parse_buffer_max_memory(const char *s, size_t *max_memory) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 0xFFFF,
+                                "buffer max memory");
+    if (!ok) {
+        return false;
+    }
+
+    *max_memory = (size_t) value * 1024 * 1024;
+    return true;
+}
+
 static bool
 parse_audio_output_buffer(const char *s, sc_tick *tick) {
     long value;
@@ -1626,6 +1850,34 @@ parse_audio_output_buffer(const char *s, sc_tick *tick) {
     return true;
 }
 
+static bool
+parse_audio_output(const char *optarg,
+                   enum sc_audio_output_backend *backend) {
+    if (!strcmp(optarg, "sdl")) {
+        *backend = SC_AUDIO_OUTPUT_BACKEND_SDL;
+        return true;
+    }
+
+    if (!strcmp(optarg, "alsa")) {
+#ifdef HAVE_ALSA
+        *backend = SC_AUDIO_OUTPUT_BACKEND_ALSA;
+        return true;
+#else
+        LOGE("ALSA audio output is disabled (or unsupported on this "
+             "platform).");
+        return false;
+#endif
+    }
+
+    if (!strcmp(optarg, "null")) {
+        *backend = SC_AUDIO_OUTPUT_BACKEND_NULL;
+        return true;
+    }
+
+    LOGE("Unsupported audio output: %s (expected sdl, alsa or null)", optarg);
+    return false;
+}
+
 static bool
 parse_orientation(const char *s, enum sc_orientation *orientation) {
     if (!strcmp(s, "0")) {
@@ -1873,6 +2125,57 @@ sc_parse_shortcut_mods(const char *s, uint8_t *mods) {
 }
 #endif
 
+static uint8_t
+parse_async_sinks_item(const char *item, size_t len) {
+#define STREQ(literal, s, len) \
+    ((sizeof(literal)-1 == len) && !memcmp(literal, s, len))
+
+    if (STREQ("recorder", item, len)) {
+        return SC_ASYNC_SINK_RECORDER;
+    }
+    if (STREQ("v4l2", item, len)) {
+        return SC_ASYNC_SINK_V4L2;
+    }
+    if (STREQ("shm", item, len)) {
+        return SC_ASYNC_SINK_SHM;
+    }
+#undef STREQ
+
+    LOGE("Unknown async sink: %.*s (must be one of: recorder, v4l2, shm)",
+         (int) len, item);
+
+    return 0;
+}
+
+static bool
+parse_async_sinks(const char *s, uint8_t *async_sinks) {
+    uint8_t sinks = 0;
+
+    // A list of sinks, for example "recorder,v4l2"
+
+    for (;;) {
+        char *comma = strchr(s, ',');
+        size_t limit = comma ? (size_t) (comma - s) : strlen(s);
+
+        uint8_t sink = parse_async_sinks_item(s, limit);
+        if (!sink) {
+            return false;
+        }
+
+        sinks |= sink;
+
+        if (!comma) {
+            break;
+        }
+
+        s = comma + 1;
+    }
+
+    *async_sinks = sinks;
+
+    return true;
+}
+
 static enum sc_record_format
 get_record_format(const char *name) {
     if (!strcmp(name, "mp4")) {
@@ -1915,6 +2218,59 @@ parse_record_format(const char *optarg, enum sc_record_format *format) {
     return true;
 }
 
+static bool
+parse_screenshot_format(const char *optarg,
+                        enum sc_screenshot_format *format) {
+    if (!strcmp(optarg, "png")) {
+        *format = SC_SCREENSHOT_FORMAT_PNG;
+        return true;
+    }
+    if (!strcmp(optarg, "raw")) {
+        *format = SC_SCREENSHOT_FORMAT_RAW;
+        return true;
+    }
+    LOGE("Unsupported screenshot format: %s (expected png or raw)", optarg);
+    return false;
+}
+
+static bool
+parse_screenshot_burst(const char *s, sc_tick *tick) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 1, 60, "screenshot burst");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_SEC(value);
+    return true;
+}
+
+static bool
+parse_mouse_sampling_rate(const char *s, uint16_t *rate) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 1000,
+                                "mouse sampling rate");
+    if (!ok) {
+        return false;
+    }
+
+    *rate = (uint16_t) value;
+    return true;
+}
+
+static bool
+parse_ping_interval(const char *s, sc_tick *tick) {
+    long value;
+    bool ok = parse_integer_arg(s, &value, false, 0, 0x7FFFFFFF,
+                                "ping interval");
+    if (!ok) {
+        return false;
+    }
+
+    *tick = SC_TICK_FROM_MS(value);
+    return true;
+}
+
 static bool
 parse_ip(const char *optarg, uint32_t *ipv4) {
     return net_parse_ipv4(optarg, ipv4);
@@ -2558,6 +2914,12 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_VIDEO_BUFFER_MAX_MEMORY:
+                if (!parse_buffer_max_memory(optarg,
+                                             &opts->video_buffer_max_memory)) {
+                    return false;
+                }
+                break;
             case OPT_NO_CLIPBOARD_AUTOSYNC:
                 opts->clipboard_autosync = false;
                 break;
@@ -2624,6 +2986,63 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                 LOGE("V4L2 (--v4l2-buffer) is disabled (or unsupported on this "
                      "platform).");
                 return false;
+#endif
+            case OPT_BENCHMARK:
+                opts->benchmark = true;
+                break;
+            case OPT_SCREENSHOT_DIR:
+                opts->screenshot_dir = optarg;
+                break;
+            case OPT_SCREENSHOT_FORMAT:
+                if (!parse_screenshot_format(optarg,
+                                             &opts->screenshot_format)) {
+                    return false;
+                }
+                break;
+            case OPT_SCREENSHOT_BURST:
+                if (!parse_screenshot_burst(optarg, &opts->screenshot_burst)) {
+                    return false;
+                }
+                break;
+            case OPT_MOUSE_SAMPLING_RATE:
+                if (!parse_mouse_sampling_rate(optarg,
+                                               &opts->mouse_sampling_rate)) {
+                    return false;
+                }
+                break;
+            case OPT_NO_MOUSE_HID_SAMPLING:
+                opts->mouse_hid_sampling = false;
+                break;
+            case OPT_AV_SYNC:
+                opts->av_sync = true;
+                break;
+            case OPT_AUDIO_BUFFER_ADAPTIVE:
+                if (!parse_buffering_range(optarg, &opts->audio_buffer_min,
+                                           &opts->audio_buffer_max)) {
+                    return false;
+                }
+                break;
+            case OPT_INPUT_PREDICTION:
+                opts->input_prediction = true;
+                break;
+            case OPT_PING_INTERVAL:
+                if (!parse_ping_interval(optarg, &opts->ping_interval)) {
+                    return false;
+                }
+                break;
+            case OPT_ASYNC_SINKS:
+                if (!parse_async_sinks(optarg, &opts->async_sinks)) {
+                    return false;
+                }
+                break;
+            case OPT_SHM_SINK:
+#ifdef HAVE_SHM
+                opts->shm_name = optarg;
+                break;
+#else
+                LOGE("Shared memory (--shm-sink) is disabled (or unsupported "
+                     "on this platform).");
+                return false;
 #endif
             case OPT_LIST_ENCODERS:
                 opts->list |= SC_OPTION_LIST_ENCODERS;
@@ -2654,6 +3073,18 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
                     return false;
                 }
                 break;
+            case OPT_AUDIO_OUTPUT:
+                if (!parse_audio_output(optarg,
+                                        &opts->audio_output_backend)) {
+                    return false;
+                }
+                break;
+            case OPT_AUDIO_OUTPUT_DEVICE:
+                opts->audio_output_device = optarg;
+                break;
+            case OPT_AUDIO_METER:
+                opts->audio_meter = true;
+                break;
             case OPT_VIDEO_SOURCE:
                 if (!parse_video_source(optarg, &opts->video_source)) {
                     return false;
@@ -2770,12 +3201,16 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
 
     bool otg = false;
     bool v4l2 = false;
+    bool shm = false;
 #ifdef HAVE_USB
     otg = opts->otg;
 #endif
 #ifdef HAVE_V4L2
     v4l2 = !!opts->v4l2_device;
 #endif
+#ifdef HAVE_SHM
+    shm = !!opts->shm_name;
+#endif
 
     if (!opts->window) {
         // Without window, there cannot be any video playback or control
@@ -2794,13 +3229,16 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
     }
 
     if (opts->video && !opts->video_playback && !opts->record_filename
-            && !v4l2) {
-        LOGI("No video playback, no recording, no V4L2 sink: video disabled");
+            && !v4l2 && !shm && !opts->benchmark) {
+        LOGI("No video playback, no recording, no V4L2 sink, no shared memory "
+             "sink: video disabled");
         opts->video = false;
     }
 
-    if (opts->audio && !opts->audio_playback && !opts->record_filename) {
-        LOGI("No audio playback, no recording: audio disabled");
+    if (opts->audio && !opts->audio_playback && !opts->record_filename
+            && !opts->audio_meter) {
+        LOGI("No audio playback, no recording, no audio meter: audio "
+             "disabled");
         opts->audio = false;
     }
 
@@ -2846,6 +3284,38 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
     }
 #endif
 
+    if (opts->benchmark && !opts->video) {
+        LOGE("Benchmark requires video capture, but --no-video was set.");
+        return false;
+    }
+
+    if (opts->audio_meter && !opts->audio) {
+        LOGE("Audio meter requires audio capture, but --no-audio was set.");
+        return false;
+    }
+
+    if (shm && !opts->video) {
+        LOGE("Shared memory sink requires video capture, but --no-video was "
+             "set.");
+        return false;
+    }
+
+    if ((opts->async_sinks & SC_ASYNC_SINK_RECORDER) && !opts->record_filename) {
+        LOGE("Async recorder requested without recording (--record)");
+        return false;
+    }
+
+    if ((opts->async_sinks & SC_ASYNC_SINK_V4L2) && !v4l2) {
+        LOGE("Async V4L2 sink requested without V4L2 sink (--v4l2-sink)");
+        return false;
+    }
+
+    if ((opts->async_sinks & SC_ASYNC_SINK_SHM) && !shm) {
+        LOGE("Async shared memory sink requested without shared memory sink "
+             "(--shm-sink)");
+        return false;
+    }
+
     if (opts->control) {
         if (opts->keyboard_input_mode == SC_KEYBOARD_INPUT_MODE_AUTO) {
             opts->keyboard_input_mode = otg ? SC_KEYBOARD_INPUT_MODE_AOA
@@ -3172,6 +3642,18 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGE("Cannot start an Android app if control is disabled");
             return false;
         }
+        if (opts->ping_interval) {
+            LOGE("Cannot measure the control latency if control is disabled");
+            return false;
+        }
+        if (opts->input_prediction) {
+            LOGE("Cannot predict input if control is disabled");
+            return false;
+        }
+        if (opts->mouse_sampling_rate) {
+            LOGE("Cannot sample mouse events if control is disabled");
+            return false;
+        }
     }
 
 # ifdef _WIN32
@@ -3190,6 +3672,28 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
         opts->start_fps_counter = false;
     }
 
+    if (opts->input_prediction && !opts->video_playback) {
+        LOGW("--input-prediction has no effect without video playback");
+        opts->input_prediction = false;
+    }
+
+    if (opts->audio_buffer_max && !opts->audio_playback) {
+        LOGW("--audio-buffer-adaptive has no effect without audio playback");
+        opts->audio_buffer_min = 0;
+        opts->audio_buffer_max = 0;
+    }
+
+    if ((opts->audio_output_backend != SC_AUDIO_OUTPUT_BACKEND_SDL
+            || opts->audio_output_device) && !opts->audio_playback) {
+        LOGW("--audio-output and --audio-output-device have no effect "
+             "without audio playback");
+    }
+
+    if (opts->av_sync && (!opts->video_playback || !opts->audio_playback)) {
+        LOGW("--av-sync has no effect without both video and audio playback");
+        opts->av_sync = false;
+    }
+
     if (otg) {
         // OTG mode is compatible with only very few options.
         // Only report obvious errors.
@@ -3221,6 +3725,10 @@ parse_args_with_getopt(struct scrcpy_cli_args *args, int argc, char *argv[],
             LOGE("OTG mode: could not sink to V4L2 device");
             return false;
         }
+        if (shm) {
+            LOGE("OTG mode: could not sink to shared memory");
+            return false;
+        }
     }
 
     return true;
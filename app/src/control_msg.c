@@ -178,6 +178,10 @@ sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf) {
             size_t len = write_string_tiny(&buf[1], msg->start_app.name, 255);
             return 1 + len;
         }
+        case SC_CONTROL_MSG_TYPE_PING:
+            sc_write64be(&buf[1], msg->ping.push_date);
+            sc_write64be(&buf[9], msg->ping.send_date);
+            return 17;
         case SC_CONTROL_MSG_TYPE_EXPAND_NOTIFICATION_PANEL:
         case SC_CONTROL_MSG_TYPE_EXPAND_SETTINGS_PANEL:
         case SC_CONTROL_MSG_TYPE_COLLAPSE_PANELS:
@@ -192,6 +196,50 @@ sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf) {
     }
 }
 
+size_t
+sc_control_msg_serialize_bulk(const struct sc_control_msg *msg,
+                              uint8_t *header, const uint8_t **payload,
+                              size_t *payload_len) {
+    assert(sc_control_msg_is_bulk(msg));
+
+    header[0] = msg->type;
+    switch (msg->type) {
+        case SC_CONTROL_MSG_TYPE_SET_CLIPBOARD: {
+            const char *text = msg->set_clipboard.text;
+            size_t len = text ? sc_str_utf8_truncation_index(text,
+                        SC_CONTROL_MSG_BULK_CLIPBOARD_TEXT_MAX_LENGTH) : 0;
+            sc_write64be(&header[1], msg->set_clipboard.sequence);
+            header[9] = !!msg->set_clipboard.paste;
+            sc_write32be(&header[10], len);
+            *payload = (const uint8_t *) text;
+            *payload_len = len;
+            return 14;
+        }
+        case SC_CONTROL_MSG_TYPE_START_APP: {
+            const char *name = msg->start_app.name;
+            size_t len = name ? sc_str_utf8_truncation_index(name, 255) : 0;
+            header[1] = len;
+            *payload = (const uint8_t *) name;
+            *payload_len = len;
+            return 2;
+        }
+        default:
+            assert(!"not a bulk message");
+            *payload = NULL;
+            *payload_len = 0;
+            return 1;
+    }
+}
+
+size_t
+sc_control_msg_serialize_chunk_header(size_t len, bool last, uint8_t *buf) {
+    assert(len <= SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD);
+    buf[0] = SC_CONTROL_MSG_TYPE_CHUNK;
+    buf[1] = last;
+    sc_write16be(&buf[2], len);
+    return SC_CONTROL_MSG_CHUNK_HEADER_SIZE + len;
+}
+
 void
 sc_control_msg_log(const struct sc_control_msg *msg) {
 #define LOG_CMSG(fmt, ...) LOGV("input: " fmt, ## __VA_ARGS__)
@@ -314,20 +362,105 @@ sc_control_msg_log(const struct sc_control_msg *msg) {
         case SC_CONTROL_MSG_TYPE_RESET_VIDEO:
             LOG_CMSG("reset video");
             break;
+        case SC_CONTROL_MSG_TYPE_PING:
+            LOG_CMSG("ping push_date=%" PRIu64_, msg->ping.push_date);
+            break;
         default:
             LOG_CMSG("unknown type: %u", (unsigned) msg->type);
             break;
     }
 }
 
+bool
+sc_control_msg_is_move(const struct sc_control_msg *msg) {
+    if (msg->type != SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT) {
+        return false;
+    }
+
+    enum android_motionevent_action action = msg->inject_touch_event.action;
+    return action == AMOTION_EVENT_ACTION_MOVE
+        || action == AMOTION_EVENT_ACTION_HOVER_MOVE;
+}
+
 bool
 sc_control_msg_is_droppable(const struct sc_control_msg *msg) {
-    // Cannot drop UHID_CREATE messages, because it would cause all further
-    // UHID_INPUT messages for this device to be invalid.
-    // Cannot drop UHID_DESTROY messages either, because a further UHID_CREATE
-    // with the same id may fail.
-    return msg->type != SC_CONTROL_MSG_TYPE_UHID_CREATE
-        && msg->type != SC_CONTROL_MSG_TYPE_UHID_DESTROY;
+    // Never drop DOWN/UP events (it would leave a pointer pressed), key
+    // events, text or UHID messages (a missing UHID_CREATE would cause all
+    // further UHID_INPUT messages for this device to be invalid).
+    return sc_control_msg_is_move(msg)
+        || msg->type == SC_CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT;
+}
+
+bool
+sc_control_msg_is_bulk(const struct sc_control_msg *msg) {
+    // Text injection is not a bulk message: its size is limited, and it must
+    // not be reordered with key events
+    return msg->type == SC_CONTROL_MSG_TYPE_SET_CLIPBOARD
+        || msg->type == SC_CONTROL_MSG_TYPE_START_APP;
+}
+
+static inline bool
+sc_size_equals(struct sc_size a, struct sc_size b) {
+    return a.width == b.width && a.height == b.height;
+}
+
+static bool
+merge_move(struct sc_control_msg *prev, const struct sc_control_msg *msg) {
+    if (!sc_control_msg_is_move(prev) || !sc_control_msg_is_move(msg)) {
+        return false;
+    }
+
+    if (prev->inject_touch_event.pointer_id
+                != msg->inject_touch_event.pointer_id
+            || prev->inject_touch_event.action
+                != msg->inject_touch_event.action
+            || prev->inject_touch_event.action_button
+                != msg->inject_touch_event.action_button
+            || prev->inject_touch_event.buttons
+                != msg->inject_touch_event.buttons
+            || !sc_size_equals(prev->inject_touch_event.position.screen_size,
+                               msg->inject_touch_event.position.screen_size)) {
+        return false;
+    }
+
+    prev->inject_touch_event.position = msg->inject_touch_event.position;
+    prev->inject_touch_event.pressure = msg->inject_touch_event.pressure;
+    return true;
+}
+
+static bool
+merge_scroll(struct sc_control_msg *prev, const struct sc_control_msg *msg) {
+    if (prev->type != SC_CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT
+            || msg->type != SC_CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT) {
+        return false;
+    }
+
+    if (prev->inject_scroll_event.buttons != msg->inject_scroll_event.buttons
+            || !sc_size_equals(prev->inject_scroll_event.position.screen_size,
+                               msg->inject_scroll_event.position.screen_size)) {
+        return false;
+    }
+
+    float hscroll = prev->inject_scroll_event.hscroll
+                  + msg->inject_scroll_event.hscroll;
+    float vscroll = prev->inject_scroll_event.vscroll
+                  + msg->inject_scroll_event.vscroll;
+    // The serialized values must be in [-1, 1]
+    if (hscroll < -1.0f || hscroll > 1.0f
+            || vscroll < -1.0f || vscroll > 1.0f) {
+        return false;
+    }
+
+    prev->inject_scroll_event.position = msg->inject_scroll_event.position;
+    prev->inject_scroll_event.hscroll = hscroll;
+    prev->inject_scroll_event.vscroll = vscroll;
+    return true;
+}
+
+bool
+sc_control_msg_merge(struct sc_control_msg *prev,
+                     const struct sc_control_msg *msg) {
+    return merge_move(prev, msg) || merge_scroll(prev, msg);
 }
 
 void
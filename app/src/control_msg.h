@@ -18,6 +18,18 @@
 // type: 1 byte; sequence: 8 bytes; paste flag: 1 byte; length: 4 bytes
 #define SC_CONTROL_MSG_CLIPBOARD_TEXT_MAX_LENGTH (SC_CONTROL_MSG_MAX_SIZE - 14)
 
+// Bulk messages are streamed by chunks, so they may be larger
+#define SC_CONTROL_MSG_BULK_MAX_SIZE (1 << 24) // 16M
+#define SC_CONTROL_MSG_BULK_CLIPBOARD_TEXT_MAX_LENGTH \
+    (SC_CONTROL_MSG_BULK_MAX_SIZE - 14)
+// Max size of the part of a bulk message serialized before its payload
+#define SC_CONTROL_MSG_BULK_HEADER_MAX_SIZE 14
+
+// Max payload size of a single chunk of a bulk message
+#define SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD 0x1000 // 4k
+// type: 1 byte; last flag: 1 byte; length: 2 bytes
+#define SC_CONTROL_MSG_CHUNK_HEADER_SIZE 4
+
 #define SC_POINTER_ID_MOUSE UINT64_C(-1)
 #define SC_POINTER_ID_GENERIC_FINGER UINT64_C(-2)
 
@@ -43,6 +55,10 @@ enum sc_control_msg_type {
     SC_CONTROL_MSG_TYPE_OPEN_HARD_KEYBOARD_SETTINGS,
     SC_CONTROL_MSG_TYPE_START_APP,
     SC_CONTROL_MSG_TYPE_RESET_VIDEO,
+    SC_CONTROL_MSG_TYPE_PING,
+    // Not a message by itself: a piece of a serialized bulk message (see
+    // sc_control_msg_serialize_chunk_header())
+    SC_CONTROL_MSG_TYPE_CHUNK,
 };
 
 enum sc_copy_key {
@@ -111,6 +127,11 @@ struct sc_control_msg {
         struct {
             char *name;
         } start_app;
+        struct {
+            // Echoed by the device, to measure the latency
+            uint64_t push_date; // when the message is queued
+            uint64_t send_date; // when the message is serialized
+        } ping;
     };
 };
 
@@ -119,14 +140,65 @@ struct sc_control_msg {
 size_t
 sc_control_msg_serialize(const struct sc_control_msg *msg, uint8_t *buf);
 
+/**
+ * Serialize a bulk message without copying its payload
+ *
+ * The header (at most SC_CONTROL_MSG_BULK_HEADER_MAX_SIZE bytes) is written to
+ * `header`, and `*payload` is set to the remaining bytes of the serialized
+ * message, which reference the message data (they are valid as long as the
+ * message is not destroyed). The clipboard text is truncated to
+ * SC_CONTROL_MSG_BULK_CLIPBOARD_TEXT_MAX_LENGTH.
+ *
+ * Return the header size.
+ */
+size_t
+sc_control_msg_serialize_bulk(const struct sc_control_msg *msg,
+                              uint8_t *header, const uint8_t **payload,
+                              size_t *payload_len);
+
+/**
+ * Serialize the header of a chunk of a serialized bulk message
+ *
+ * A large bulk message is sent as a sequence of chunks, so that real-time
+ * messages may be sent in between. The device reassembles the message once
+ * the last chunk is received.
+ *
+ * The chunk payload (`len` bytes, at most SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD)
+ * must be written by the caller at `buf + SC_CONTROL_MSG_CHUNK_HEADER_SIZE`.
+ *
+ * Return the total size of the chunk.
+ */
+size_t
+sc_control_msg_serialize_chunk_header(size_t len, bool last, uint8_t *buf);
+
 void
 sc_control_msg_log(const struct sc_control_msg *msg);
 
-// Even when the buffer is "full", some messages must absolutely not be dropped
-// to avoid inconsistencies.
+// Only motion events (touch/mouse moves and scrolls) may be dropped when the
+// buffer is "full": other messages must absolutely not be dropped, to avoid
+// inconsistencies (or losing user actions).
 bool
 sc_control_msg_is_droppable(const struct sc_control_msg *msg);
 
+// Return true if msg is a bulk message (potentially large, and not related to
+// real-time input), which must not delay input events
+bool
+sc_control_msg_is_bulk(const struct sc_control_msg *msg);
+
+// Return true if msg is a touch (or mouse) MOVE or HOVER_MOVE event
+bool
+sc_control_msg_is_move(const struct sc_control_msg *msg);
+
+// Merge msg into prev (an older message not sent yet) if the result is
+// equivalent to sending both:
+//  - consecutive MOVE events for the same pointer (the last position wins);
+//  - consecutive scroll events (the deltas are accumulated).
+//
+// Return true if msg has been merged (it must not be sent anymore).
+bool
+sc_control_msg_merge(struct sc_control_msg *prev,
+                     const struct sc_control_msg *msg);
+
 void
 sc_control_msg_destroy(struct sc_control_msg *msg);
 
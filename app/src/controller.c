@@ -1,12 +1,19 @@
 #include "controller.h"
 
 #include <assert.h>
+#include <inttypes.h>
+#include <string.h>
 
 #include "util/log.h"
 
 // Drop droppable events above this limit
 #define SC_CONTROL_MSG_QUEUE_LIMIT 60
 
+// Max number of messages dequeued at once
+#define SC_CONTROLLER_MAX_BATCH 64
+// Send the serialized messages once this size is reached
+#define SC_CONTROLLER_BATCH_SIZE 0x10000 // 64k
+
 static void
 sc_controller_receiver_on_ended(struct sc_receiver *receiver, bool error,
                                 void *userdata) {
@@ -22,6 +29,7 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
                    const struct sc_controller_callbacks *cbs,
                    void *cbs_userdata) {
     sc_vecdeque_init(&controller->queue);
+    sc_vecdeque_init(&controller->bulk_queue);
 
     // Add 4 to support 4 non-droppable events without re-allocation
     bool ok = sc_vecdeque_reserve(&controller->queue,
@@ -30,6 +38,8 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
         return false;
     }
 
+    controller->bulk.active = false;
+
     static const struct sc_receiver_callbacks receiver_cbs = {
         .on_ended = sc_controller_receiver_on_ended,
     };
@@ -37,41 +47,64 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
     ok = sc_receiver_init(&controller->receiver, control_socket, &receiver_cbs,
                           controller);
     if (!ok) {
-        sc_vecdeque_destroy(&controller->queue);
-        return false;
+        goto error_destroy_queue;
     }
 
     ok = sc_mutex_init(&controller->mutex);
     if (!ok) {
-        sc_receiver_destroy(&controller->receiver);
-        sc_vecdeque_destroy(&controller->queue);
-        return false;
+        goto error_destroy_receiver;
     }
 
     ok = sc_cond_init(&controller->msg_cond);
     if (!ok) {
-        sc_receiver_destroy(&controller->receiver);
-        sc_mutex_destroy(&controller->mutex);
-        sc_vecdeque_destroy(&controller->queue);
-        return false;
+        goto error_destroy_mutex;
     }
 
     controller->control_socket = control_socket;
     controller->stopped = false;
+    controller->ping_interval = 0;
+    controller->next_ping = 0;
+    controller->stats.msgs = 0;
+    controller->stats.sends = 0;
+    controller->stats.chunks = 0;
+    controller->stats.merged = 0;
+    controller->stats.dropped = 0;
 
     assert(cbs && cbs->on_ended);
     controller->cbs = cbs;
     controller->cbs_userdata = cbs_userdata;
 
     return true;
+
+error_destroy_mutex:
+    sc_mutex_destroy(&controller->mutex);
+error_destroy_receiver:
+    sc_receiver_destroy(&controller->receiver);
+error_destroy_queue:
+    sc_vecdeque_destroy(&controller->queue);
+
+    return false;
+}
+
+static void
+sc_controller_clear_queue(struct sc_control_msg_queue *queue) {
+    while (!sc_vecdeque_is_empty(queue)) {
+        struct sc_control_msg *msg = sc_vecdeque_popref(queue);
+        assert(msg);
+        sc_control_msg_destroy(msg);
+    }
+    sc_vecdeque_destroy(queue);
 }
 
 void
 sc_controller_configure(struct sc_controller *controller,
                         struct sc_acksync *acksync,
-                        struct sc_uhid_devices *uhid_devices) {
+                        struct sc_uhid_devices *uhid_devices,
+                        sc_tick ping_interval, bool report_latency) {
     controller->receiver.acksync = acksync;
     controller->receiver.uhid_devices = uhid_devices;
+    controller->receiver.latency.report = report_latency;
+    controller->ping_interval = ping_interval;
 }
 
 void
@@ -79,16 +112,58 @@ sc_controller_destroy(struct sc_controller *controller) {
     sc_cond_destroy(&controller->msg_cond);
     sc_mutex_destroy(&controller->mutex);
 
-    while (!sc_vecdeque_is_empty(&controller->queue)) {
-        struct sc_control_msg *msg = sc_vecdeque_popref(&controller->queue);
-        assert(msg);
-        sc_control_msg_destroy(msg);
+    sc_controller_clear_queue(&controller->queue);
+    sc_controller_clear_queue(&controller->bulk_queue);
+    if (controller->bulk.active) {
+        sc_control_msg_destroy(&controller->bulk.msg);
     }
-    sc_vecdeque_destroy(&controller->queue);
 
     sc_receiver_destroy(&controller->receiver);
 }
 
+// Must be called with the mutex locked
+static bool
+sc_controller_merge_msg(struct sc_controller *controller,
+                        const struct sc_control_msg *msg) {
+    if (!sc_control_msg_is_droppable(msg)) {
+        // Only motion events may be merged
+        return false;
+    }
+
+    // Search a message to merge into from the most recent one. Skip MOVE
+    // events for other pointers (several pointers may move simultaneously),
+    // but never reorder msg with any other message.
+    bool is_move = sc_control_msg_is_move(msg);
+    for (size_t i = sc_vecdeque_size(&controller->queue); i; --i) {
+        struct sc_control_msg *prev =
+            sc_vecdeque_getref(&controller->queue, i - 1);
+        if (sc_control_msg_merge(prev, msg)) {
+            return true;
+        }
+        if (!is_move || !sc_control_msg_is_move(prev)) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+// Return true if the message must be sent by chunks on the bulk lane (not
+// ordered with the real-time messages)
+static bool
+sc_controller_is_unordered_bulk(const struct sc_control_msg *msg) {
+    if (msg->type == SC_CONTROL_MSG_TYPE_SET_CLIPBOARD) {
+        // A clipboard set to paste, or awaiting an ACK, may be followed by
+        // key events to paste it (if the keyboard does not support
+        // asynchronous paste), they must not be reordered. A clipboard
+        // autosync does not have to wait for the input events.
+        return !msg->set_clipboard.paste
+            && msg->set_clipboard.sequence == SC_SEQUENCE_INVALID;
+    }
+
+    return sc_control_msg_is_bulk(msg);
+}
+
 bool
 sc_controller_push_msg(struct sc_controller *controller,
                        const struct sc_control_msg *msg) {
@@ -100,7 +175,23 @@ sc_controller_push_msg(struct sc_controller *controller,
 
     sc_mutex_lock(&controller->mutex);
     size_t size = sc_vecdeque_size(&controller->queue);
-    if (size < SC_CONTROL_MSG_QUEUE_LIMIT) {
+    if (sc_controller_is_unordered_bulk(msg)) {
+        // Bulk messages are never dropped
+        bool was_empty = sc_vecdeque_is_empty(&controller->bulk_queue);
+        bool ok = sc_vecdeque_push(&controller->bulk_queue, *msg);
+        if (ok) {
+            pushed = true;
+            if (was_empty) {
+                sc_cond_signal(&controller->msg_cond);
+            }
+        } else {
+            LOG_OOM();
+        }
+    } else if (sc_controller_merge_msg(controller, msg)) {
+        // Not sent yet, so the merged message is pushed
+        ++controller->stats.merged;
+        pushed = true;
+    } else if (size < SC_CONTROL_MSG_QUEUE_LIMIT) {
         bool was_empty = sc_vecdeque_is_empty(&controller->queue);
         sc_vecdeque_push_noresize(&controller->queue, *msg);
         pushed = true;
@@ -115,8 +206,10 @@ sc_controller_push_msg(struct sc_controller *controller,
             // A non-droppable event must be dropped anyway
             LOG_OOM();
         }
+    } else {
+        // Otherwise, the msg is discarded
+        ++controller->stats.dropped;
     }
-    // Otherwise, the msg is discarded
 
     sc_mutex_unlock(&controller->mutex);
 
@@ -124,36 +217,234 @@ sc_controller_push_msg(struct sc_controller *controller,
 }
 
 static bool
-process_msg(struct sc_controller *controller,
-            const struct sc_control_msg *msg, bool *eos) {
-    static uint8_t serialized_msg[SC_CONTROL_MSG_MAX_SIZE];
-    size_t length = sc_control_msg_serialize(msg, serialized_msg);
-    if (!length) {
-        *eos = false;
+send_batch(struct sc_controller *controller, const uint8_t *buf, size_t len,
+           unsigned msgs, bool *eos) {
+    ssize_t w = net_send_all(controller->control_socket, buf, len);
+    if ((size_t) w != len) {
+        *eos = true;
         return false;
     }
 
-    ssize_t w =
-        net_send_all(controller->control_socket, serialized_msg, length);
-    if ((size_t) w != length) {
-        *eos = true;
+    controller->stats.msgs += msgs;
+    ++controller->stats.sends;
+    return true;
+}
+
+static bool
+process_msgs(struct sc_controller *controller, struct sc_control_msg *msgs,
+             size_t count, bool *eos) {
+    // A message of any size can always be serialized after less than
+    // SC_CONTROLLER_BATCH_SIZE bytes
+    static uint8_t buf[SC_CONTROLLER_BATCH_SIZE + SC_CONTROL_MSG_MAX_SIZE];
+    size_t len = 0;
+    unsigned pending = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        assert(len < SC_CONTROLLER_BATCH_SIZE);
+        if (msgs[i].type == SC_CONTROL_MSG_TYPE_PING) {
+            // The time spent in the queue is measured up to this point
+            msgs[i].ping.send_date = sc_tick_now();
+        }
+        size_t length = sc_control_msg_serialize(&msgs[i], buf + len);
+        if (!length) {
+            *eos = false;
+            return false;
+        }
+
+        len += length;
+        ++pending;
+
+        if (len >= SC_CONTROLLER_BATCH_SIZE) {
+            if (!send_batch(controller, buf, len, pending, eos)) {
+                return false;
+            }
+            len = 0;
+            pending = 0;
+        }
+    }
+
+    if (len) {
+        return send_batch(controller, buf, len, pending, eos);
+    }
+
+    return true;
+}
+
+static void
+end_bulk(struct sc_controller *controller) {
+    assert(controller->bulk.active);
+    sc_control_msg_destroy(&controller->bulk.msg);
+    controller->bulk.active = false;
+}
+
+static size_t
+get_bulk_size(struct sc_controller *controller) {
+    return controller->bulk.header_len + controller->bulk.payload_len;
+}
+
+// Copy the next len bytes of the serialized bulk message
+static void
+read_bulk(struct sc_controller *controller, uint8_t *buf, size_t len) {
+    assert(controller->bulk.offset + len <= get_bulk_size(controller));
+
+    size_t offset = controller->bulk.offset;
+    size_t header_len = controller->bulk.header_len;
+    if (offset < header_len) {
+        size_t n = MIN(len, header_len - offset);
+        memcpy(buf, controller->bulk.header + offset, n);
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+
+    if (len) {
+        memcpy(buf, controller->bulk.payload + offset - header_len, len);
+        offset += len;
+    }
+
+    controller->bulk.offset = offset;
+}
+
+// Start streaming a bulk message by chunks (or send it immediately if it is
+// small). The bulk message is owned by the controller thread from now on.
+static bool
+start_bulk(struct sc_controller *controller, const struct sc_control_msg *msg,
+           bool ordered, bool *eos) {
+    assert(!controller->bulk.active);
+
+    controller->bulk.active = true;
+    controller->bulk.ordered = ordered;
+    controller->bulk.msg = *msg;
+    controller->bulk.offset = 0;
+    controller->bulk.header_len =
+        sc_control_msg_serialize_bulk(&controller->bulk.msg,
+                                      controller->bulk.header,
+                                      &controller->bulk.payload,
+                                      &controller->bulk.payload_len);
+
+    size_t size = get_bulk_size(controller);
+    if (size <= SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD) {
+        // Not worth splitting
+        uint8_t buf[SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD];
+        read_bulk(controller, buf, size);
+        end_bulk(controller);
+        return send_batch(controller, buf, size, 1, eos);
+    }
+
+    return true;
+}
+
+static bool
+send_bulk_chunk(struct sc_controller *controller, bool *eos) {
+    assert(controller->bulk.active);
+
+    uint8_t buf[SC_CONTROL_MSG_CHUNK_HEADER_SIZE
+              + SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD];
+
+    size_t remaining = get_bulk_size(controller) - controller->bulk.offset;
+    assert(remaining);
+    size_t chunk_len = MIN(remaining, SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD);
+    bool last = chunk_len == remaining;
+
+    uint8_t *data = &buf[SC_CONTROL_MSG_CHUNK_HEADER_SIZE];
+    read_bulk(controller, data, chunk_len);
+    size_t len = sc_control_msg_serialize_chunk_header(chunk_len, last, buf);
+
+    if (last) {
+        end_bulk(controller);
+    }
+
+    // The message is counted once its last chunk is sent
+    if (!send_batch(controller, buf, len, last ? 1 : 0, eos)) {
         return false;
     }
 
+    ++controller->stats.chunks;
     return true;
 }
 
+static void
+log_stats(struct sc_controller *controller) {
+    uint64_t msgs = controller->stats.msgs;
+    uint64_t sends = controller->stats.sends;
+    if (!sends) {
+        return;
+    }
+
+    sc_mutex_lock(&controller->mutex);
+    uint64_t merged = controller->stats.merged;
+    uint64_t dropped = controller->stats.dropped;
+    sc_mutex_unlock(&controller->mutex);
+
+    LOGD("Controller: %" PRIu64 " messages sent in %" PRIu64 " calls "
+         "(%.2f messages per call), %" PRIu64 " merged, %" PRIu64 " dropped, "
+         "%" PRIu64 " bulk chunks", msgs, sends, (double) msgs / sends, merged,
+         dropped, controller->stats.chunks);
+}
+
+// Must be called with the mutex locked
+static void
+sc_controller_push_ping(struct sc_controller *controller, sc_tick now) {
+    assert(controller->ping_interval);
+
+    struct sc_control_msg msg;
+    msg.type = SC_CONTROL_MSG_TYPE_PING;
+    msg.ping.push_date = now;
+    msg.ping.send_date = 0; // set just before sending
+
+    // A ping is never dropped (the queue limit only applies to droppable
+    // events), so that it measures the delay of a full queue
+    bool ok = sc_vecdeque_push(&controller->queue, msg);
+    if (!ok) {
+        LOG_OOM();
+        // Retry on the next interval
+    }
+
+    controller->next_ping = now + controller->ping_interval;
+}
+
 static int
 run_controller(void *data) {
     struct sc_controller *controller = data;
 
     bool error = false;
 
+    // Messages dequeued at once, to be sent together
+    struct sc_control_msg batch[SC_CONTROLLER_MAX_BATCH];
+
+    sc_tick ping_interval = controller->ping_interval;
+    if (ping_interval) {
+        controller->next_ping = sc_tick_now() + ping_interval;
+    }
+
     for (;;) {
+        // A bulk message is being sent by chunks
+        bool bulk_pending = controller->bulk.active;
+        // Real-time messages must wait until the bulk message is sent
+        bool lane_held = bulk_pending && controller->bulk.ordered;
+
         sc_mutex_lock(&controller->mutex);
-        while (!controller->stopped
-                && sc_vecdeque_is_empty(&controller->queue)) {
-            sc_cond_wait(&controller->msg_cond, &controller->mutex);
+        for (;;) {
+            if (controller->stopped) {
+                break;
+            }
+            if (ping_interval) {
+                sc_tick now = sc_tick_now();
+                if (now >= controller->next_ping) {
+                    sc_controller_push_ping(controller, now);
+                }
+            }
+            if (!sc_vecdeque_is_empty(&controller->queue)
+                    || !sc_vecdeque_is_empty(&controller->bulk_queue)
+                    || bulk_pending) {
+                break;
+            }
+            if (ping_interval) {
+                sc_cond_timedwait(&controller->msg_cond, &controller->mutex,
+                                  controller->next_ping);
+            } else {
+                sc_cond_wait(&controller->msg_cond, &controller->mutex);
+            }
         }
         if (controller->stopped) {
             // stop immediately, do not process further msgs
@@ -162,13 +453,59 @@ run_controller(void *data) {
             break;
         }
 
-        assert(!sc_vecdeque_is_empty(&controller->queue));
-        struct sc_control_msg msg = sc_vecdeque_pop(&controller->queue);
+        // Real-time messages first, up to the first bulk message in the
+        // real-time lane (which is sent by chunks in order)
+        size_t count = 0;
+        struct sc_control_msg bulk_msg;
+        bool has_bulk_msg = false;
+        bool ordered = false;
+        while (!lane_held && count < SC_CONTROLLER_MAX_BATCH
+                && !sc_vecdeque_is_empty(&controller->queue)) {
+            struct sc_control_msg *msg =
+                sc_vecdeque_getref(&controller->queue, 0);
+            if (sc_control_msg_is_bulk(msg)) {
+                if (!bulk_pending) {
+                    bulk_msg = sc_vecdeque_pop(&controller->queue);
+                    has_bulk_msg = true;
+                    ordered = true;
+                }
+                // else wait for the current bulk transfer to complete
+                break;
+            }
+            batch[count++] = sc_vecdeque_pop(&controller->queue);
+        }
+
+        // Then at most one chunk of a bulk message, so that real-time
+        // messages pushed in the meantime are not delayed by a full transfer
+        if (!bulk_pending && !has_bulk_msg
+                && !sc_vecdeque_is_empty(&controller->bulk_queue)) {
+            bulk_msg = sc_vecdeque_pop(&controller->bulk_queue);
+            has_bulk_msg = true;
+        }
         sc_mutex_unlock(&controller->mutex);
 
         bool eos;
-        bool ok = process_msg(controller, &msg, &eos);
-        sc_control_msg_destroy(&msg);
+        bool ok = true;
+        if (count) {
+            ok = process_msgs(controller, batch, count, &eos);
+            for (size_t i = 0; i < count; ++i) {
+                sc_control_msg_destroy(&batch[i]);
+            }
+        }
+
+        if (has_bulk_msg) {
+            if (ok) {
+                // bulk_msg is now owned by the bulk transfer
+                ok = start_bulk(controller, &bulk_msg, ordered, &eos);
+            } else {
+                sc_control_msg_destroy(&bulk_msg);
+            }
+        }
+
+        if (ok && controller->bulk.active) {
+            ok = send_bulk_chunk(controller, &eos);
+        }
+
         if (!ok) {
             if (eos) {
                 LOGD("Controller stopped (socket closed)");
@@ -178,6 +515,8 @@ run_controller(void *data) {
         }
     }
 
+    log_stats(controller);
+
     controller->cbs->on_ended(controller, error, controller->cbs_userdata);
 
     return 0;
@@ -216,3 +555,8 @@ sc_controller_join(struct sc_controller *controller) {
     sc_thread_join(&controller->thread, NULL);
     sc_receiver_join(&controller->receiver);
 }
+
+sc_tick
+sc_controller_get_round_trip(struct sc_controller *controller) {
+    return sc_receiver_get_round_trip(&controller->receiver);
+}
@@ -4,12 +4,14 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "control_msg.h"
 #include "receiver.h"
 #include "util/acksync.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/tick.h"
 #include "util/vecdeque.h"
 
 struct sc_control_msg_queue SC_VECDEQUE(struct sc_control_msg);
@@ -20,9 +22,45 @@ struct sc_controller {
     sc_mutex mutex;
     sc_cond msg_cond;
     bool stopped;
-    struct sc_control_msg_queue queue;
+    // Two lanes: real-time input events must not wait for bulk messages
+    // (app start), which are sent by chunks in between.
+    //
+    // A clipboard to paste (or awaiting an ACK) is also sent by chunks, but
+    // it is pushed to the real-time lane, and holds it until it is fully
+    // sent: the input events which follow (typically Ctrl+V) must not reach
+    // the device before it. A clipboard autosync is sent on the bulk lane.
+    struct sc_control_msg_queue queue; // real-time lane
+    struct sc_control_msg_queue bulk_queue; // bulk lane
     struct sc_receiver receiver;
 
+    // Bulk message being streamed by chunks (only accessed by the controller
+    // thread)
+    struct {
+        bool active;
+        bool ordered; // the real-time lane is held until the end
+        struct sc_control_msg msg;
+        // The serialized message is header + payload (referencing msg data)
+        uint8_t header[SC_CONTROL_MSG_BULK_HEADER_MAX_SIZE];
+        size_t header_len;
+        const uint8_t *payload;
+        size_t payload_len;
+        size_t offset; // number of bytes already sent
+    } bulk;
+
+    // Interval between two ping messages (0 to disable)
+    sc_tick ping_interval;
+    sc_tick next_ping; // only accessed by the controller thread
+
+    struct {
+        // Only accessed by the controller thread
+        uint64_t msgs; // number of messages sent
+        uint64_t sends; // number of send calls
+        uint64_t chunks; // number of chunks of bulk messages sent
+        // Protected by the mutex
+        uint64_t merged; // motion events merged into a queued message
+        uint64_t dropped; // motion events dropped because the queue was full
+    } stats;
+
     const struct sc_controller_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -37,10 +75,17 @@ sc_controller_init(struct sc_controller *controller, sc_socket control_socket,
                    const struct sc_controller_callbacks *cbs,
                    void *cbs_userdata);
 
+/**
+ * Configure the optional features
+ *
+ * If `ping_interval` is not 0, ping messages are sent to measure the control
+ * channel latency, which is logged periodically if `report_latency` is true.
+ */
 void
 sc_controller_configure(struct sc_controller *controller,
                         struct sc_acksync *acksync,
-                        struct sc_uhid_devices *uhid_devices);
+                        struct sc_uhid_devices *uhid_devices,
+                        sc_tick ping_interval, bool report_latency);
 
 void
 sc_controller_destroy(struct sc_controller *controller);
@@ -58,4 +103,12 @@ bool
 sc_controller_push_msg(struct sc_controller *controller,
                        const struct sc_control_msg *msg);
 
+/**
+ * Return the smoothed control channel round-trip, or 0 if unknown
+ *
+ * May be called from any thread.
+ */
+sc_tick
+sc_controller_get_round_trip(struct sc_controller *controller);
+
 #endif
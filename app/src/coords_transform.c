@@ -0,0 +1,67 @@
+#include "coords_transform.h"
+
+void
+sc_coords_transform_init(struct sc_coords_transform *t,
+                         struct sc_size window_size,
+                         struct sc_size drawable_size,
+                         struct sc_point rect_pos, struct sc_size rect_size,
+                         struct sc_size content_size,
+                         enum sc_orientation orientation) {
+    t->window_size = window_size;
+    t->drawable_size = drawable_size;
+
+    t->rect_x = rect_pos.x;
+    t->rect_y = rect_pos.y;
+    t->rect_w = rect_size.width;
+    t->rect_h = rect_size.height;
+
+    int32_t w = content_size.width;
+    int32_t h = content_size.height;
+    t->content_w = w;
+    t->content_h = h;
+
+    // (x, y) are the content coordinates
+    switch (orientation) {
+        case SC_ORIENTATION_0:
+            // (x, y)
+            t->xx = 1; t->xy = 0; t->x0 = 0;
+            t->yx = 0; t->yy = 1; t->y0 = 0;
+            break;
+        case SC_ORIENTATION_90:
+            // (y, w - x)
+            t->xx = 0; t->xy = 1; t->x0 = 0;
+            t->yx = -1; t->yy = 0; t->y0 = w;
+            break;
+        case SC_ORIENTATION_180:
+            // (w - x, h - y)
+            t->xx = -1; t->xy = 0; t->x0 = w;
+            t->yx = 0; t->yy = -1; t->y0 = h;
+            break;
+        case SC_ORIENTATION_270:
+            // (h - y, x)
+            t->xx = 0; t->xy = -1; t->x0 = h;
+            t->yx = 1; t->yy = 0; t->y0 = 0;
+            break;
+        case SC_ORIENTATION_FLIP_0:
+            // (w - x, y)
+            t->xx = -1; t->xy = 0; t->x0 = w;
+            t->yx = 0; t->yy = 1; t->y0 = 0;
+            break;
+        case SC_ORIENTATION_FLIP_90:
+            // (h - y, w - x)
+            t->xx = 0; t->xy = -1; t->x0 = h;
+            t->yx = -1; t->yy = 0; t->y0 = w;
+            break;
+        case SC_ORIENTATION_FLIP_180:
+            // (x, h - y)
+            t->xx = 1; t->xy = 0; t->x0 = 0;
+            t->yx = 0; t->yy = -1; t->y0 = h;
+            break;
+        default:
+            assert(orientation == SC_ORIENTATION_FLIP_270);
+            // (y, x)
+            t->xx = 0; t->xy = 1; t->x0 = 0;
+            t->yx = 1; t->yy = 0; t->y0 = 0;
+            break;
+    }
+}
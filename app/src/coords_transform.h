@@ -0,0 +1,82 @@
+#ifndef SC_COORDS_TRANSFORM_H
+#define SC_COORDS_TRANSFORM_H
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "coords.h"
+#include "options.h"
+
+/**
+ * Transform from window coordinates to frame coordinates
+ *
+ * It is precomputed whenever the window size, the content rectangle, the
+ * orientation or the frame size change, so that mapping the position of an
+ * input event requires neither SDL calls nor branches.
+ *
+ * The integer arithmetic (and its rounding) is exactly the same as applying
+ * the HiDPI scale, the content rectangle and the orientation separately.
+ */
+struct sc_coords_transform {
+    // window -> drawable (HiDPI scale)
+    struct sc_size window_size;
+    struct sc_size drawable_size;
+
+    // drawable -> content (scaled to the content size, not rotated)
+    int32_t rect_x;
+    int32_t rect_y;
+    int32_t rect_w;
+    int32_t rect_h;
+    int32_t content_w;
+    int32_t content_h;
+
+    // content -> frame (orientation), with coefficients in {-1, 0, 1}:
+    //   frame.x = xx * x + xy * y + x0
+    //   frame.y = yx * x + yy * y + y0
+    int32_t xx, xy, x0;
+    int32_t yx, yy, y0;
+};
+
+void
+sc_coords_transform_init(struct sc_coords_transform *t,
+                         struct sc_size window_size,
+                         struct sc_size drawable_size,
+                         struct sc_point rect_pos, struct sc_size rect_size,
+                         struct sc_size content_size,
+                         enum sc_orientation orientation);
+
+// Convert coordinates from window to drawable (HiDPI scaling)
+static inline void
+sc_coords_transform_window_to_drawable(const struct sc_coords_transform *t,
+                                       int32_t *x, int32_t *y) {
+    assert(t->window_size.width && t->window_size.height);
+    // 64 bits for intermediate multiplications
+    *x = (int64_t) *x * t->drawable_size.width / t->window_size.width;
+    *y = (int64_t) *y * t->drawable_size.height / t->window_size.height;
+}
+
+static inline struct sc_point
+sc_coords_transform_drawable_to_frame(const struct sc_coords_transform *t,
+                                      int32_t x, int32_t y) {
+    // The content rectangle must be initialized to avoid a division by zero
+    assert(t->rect_w && t->rect_h);
+
+    x = (int64_t) (x - t->rect_x) * t->content_w / t->rect_w;
+    y = (int64_t) (y - t->rect_y) * t->content_h / t->rect_h;
+
+    return (struct sc_point) {
+        .x = t->xx * x + t->xy * y + t->x0,
+        .y = t->yx * x + t->yy * y + t->y0,
+    };
+}
+
+static inline struct sc_point
+sc_coords_transform_window_to_frame(const struct sc_coords_transform *t,
+                                    int32_t x, int32_t y) {
+    sc_coords_transform_window_to_drawable(t, &x, &y);
+    return sc_coords_transform_drawable_to_frame(t, x, y);
+}
+
+#endif
@@ -94,12 +94,20 @@ sc_decoder_packet_sink_push(struct sc_packet_sink *sink,
     return sc_decoder_push(decoder, packet);
 }
 
+static struct sc_frame_source *
+sc_decoder_packet_sink_get_frame_source(struct sc_packet_sink *sink) {
+    struct sc_decoder *decoder = DOWNCAST(sink);
+    return &decoder->frame_source;
+}
+
 void
 sc_decoder_init(struct sc_decoder *decoder, const char *name) {
     decoder->name = name; // statically allocated
     sc_frame_source_init(&decoder->frame_source);
 
     static const struct sc_packet_sink_ops ops = {
+        .name = "decoder",
+        .get_frame_source = sc_decoder_packet_sink_get_frame_source,
         .open = sc_decoder_packet_sink_open,
         .close = sc_decoder_packet_sink_close,
         .push = sc_decoder_packet_sink_push,
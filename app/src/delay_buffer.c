@@ -1,9 +1,11 @@
 #include "delay_buffer.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stdlib.h>
 
 #include <libavutil/avutil.h>
+#include <libavutil/imgutils.h>
 #include <libavformat/avformat.h>
 
 #include "util/log.h"
@@ -12,26 +14,112 @@
 #define DOWNCAST(SINK) container_of(SINK, struct sc_delay_buffer, frame_sink)
 
 static bool
-sc_delayed_frame_init(struct sc_delayed_frame *dframe, const AVFrame *frame) {
-    dframe->frame = av_frame_alloc();
-    if (!dframe->frame) {
-        LOG_OOM();
-        return false;
+sc_delay_buffer_fill_frame(AVFrame *dst, const AVFrame *frame) {
+    // Reuse the buffers of the shell if possible (they may still be
+    // referenced by a sink which has not consumed the previous frame yet)
+    bool reuse = dst->buf[0]
+              && dst->format == frame->format
+              && dst->width == frame->width
+              && dst->height == frame->height
+              && av_frame_is_writable(dst);
+    if (!reuse) {
+        av_frame_unref(dst);
+        dst->format = frame->format;
+        dst->width = frame->width;
+        dst->height = frame->height;
+        if (av_frame_get_buffer(dst, 0)) {
+            LOG_OOM();
+            return false;
+        }
     }
 
-    if (av_frame_ref(dframe->frame, frame)) {
-        LOG_OOM();
-        av_frame_free(&dframe->frame);
+    // Copy the frame, so that the decoder frame is not held during the delay
+    if (av_frame_copy(dst, frame) < 0 || av_frame_copy_props(dst, frame) < 0) {
+        LOGE("Could not copy frame");
+        av_frame_unref(dst);
         return false;
     }
 
     return true;
 }
 
+static inline unsigned
+sc_delay_buffer_index(struct sc_delay_buffer *db, unsigned offset) {
+    return (db->head + offset) % SC_DELAY_BUFFER_MAX_FRAMES;
+}
+
+static inline void
+sc_delay_buffer_release_frame(struct sc_delay_buffer *db, AVFrame *frame) {
+    assert(db->pool_size < SC_DELAY_BUFFER_MAX_FRAMES);
+    db->pool[db->pool_size++] = frame;
+}
+
 static void
-sc_delayed_frame_destroy(struct sc_delayed_frame *dframe) {
+sc_delay_buffer_drop_head(struct sc_delay_buffer *db) {
+    assert(db->count);
+    struct sc_delayed_frame *dframe = &db->ring[db->head];
+    // Release the buffers, so that the memory limit is respected
     av_frame_unref(dframe->frame);
-    av_frame_free(&dframe->frame);
+    sc_delay_buffer_release_frame(db, dframe->frame);
+    db->memory -= dframe->size;
+    db->head = sc_delay_buffer_index(db, 1);
+    --db->count;
+}
+
+static void
+sc_delay_buffer_stats_on_forward(struct sc_delay_buffer_stats *stats,
+                                 sc_tick delay) {
+    if (!stats->pushed || delay < stats->delay_min) {
+        stats->delay_min = delay;
+    }
+    if (delay > stats->delay_max) {
+        stats->delay_max = delay;
+    }
+    stats->delay_total += delay;
+    ++stats->pushed;
+}
+
+static void
+sc_delay_buffer_stats_on_av_sync(struct sc_delay_buffer_stats *stats,
+                                 sc_tick offset) {
+    if (!stats->av_synced || offset < stats->av_offset_min) {
+        stats->av_offset_min = offset;
+    }
+    if (!stats->av_synced || offset > stats->av_offset_max) {
+        stats->av_offset_max = offset;
+    }
+    stats->av_offset_total += offset;
+    ++stats->av_synced;
+}
+
+static void
+sc_delay_buffer_stats_log(struct sc_delay_buffer *db) {
+    struct sc_delay_buffer_stats *stats = &db->stats;
+    if (!stats->pushed) {
+        return;
+    }
+
+    sc_tick avg = stats->delay_total / (sc_tick) stats->pushed;
+    LOGI("Buffering: target %" PRItick " ms, actual avg %" PRItick " ms "
+         "(min %" PRItick ", max %" PRItick "), dropped %" PRIu64
+         " (memory) + %" PRIu64 " (catch-up)",
+         SC_TICK_TO_MS(db->delay), SC_TICK_TO_MS(avg),
+         SC_TICK_TO_MS(stats->delay_min), SC_TICK_TO_MS(stats->delay_max),
+         stats->dropped_memory, stats->dropped_catch_up);
+
+    if (db->av_sync) {
+        if (!stats->av_synced) {
+            LOGI("A/V sync: no frame synchronized to the audio clock");
+            return;
+        }
+
+        sc_tick avg = stats->av_offset_total / (sc_tick) stats->av_synced;
+        LOGI("A/V sync: offset avg %" PRItick " ms (min %" PRItick ", max %"
+             PRItick "), %" PRIu64 "/%" PRIu64 " frames synchronized",
+             SC_TICK_TO_MS(avg), SC_TICK_TO_MS(stats->av_offset_min),
+             SC_TICK_TO_MS(stats->av_offset_max), stats->av_synced,
+             stats->pushed);
+    }
 }
 
 static int
@@ -40,84 +128,137 @@ run_buffering(void *data) {
 
     assert(db->delay > 0);
 
-    for (;;) {
-        sc_mutex_lock(&db->mutex);
+    sc_mutex_lock(&db->mutex);
 
-        while (!db->stopped && sc_vecdeque_is_empty(&db->queue)) {
+    for (;;) {
+        while (!db->stopped && !db->count) {
             sc_cond_wait(&db->queue_cond, &db->mutex);
         }
 
         if (db->stopped) {
-            sc_mutex_unlock(&db->mutex);
-            goto stopped;
+            break;
         }
 
-        struct sc_delayed_frame dframe = sc_vecdeque_pop(&db->queue);
-
-        sc_tick max_deadline = sc_tick_now() + db->delay;
-        // PTS (written by the server) are expressed in microseconds
-        sc_tick pts = SC_TICK_FROM_US(dframe.frame->pts);
-
-        bool timed_out = false;
-        while (!db->stopped && !timed_out) {
-            sc_tick deadline = sc_clock_to_system_time(&db->clock, pts)
-                             + db->delay;
-            if (deadline > max_deadline) {
-                deadline = max_deadline;
+        struct sc_delayed_frame *dframe = &db->ring[db->head];
+
+        sc_tick max_deadline = dframe->push_date + db->delay;
+        sc_tick deadline = sc_clock_to_system_time(&db->clock, dframe->pts)
+                         + db->delay;
+
+        sc_tick now = sc_tick_now();
+
+        if (db->av_sync) {
+            sc_tick audio_date;
+            if (sc_av_sync_to_system_time(db->av_sync, dframe->pts, now,
+                                          &audio_date)) {
+                // Present the frame when the audio is heard (the delay is
+                // only the upper bound)
+                deadline = audio_date;
+            } else {
+                // No audio clock (not started yet, or stalled), do not delay
+                // the video
+                deadline = now;
             }
-
-            timed_out =
-                !sc_cond_timedwait(&db->wait_cond, &db->mutex, deadline);
         }
 
-        bool stopped = db->stopped;
-        sc_mutex_unlock(&db->mutex);
+        if (deadline > max_deadline) {
+            deadline = max_deadline;
+        }
 
-        if (stopped) {
-            sc_delayed_frame_destroy(&dframe);
-            goto stopped;
+        if (now < deadline) {
+            // Wait then reevaluate: the clock may have been updated, or the
+            // head frame dropped in the meantime
+            sc_cond_timedwait(&db->wait_cond, &db->mutex, deadline);
+            continue;
         }
 
 #ifdef SC_BUFFERING_DEBUG
         LOGD("Buffering: %" PRItick ";%" PRItick ";%" PRItick,
-             pts, dframe.push_date, sc_tick_now());
+             dframe->pts, dframe->push_date, now);
 #endif
 
-        bool ok = sc_frame_source_sinks_push(&db->frame_source, dframe.frame);
-        sc_delayed_frame_destroy(&dframe);
+        sc_delay_buffer_stats_on_forward(&db->stats, now - dframe->push_date);
+        sc_tick audio_pts;
+        if (db->av_sync
+                && sc_av_sync_get_audio_pts(db->av_sync, now, &audio_pts)) {
+            // The audio heard when the frame is presented
+            sc_delay_buffer_stats_on_av_sync(&db->stats,
+                                             audio_pts - dframe->pts);
+        }
+
+        // Take the frame, and release the previous output frame (its
+        // buffers will be reused if possible)
+        if (db->out_frame) {
+            sc_delay_buffer_release_frame(db, db->out_frame);
+        }
+        db->out_frame = dframe->frame;
+
+        db->memory -= dframe->size;
+        db->head = sc_delay_buffer_index(db, 1);
+        --db->count;
+
+        sc_mutex_unlock(&db->mutex);
+
+        bool ok = sc_frame_source_sinks_push(&db->frame_source, db->out_frame);
+
+        sc_mutex_lock(&db->mutex);
+
         if (!ok) {
             LOGE("Delayed frame could not be pushed, stopping");
-            sc_mutex_lock(&db->mutex);
             // Prevent to push any new frame
             db->stopped = true;
-            sc_mutex_unlock(&db->mutex);
-            goto stopped;
+            break;
         }
     }
 
-stopped:
     assert(db->stopped);
 
-    // Flush queue
-    while (!sc_vecdeque_is_empty(&db->queue)) {
-        struct sc_delayed_frame *dframe = sc_vecdeque_popref(&db->queue);
-        sc_delayed_frame_destroy(dframe);
-    }
+    sc_mutex_unlock(&db->mutex);
 
     LOGD("Buffering thread ended");
 
     return 0;
 }
 
+static void
+sc_delay_buffer_free_frames(struct sc_delay_buffer *db) {
+    while (db->count) {
+        av_frame_free(&db->ring[db->head].frame);
+        db->head = sc_delay_buffer_index(db, 1);
+        --db->count;
+    }
+    while (db->pool_size) {
+        av_frame_free(&db->pool[--db->pool_size]);
+    }
+    // av_frame_free() accepts NULL
+    av_frame_free(&db->out_frame);
+}
+
 static bool
 sc_delay_buffer_frame_sink_open(struct sc_frame_sink *sink,
                                 const AVCodecContext *ctx) {
     struct sc_delay_buffer *db = DOWNCAST(sink);
     (void) ctx;
 
+    db->head = 0;
+    db->count = 0;
+    db->memory = 0;
+    db->out_frame = NULL;
+
+    // Preallocate the frame shells (their buffers are allocated on demand)
+    for (db->pool_size = 0; db->pool_size < SC_DELAY_BUFFER_MAX_FRAMES;
+            ++db->pool_size) {
+        AVFrame *frame = av_frame_alloc();
+        if (!frame) {
+            LOG_OOM();
+            goto error_free_frames;
+        }
+        db->pool[db->pool_size] = frame;
+    }
+
     bool ok = sc_mutex_init(&db->mutex);
     if (!ok) {
-        return false;
+        goto error_free_frames;
     }
 
     ok = sc_cond_init(&db->queue_cond);
@@ -131,8 +272,8 @@ sc_delay_buffer_frame_sink_open(struct sc_frame_sink *sink,
     }
 
     sc_clock_init(&db->clock);
-    sc_vecdeque_init(&db->queue);
     db->stopped = false;
+    db->stats = (struct sc_delay_buffer_stats) {0};
 
     if (!sc_frame_source_sinks_open(&db->frame_source, ctx)) {
         goto error_destroy_wait_cond;
@@ -154,6 +295,8 @@ error_destroy_queue_cond:
     sc_cond_destroy(&db->queue_cond);
 error_destroy_mutex:
     sc_mutex_destroy(&db->mutex);
+error_free_frames:
+    sc_delay_buffer_free_frames(db);
 
     return false;
 }
@@ -172,9 +315,12 @@ sc_delay_buffer_frame_sink_close(struct sc_frame_sink *sink) {
 
     sc_frame_source_sinks_close(&db->frame_source);
 
+    sc_delay_buffer_stats_log(db);
+
     sc_cond_destroy(&db->wait_cond);
     sc_cond_destroy(&db->queue_cond);
     sc_mutex_destroy(&db->mutex);
+    sc_delay_buffer_free_frames(db);
 }
 
 static bool
@@ -182,6 +328,13 @@ sc_delay_buffer_frame_sink_push(struct sc_frame_sink *sink,
                                 const AVFrame *frame) {
     struct sc_delay_buffer *db = DOWNCAST(sink);
 
+    int size = av_image_get_buffer_size(frame->format, frame->width,
+                                        frame->height, 1);
+    if (size < 0) {
+        LOGE("Unsupported frame format");
+        return false;
+    }
+
     sc_mutex_lock(&db->mutex);
 
     if (db->stopped) {
@@ -189,8 +342,9 @@ sc_delay_buffer_frame_sink_push(struct sc_frame_sink *sink,
         return false;
     }
 
+    sc_tick now = sc_tick_now();
     sc_tick pts = SC_TICK_FROM_US(frame->pts);
-    sc_clock_update(&db->clock, sc_tick_now(), pts);
+    sc_clock_update(&db->clock, now, pts);
     sc_cond_signal(&db->wait_cond);
 
     if (db->first_frame_asap && db->clock.range == 1) {
@@ -198,24 +352,51 @@ sc_delay_buffer_frame_sink_push(struct sc_frame_sink *sink,
         return sc_frame_source_sinks_push(&db->frame_source, frame);
     }
 
-    struct sc_delayed_frame dframe;
-    bool ok = sc_delayed_frame_init(&dframe, frame);
-    if (!ok) {
-        sc_mutex_unlock(&db->mutex);
-        return false;
+    // Make room (if all the frame shells are in use, or if the memory limit
+    // would be exceeded)
+    while (db->count && (!db->pool_size
+                         || db->memory + size > db->max_memory)) {
+        sc_delay_buffer_drop_head(db);
+        ++db->stats.dropped_memory;
     }
 
-#ifdef SC_BUFFERING_DEBUG
-    dframe.push_date = sc_tick_now();
-#endif
+    assert(db->pool_size);
+    AVFrame *dst = db->pool[--db->pool_size];
+
+    sc_mutex_unlock(&db->mutex);
+
+    // Copy without lock, dst is only accessed by the current thread until it
+    // is queued
+    bool ok = sc_delay_buffer_fill_frame(dst, frame);
+
+    sc_mutex_lock(&db->mutex);
 
-    ok = sc_vecdeque_push(&db->queue, dframe);
     if (!ok) {
+        sc_delay_buffer_release_frame(db, dst);
         sc_mutex_unlock(&db->mutex);
-        LOG_OOM();
         return false;
     }
 
+    // The buffering thread may only have removed frames meanwhile
+    assert(db->count < SC_DELAY_BUFFER_MAX_FRAMES);
+    struct sc_delayed_frame *dframe =
+        &db->ring[sc_delay_buffer_index(db, db->count)];
+    dframe->frame = dst;
+    dframe->pts = pts;
+    dframe->push_date = now;
+    dframe->size = size;
+
+    db->memory += size;
+    ++db->count;
+
+    // Catch up if the buffered frames exceed the target delay (by a margin)
+    while (db->count > 1
+            && pts - db->ring[db->head].pts
+                    > db->delay + SC_DELAY_BUFFER_CATCH_UP_MARGIN) {
+        sc_delay_buffer_drop_head(db);
+        ++db->stats.dropped_catch_up;
+    }
+
     sc_cond_signal(&db->queue_cond);
 
     sc_mutex_unlock(&db->mutex);
@@ -223,17 +404,28 @@ sc_delay_buffer_frame_sink_push(struct sc_frame_sink *sink,
     return true;
 }
 
+static struct sc_frame_source *
+sc_delay_buffer_frame_sink_get_frame_source(struct sc_frame_sink *sink) {
+    struct sc_delay_buffer *db = DOWNCAST(sink);
+    return &db->frame_source;
+}
+
 void
 sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
-                     bool first_frame_asap) {
+                     bool first_frame_asap, size_t max_memory) {
     assert(delay > 0);
+    assert(max_memory > 0);
 
     db->delay = delay;
     db->first_frame_asap = first_frame_asap;
+    db->max_memory = max_memory;
+    db->av_sync = NULL;
 
     sc_frame_source_init(&db->frame_source);
 
     static const struct sc_frame_sink_ops ops = {
+        .name = "delay_buffer",
+        .get_frame_source = sc_delay_buffer_frame_sink_get_frame_source,
         .open = sc_delay_buffer_frame_sink_open,
         .close = sc_delay_buffer_frame_sink_close,
         .push = sc_delay_buffer_frame_sink_push,
@@ -241,3 +433,9 @@ sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
 
     db->frame_sink.ops = &ops;
 }
+
+void
+sc_delay_buffer_set_av_sync(struct sc_delay_buffer *db,
+                            struct sc_av_sync *av_sync) {
+    db->av_sync = av_sync;
+}
@@ -4,27 +4,51 @@
 #include "common.h"
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include "av_sync.h"
 #include "clock.h"
 #include "trait/frame_source.h"
 #include "trait/frame_sink.h"
 #include "util/thread.h"
 #include "util/tick.h"
-#include "util/vecdeque.h"
 
 //#define SC_BUFFERING_DEBUG // uncomment to debug
 
+// Max number of frames held by a delay buffer
+#define SC_DELAY_BUFFER_MAX_FRAMES 256
+
+// If the buffered frames span more than the delay plus this margin (for
+// example after a stall), drop the oldest ones to catch up
+#define SC_DELAY_BUFFER_CATCH_UP_MARGIN SC_TICK_FROM_MS(100)
+
 // forward declarations
 typedef struct AVFrame AVFrame;
 
 struct sc_delayed_frame {
     AVFrame *frame;
-#ifdef SC_BUFFERING_DEBUG
+    sc_tick pts;
     sc_tick push_date;
-#endif
+    size_t size;
 };
 
-struct sc_delayed_frame_queue SC_VECDEQUE(struct sc_delayed_frame);
+struct sc_delay_buffer_stats {
+    uint64_t pushed;
+    uint64_t dropped_memory;
+    uint64_t dropped_catch_up;
+    // Actual delay (time spent in the buffer) of the forwarded frames
+    sc_tick delay_total;
+    sc_tick delay_min;
+    sc_tick delay_max;
+    // A/V offset (PTS of the audio heard when the frame is presented minus
+    // the frame PTS, positive if the video is late) of the forwarded frames,
+    // if synchronized to the audio
+    uint64_t av_synced;
+    sc_tick av_offset_total;
+    sc_tick av_offset_min;
+    sc_tick av_offset_max;
+};
 
 struct sc_delay_buffer {
     struct sc_frame_source frame_source; // frame source trait
@@ -32,6 +56,10 @@ struct sc_delay_buffer {
 
     sc_tick delay;
     bool first_frame_asap;
+    size_t max_memory;
+
+    // If set, present the frames in sync with the audio clock
+    struct sc_av_sync *av_sync;
 
     sc_thread thread;
     sc_mutex mutex;
@@ -39,24 +67,52 @@ struct sc_delay_buffer {
     sc_cond wait_cond;
 
     struct sc_clock clock;
-    struct sc_delayed_frame_queue queue;
+
+    // Preallocated ring of delayed frames
+    struct sc_delayed_frame ring[SC_DELAY_BUFFER_MAX_FRAMES];
+    unsigned head;
+    unsigned count;
+    size_t memory; // size of the queued frames
+
+    // Unused frame shells, allocated once, whose buffers are reused when
+    // possible (the most recently released ones are on top)
+    AVFrame *pool[SC_DELAY_BUFFER_MAX_FRAMES];
+    unsigned pool_size;
+
+    // Frame being pushed by the buffering thread
+    AVFrame *out_frame;
+
     bool stopped;
-};
 
-struct sc_delay_buffer_callbacks {
-    bool (*on_new_frame)(struct sc_delay_buffer *db, const AVFrame *frame,
-                         void *userdata);
+    struct sc_delay_buffer_stats stats;
 };
 
 /**
  * Initialize a delay buffer.
  *
+ * Frames are copied into buffers owned by the delay buffer (so that decoder
+ * frames are not held during the delay).
+ *
  * \param delay a (strictly) positive delay
  * \param first_frame_asap if true, do not delay the first frame (useful for
                            a video stream).
+ * \param max_memory the max size of the queued frames (the oldest frames are
+ *                   dropped if it is exceeded)
  */
 void
 sc_delay_buffer_init(struct sc_delay_buffer *db, sc_tick delay,
-                     bool first_frame_asap);
+                     bool first_frame_asap, size_t max_memory);
+
+/**
+ * Present the frames at the date the audio with the same PTS is played
+ *
+ * The delay then becomes the max delay: a frame is never held longer, even if
+ * the audio is late.
+ *
+ * Must be called before the delay buffer is opened.
+ */
+void
+sc_delay_buffer_set_av_sync(struct sc_delay_buffer *db,
+                            struct sc_av_sync *av_sync);
 
 #endif
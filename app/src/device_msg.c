@@ -1,8 +1,6 @@
 #include "device_msg.h"
 
 #include <stdint.h>
-#include <stdlib.h>
-#include <string.h>
 
 #include "util/binary.h"
 #include "util/log.h"
@@ -25,17 +23,9 @@ sc_device_msg_deserialize(const uint8_t *buf, size_t len,
             if (clipboard_len > len - 5) {
                 return 0; // no complete message
             }
-            char *text = malloc(clipboard_len + 1);
-            if (!text) {
-                LOG_OOM();
-                return -1;
-            }
-            if (clipboard_len) {
-                memcpy(text, &buf[5], clipboard_len);
-            }
-            text[clipboard_len] = '\0';
 
-            msg->clipboard.text = text;
+            msg->clipboard.text = (const char *) &buf[5];
+            msg->clipboard.length = clipboard_len;
             return 5 + clipboard_len;
         }
         case DEVICE_MSG_TYPE_ACK_CLIPBOARD: {
@@ -53,41 +43,41 @@ sc_device_msg_deserialize(const uint8_t *buf, size_t len,
             }
             uint16_t id = sc_read16be(&buf[1]);
             size_t size = sc_read16be(&buf[3]);
-            if (size < len - 5) {
+            if (size > len - 5) {
                 return 0; // not available
             }
-            uint8_t *data = malloc(size);
-            if (!data) {
-                LOG_OOM();
-                return -1;
-            }
-            if (size) {
-                memcpy(data, &buf[5], size);
-            }
 
             msg->uhid_output.id = id;
             msg->uhid_output.size = size;
-            msg->uhid_output.data = data;
+            msg->uhid_output.data = &buf[5];
 
             return 5 + size;
         }
+        case DEVICE_MSG_TYPE_PONG: {
+            if (len < 21) {
+                return 0; // no complete message
+            }
+            msg->pong.push_date = sc_read64be(&buf[1]);
+            msg->pong.send_date = sc_read64be(&buf[9]);
+            msg->pong.device_delay = sc_read32be(&buf[17]);
+            return 21;
+        }
+        case DEVICE_MSG_TYPE_CHUNK: {
+            if (len < 4) {
+                // at least type + last flag + size
+                return 0; // no complete message
+            }
+            size_t size = sc_read16be(&buf[2]);
+            if (size > len - 4) {
+                return 0; // no complete message
+            }
+            msg->chunk.last = buf[1];
+            msg->chunk.size = size;
+            msg->chunk.data = &buf[4];
+            return 4 + size;
+        }
         default:
             LOGW("Unknown device message type: %d", (int) msg->type);
             return -1; // error, we cannot recover
     }
 }
-
-void
-sc_device_msg_destroy(struct sc_device_msg *msg) {
-    switch (msg->type) {
-        case DEVICE_MSG_TYPE_CLIPBOARD:
-            free(msg->clipboard.text);
-            break;
-        case DEVICE_MSG_TYPE_UHID_OUTPUT:
-            free(msg->uhid_output.data);
-            break;
-        default:
-            // nothing to do
-            break;
-    }
-}
@@ -7,21 +7,32 @@
 #include <stdint.h>
 #include <unistd.h>
 
-#define DEVICE_MSG_MAX_SIZE (1 << 18) // 256k
+// Larger messages (typically the clipboard) are streamed by chunks
+#define DEVICE_MSG_MAX_SIZE (1 << 17) // 128k
 // type: 1 byte; length: 4 bytes
 #define DEVICE_MSG_TEXT_MAX_LENGTH (DEVICE_MSG_MAX_SIZE - 5)
 
+// Max size of a message reassembled from chunks
+#define DEVICE_MSG_BULK_MAX_SIZE (1 << 24) // 16M
+
 enum sc_device_msg_type {
     DEVICE_MSG_TYPE_CLIPBOARD,
     DEVICE_MSG_TYPE_ACK_CLIPBOARD,
     DEVICE_MSG_TYPE_UHID_OUTPUT,
+    DEVICE_MSG_TYPE_PONG,
+    // Not a message by itself: a piece of a serialized bulk message
+    DEVICE_MSG_TYPE_CHUNK,
 };
 
+// A device message does not own any data: its payload (if any) references the
+// buffer it has been deserialized from, so it must be copied by consumers which
+// need it after the buffer is reused.
 struct sc_device_msg {
     enum sc_device_msg_type type;
     union {
         struct {
-            char *text; // owned, to be freed by free()
+            const char *text; // not null-terminated
+            size_t length;
         } clipboard;
         struct {
             uint64_t sequence;
@@ -29,17 +40,29 @@ struct sc_device_msg {
         struct {
             uint16_t id;
             uint16_t size;
-            uint8_t *data; // owned, to be freed by free()
+            const uint8_t *data;
         } uhid_output;
+        struct {
+            // Echoed from the ping message
+            uint64_t push_date;
+            uint64_t send_date;
+            // Time between the reception of the ping and the sending of the
+            // pong on the device, in microseconds
+            uint32_t device_delay;
+        } pong;
+        struct {
+            bool last;
+            uint16_t size;
+            const uint8_t *data;
+        } chunk;
     };
 };
 
 // return the number of bytes consumed (0 for no msg available, -1 on error)
+//
+// The payload is not copied: msg references buf.
 ssize_t
 sc_device_msg_deserialize(const uint8_t *buf, size_t len,
                           struct sc_device_msg *msg);
 
-void
-sc_device_msg_destroy(struct sc_device_msg *msg);
-
 #endif
@@ -4,6 +4,11 @@
 #include <libavutil/pixfmt.h>
 
 #include "util/log.h"
+#include "util/tick.h"
+
+// Size of the predicted pointer positions, in drawable pixels
+#define SC_DISPLAY_PREDICTION_CURSOR_SIZE 12
+#define SC_DISPLAY_PREDICTION_TRAIL_SIZE 6
 
 static bool
 sc_display_init_novideo_icon(struct sc_display *display,
@@ -289,9 +294,54 @@ sc_display_update_texture(struct sc_display *display, const AVFrame *frame) {
     return SC_DISPLAY_RESULT_OK;
 }
 
+static void
+sc_display_render_prediction(struct sc_display *display,
+                             const struct sc_input_prediction *ip) {
+    if (!ip->count) {
+        return;
+    }
+
+    SDL_Renderer *renderer = display->renderer;
+
+    // The draw color is also used by SDL_RenderClear(), restore it afterwards
+    uint8_t r, g, b, a;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+    SDL_BlendMode blend_mode;
+    SDL_GetRenderDrawBlendMode(renderer, &blend_mode);
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    sc_tick now = sc_tick_now();
+    for (unsigned i = 0; i < ip->count; ++i) {
+        uint8_t alpha = sc_input_prediction_get_alpha(ip, i, now);
+        if (!alpha) {
+            continue;
+        }
+
+        const struct sc_input_prediction_point *point =
+            sc_input_prediction_get(ip, i);
+        bool cursor = i == ip->count - 1;
+        int size = cursor ? SC_DISPLAY_PREDICTION_CURSOR_SIZE
+                          : SC_DISPLAY_PREDICTION_TRAIL_SIZE;
+        SDL_Rect rect = {
+            .x = point->x - size / 2,
+            .y = point->y - size / 2,
+            .w = size,
+            .h = size,
+        };
+
+        SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, alpha);
+        SDL_RenderFillRect(renderer, &rect);
+    }
+
+    SDL_SetRenderDrawBlendMode(renderer, blend_mode);
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+}
+
 enum sc_display_result
 sc_display_render(struct sc_display *display, const SDL_Rect *geometry,
-                  enum sc_orientation orientation) {
+                  enum sc_orientation orientation,
+                  const struct sc_input_prediction *prediction) {
     SDL_RenderClear(display->renderer);
 
     if (display->pending.flags) {
@@ -337,6 +387,10 @@ sc_display_render(struct sc_display *display, const SDL_Rect *geometry,
         }
     }
 
+    if (prediction) {
+        sc_display_render_prediction(display, prediction);
+    }
+
     SDL_RenderPresent(display->renderer);
     return SC_DISPLAY_RESULT_OK;
 }
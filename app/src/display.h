@@ -8,6 +8,7 @@
 #include <SDL2/SDL.h>
 
 #include "coords.h"
+#include "input_prediction.h"
 #include "opengl.h"
 #include "options.h"
 
@@ -56,8 +57,10 @@ sc_display_set_texture_size(struct sc_display *display, struct sc_size size);
 enum sc_display_result
 sc_display_update_texture(struct sc_display *display, const AVFrame *frame);
 
+// The input prediction overlay, if not NULL, is drawn over the content
 enum sc_display_result
 sc_display_render(struct sc_display *display, const SDL_Rect *geometry,
-                  enum sc_orientation orientation);
+                  enum sc_orientation orientation,
+                  const struct sc_input_prediction *prediction);
 
 #endif
@@ -272,6 +272,21 @@ static bool queue_pop(struct event_queue *queue, SDL_Event *event, Uint64 *times
     return true;
 }
 
+bool event_log_parse_line(const char *line, SDL_Event *event, Uint64 *timestamp) {
+    if (line[0] == '#') return false;
+    
+    char type[32];
+    int x, y, code, modifiers;
+    
+    if (sscanf(line, "%llu %31s %d %d %d %x", 
+               timestamp, type, &x, &y, &code, &modifiers) != 6) {
+        LOGW("Invalid log line format: %s", line);
+        return false;
+    }
+    
+    return parse_and_create_event(type, x, y, code, modifiers, event);
+}
+
 bool event_replayer_process(struct event_replayer *replayer) {
     if (!replayer->is_replaying) {
         return false;
@@ -285,20 +300,9 @@ bool event_replayer_process(struct event_replayer *replayer) {
                 break;
             }
             
-            if (line[0] == '#') continue;
-            
-            Uint64 timestamp;
-            char type[32];
-            int x, y, code, modifiers;
-            
-            if (sscanf(line, "%llu %s %d %d %d %x", 
-                       &timestamp, type, &x, &y, &code, &modifiers) != 6) {
-                LOGW("Invalid log line format: %s", line);
-                continue;
-            }
-            
             SDL_Event event;
-            if (parse_and_create_event(type, x, y, code, modifiers, &event)) {
+            Uint64 timestamp;
+            if (event_log_parse_line(line, &event, &timestamp)) {
                 queue_push(&replayer->queue, &event, timestamp);
             }
         }
@@ -61,6 +61,9 @@ bool event_logger_init(struct event_logger *logger, const char *filename);
 void event_logger_record(struct event_logger *logger, const SDL_Event *event);
 void event_logger_close(struct event_logger *logger);
 
+// 로그 한 줄을 이벤트로 변환 (주석이나 잘못된 줄이면 false)
+bool event_log_parse_line(const char *line, SDL_Event *event, Uint64 *timestamp);
+
 bool event_replayer_init(struct event_replayer *replayer, const char *filename, SDL_Window *window);
 bool event_replayer_process(struct event_replayer *replayer);
 void event_replayer_close(struct event_replayer *replayer);
@@ -21,6 +21,7 @@ sc_input_manager_init(struct sc_input_manager *im,
     im->controller = params->controller;
     im->fp = params->fp;
     im->screen = params->screen;
+    im->screenshot = params->screenshot;
     im->kp = params->kp;
     im->mp = params->mp;
     im->gp = params->gp;
@@ -229,6 +230,23 @@ switch_fps_counter_state(struct sc_input_manager *im) {
     }
 }
 
+static void
+take_screenshot(struct sc_input_manager *im, bool burst) {
+    assert(im->screenshot);
+
+    struct sc_screen *screen = im->screen;
+    // The frame currently displayed (even if paused)
+    const AVFrame *frame = screen->has_frame ? screen->frame : NULL;
+
+    if (burst) {
+        sc_screenshot_start_burst(im->screenshot, frame);
+    } else if (frame) {
+        sc_screenshot_capture(im->screenshot, frame);
+    } else {
+        LOGW("No frame to capture");
+    }
+}
+
 static void
 clipboard_paste(struct sc_input_manager *im) {
     assert(im->controller && im->kp);
@@ -403,14 +421,25 @@ sc_input_manager_process_key(struct sc_input_manager *im,
                     action_home(im, action);
                 }
                 return;
-            case SDLK_b: // fall-through
+            case SDLK_b:
+                if (shift) {
+                    if (video && im->screenshot && !repeat && down) {
+                        take_screenshot(im, true);
+                    }
+                    return;
+                }
+                // fall-through
             case SDLK_BACKSPACE:
                 if (im->kp && !shift && !repeat && !paused) {
                     action_back(im, action);
                 }
                 return;
             case SDLK_s:
-                if (im->kp && !shift && !repeat && !paused) {
+                if (shift) {
+                    if (video && im->screenshot && !repeat && down) {
+                        take_screenshot(im, false);
+                    }
+                } else if (im->kp && !repeat && !paused) {
                     action_app_switch(im, action);
                 }
                 return;
@@ -625,6 +654,19 @@ sc_input_manager_get_position(struct sc_input_manager *im, int32_t x,
     };
 }
 
+static void
+sc_input_manager_predict_input(struct sc_input_manager *im, int32_t x,
+                               int32_t y, bool trail) {
+    if (!im->screen->input_prediction) {
+        return;
+    }
+
+    // Input prediction requires control
+    assert(im->controller);
+    sc_tick round_trip = sc_controller_get_round_trip(im->controller);
+    sc_screen_predict_input(im->screen, x, y, trail, round_trip);
+}
+
 static void
 sc_input_manager_process_mouse_motion(struct sc_input_manager *im,
                                       const SDL_MouseMotionEvent *event) {
@@ -645,14 +687,21 @@ sc_input_manager_process_mouse_motion(struct sc_input_manager *im,
     assert(im->mp->ops->process_mouse_motion);
     im->mp->ops->process_mouse_motion(im->mp, &evt);
 
+    if (im->screen->input_prediction && !im->mp->relative_mode) {
+        int32_t x = event->x;
+        int32_t y = event->y;
+        sc_screen_hidpi_scale_coords(im->screen, &x, &y);
+        // Draw a trail while dragging
+        sc_input_manager_predict_input(im, x, y, im->mouse_buttons_state != 0);
+    }
+
     // vfinger must never be used in relative mode
     assert(!im->mp->relative_mode || !im->vfinger_down);
 
     if (im->vfinger_down) {
         assert(!im->mp->relative_mode); // assert one more time
-        struct sc_point mouse =
-           sc_screen_convert_window_to_frame_coords(im->screen, event->x,
-                                                    event->y);
+        // Reuse the position already mapped to the frame
+        struct sc_point mouse = evt.position.point;
         struct sc_point vfinger = inverse_point(mouse, im->screen->frame_size,
                                                 im->vfinger_invert_x,
                                                 im->vfinger_invert_y);
@@ -668,13 +717,12 @@ sc_input_manager_process_touch(struct sc_input_manager *im,
         return;
     }
 
-    int dw;
-    int dh;
-    SDL_GL_GetDrawableSize(im->screen->window, &dw, &dh);
+    // The drawable size is cached along with the coordinates transform
+    struct sc_size drawable_size = im->screen->transform.drawable_size;
 
     // SDL touch event coordinates are normalized in the range [0; 1]
-    int32_t x = event->x * dw;
-    int32_t y = event->y * dh;
+    int32_t x = event->x * drawable_size.width;
+    int32_t y = event->y * drawable_size.height;
 
     struct sc_touch_event evt = {
         .position = {
@@ -688,6 +736,11 @@ sc_input_manager_process_touch(struct sc_input_manager *im,
     };
 
     im->mp->ops->process_touch(im->mp, &evt);
+
+    if (event->type != SDL_FINGERUP) {
+        bool trail = event->type == SDL_FINGERMOTION;
+        sc_input_manager_predict_input(im, x, y, trail);
+    }
 }
 
 static enum sc_mouse_binding
@@ -823,6 +876,14 @@ sc_input_manager_process_mouse_button(struct sc_input_manager *im,
     assert(im->mp->ops->process_mouse_click);
     im->mp->ops->process_mouse_click(im->mp, &evt);
 
+    if (down && im->screen->input_prediction && !im->mp->relative_mode) {
+        int32_t x = event->x;
+        int32_t y = event->y;
+        sc_screen_hidpi_scale_coords(im->screen, &x, &y);
+        // Start a new trail
+        sc_input_manager_predict_input(im, x, y, false);
+    }
+
     if (im->mp->relative_mode) {
         assert(!im->vfinger_down); // vfinger must not be used in relative mode
         // No pinch-to-zoom simulation
@@ -850,9 +911,8 @@ sc_input_manager_process_mouse_button(struct sc_input_manager *im,
     // of the screen. It is expected to be less frequently used, that's why the
     // one-mod shortcuts are assigned to rotation and vertical tilt.
     if (change_vfinger) {
-        struct sc_point mouse =
-            sc_screen_convert_window_to_frame_coords(im->screen, event->x,
-                                                                 event->y);
+        // Reuse the position already mapped to the frame
+        struct sc_point mouse = evt.position.point;
         if (down) {
             // Ctrl  Shift     invert_x  invert_y
             // ----  ----- ==> --------  --------
@@ -11,6 +11,7 @@
 #include "file_pusher.h"
 #include "fps_counter.h"
 #include "options.h"
+#include "screenshot.h"
 #include "trait/gamepad_processor.h"
 #include "trait/key_processor.h"
 #include "trait/mouse_processor.h"
@@ -19,6 +20,7 @@ struct sc_input_manager {
     struct sc_controller *controller;
     struct sc_file_pusher *fp;
     struct sc_screen *screen;
+    struct sc_screenshot *screenshot; // may be NULL
 
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
@@ -50,6 +52,7 @@ struct sc_input_manager_params {
     struct sc_controller *controller;
     struct sc_file_pusher *fp;
     struct sc_screen *screen;
+    struct sc_screenshot *screenshot;
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
     struct sc_gamepad_processor *gp;
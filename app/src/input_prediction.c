@@ -0,0 +1,91 @@
+#include "input_prediction.h"
+
+void
+sc_input_prediction_init(struct sc_input_prediction *ip) {
+    ip->head = 0;
+    ip->count = 0;
+    ip->has_frame = false;
+    ip->last_pts = 0;
+    ip->last_frame_date = 0;
+}
+
+static void
+sc_input_prediction_pop(struct sc_input_prediction *ip) {
+    assert(ip->count);
+    ip->head = (ip->head + 1) % SC_INPUT_PREDICTION_TRAIL_LENGTH;
+    --ip->count;
+}
+
+void
+sc_input_prediction_push(struct sc_input_prediction *ip, int32_t x, int32_t y,
+                         bool trail, sc_tick round_trip, sc_tick now) {
+    if (!trail) {
+        ip->count = 0;
+    } else if (ip->count == SC_INPUT_PREDICTION_TRAIL_LENGTH) {
+        sc_input_prediction_pop(ip);
+    }
+
+    int64_t device_date;
+    if (ip->has_frame) {
+        // The frame PTS are expressed in microseconds. The frames captured
+        // before the event reaches the device must not acknowledge it.
+        device_date = ip->last_pts
+                    + SC_TICK_TO_US(now - ip->last_frame_date + round_trip);
+    } else {
+        // Any frame will acknowledge the position
+        device_date = INT64_MIN;
+    }
+
+    unsigned i = (ip->head + ip->count) % SC_INPUT_PREDICTION_TRAIL_LENGTH;
+    ip->points[i] = (struct sc_input_prediction_point) {
+        .x = x,
+        .y = y,
+        .date = now,
+        .device_date = device_date,
+    };
+    ++ip->count;
+}
+
+bool
+sc_input_prediction_on_frame(struct sc_input_prediction *ip, int64_t pts,
+                             sc_tick now) {
+    ip->has_frame = true;
+    ip->last_pts = pts;
+    ip->last_frame_date = now;
+
+    // The points are ordered by date, so they are acknowledged in order
+    bool acked = false;
+    while (ip->count
+            && sc_input_prediction_get(ip, 0)->device_date < pts) {
+        sc_input_prediction_pop(ip);
+        acked = true;
+    }
+
+    return acked;
+}
+
+void
+sc_input_prediction_expire(struct sc_input_prediction *ip, sc_tick now) {
+    while (ip->count && now - sc_input_prediction_get(ip, 0)->date
+                            >= SC_INPUT_PREDICTION_MAX_AGE) {
+        sc_input_prediction_pop(ip);
+    }
+}
+
+uint8_t
+sc_input_prediction_get_alpha(const struct sc_input_prediction *ip,
+                              unsigned index, sc_tick now) {
+    const struct sc_input_prediction_point *point =
+        sc_input_prediction_get(ip, index);
+
+    sc_tick age = now - point->date;
+    if (age >= SC_INPUT_PREDICTION_MAX_AGE) {
+        return 0;
+    }
+
+    // The most recent point is the most opaque
+    unsigned rank = index + 1;
+    uint64_t alpha = 255 * rank / ip->count;
+    return alpha * (SC_INPUT_PREDICTION_MAX_AGE - age)
+                 / SC_INPUT_PREDICTION_MAX_AGE;
+}
@@ -0,0 +1,104 @@
+#ifndef SC_INPUT_PREDICTION_H
+#define SC_INPUT_PREDICTION_H
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+// Number of positions kept to draw the trail
+#define SC_INPUT_PREDICTION_TRAIL_LENGTH 16
+// Positions not acknowledged by a frame after this delay are dropped (the
+// device does not send frames if its content does not change)
+#define SC_INPUT_PREDICTION_MAX_AGE SC_TICK_FROM_MS(500)
+// Interval between two ping messages to estimate the round-trip, if not
+// explicitly requested
+#define SC_INPUT_PREDICTION_PING_INTERVAL SC_TICK_FROM_MS(500)
+
+struct sc_input_prediction_point {
+    int32_t x; // in drawable coordinates
+    int32_t y;
+    sc_tick date; // local date of the input event
+    // Estimated device date (in the frame PTS time base) when the input event
+    // occurred
+    int64_t device_date;
+};
+
+/**
+ * Local overlay of the most recent pointer positions
+ *
+ * Over a high-latency link, the effect of an input event is only visible once
+ * a frame captured after its injection is received. Meanwhile, the positions
+ * are drawn locally over the device frame.
+ *
+ * The device clock is unknown, so the device date of an input event is
+ * estimated from the PTS of the last frame received and the local time
+ * elapsed since, plus the round-trip: the event reaches the device after the
+ * control delay, and the last frame was captured one video delay before it
+ * was received (both approximated by the control round-trip). A position is
+ * acknowledged (and removed) once a frame with a later PTS is received.
+ */
+struct sc_input_prediction {
+    // Circular buffer of positions, from the oldest to the most recent
+    struct sc_input_prediction_point points[SC_INPUT_PREDICTION_TRAIL_LENGTH];
+    unsigned head; // index of the oldest point
+    unsigned count;
+
+    // Last frame received
+    bool has_frame;
+    int64_t last_pts;
+    sc_tick last_frame_date;
+};
+
+void
+sc_input_prediction_init(struct sc_input_prediction *ip);
+
+/**
+ * Add a pointer position
+ *
+ * If `trail` is false (no button pressed), only the last position is kept
+ * (cursor). Otherwise, the position is appended to the trail (drag).
+ *
+ * The `round_trip` is the current estimate of the control channel round-trip
+ * (0 if unknown).
+ */
+void
+sc_input_prediction_push(struct sc_input_prediction *ip, int32_t x, int32_t y,
+                         bool trail, sc_tick round_trip, sc_tick now);
+
+/**
+ * Notify that a frame has been received
+ *
+ * Return true if some positions have been acknowledged.
+ */
+bool
+sc_input_prediction_on_frame(struct sc_input_prediction *ip, int64_t pts,
+                             sc_tick now);
+
+/**
+ * Drop the positions older than SC_INPUT_PREDICTION_MAX_AGE
+ */
+void
+sc_input_prediction_expire(struct sc_input_prediction *ip, sc_tick now);
+
+static inline const struct sc_input_prediction_point *
+sc_input_prediction_get(const struct sc_input_prediction *ip, unsigned index) {
+    assert(index < ip->count);
+    unsigned i = (ip->head + index) % SC_INPUT_PREDICTION_TRAIL_LENGTH;
+    return &ip->points[i];
+}
+
+/**
+ * Return the opacity of the point at `index`, in [0, 255]
+ *
+ * Older points of the trail fade out, and every point fades out as it gets
+ * closer to SC_INPUT_PREDICTION_MAX_AGE.
+ */
+uint8_t
+sc_input_prediction_get_alpha(const struct sc_input_prediction *ip,
+                              unsigned index, sc_tick now);
+
+#endif
@@ -0,0 +1,262 @@
+#include "mouse_sampler.h"
+
+#include <assert.h>
+
+#include "events.h"
+#include "util/log.h"
+
+/** Downcast mouse processor to mouse_sampler */
+#define DOWNCAST(MP) container_of(MP, struct sc_mouse_sampler, mouse_processor)
+
+// HID mouse reports store the relative motion and the wheel steps on 8 bits,
+// do not accumulate beyond
+#define SC_MOUSE_SAMPLER_HID_MAX_REL 127
+#define SC_MOUSE_SAMPLER_HID_MAX_SCROLL 127.0f
+// The SDK scroll values are serialized in [-1, 1]
+#define SC_MOUSE_SAMPLER_SDK_MAX_SCROLL 1.0f
+
+static void
+sc_mouse_sampler_flush_scroll(struct sc_mouse_sampler *sampler) {
+    struct sc_mouse_processor *delegate = sampler->delegate;
+    struct sc_mouse_scroll_event *scroll = &sampler->scroll;
+    float max = sampler->max_scroll;
+
+    // Forward the accumulated values in as few events as possible (once the
+    // remaining values are in range, they are forwarded exactly, so that the
+    // loop terminates)
+    do {
+        struct sc_mouse_scroll_event event = *scroll;
+        event.hscroll = CLAMP(scroll->hscroll, -max, max);
+        event.vscroll = CLAMP(scroll->vscroll, -max, max);
+        delegate->ops->process_mouse_scroll(delegate, &event);
+
+        scroll->hscroll -= event.hscroll;
+        scroll->vscroll -= event.vscroll;
+    } while (scroll->hscroll != 0.0f || scroll->vscroll != 0.0f);
+}
+
+static void
+sc_mouse_sampler_flush(struct sc_mouse_sampler *sampler, sc_tick now) {
+    struct sc_mouse_processor *delegate = sampler->delegate;
+
+    // At most one of them is pending
+    assert(!sampler->has_motion || !sampler->has_scroll);
+
+    if (sampler->has_motion) {
+        delegate->ops->process_mouse_motion(delegate, &sampler->motion);
+        sampler->has_motion = false;
+        sampler->last_sent = now;
+    } else if (sampler->has_scroll) {
+        sc_mouse_sampler_flush_scroll(sampler);
+        sampler->has_scroll = false;
+        sampler->last_sent = now;
+    }
+}
+
+static void
+sc_mouse_sampler_run_flush(void *userdata) {
+    struct sc_mouse_sampler *sampler = userdata;
+
+    sampler->timer = 0;
+    if (!sampler->stopped) {
+        sc_mouse_sampler_flush(sampler, sc_tick_now());
+    }
+}
+
+static uint32_t
+sc_mouse_sampler_on_timer(uint32_t interval, void *userdata) {
+    (void) interval;
+
+    // Called from the SDL timer thread
+    struct sc_mouse_sampler *sampler = userdata;
+    bool ok = sc_post_to_main_thread(sc_mouse_sampler_run_flush, sampler);
+    (void) ok; // any error already logged
+
+    // One-shot timer
+    return 0;
+}
+
+static void
+sc_mouse_sampler_schedule_flush(struct sc_mouse_sampler *sampler,
+                                sc_tick now) {
+    if (sampler->timer) {
+        // Already scheduled
+        return;
+    }
+
+    sc_tick deadline = sampler->last_sent + sampler->period;
+    assert(deadline > now);
+    // SDL timers have a millisecond resolution, round up
+    uint32_t delay_ms = (SC_TICK_TO_US(deadline - now) + 999) / 1000;
+
+    sampler->timer =
+        SDL_AddTimer(delay_ms, sc_mouse_sampler_on_timer, sampler);
+    if (!sampler->timer) {
+        LOGW("Could not add timer: %s", SDL_GetError());
+        // Do not hold the event
+        sc_mouse_sampler_flush(sampler, now);
+    }
+}
+
+// Return true if the event can be forwarded immediately
+static bool
+sc_mouse_sampler_can_send(struct sc_mouse_sampler *sampler, sc_tick now) {
+    return !sampler->timer && now - sampler->last_sent >= sampler->period;
+}
+
+static bool
+sc_mouse_sampler_merge_motion(struct sc_mouse_sampler *sampler,
+                              const struct sc_mouse_motion_event *event) {
+    struct sc_mouse_motion_event *motion = &sampler->motion;
+    if (motion->pointer_id != event->pointer_id
+            || motion->buttons_state != event->buttons_state) {
+        return false;
+    }
+
+    int32_t xrel = motion->xrel + event->xrel;
+    int32_t yrel = motion->yrel + event->yrel;
+    int32_t max = sampler->max_rel;
+    if (max && (xrel < -max || xrel > max || yrel < -max || yrel > max)) {
+        return false;
+    }
+
+    motion->position = event->position;
+    motion->xrel = xrel;
+    motion->yrel = yrel;
+    return true;
+}
+
+static bool
+sc_mouse_sampler_merge_scroll(struct sc_mouse_sampler *sampler,
+                              const struct sc_mouse_scroll_event *event) {
+    struct sc_mouse_scroll_event *scroll = &sampler->scroll;
+    if (scroll->buttons_state != event->buttons_state) {
+        return false;
+    }
+
+    // Accumulate without limit, the values are split on flush
+    scroll->position = event->position;
+    scroll->hscroll += event->hscroll;
+    scroll->vscroll += event->vscroll;
+    return true;
+}
+
+static void
+sc_mouse_processor_process_mouse_motion(struct sc_mouse_processor *mp,
+                                    const struct sc_mouse_motion_event *event) {
+    struct sc_mouse_sampler *sampler = DOWNCAST(mp);
+
+    sc_tick now = sc_tick_now();
+
+    if (sampler->has_scroll) {
+        sc_mouse_sampler_flush(sampler, now);
+    }
+
+    if (sampler->has_motion) {
+        if (sc_mouse_sampler_merge_motion(sampler, event)) {
+            return;
+        }
+        // Could not merge, forward the pending motion first
+        sc_mouse_sampler_flush(sampler, now);
+    }
+
+    if (sc_mouse_sampler_can_send(sampler, now)) {
+        sampler->delegate->ops->process_mouse_motion(sampler->delegate, event);
+        sampler->last_sent = now;
+        return;
+    }
+
+    sampler->motion = *event;
+    sampler->has_motion = true;
+    sc_mouse_sampler_schedule_flush(sampler, now);
+}
+
+static void
+sc_mouse_processor_process_mouse_scroll(struct sc_mouse_processor *mp,
+                                    const struct sc_mouse_scroll_event *event) {
+    struct sc_mouse_sampler *sampler = DOWNCAST(mp);
+
+    sc_tick now = sc_tick_now();
+
+    if (sampler->has_motion) {
+        sc_mouse_sampler_flush(sampler, now);
+    }
+
+    if (sampler->has_scroll) {
+        if (sc_mouse_sampler_merge_scroll(sampler, event)) {
+            return;
+        }
+        sc_mouse_sampler_flush(sampler, now);
+    }
+
+    sampler->scroll = *event;
+
+    if (sc_mouse_sampler_can_send(sampler, now)) {
+        sc_mouse_sampler_flush_scroll(sampler);
+        sampler->last_sent = now;
+        return;
+    }
+
+    sampler->has_scroll = true;
+    sc_mouse_sampler_schedule_flush(sampler, now);
+}
+
+static void
+sc_mouse_processor_process_mouse_click(struct sc_mouse_processor *mp,
+                                   const struct sc_mouse_click_event *event) {
+    struct sc_mouse_sampler *sampler = DOWNCAST(mp);
+
+    sc_mouse_sampler_flush(sampler, sc_tick_now());
+    sampler->delegate->ops->process_mouse_click(sampler->delegate, event);
+}
+
+static void
+sc_mouse_processor_process_touch(struct sc_mouse_processor *mp,
+                                 const struct sc_touch_event *event) {
+    struct sc_mouse_sampler *sampler = DOWNCAST(mp);
+
+    sc_mouse_sampler_flush(sampler, sc_tick_now());
+    sampler->delegate->ops->process_touch(sampler->delegate, event);
+}
+
+void
+sc_mouse_sampler_init(struct sc_mouse_sampler *sampler,
+                      struct sc_mouse_processor *delegate, uint16_t rate,
+                      bool hid) {
+    assert(rate);
+
+    sampler->delegate = delegate;
+    sampler->period = SC_TICK_FROM_SEC(1) / rate;
+    // The SDK mouse only uses the position, not the relative motion
+    sampler->max_rel = hid ? SC_MOUSE_SAMPLER_HID_MAX_REL : 0;
+    sampler->max_scroll = hid ? SC_MOUSE_SAMPLER_HID_MAX_SCROLL
+                              : SC_MOUSE_SAMPLER_SDK_MAX_SCROLL;
+    sampler->last_sent = 0;
+    sampler->has_motion = false;
+    sampler->has_scroll = false;
+    sampler->timer = 0;
+    sampler->stopped = false;
+
+    // Expose the same optional operations as the delegate
+    sampler->ops = (struct sc_mouse_processor_ops) {
+        .process_mouse_motion = sc_mouse_processor_process_mouse_motion,
+        .process_mouse_click = sc_mouse_processor_process_mouse_click,
+        .process_mouse_scroll = delegate->ops->process_mouse_scroll
+                              ? sc_mouse_processor_process_mouse_scroll : NULL,
+        .process_touch = delegate->ops->process_touch
+                       ? sc_mouse_processor_process_touch : NULL,
+    };
+
+    sampler->mouse_processor.ops = &sampler->ops;
+    sampler->mouse_processor.relative_mode = delegate->relative_mode;
+}
+
+void
+sc_mouse_sampler_destroy(struct sc_mouse_sampler *sampler) {
+    // A flush may already have been posted to the main thread
+    sampler->stopped = true;
+    if (sampler->timer) {
+        SDL_RemoveTimer(sampler->timer);
+        sampler->timer = 0;
+    }
+}
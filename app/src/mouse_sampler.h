@@ -0,0 +1,64 @@
+#ifndef SC_MOUSE_SAMPLER_H
+#define SC_MOUSE_SAMPLER_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL_timer.h>
+
+#include "trait/mouse_processor.h"
+#include "util/tick.h"
+
+/**
+ * Mouse processor limiting the rate of motion and scroll events
+ *
+ * High-rate mice (1000-8000 Hz) generate one motion event per report, far more
+ * than the device can consume. The motion (relative motion and last position)
+ * and scroll deltas received within a sampling period are accumulated and
+ * forwarded as a single event to the delegate mouse processor.
+ *
+ * The accumulated scroll is forwarded in as few events as the delegate can
+ * represent: a HID report holds up to 127 wheel steps, an SDK scroll event
+ * holds values in [-1, 1].
+ *
+ * Click and touch events are forwarded immediately, after the pending
+ * accumulated events, to preserve the order.
+ *
+ * All functions must be called from the main thread.
+ */
+struct sc_mouse_sampler {
+    struct sc_mouse_processor mouse_processor; // mouse processor trait
+
+    struct sc_mouse_processor_ops ops; // same optional ops as the delegate
+    struct sc_mouse_processor *delegate;
+    sc_tick period;
+    int32_t max_rel; // max accumulated relative motion, or 0 if unlimited
+    float max_scroll; // max scroll value of a single forwarded event
+
+    sc_tick last_sent; // date of the last event forwarded
+    bool has_motion;
+    struct sc_mouse_motion_event motion;
+    bool has_scroll;
+    struct sc_mouse_scroll_event scroll; // hscroll/vscroll accumulated
+
+    SDL_TimerID timer; // pending flush, or 0
+    bool stopped;
+};
+
+/**
+ * Initialize a mouse sampler forwarding at most `rate` motion (or scroll)
+ * events per second
+ *
+ * If `hid` is true, the delegate sends HID reports (UHID or AOA), which limit
+ * the relative motion and scroll values of a single event.
+ */
+void
+sc_mouse_sampler_init(struct sc_mouse_sampler *sampler,
+                      struct sc_mouse_processor *delegate, uint16_t rate,
+                      bool hid);
+
+void
+sc_mouse_sampler_destroy(struct sc_mouse_sampler *sampler);
+
+#endif
@@ -60,14 +60,29 @@ const struct scrcpy_options scrcpy_options_default = {
     .window_height = 0,
     .display_id = 0,
     .video_buffer = 0,
+    .video_buffer_max_memory = 512 * 1024 * 1024,
     .audio_buffer = -1, // depends on the audio format,
+    .audio_buffer_min = 0,
+    .audio_buffer_max = 0,
     .audio_output_buffer = SC_TICK_FROM_MS(5),
+    .audio_output_backend = SC_AUDIO_OUTPUT_BACKEND_SDL,
+    .audio_output_device = NULL,
     .time_limit = 0,
     .screen_off_timeout = -1,
 #ifdef HAVE_V4L2
     .v4l2_device = NULL,
     .v4l2_buffer = 0,
 #endif
+#ifdef HAVE_SHM
+    .shm_name = NULL,
+#endif
+    .async_sinks = 0,
+    .benchmark = false,
+    .audio_meter = false,
+    .screenshot_dir = ".",
+    .screenshot_format = SC_SCREENSHOT_FORMAT_PNG,
+    .screenshot_burst = SC_TICK_FROM_SEC(3),
+    .ping_interval = 0,
 #ifdef HAVE_USB
     .otg = false,
 #endif
@@ -110,6 +125,10 @@ const struct scrcpy_options scrcpy_options_default = {
     .angle = NULL,
     .vd_destroy_content = true,
     .vd_system_decorations = true,
+    .input_prediction = false,
+    .mouse_sampling_rate = 0,
+    .mouse_hid_sampling = true,
+    .av_sync = false,
     .record_events = false,
     .replay_file = NULL,
 };
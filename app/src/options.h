@@ -40,6 +40,11 @@ sc_record_format_is_audio_only(enum sc_record_format fmt) {
         || fmt == SC_RECORD_FORMAT_WAV;
 }
 
+enum sc_screenshot_format {
+    SC_SCREENSHOT_FORMAT_PNG,
+    SC_SCREENSHOT_FORMAT_RAW, // I420
+};
+
 enum sc_codec {
     SC_CODEC_H264,
     SC_CODEC_H265,
@@ -62,6 +67,12 @@ enum sc_audio_source {
     SC_AUDIO_SOURCE_PLAYBACK,
 };
 
+enum sc_audio_output_backend {
+    SC_AUDIO_OUTPUT_BACKEND_SDL,
+    SC_AUDIO_OUTPUT_BACKEND_ALSA, // only available with HAVE_ALSA
+    SC_AUDIO_OUTPUT_BACKEND_NULL,
+};
+
 enum sc_camera_facing {
     SC_CAMERA_FACING_ANY,
     SC_CAMERA_FACING_FRONT,
@@ -258,14 +269,33 @@ struct scrcpy_options {
     uint16_t window_height;
     uint32_t display_id;
     sc_tick video_buffer;
+    size_t video_buffer_max_memory;
     sc_tick audio_buffer;
+    // Bounds of the adaptive audio buffering (0 if not adaptive)
+    sc_tick audio_buffer_min;
+    sc_tick audio_buffer_max;
     sc_tick audio_output_buffer;
+    enum sc_audio_output_backend audio_output_backend;
+    const char *audio_output_device;
     sc_tick time_limit;
     sc_tick screen_off_timeout;
 #ifdef HAVE_V4L2
     const char *v4l2_device;
     sc_tick v4l2_buffer;
 #endif
+#ifdef HAVE_SHM
+    const char *shm_name;
+#endif
+#define SC_ASYNC_SINK_RECORDER 0x1
+#define SC_ASYNC_SINK_V4L2 0x2
+#define SC_ASYNC_SINK_SHM 0x4
+    uint8_t async_sinks;
+    bool benchmark;
+    bool audio_meter;
+    const char *screenshot_dir;
+    enum sc_screenshot_format screenshot_format;
+    sc_tick screenshot_burst;
+    sc_tick ping_interval;
 #ifdef HAVE_USB
     bool otg;
 #endif
@@ -312,6 +342,10 @@ struct scrcpy_options {
     const char *start_app;
     bool vd_destroy_content;
     bool vd_system_decorations;
+    bool input_prediction;
+    uint16_t mouse_sampling_rate; // 0 to forward every event
+    bool mouse_hid_sampling;
+    bool av_sync;
     // Event recording and replay
     bool record_events;          // 이벤트 기록 여부
     const char *replay_file;     // 재생할 이벤트 파일 경로
@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <SDL2/SDL_clipboard.h>
 
 #include "device_msg.h"
@@ -15,7 +17,7 @@ struct sc_uhid_output_task_data {
     struct sc_uhid_devices *uhid_devices;
     uint16_t id;
     uint16_t size;
-    uint8_t *data;
+    uint8_t data[]; // copied, the receiver buffer is reused
 };
 
 bool
@@ -30,6 +32,16 @@ sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
     receiver->acksync = NULL;
     receiver->uhid_devices = NULL;
 
+    sc_vector_init(&receiver->bulk);
+
+    sc_latency_init(&receiver->latency.rtt);
+    sc_latency_init(&receiver->latency.queue);
+    sc_latency_init(&receiver->latency.device);
+    receiver->latency.count = 0;
+    receiver->latency.last_report = 0;
+    receiver->latency.report = false;
+    atomic_init(&receiver->round_trip, 0);
+
     assert(cbs && cbs->on_ended);
     receiver->cbs = cbs;
     receiver->cbs_userdata = cbs_userdata;
@@ -39,6 +51,7 @@ sc_receiver_init(struct sc_receiver *receiver, sc_socket control_socket,
 
 void
 sc_receiver_destroy(struct sc_receiver *receiver) {
+    sc_vector_destroy(&receiver->bulk);
     sc_mutex_destroy(&receiver->mutex);
 }
 
@@ -70,16 +83,98 @@ task_uhid_output(void *userdata) {
     sc_uhid_devices_process_hid_output(data->uhid_devices, data->id, data->data,
                                        data->size);
 
-    free(data->data);
     free(data);
 }
 
 static void
-process_msg(struct sc_receiver *receiver, struct sc_device_msg *msg) {
+log_latency(const char *name, const struct sc_latency *latency) {
+    static const unsigned pcts[] = {50, 90, 99, 100};
+    sc_tick values[ARRAY_LEN(pcts)];
+    sc_latency_get_percentiles(latency, pcts, values, ARRAY_LEN(pcts));
+
+    LOGI("Control %s: p50 %" PRItick ".%01" PRItick " ms, p90 %" PRItick
+         ".%01" PRItick " ms, p99 %" PRItick ".%01" PRItick " ms, max %"
+         PRItick ".%01" PRItick " ms", name,
+         SC_TICK_TO_MS(values[0]), SC_TICK_TO_US(values[0]) % 1000 / 100,
+         SC_TICK_TO_MS(values[1]), SC_TICK_TO_US(values[1]) % 1000 / 100,
+         SC_TICK_TO_MS(values[2]), SC_TICK_TO_US(values[2]) % 1000 / 100,
+         SC_TICK_TO_MS(values[3]), SC_TICK_TO_US(values[3]) % 1000 / 100);
+}
+
+static void
+report_latency(struct sc_receiver *receiver) {
+    if (!receiver->latency.report || !receiver->latency.count) {
+        return;
+    }
+
+    LOGI("Control latency (last %u pings):", receiver->latency.rtt.count);
+    log_latency("round-trip", &receiver->latency.rtt);
+    log_latency("queueing", &receiver->latency.queue);
+    log_latency("device", &receiver->latency.device);
+}
+
+static void
+process_pong(struct sc_receiver *receiver, const struct sc_device_msg *msg) {
+    sc_tick now = sc_tick_now();
+    sc_tick push_date = (sc_tick) msg->pong.push_date;
+    sc_tick send_date = (sc_tick) msg->pong.send_date;
+    sc_tick device_delay = SC_TICK_FROM_US(msg->pong.device_delay);
+
+    // Do not trust the server
+    if (push_date > send_date || send_date > now) {
+        LOGW("Received invalid pong");
+        return;
+    }
+
+    sc_tick rtt = now - send_date;
+    sc_tick queue = send_date - push_date;
+    LOGV("Pong: rtt=%" PRItick "us queue=%" PRItick "us device=%" PRItick "us",
+         SC_TICK_TO_US(rtt), SC_TICK_TO_US(queue),
+         SC_TICK_TO_US(device_delay));
+
+    sc_latency_add(&receiver->latency.rtt, rtt);
+    sc_latency_add(&receiver->latency.queue, queue);
+    sc_latency_add(&receiver->latency.device, device_delay);
+    ++receiver->latency.count;
+
+    sc_tick estimate = atomic_load_explicit(&receiver->round_trip,
+                                            memory_order_relaxed);
+    if (estimate) {
+        // Exponential moving average, to absorb the jitter
+        estimate += (rtt - estimate) / SC_RECEIVER_ROUND_TRIP_SMOOTHING;
+    } else {
+        estimate = rtt;
+    }
+    // 0 means unknown
+    estimate = MAX(estimate, 1);
+    atomic_store_explicit(&receiver->round_trip, estimate,
+                          memory_order_relaxed);
+
+    if (now - receiver->latency.last_report
+            >= SC_RECEIVER_LATENCY_REPORT_INTERVAL) {
+        if (receiver->latency.last_report) {
+            // Do not report on the very first pong
+            report_latency(receiver);
+        }
+        receiver->latency.last_report = now;
+    }
+}
+
+// The msg payload references the receiver buffer: it must be copied if it is
+// used after process_msg() returns
+static void
+process_msg(struct sc_receiver *receiver, const struct sc_device_msg *msg) {
     switch (msg->type) {
         case DEVICE_MSG_TYPE_CLIPBOARD: {
-            // Take ownership of the text (do not destroy the msg)
-            char *text = msg->clipboard.text;
+            // Copy the text, it is posted to the main thread
+            size_t len = msg->clipboard.length;
+            char *text = malloc(len + 1);
+            if (!text) {
+                LOG_OOM();
+                return;
+            }
+            memcpy(text, msg->clipboard.text, len);
+            text[len] = '\0';
 
             bool ok = sc_post_to_main_thread(task_set_clipboard, text);
             if (!ok) {
@@ -105,7 +200,6 @@ process_msg(struct sc_receiver *receiver, struct sc_device_msg *msg) {
             }
 
             sc_acksync_ack(receiver->acksync, msg->ack_clipboard.sequence);
-            // No allocation to free in the msg
             break;
         case DEVICE_MSG_TYPE_UHID_OUTPUT:
             if (sc_get_log_level() <= SC_LOG_LEVEL_VERBOSE) {
@@ -123,11 +217,12 @@ process_msg(struct sc_receiver *receiver, struct sc_device_msg *msg) {
 
             if (!receiver->uhid_devices) {
                 LOGE("Received unexpected HID output message");
-                sc_device_msg_destroy(msg);
                 return;
             }
 
-            struct sc_uhid_output_task_data *data = malloc(sizeof(*data));
+            // Copy the payload, it is posted to the main thread
+            struct sc_uhid_output_task_data *data =
+                malloc(sizeof(*data) + msg->uhid_output.size);
             if (!data) {
                 LOG_OOM();
                 return;
@@ -139,19 +234,66 @@ process_msg(struct sc_receiver *receiver, struct sc_device_msg *msg) {
             // gets deinitialized)
             data->uhid_devices = receiver->uhid_devices;
             data->id = msg->uhid_output.id;
-            data->data = msg->uhid_output.data; // take ownership
             data->size = msg->uhid_output.size;
+            memcpy(data->data, msg->uhid_output.data, msg->uhid_output.size);
 
             bool ok = sc_post_to_main_thread(task_uhid_output, data);
             if (!ok) {
                 LOGW("Could not post UHID output to main thread");
-                free(data->data);
                 free(data);
                 return;
             }
 
             break;
+        case DEVICE_MSG_TYPE_PONG:
+            process_pong(receiver, msg);
+            break;
+        case DEVICE_MSG_TYPE_CHUNK:
+            // Handled by process_chunk()
+            assert(!"unexpected chunk");
+            break;
+    }
+}
+
+static bool
+process_chunk(struct sc_receiver *receiver, const struct sc_device_msg *msg) {
+    assert(msg->type == DEVICE_MSG_TYPE_CHUNK);
+
+    if (receiver->bulk.size + msg->chunk.size > DEVICE_MSG_BULK_MAX_SIZE) {
+        LOGE("Device bulk message too large");
+        return false;
+    }
+
+    // Append the chunk as soon as it is received
+    bool ok = sc_vector_push_all(&receiver->bulk, msg->chunk.data,
+                                 msg->chunk.size);
+    if (!ok) {
+        LOG_OOM();
+        return false;
+    }
+
+    if (!msg->chunk.last) {
+        return true;
+    }
+
+    // The bulk message is complete
+    struct sc_device_msg bulk_msg;
+    ssize_t r = sc_device_msg_deserialize(receiver->bulk.data,
+                                          receiver->bulk.size, &bulk_msg);
+    if (r <= 0 || (size_t) r != receiver->bulk.size
+            || bulk_msg.type == DEVICE_MSG_TYPE_CHUNK) {
+        LOGE("Invalid device bulk message");
+        return false;
     }
+
+    // bulk_msg references the bulk buffer, release it only once processed
+    process_msg(receiver, &bulk_msg);
+
+    // Release the memory, a bulk message may be huge
+    sc_vector_destroy(&receiver->bulk);
+    sc_vector_init(&receiver->bulk);
+
+    return true;
 }
 
 static ssize_t
@@ -167,8 +309,13 @@ process_msgs(struct sc_receiver *receiver, const uint8_t *buf, size_t len) {
             return head;
         }
 
-        process_msg(receiver, &msg);
-        // the device msg must be destroyed by process_msg()
+        if (msg.type == DEVICE_MSG_TYPE_CHUNK) {
+            if (!process_chunk(receiver, &msg)) {
+                return -1;
+            }
+        } else {
+            process_msg(receiver, &msg);
+        }
 
         head += r;
         assert(head <= len);
@@ -182,12 +329,30 @@ static int
 run_receiver(void *data) {
     struct sc_receiver *receiver = data;
 
+    // Messages are parsed in place, in [tail, head)
     static uint8_t buf[DEVICE_MSG_MAX_SIZE];
     size_t head = 0;
+    size_t tail = 0;
 
     bool error = false;
 
     for (;;) {
+        if (head == DEVICE_MSG_MAX_SIZE) {
+            // The end of the buffer is reached, move the incomplete message
+            // (if any) to the front. This happens at most once per buffer
+            // length (and usually never, since the buffer is rewound whenever
+            // all the data is consumed).
+            size_t pending = head - tail;
+            if (pending == DEVICE_MSG_MAX_SIZE) {
+                LOGE("Device message too large");
+                error = true;
+                break;
+            }
+            memmove(buf, &buf[tail], pending);
+            head = pending;
+            tail = 0;
+        }
+
         assert(head < DEVICE_MSG_MAX_SIZE);
         ssize_t r = net_recv(receiver->control_socket, buf + head,
                              DEVICE_MSG_MAX_SIZE - head);
@@ -198,25 +363,34 @@ run_receiver(void *data) {
         }
 
         head += r;
-        ssize_t consumed = process_msgs(receiver, buf, head);
+        ssize_t consumed = process_msgs(receiver, &buf[tail], head - tail);
         if (consumed == -1) {
             // an error occurred
             error = true;
             break;
         }
 
-        if (consumed) {
-            head -= consumed;
-            // shift the remaining data in the buffer
-            memmove(buf, &buf[consumed], head);
+        tail += consumed;
+        assert(tail <= head);
+        if (tail == head) {
+            // Everything has been consumed, rewind without any copy
+            head = 0;
+            tail = 0;
         }
     }
 
+    report_latency(receiver);
+
     receiver->cbs->on_ended(receiver, error, receiver->cbs_userdata);
 
     return 0;
 }
 
+sc_tick
+sc_receiver_get_round_trip(struct sc_receiver *receiver) {
+    return atomic_load_explicit(&receiver->round_trip, memory_order_relaxed);
+}
+
 bool
 sc_receiver_start(struct sc_receiver *receiver) {
     LOGD("Starting receiver thread");
@@ -3,12 +3,21 @@
 
 #include "common.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 
 #include "uhid/uhid_output.h"
 #include "util/acksync.h"
+#include "util/latency.h"
 #include "util/net.h"
 #include "util/thread.h"
+#include "util/tick.h"
+#include "util/vector.h"
+
+// Interval between two reports of the control channel latency
+#define SC_RECEIVER_LATENCY_REPORT_INTERVAL SC_TICK_FROM_SEC(10)
+// Weight of a new round-trip measurement in the smoothed estimate (1/N)
+#define SC_RECEIVER_ROUND_TRIP_SMOOTHING 8
 
 // receive events from the device
 // managed by the controller
@@ -20,6 +29,25 @@ struct sc_receiver {
     struct sc_acksync *acksync;
     struct sc_uhid_devices *uhid_devices;
 
+    // Bulk message being reassembled from chunks (only accessed by the
+    // receiver thread)
+    struct SC_VECTOR(uint8_t) bulk;
+
+    // Control channel latency, measured by ping messages (only accessed by
+    // the receiver thread)
+    struct {
+        struct sc_latency rtt; // from send to reception of the pong
+        struct sc_latency queue; // time spent in the controller queue
+        struct sc_latency device; // time spent on the device
+        uint64_t count;
+        sc_tick last_report;
+        bool report; // log the percentiles periodically
+    } latency;
+
+    // Smoothed round-trip, or 0 if unknown (written by the receiver thread,
+    // read from any thread)
+    atomic_int_least64_t round_trip;
+
     const struct sc_receiver_callbacks *cbs;
     void *cbs_userdata;
 };
@@ -38,6 +66,14 @@ sc_receiver_destroy(struct sc_receiver *receiver);
 bool
 sc_receiver_start(struct sc_receiver *receiver);
 
+/**
+ * Return the smoothed control channel round-trip, or 0 if unknown
+ *
+ * It is only measured if ping messages are sent.
+ */
+sc_tick
+sc_receiver_get_round_trip(struct sc_receiver *receiver);
+
 // no sc_receiver_stop(), it will automatically stop on control_socket shutdown
 
 void
@@ -788,6 +788,7 @@ sc_recorder_init(struct sc_recorder *recorder, const char *filename,
 
     if (video) {
         static const struct sc_packet_sink_ops video_ops = {
+            .name = "recorder",
             .open = sc_recorder_video_packet_sink_open,
             .close = sc_recorder_video_packet_sink_close,
             .push = sc_recorder_video_packet_sink_push,
@@ -798,6 +799,7 @@ sc_recorder_init(struct sc_recorder *recorder, const char *filename,
 
     if (audio) {
         static const struct sc_packet_sink_ops audio_ops = {
+            .name = "recorder",
             .open = sc_recorder_audio_packet_sink_open,
             .close = sc_recorder_audio_packet_sink_close,
             .push = sc_recorder_audio_packet_sink_push,
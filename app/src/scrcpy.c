@@ -13,17 +13,24 @@
 # include <windows.h>
 #endif
 
+#include "async_sink.h"
+#include "audio_meter.h"
 #include "audio_player.h"
+#include "av_sync.h"
+#include "benchmark.h"
 #include "controller.h"
 #include "decoder.h"
 #include "delay_buffer.h"
 #include "demuxer.h"
 #include "events.h"
 #include "file_pusher.h"
+#include "input_prediction.h"
 #include "keyboard_sdk.h"
+#include "mouse_sampler.h"
 #include "mouse_sdk.h"
 #include "recorder.h"
 #include "screen.h"
+#include "screenshot.h"
 #include "server.h"
 #include "uhid/gamepad_uhid.h"
 #include "uhid/keyboard_uhid.h"
@@ -39,25 +46,40 @@
 #include "util/log.h"
 #include "util/net.h"
 #include "util/rand.h"
+#include "util/strbuf.h"
 #include "util/timeout.h"
 #ifdef HAVE_V4L2
 # include "v4l2_sink.h"
 #endif
+#ifdef HAVE_SHM
+# include "shm_sink.h"
+#endif
 #include "event_log.h"
 
 struct scrcpy {
     struct sc_server server;
     struct sc_screen screen;
     struct sc_audio_player audio_player;
+    struct sc_audio_meter audio_meter;
+    struct sc_av_sync av_sync;
     struct sc_demuxer video_demuxer;
     struct sc_demuxer audio_demuxer;
     struct sc_decoder video_decoder;
     struct sc_decoder audio_decoder;
+    struct sc_benchmark benchmark;
     struct sc_recorder recorder;
+    struct sc_async_packet_sink recorder_video_async;
+    struct sc_async_packet_sink recorder_audio_async;
     struct sc_delay_buffer video_buffer;
+    struct sc_screenshot screenshot;
 #ifdef HAVE_V4L2
     struct sc_v4l2_sink v4l2_sink;
     struct sc_delay_buffer v4l2_buffer;
+    struct sc_async_frame_sink v4l2_async;
+#endif
+#ifdef HAVE_SHM
+    struct sc_shm_sink shm_sink;
+    struct sc_async_frame_sink shm_async;
 #endif
     struct sc_controller controller;
     struct sc_file_pusher file_pusher;
@@ -82,6 +104,7 @@ struct scrcpy {
         struct sc_mouse_aoa mouse_aoa;
 #endif
     };
+    struct sc_mouse_sampler mouse_sampler;
     union {
         struct sc_gamepad_uhid gamepad_uhid;
 #ifdef HAVE_USB
@@ -203,6 +226,12 @@ event_loop(struct scrcpy *s) {
                     LOGW("Device disconnected");
                     running = false;
                     goto end_loop;
+                case SC_EVENT_RUN_ON_MAIN_THREAD: {
+                    sc_runnable_fn run = event.user.data1;
+                    void *userdata = event.user.data2;
+                    run(userdata);
+                    break;
+                }
                 default:
                     if (!sc_screen_handle_event(&s->screen, &event)) {
                         running = false;
@@ -224,6 +253,13 @@ event_loop(struct scrcpy *s) {
                 continue;
             }
             
+            if (event.type == SC_EVENT_RUN_ON_MAIN_THREAD) {
+                sc_runnable_fn run = event.user.data1;
+                void *userdata = event.user.data2;
+                run(userdata);
+                continue;
+            }
+
             if (!s->replay_mode && s->options.record_events) {
                 event_logger_record(&s->logger, &event);
             }
@@ -394,6 +430,37 @@ scrcpy_generate_scid(void) {
     return sc_rand_u32(&rand) & 0x7FFFFFFF;
 }
 
+static void
+sc_log_stages(const char *name, const struct sc_packet_source *source) {
+    struct sc_strbuf buf;
+    if (!sc_strbuf_init(&buf, 64)) {
+        LOG_OOM();
+        return;
+    }
+
+    bool ok = sc_strbuf_append_staticstr(&buf, "demuxer -> ")
+           && sc_packet_source_describe(source, &buf);
+    if (ok) {
+        LOGI("%s stages: %s", name, buf.s);
+    } else {
+        LOG_OOM();
+    }
+
+    free(buf.s);
+}
+
+// Report which stages are actually plugged, to make it explicit whether the
+// streams are decoded
+static void
+sc_log_pipeline(struct scrcpy *s, const struct scrcpy_options *options) {
+    if (options->video) {
+        sc_log_stages("Video", &s->video_demuxer.packet_source);
+    }
+    if (options->audio) {
+        sc_log_stages("Audio", &s->audio_demuxer.packet_source);
+    }
+}
+
 static void
 init_sdl_gamepads(void) {
     // Trigger a SDL_CONTROLLERDEVICEADDED event for all gamepads already
@@ -439,6 +506,9 @@ scrcpy(struct scrcpy_options *options) {
     bool recorder_started = false;
 #ifdef HAVE_V4L2
     bool v4l2_sink_initialized = false;
+#endif
+#ifdef HAVE_SHM
+    bool shm_sink_initialized = false;
 #endif
     bool video_demuxer_started = false;
     bool audio_demuxer_started = false;
@@ -450,7 +520,9 @@ scrcpy(struct scrcpy_options *options) {
 #endif
     bool controller_initialized = false;
     bool controller_started = false;
+    bool mouse_sampler_initialized = false;
     bool screen_initialized = false;
+    bool screenshot_initialized = false;
     bool timeout_initialized = false;
     bool timeout_started = false;
 
@@ -560,7 +632,10 @@ scrcpy(struct scrcpy_options *options) {
         }
     }
 
-    if (options->audio_playback) {
+    // Only the SDL audio output uses the SDL audio subsystem (the null output
+    // must work without any audio device)
+    if (options->audio_playback
+            && options->audio_output_backend == SC_AUDIO_OUTPUT_BACKEND_SDL) {
         if (SDL_Init(SDL_INIT_AUDIO)) {
             LOGE("Could not initialize SDL audio: %s", SDL_GetError());
             goto end;
@@ -625,20 +700,41 @@ scrcpy(struct scrcpy_options *options) {
                         &audio_demuxer_cbs, options);
     }
 
-    bool needs_video_decoder = options->video_playback;
-    bool needs_audio_decoder = options->audio_playback;
+    bool needs_video_decoder = options->video_playback || options->benchmark;
+    bool needs_audio_decoder = options->audio_playback || options->audio_meter;
 #ifdef HAVE_V4L2
     needs_video_decoder |= !!options->v4l2_device;
 #endif
+#ifdef HAVE_SHM
+    needs_video_decoder |= !!options->shm_name;
+#endif
+    if (options->benchmark) {
+        // Must be added before the decoder, to date the packets before they
+        // are decoded (it only records the reception date)
+        sc_benchmark_init(&s->benchmark);
+        sc_packet_source_add_sink(&s->video_demuxer.packet_source,
+                                  &s->benchmark.packet_sink);
+    }
+    // The decoders are added before the recorder, so that decoding (for
+    // display) is never delayed by recording
     if (needs_video_decoder) {
         sc_decoder_init(&s->video_decoder, "video");
         sc_packet_source_add_sink(&s->video_demuxer.packet_source,
                                   &s->video_decoder.packet_sink);
+        if (options->benchmark) {
+            sc_frame_source_add_sink(&s->video_decoder.frame_source,
+                                     &s->benchmark.frame_sink);
+        }
     }
     if (needs_audio_decoder) {
         sc_decoder_init(&s->audio_decoder, "audio");
         sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
                                   &s->audio_decoder.packet_sink);
+        if (options->audio_meter) {
+            sc_audio_meter_init(&s->audio_meter);
+            sc_frame_source_add_sink(&s->audio_decoder.frame_source,
+                                     &s->audio_meter.frame_sink);
+        }
     }
 
     if (options->record_filename) {
@@ -658,13 +754,30 @@ scrcpy(struct scrcpy_options *options) {
         }
         recorder_started = true;
 
+        bool async = options->async_sinks & SC_ASYNC_SINK_RECORDER;
         if (options->video) {
-            sc_packet_source_add_sink(&s->video_demuxer.packet_source,
-                                      &s->recorder.video_packet_sink);
+            struct sc_packet_source *src = &s->video_demuxer.packet_source;
+            if (async) {
+                sc_async_packet_sink_init(&s->recorder_video_async,
+                                          "recorder-video",
+                                          SC_ASYNC_PACKET_SINK_CAPACITY);
+                sc_packet_source_add_sink(src,
+                                          &s->recorder_video_async.packet_sink);
+                src = &s->recorder_video_async.packet_source;
+            }
+            sc_packet_source_add_sink(src, &s->recorder.video_packet_sink);
         }
         if (options->audio) {
-            sc_packet_source_add_sink(&s->audio_demuxer.packet_source,
-                                      &s->recorder.audio_packet_sink);
+            struct sc_packet_source *src = &s->audio_demuxer.packet_source;
+            if (async) {
+                sc_async_packet_sink_init(&s->recorder_audio_async,
+                                          "recorder-audio",
+                                          SC_ASYNC_PACKET_SINK_CAPACITY);
+                sc_packet_source_add_sink(src,
+                                          &s->recorder_audio_async.packet_sink);
+                src = &s->recorder_audio_async.packet_source;
+            }
+            sc_packet_source_add_sink(src, &s->recorder.audio_packet_sink);
         }
     }
 
@@ -812,6 +925,16 @@ aoa_complete:
             mp = &s->mouse_uhid.mouse_processor;
         }
 
+        if (mp && options->mouse_sampling_rate) {
+            bool hid = options->mouse_input_mode != SC_MOUSE_INPUT_MODE_SDK;
+            if (!hid || options->mouse_hid_sampling) {
+                sc_mouse_sampler_init(&s->mouse_sampler, mp,
+                                      options->mouse_sampling_rate, hid);
+                mouse_sampler_initialized = true;
+                mp = &s->mouse_sampler.mouse_processor;
+            }
+        }
+
         if (options->gamepad_input_mode == SC_GAMEPAD_INPUT_MODE_UHID) {
             sc_gamepad_uhid_init(&s->gamepad_uhid, &s->controller);
             gp = &s->gamepad_uhid.gamepad_processor;
@@ -823,7 +946,15 @@ aoa_complete:
             uhid_devices = &s->uhid_devices;
         }
 
-        sc_controller_configure(&s->controller, acksync, uhid_devices);
+        sc_tick ping_interval = options->ping_interval;
+        if (!ping_interval && options->input_prediction) {
+            // The input prediction needs the round-trip estimate, but do not
+            // report the latency if it has not been explicitly requested
+            ping_interval = SC_INPUT_PREDICTION_PING_INTERVAL;
+        }
+
+        sc_controller_configure(&s->controller, acksync, uhid_devices,
+                                ping_interval, options->ping_interval != 0);
 
         if (!sc_controller_start(&s->controller)) {
             goto end;
@@ -838,6 +969,17 @@ aoa_complete:
         const char *window_title =
             options->window_title ? options->window_title : info->device_name;
 
+        struct sc_screenshot *screenshot = NULL;
+        if (options->video_playback) {
+            if (!sc_screenshot_init(&s->screenshot, options->screenshot_dir,
+                                    options->screenshot_format,
+                                    options->screenshot_burst)) {
+                goto end;
+            }
+            screenshot_initialized = true;
+            screenshot = &s->screenshot;
+        }
+
         struct sc_screen_params screen_params = {
             .video = options->video_playback,
             .controller = controller,
@@ -845,6 +987,7 @@ aoa_complete:
             .kp = kp,
             .mp = mp,
             .gp = gp,
+            .screenshot = screenshot,
             .mouse_bindings = options->mouse_bindings,
             .legacy_paste = options->legacy_paste,
             .clipboard_autosync = options->clipboard_autosync,
@@ -860,6 +1003,7 @@ aoa_complete:
             .mipmaps = options->mipmaps,
             .fullscreen = options->fullscreen,
             .start_fps_counter = options->start_fps_counter,
+            .input_prediction = options->input_prediction,
         };
 
         if (!sc_screen_init(&s->screen, &screen_params)) {
@@ -869,20 +1013,47 @@ aoa_complete:
 
         if (options->video_playback) {
             struct sc_frame_source *src = &s->video_decoder.frame_source;
-            if (options->video_buffer) {
+            if (options->av_sync) {
+                sc_av_sync_init(&s->av_sync);
+
+                // The video buffer delay is the max delay
+                sc_tick audio_buffer = MAX(options->audio_buffer,
+                                           options->audio_buffer_max);
+                sc_tick max_delay = audio_buffer
+                                  + options->audio_output_buffer
+                                  + SC_AV_SYNC_MAX_DELAY_MARGIN;
+                if (options->video_buffer > max_delay) {
+                    max_delay = options->video_buffer;
+                }
+
+                sc_delay_buffer_init(&s->video_buffer, max_delay, true,
+                                     options->video_buffer_max_memory);
+                sc_delay_buffer_set_av_sync(&s->video_buffer, &s->av_sync);
+                sc_frame_source_add_sink(src, &s->video_buffer.frame_sink);
+                src = &s->video_buffer.frame_source;
+            } else if (options->video_buffer) {
                 sc_delay_buffer_init(&s->video_buffer,
-                                     options->video_buffer, true);
+                                     options->video_buffer, true,
+                                     options->video_buffer_max_memory);
                 sc_frame_source_add_sink(src, &s->video_buffer.frame_sink);
                 src = &s->video_buffer.frame_source;
             }
 
             sc_frame_source_add_sink(src, &s->screen.frame_sink);
+            // Capture the frames as they are displayed (after buffering)
+            sc_frame_source_add_sink(src, &s->screenshot.frame_sink);
         }
     }
 
     if (options->audio_playback) {
+        // av_sync is only enabled with video playback (initialized above)
+        struct sc_av_sync *av_sync = options->av_sync ? &s->av_sync : NULL;
         sc_audio_player_init(&s->audio_player, options->audio_buffer,
-                             options->audio_output_buffer);
+                             options->audio_buffer_min,
+                             options->audio_buffer_max,
+                             options->audio_output_buffer,
+                             options->audio_output_backend,
+                             options->audio_output_device, av_sync);
         sc_frame_source_add_sink(&s->audio_decoder.frame_source,
                                  &s->audio_player.frame_sink);
     }
@@ -894,8 +1065,15 @@ aoa_complete:
         }
 
         struct sc_frame_source *src = &s->video_decoder.frame_source;
+        if (options->async_sinks & SC_ASYNC_SINK_V4L2) {
+            sc_async_frame_sink_init(&s->v4l2_async, "v4l2",
+                                     SC_ASYNC_FRAME_SINK_CAPACITY);
+            sc_frame_source_add_sink(src, &s->v4l2_async.frame_sink);
+            src = &s->v4l2_async.frame_source;
+        }
         if (options->v4l2_buffer) {
-            sc_delay_buffer_init(&s->v4l2_buffer, options->v4l2_buffer, true);
+            sc_delay_buffer_init(&s->v4l2_buffer, options->v4l2_buffer, true,
+                                 options->video_buffer_max_memory);
             sc_frame_source_add_sink(src, &s->v4l2_buffer.frame_sink);
             src = &s->v4l2_buffer.frame_source;
         }
@@ -906,6 +1084,28 @@ aoa_complete:
     }
 #endif
 
+#ifdef HAVE_SHM
+    if (options->shm_name) {
+        if (!sc_shm_sink_init(&s->shm_sink, options->shm_name)) {
+            goto end;
+        }
+
+        struct sc_frame_source *src = &s->video_decoder.frame_source;
+        if (options->async_sinks & SC_ASYNC_SINK_SHM) {
+            sc_async_frame_sink_init(&s->shm_async, "shm",
+                                     SC_ASYNC_FRAME_SINK_CAPACITY);
+            sc_frame_source_add_sink(src, &s->shm_async.frame_sink);
+            src = &s->shm_async.frame_source;
+        }
+
+        sc_frame_source_add_sink(src, &s->shm_sink.frame_sink);
+
+        shm_sink_initialized = true;
+    }
+#endif
+
+    sc_log_pipeline(s, options);
+
     // Now that the header values have been consumed, the socket(s) will
     // receive the stream(s). Start the demuxer(s).
 
@@ -996,6 +1196,11 @@ end:
         sc_timeout_stop(&s->timeout);
     }
 
+    if (mouse_sampler_initialized) {
+        // Cancel any pending flush before destroying the delegate
+        sc_mouse_sampler_destroy(&s->mouse_sampler);
+    }
+
     // The demuxer is not stopped explicitly, because it will stop by itself on
     // end-of-stream
 #ifdef HAVE_USB
@@ -1057,6 +1262,12 @@ end:
     }
 #endif
 
+#ifdef HAVE_SHM
+    if (shm_sink_initialized) {
+        sc_shm_sink_destroy(&s->shm_sink);
+    }
+#endif
+
 #ifdef HAVE_USB
     if (aoa_hid_initialized) {
         sc_aoa_join(&s->aoa);
@@ -1075,6 +1286,11 @@ end:
         sc_screen_destroy(&s->screen);
     }
 
+    // Write the pending screenshots only once no frame can be captured anymore
+    if (screenshot_initialized) {
+        sc_screenshot_destroy(&s->screenshot);
+    }
+
     if (controller_started) {
         sc_controller_join(&s->controller);
     }
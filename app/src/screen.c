@@ -11,6 +11,9 @@
 
 #define DISPLAY_MARGINS 96
 
+// Delay between two renders of the input prediction overlay (~60 fps)
+#define SC_SCREEN_PREDICTION_RENDER_INTERVAL_MS 16
+
 #define DOWNCAST(SINK) container_of(SINK, struct sc_screen, frame_sink)
 
 static inline struct sc_size
@@ -166,6 +169,10 @@ static void
 sc_screen_update_content_rect(struct sc_screen *screen) {
     assert(screen->video);
 
+    int ww;
+    int wh;
+    SDL_GetWindowSize(screen->window, &ww, &wh);
+
     int dw;
     int dh;
     SDL_GL_GetDrawableSize(screen->window, &dw, &dh);
@@ -181,24 +188,32 @@ sc_screen_update_content_rect(struct sc_screen *screen) {
         rect->y = 0;
         rect->w = drawable_size.width;
         rect->h = drawable_size.height;
-        return;
-    }
-
-    bool keep_width = content_size.width * drawable_size.height
-                    > content_size.height * drawable_size.width;
-    if (keep_width) {
-        rect->x = 0;
-        rect->w = drawable_size.width;
-        rect->h = drawable_size.width * content_size.height
-                                      / content_size.width;
-        rect->y = (drawable_size.height - rect->h) / 2;
     } else {
-        rect->y = 0;
-        rect->h = drawable_size.height;
-        rect->w = drawable_size.height * content_size.width
-                                       / content_size.height;
-        rect->x = (drawable_size.width - rect->w) / 2;
+        bool keep_width = content_size.width * drawable_size.height
+                        > content_size.height * drawable_size.width;
+        if (keep_width) {
+            rect->x = 0;
+            rect->w = drawable_size.width;
+            rect->h = drawable_size.width * content_size.height
+                                          / content_size.width;
+            rect->y = (drawable_size.height - rect->h) / 2;
+        } else {
+            rect->y = 0;
+            rect->h = drawable_size.height;
+            rect->w = drawable_size.height * content_size.width
+                                           / content_size.height;
+            rect->x = (drawable_size.width - rect->w) / 2;
+        }
     }
+
+    // Input events are mapped to the frame on every event, precompute the
+    // transform once
+    struct sc_size window_size = {ww, wh};
+    struct sc_point rect_pos = {rect->x, rect->y};
+    struct sc_size rect_size = {rect->w, rect->h};
+    sc_coords_transform_init(&screen->transform, window_size, drawable_size,
+                             rect_pos, rect_size, content_size,
+                             screen->orientation);
 }
 
 // render the texture to the renderer
@@ -213,15 +228,22 @@ sc_screen_render(struct sc_screen *screen, bool update_content_rect) {
         sc_screen_update_content_rect(screen);
     }
 
+    const struct sc_input_prediction *prediction = NULL;
+    if (screen->input_prediction) {
+        sc_input_prediction_expire(&screen->prediction, sc_tick_now());
+        prediction = &screen->prediction;
+    }
+
     enum sc_display_result res =
-        sc_display_render(&screen->display, &screen->rect, screen->orientation);
+        sc_display_render(&screen->display, &screen->rect, screen->orientation,
+                          prediction);
     (void) res; // any error already logged
 }
 
 static void
 sc_screen_render_novideo(struct sc_screen *screen) {
     enum sc_display_result res =
-        sc_display_render(&screen->display, NULL, SC_ORIENTATION_0);
+        sc_display_render(&screen->display, NULL, SC_ORIENTATION_0, NULL);
     (void) res; // any error already logged
 }
 
@@ -336,6 +358,11 @@ sc_screen_init(struct sc_screen *screen,
 
     screen->video = params->video;
 
+    // The overlay is drawn over the video frames
+    screen->input_prediction = params->video && params->input_prediction;
+    sc_input_prediction_init(&screen->prediction);
+    screen->prediction_timer = 0;
+
     screen->req.x = params->window_x;
     screen->req.y = params->window_y;
     screen->req.width = params->window_width;
@@ -433,6 +460,7 @@ sc_screen_init(struct sc_screen *screen,
         .controller = params->controller,
         .fp = params->fp,
         .screen = screen,
+        .screenshot = params->screenshot,
         .kp = params->kp,
         .mp = params->mp,
         .gp = params->gp,
@@ -454,6 +482,7 @@ sc_screen_init(struct sc_screen *screen,
 #endif
 
     static const struct sc_frame_sink_ops ops = {
+        .name = "screen",
         .open = sc_screen_frame_sink_open,
         .close = sc_screen_frame_sink_close,
         .push = sc_screen_frame_sink_push,
@@ -530,6 +559,9 @@ sc_screen_destroy(struct sc_screen *screen) {
 #ifndef NDEBUG
     assert(!screen->open);
 #endif
+    if (screen->prediction_timer) {
+        SDL_RemoveTimer(screen->prediction_timer);
+    }
     sc_display_destroy(&screen->display);
     av_frame_free(&screen->frame);
     SDL_DestroyWindow(screen->window);
@@ -667,6 +699,11 @@ sc_screen_apply_frame(struct sc_screen *screen) {
         return true;
     }
 
+    if (screen->input_prediction && frame->pts != AV_NOPTS_VALUE) {
+        sc_input_prediction_on_frame(&screen->prediction, frame->pts,
+                                     sc_tick_now());
+    }
+
     if (!screen->has_frame) {
         screen->has_frame = true;
         // this is the very first frame, show the window
@@ -875,73 +912,85 @@ struct sc_point
 sc_screen_convert_drawable_to_frame_coords(struct sc_screen *screen,
                                            int32_t x, int32_t y) {
     assert(screen->video);
-
-    enum sc_orientation orientation = screen->orientation;
-
-    int32_t w = screen->content_size.width;
-    int32_t h = screen->content_size.height;
-
-    // screen->rect must be initialized to avoid a division by zero
-    assert(screen->rect.w && screen->rect.h);
-
-    x = (int64_t) (x - screen->rect.x) * w / screen->rect.w;
-    y = (int64_t) (y - screen->rect.y) * h / screen->rect.h;
-
-    struct sc_point result;
-    switch (orientation) {
-        case SC_ORIENTATION_0:
-            result.x = x;
-            result.y = y;
-            break;
-        case SC_ORIENTATION_90:
-            result.x = y;
-            result.y = w - x;
-            break;
-        case SC_ORIENTATION_180:
-            result.x = w - x;
-            result.y = h - y;
-            break;
-        case SC_ORIENTATION_270:
-            result.x = h - y;
-            result.y = x;
-            break;
-        case SC_ORIENTATION_FLIP_0:
-            result.x = w - x;
-            result.y = y;
-            break;
-        case SC_ORIENTATION_FLIP_90:
-            result.x = h - y;
-            result.y = w - x;
-            break;
-        case SC_ORIENTATION_FLIP_180:
-            result.x = x;
-            result.y = h - y;
-            break;
-        default:
-            assert(orientation == SC_ORIENTATION_FLIP_270);
-            result.x = y;
-            result.y = x;
-            break;
-    }
-
-    return result;
+    return sc_coords_transform_drawable_to_frame(&screen->transform, x, y);
 }
 
 struct sc_point
 sc_screen_convert_window_to_frame_coords(struct sc_screen *screen,
                                          int32_t x, int32_t y) {
-    sc_screen_hidpi_scale_coords(screen, &x, &y);
-    return sc_screen_convert_drawable_to_frame_coords(screen, x, y);
+    assert(screen->video);
+    return sc_coords_transform_window_to_frame(&screen->transform, x, y);
 }
 
 void
 sc_screen_hidpi_scale_coords(struct sc_screen *screen, int32_t *x, int32_t *y) {
     // take the HiDPI scaling (dw/ww and dh/wh) into account
-    int ww, wh, dw, dh;
-    SDL_GetWindowSize(screen->window, &ww, &wh);
-    SDL_GL_GetDrawableSize(screen->window, &dw, &dh);
+    sc_coords_transform_window_to_drawable(&screen->transform, x, y);
+}
+
+static void
+sc_screen_schedule_prediction_render(struct sc_screen *screen);
+
+static void
+sc_screen_run_prediction_render(void *userdata) {
+    struct sc_screen *screen = userdata;
+
+    screen->prediction_timer = 0;
+    if (!screen->has_frame) {
+        return;
+    }
+
+    // Expire the old positions and fade out the remaining ones
+    sc_screen_render(screen, false);
+
+    if (screen->prediction.count) {
+        // Render again until the overlay is empty, even if the device screen
+        // does not change
+        sc_screen_schedule_prediction_render(screen);
+    }
+}
+
+static uint32_t
+sc_screen_on_prediction_timer(uint32_t interval, void *userdata) {
+    (void) interval;
+
+    // Called from the SDL timer thread
+    struct sc_screen *screen = userdata;
+    bool ok = sc_post_to_main_thread(sc_screen_run_prediction_render, screen);
+    (void) ok; // any error already logged
+
+    // One-shot timer
+    return 0;
+}
+
+static void
+sc_screen_schedule_prediction_render(struct sc_screen *screen) {
+    if (screen->prediction_timer) {
+        // Already scheduled
+        return;
+    }
+
+    screen->prediction_timer =
+        SDL_AddTimer(SC_SCREEN_PREDICTION_RENDER_INTERVAL_MS,
+                     sc_screen_on_prediction_timer, screen);
+    if (!screen->prediction_timer) {
+        LOGW("Could not add timer: %s", SDL_GetError());
+        // Do not hold the overlay
+        sc_screen_render(screen, false);
+    }
+}
+
+void
+sc_screen_predict_input(struct sc_screen *screen, int32_t x, int32_t y,
+                        bool trail, sc_tick round_trip) {
+    if (!screen->input_prediction || !screen->has_frame || screen->paused) {
+        return;
+    }
+
+    sc_input_prediction_push(&screen->prediction, x, y, trail, round_trip,
+                             sc_tick_now());
 
-    // scale for HiDPI (64 bits for intermediate multiplications)
-    *x = (int64_t) *x * dw / ww;
-    *y = (int64_t) *y * dh / wh;
+    // Mouse events may be received at a far higher rate than the display
+    // refresh rate: do not render on every event
+    sc_screen_schedule_prediction_render(screen);
 }
@@ -9,10 +9,12 @@
 
 #include "controller.h"
 #include "coords.h"
+#include "coords_transform.h"
 #include "display.h"
 #include "fps_counter.h"
 #include "frame_buffer.h"
 #include "input_manager.h"
+#include "input_prediction.h"
 #include "mouse_capture.h"
 #include "opengl.h"
 #include "options.h"
@@ -58,6 +60,8 @@ struct sc_screen {
     enum sc_orientation orientation;
     // rectangle of the content (excluding black borders)
     struct SDL_Rect rect;
+    // window to frame coordinates, updated along with rect
+    struct sc_coords_transform transform;
     bool has_frame;
     bool fullscreen;
     bool maximized;
@@ -67,6 +71,14 @@ struct sc_screen {
 
     bool paused;
     AVFrame *resume_frame;
+
+    // Local overlay of the pointer positions, until they are visible on the
+    // device frames
+    bool input_prediction;
+    struct sc_input_prediction prediction;
+    // Pending render of the overlay, or 0 (the overlay is rendered at a
+    // limited rate, until it is empty)
+    SDL_TimerID prediction_timer;
 };
 
 struct sc_screen_params {
@@ -77,6 +89,7 @@ struct sc_screen_params {
     struct sc_key_processor *kp;
     struct sc_mouse_processor *mp;
     struct sc_gamepad_processor *gp;
+    struct sc_screenshot *screenshot; // may be NULL
 
     struct sc_mouse_bindings mouse_bindings;
     bool legacy_paste;
@@ -98,6 +111,7 @@ struct sc_screen_params {
 
     bool fullscreen;
     bool start_fps_counter;
+    bool input_prediction;
 };
 
 // initialize screen, create window, renderer and texture (window is hidden)
@@ -169,4 +183,13 @@ sc_screen_convert_drawable_to_frame_coords(struct sc_screen *screen,
 void
 sc_screen_hidpi_scale_coords(struct sc_screen *screen, int32_t *x, int32_t *y);
 
+// Draw a pointer position (in drawable coordinates) locally, until it is
+// acknowledged by a device frame (no-op if input prediction is disabled)
+//
+// If trail is false, the previous positions are discarded. The round_trip is
+// the current estimate of the control channel round-trip (0 if unknown).
+void
+sc_screen_predict_input(struct sc_screen *screen, int32_t x, int32_t y,
+                        bool trail, sc_tick round_trip);
+
 #endif
@@ -0,0 +1,628 @@
+#include "screenshot.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_screenshot */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_screenshot, frame_sink)
+
+// YUV to RGB coefficients, in 16.16 fixed point
+struct sc_yuv_coefs {
+    int y_offset;
+    int y;
+    int rv;
+    int gu;
+    int gv;
+    int bu;
+};
+
+static inline int
+to_fixed(double value) {
+    return (int) (value * 65536 + 0.5);
+}
+
+static void
+get_yuv_coefs(const AVFrame *frame, struct sc_yuv_coefs *coefs) {
+    double kr;
+    double kb;
+    switch (frame->colorspace) {
+        case AVCOL_SPC_BT709:
+            kr = 0.2126;
+            kb = 0.0722;
+            break;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL:
+            kr = 0.2627;
+            kb = 0.0593;
+            break;
+        default:
+            // BT.601
+            kr = 0.299;
+            kb = 0.114;
+    }
+    double kg = 1 - kr - kb;
+
+    bool full_range = frame->color_range == AVCOL_RANGE_JPEG
+                   || frame->format == AV_PIX_FMT_YUVJ420P;
+    double y_scale = full_range ? 1 : 255.0 / 219;
+    double c_scale = full_range ? 1 : 255.0 / 224;
+
+    coefs->y_offset = full_range ? 0 : 16;
+    coefs->y = to_fixed(y_scale);
+    coefs->rv = to_fixed(2 * (1 - kr) * c_scale);
+    coefs->gu = to_fixed(2 * kb * (1 - kb) / kg * c_scale);
+    coefs->gv = to_fixed(2 * kr * (1 - kr) / kg * c_scale);
+    coefs->bu = to_fixed(2 * (1 - kb) * c_scale);
+}
+
+static inline uint8_t
+clip_pixel(int value) {
+    value >>= 16;
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+static void
+convert_to_rgb(const AVFrame *src, AVFrame *dst) {
+    struct sc_yuv_coefs coefs;
+    get_yuv_coefs(src, &coefs);
+
+    for (int row = 0; row < src->height; ++row) {
+        const uint8_t *py = src->data[0] + row * src->linesize[0];
+        const uint8_t *pu = src->data[1] + (row / 2) * src->linesize[1];
+        const uint8_t *pv = src->data[2] + (row / 2) * src->linesize[2];
+        uint8_t *out = dst->data[0] + row * dst->linesize[0];
+
+        for (int col = 0; col < src->width; ++col) {
+            int y = (py[col] - coefs.y_offset) * coefs.y + (1 << 15);
+            int u = pu[col / 2] - 128;
+            int v = pv[col / 2] - 128;
+            *out++ = clip_pixel(y + coefs.rv * v);
+            *out++ = clip_pixel(y - coefs.gu * u - coefs.gv * v);
+            *out++ = clip_pixel(y + coefs.bu * u);
+        }
+    }
+}
+
+static bool
+sc_screenshot_write_png(struct sc_screenshot *ss, const AVFrame *frame,
+                        FILE *file) {
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+    if (!codec) {
+        LOGE("PNG encoder not available (use --screenshot-format=raw)");
+        return false;
+    }
+
+    // Reuse the RGB buffer if the size did not change
+    AVFrame *rgb = ss->rgb_frame;
+    if (rgb->width != frame->width || rgb->height != frame->height) {
+        av_frame_unref(rgb);
+        rgb->format = AV_PIX_FMT_RGB24;
+        rgb->width = frame->width;
+        rgb->height = frame->height;
+        if (av_frame_get_buffer(rgb, 0)) {
+            LOG_OOM();
+            return false;
+        }
+    }
+
+    convert_to_rgb(frame, rgb);
+
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    if (!ctx) {
+        LOG_OOM();
+        return false;
+    }
+
+    bool ret = false;
+
+    ctx->width = frame->width;
+    ctx->height = frame->height;
+    ctx->pix_fmt = AV_PIX_FMT_RGB24;
+    ctx->time_base = (AVRational) {1, 1};
+
+    if (avcodec_open2(ctx, codec, NULL) < 0) {
+        LOGE("Could not open PNG encoder");
+        goto free_context;
+    }
+
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        LOG_OOM();
+        goto free_context;
+    }
+
+    if (avcodec_send_frame(ctx, rgb) < 0 || avcodec_send_frame(ctx, NULL) < 0
+            || avcodec_receive_packet(ctx, packet) < 0) {
+        LOGE("Could not encode PNG");
+        goto free_packet;
+    }
+
+    ret = fwrite(packet->data, 1, packet->size, file) == (size_t) packet->size;
+
+free_packet:
+    av_packet_free(&packet);
+free_context:
+    avcodec_free_context(&ctx);
+
+    return ret;
+}
+
+static bool
+sc_screenshot_write_raw(const AVFrame *frame, FILE *file) {
+    // I420, without padding
+    for (int i = 0; i < 3; ++i) {
+        int width = i ? (frame->width + 1) / 2 : frame->width;
+        int height = i ? (frame->height + 1) / 2 : frame->height;
+        const uint8_t *data = frame->data[i];
+        for (int row = 0; row < height; ++row) {
+            if (fwrite(data, 1, width, file) != (size_t) width) {
+                return false;
+            }
+            data += frame->linesize[i];
+        }
+    }
+
+    return true;
+}
+
+static char *
+sc_screenshot_create_filename(struct sc_screenshot *ss, const AVFrame *frame,
+                              time_t time) {
+    struct tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+
+    char date[32];
+    strftime(date, sizeof(date), "%Y%m%d-%H%M%S", &tm);
+
+    unsigned index = ++ss->next_index;
+
+    char name[96];
+    if (ss->format == SC_SCREENSHOT_FORMAT_RAW) {
+        // The raw data does not contain the frame size
+        snprintf(name, sizeof(name), "scrcpy-%s-%04u-%dx%d.yuv", date, index,
+                 frame->width, frame->height);
+    } else {
+        snprintf(name, sizeof(name), "scrcpy-%s-%04u.png", date, index);
+    }
+
+    size_t len = strlen(ss->dir) + 1 + strlen(name) + 1;
+    char *filename = malloc(len);
+    if (!filename) {
+        LOG_OOM();
+        return NULL;
+    }
+
+    snprintf(filename, len, "%s/%s", ss->dir, name);
+    return filename;
+}
+
+static void
+sc_screenshot_write(struct sc_screenshot *ss, const AVFrame *frame,
+                    time_t time, bool burst) {
+    if (frame->format != AV_PIX_FMT_YUV420P
+            && frame->format != AV_PIX_FMT_YUVJ420P) {
+        LOGW("Screenshot: unsupported frame format %d", frame->format);
+        return;
+    }
+
+    char *filename = sc_screenshot_create_filename(ss, frame, time);
+    if (!filename) {
+        return;
+    }
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        LOGE("Could not open screenshot file: %s", filename);
+        free(filename);
+        return;
+    }
+
+    bool ok = ss->format == SC_SCREENSHOT_FORMAT_RAW
+            ? sc_screenshot_write_raw(frame, file)
+            : sc_screenshot_write_png(ss, frame, file);
+
+    if (fclose(file)) {
+        ok = false;
+    }
+
+    if (!ok) {
+        LOGE("Could not write screenshot: %s", filename);
+    } else if (burst) {
+        LOGD("Screenshot written: %s", filename);
+    } else {
+        LOGI("Screenshot written: %s", filename);
+    }
+
+    free(filename);
+}
+
+// Release the buffers of the entries which are not pending (must be called
+// with the mutex locked)
+static void
+sc_screenshot_release_buffers(struct sc_screenshot *ss) {
+    for (unsigned i = ss->count; i < SC_SCREENSHOT_MAX_FRAMES; ++i) {
+        unsigned index = (ss->head + i) % SC_SCREENSHOT_MAX_FRAMES;
+        av_frame_unref(ss->ring[index].frame);
+    }
+}
+
+static void
+sc_screenshot_end_burst(struct sc_screenshot *ss) {
+    assert(atomic_load_explicit(&ss->bursting, memory_order_relaxed));
+    atomic_store_explicit(&ss->bursting, false, memory_order_relaxed);
+
+    // Release the buffers preallocated but not used by the burst
+    sc_screenshot_release_buffers(ss);
+
+    LOGI("Burst capture complete: %u frames (%u dropped), writing to %s",
+         ss->burst_captured, ss->burst_dropped, ss->dir);
+}
+
+static size_t
+sc_screenshot_get_frame_size(int width, int height) {
+    // YUV 4:2:0
+    return (size_t) width * height * 3 / 2;
+}
+
+// Max number of frames held in memory for this resolution
+static unsigned
+sc_screenshot_get_capacity(int width, int height) {
+    size_t frame_size = sc_screenshot_get_frame_size(width, height);
+    size_t capacity = SC_SCREENSHOT_MAX_MEMORY / frame_size;
+    return CLAMP(capacity, 1, SC_SCREENSHOT_MAX_FRAMES);
+}
+
+// Make sure the entry frame has a buffer for this format and resolution
+static bool
+sc_screenshot_alloc_entry(struct sc_screenshot_entry *entry, int format,
+                          int width, int height) {
+    AVFrame *frame = entry->frame;
+    if (frame->buf[0] && frame->format == format && frame->width == width
+            && frame->height == height) {
+        // Reuse the preallocated buffer
+        return true;
+    }
+
+    av_frame_unref(frame);
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0)) {
+        LOG_OOM();
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sc_screenshot_enqueue(struct sc_screenshot *ss, const AVFrame *frame,
+                      bool burst) {
+    unsigned capacity =
+        sc_screenshot_get_capacity(frame->width, frame->height);
+    if (ss->count >= capacity) {
+        return false;
+    }
+
+    struct sc_screenshot_entry *entry =
+        &ss->ring[(ss->head + ss->count) % SC_SCREENSHOT_MAX_FRAMES];
+    // Copy the frame, so that no decoder buffer is held (the decoder pool is
+    // limited)
+    if (!sc_screenshot_alloc_entry(entry, frame->format, frame->width,
+                                   frame->height)) {
+        return false;
+    }
+    if (av_frame_copy(entry->frame, frame) < 0) {
+        LOGE("Could not copy frame");
+        return false;
+    }
+    entry->frame->colorspace = frame->colorspace;
+    entry->frame->color_range = frame->color_range;
+    entry->time = time(NULL);
+    entry->burst = burst;
+
+    ++ss->count;
+    if (!atomic_load_explicit(&ss->bursting, memory_order_relaxed)) {
+        // During a burst, the thread only waits for the deadline
+        sc_cond_signal(&ss->cond);
+    }
+
+    return true;
+}
+
+static int
+run_screenshot(void *data) {
+    struct sc_screenshot *ss = data;
+
+    sc_mutex_lock(&ss->mutex);
+
+    for (;;) {
+        // Do not write anything during a burst, frames are kept in memory
+        for (;;) {
+            bool bursting =
+                atomic_load_explicit(&ss->bursting, memory_order_relaxed);
+            if (ss->stopped || (!bursting && ss->count)) {
+                break;
+            }
+            if (!bursting) {
+                sc_cond_wait(&ss->cond, &ss->mutex);
+            } else if (sc_tick_now() >= ss->burst_deadline) {
+                sc_screenshot_end_burst(ss);
+            } else {
+                sc_cond_timedwait(&ss->cond, &ss->mutex, ss->burst_deadline);
+            }
+        }
+
+        if (atomic_load_explicit(&ss->bursting, memory_order_relaxed)) {
+            assert(ss->stopped);
+            sc_screenshot_end_burst(ss);
+        }
+
+        if (!ss->count) {
+            // Stopped, and all the pending frames have been written
+            assert(ss->stopped);
+            break;
+        }
+
+        // The producer never accesses the pending entries, so the entry may
+        // be written without the lock
+        struct sc_screenshot_entry *entry = &ss->ring[ss->head];
+
+        sc_mutex_unlock(&ss->mutex);
+
+        sc_screenshot_write(ss, entry->frame, entry->time, entry->burst);
+        // Do not keep the memory once written
+        av_frame_unref(entry->frame);
+
+        sc_mutex_lock(&ss->mutex);
+
+        ss->head = (ss->head + 1) % SC_SCREENSHOT_MAX_FRAMES;
+        --ss->count;
+    }
+
+    sc_mutex_unlock(&ss->mutex);
+
+    LOGD("Screenshot thread ended");
+
+    return 0;
+}
+
+static bool
+sc_screenshot_frame_sink_open(struct sc_frame_sink *sink,
+                              const AVCodecContext *ctx) {
+    (void) sink;
+    (void) ctx;
+    // The thread lifecycle is not managed by the frame producer
+    return true;
+}
+
+static void
+sc_screenshot_frame_sink_close(struct sc_frame_sink *sink) {
+    (void) sink;
+    // Any running burst ends on its deadline
+}
+
+static bool
+sc_screenshot_frame_sink_push(struct sc_frame_sink *sink,
+                              const AVFrame *frame) {
+    struct sc_screenshot *ss = DOWNCAST(sink);
+
+    // Do not lock outside of a burst (almost always)
+    if (!atomic_load_explicit(&ss->bursting, memory_order_relaxed)) {
+        return true;
+    }
+
+    sc_mutex_lock(&ss->mutex);
+    if (atomic_load_explicit(&ss->bursting, memory_order_relaxed)
+            && sc_tick_now() < ss->burst_deadline) {
+        if (sc_screenshot_enqueue(ss, frame, true)) {
+            ++ss->burst_captured;
+        } else {
+            ++ss->burst_dropped;
+        }
+    }
+    sc_mutex_unlock(&ss->mutex);
+
+    return true;
+}
+
+static void
+sc_screenshot_free_frames(struct sc_screenshot *ss, unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+        av_frame_free(&ss->ring[i].frame);
+    }
+    av_frame_free(&ss->rgb_frame);
+}
+
+bool
+sc_screenshot_init(struct sc_screenshot *ss, const char *dir,
+                   enum sc_screenshot_format format, sc_tick burst_duration) {
+    assert(burst_duration > 0);
+
+    ss->dir = strdup(dir);
+    if (!ss->dir) {
+        LOG_OOM();
+        return false;
+    }
+
+    ss->format = format;
+    ss->burst_duration = burst_duration;
+
+    // av_frame_free() accepts NULL
+    ss->rgb_frame = NULL;
+
+    unsigned i;
+    for (i = 0; i < SC_SCREENSHOT_MAX_FRAMES; ++i) {
+        ss->ring[i].frame = av_frame_alloc();
+        if (!ss->ring[i].frame) {
+            LOG_OOM();
+            goto error_free_frames;
+        }
+    }
+
+    ss->rgb_frame = av_frame_alloc();
+    if (!ss->rgb_frame) {
+        LOG_OOM();
+        goto error_free_frames;
+    }
+
+    bool ok = sc_mutex_init(&ss->mutex);
+    if (!ok) {
+        goto error_free_frames;
+    }
+
+    ok = sc_cond_init(&ss->cond);
+    if (!ok) {
+        goto error_destroy_mutex;
+    }
+
+    ss->head = 0;
+    ss->count = 0;
+    atomic_init(&ss->bursting, false);
+    ss->burst_deadline = 0;
+    ss->burst_captured = 0;
+    ss->burst_dropped = 0;
+    ss->stopped = false;
+    ss->thread_started = false;
+    ss->next_index = 0;
+
+    static const struct sc_frame_sink_ops ops = {
+        .name = "screenshot",
+        .open = sc_screenshot_frame_sink_open,
+        .close = sc_screenshot_frame_sink_close,
+        .push = sc_screenshot_frame_sink_push,
+    };
+
+    ss->frame_sink.ops = &ops;
+
+    return true;
+
+error_destroy_mutex:
+    sc_mutex_destroy(&ss->mutex);
+error_free_frames:
+    sc_screenshot_free_frames(ss, i);
+    free(ss->dir);
+
+    return false;
+}
+
+void
+sc_screenshot_destroy(struct sc_screenshot *ss) {
+    if (ss->thread_started) {
+        sc_mutex_lock(&ss->mutex);
+        if (ss->count) {
+            LOGI("Writing %u pending screenshot(s)...", ss->count);
+        }
+        ss->stopped = true;
+        sc_cond_signal(&ss->cond);
+        sc_mutex_unlock(&ss->mutex);
+
+        sc_thread_join(&ss->thread, NULL);
+    }
+
+    sc_cond_destroy(&ss->cond);
+    sc_mutex_destroy(&ss->mutex);
+    sc_screenshot_free_frames(ss, SC_SCREENSHOT_MAX_FRAMES);
+    free(ss->dir);
+}
+
+// The thread is started on the first capture, so that nothing runs if the
+// feature is never used
+static bool
+sc_screenshot_start_thread(struct sc_screenshot *ss) {
+    if (ss->thread_started) {
+        return true;
+    }
+
+    bool ok = sc_thread_create(&ss->thread, run_screenshot, "scrcpy-shot", ss);
+    if (!ok) {
+        LOGE("Could not start screenshot thread");
+        return false;
+    }
+
+    ss->thread_started = true;
+    return true;
+}
+
+bool
+sc_screenshot_capture(struct sc_screenshot *ss, const AVFrame *frame) {
+    if (!sc_screenshot_start_thread(ss)) {
+        return false;
+    }
+
+    sc_mutex_lock(&ss->mutex);
+    bool ok = sc_screenshot_enqueue(ss, frame, false);
+    sc_mutex_unlock(&ss->mutex);
+
+    if (!ok) {
+        LOGW("Could not capture screenshot (too many pending frames)");
+    }
+
+    return ok;
+}
+
+// Preallocate the buffers for the burst, so that the frame sink only copies
+// (must be called with the mutex locked)
+static void
+sc_screenshot_prealloc_burst(struct sc_screenshot *ss, const AVFrame *frame) {
+    unsigned capacity =
+        sc_screenshot_get_capacity(frame->width, frame->height);
+    for (unsigned i = ss->count; i < capacity; ++i) {
+        unsigned index = (ss->head + i) % SC_SCREENSHOT_MAX_FRAMES;
+        if (!sc_screenshot_alloc_entry(&ss->ring[index], frame->format,
+                                       frame->width, frame->height)) {
+            // The remaining buffers will be allocated on capture
+            break;
+        }
+    }
+}
+
+void
+sc_screenshot_start_burst(struct sc_screenshot *ss, const AVFrame *frame) {
+    if (!sc_screenshot_start_thread(ss)) {
+        return;
+    }
+
+    sc_mutex_lock(&ss->mutex);
+
+    if (atomic_load_explicit(&ss->bursting, memory_order_relaxed)) {
+        sc_mutex_unlock(&ss->mutex);
+        LOGW("Burst capture already in progress");
+        return;
+    }
+
+    ss->burst_deadline = sc_tick_now() + ss->burst_duration;
+    ss->burst_captured = 0;
+    ss->burst_dropped = 0;
+
+    if (frame) {
+        sc_screenshot_prealloc_burst(ss, frame);
+        if (sc_screenshot_enqueue(ss, frame, true)) {
+            ++ss->burst_captured;
+        } else {
+            ++ss->burst_dropped;
+        }
+    }
+
+    // Let the frame sink capture the frames
+    atomic_store_explicit(&ss->bursting, true, memory_order_relaxed);
+
+    // Wake up the thread to take the deadline into account
+    sc_cond_signal(&ss->cond);
+
+    sc_mutex_unlock(&ss->mutex);
+
+    LOGI("Burst capture started (%" PRItick " ms)",
+         SC_TICK_TO_MS(ss->burst_duration));
+}
@@ -0,0 +1,116 @@
+#ifndef SC_SCREENSHOT_H
+#define SC_SCREENSHOT_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "options.h"
+#include "trait/frame_sink.h"
+#include "util/thread.h"
+#include "util/tick.h"
+
+// Max number of frames held in memory (captured but not written yet)
+#define SC_SCREENSHOT_MAX_FRAMES 256
+// Max memory used by the frames held in memory (the max number of frames
+// depends on the resolution)
+#define SC_SCREENSHOT_MAX_MEMORY (256 * 1024 * 1024)
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+struct sc_screenshot_entry {
+    AVFrame *frame;
+    time_t time; // capture date, used for the file name
+    bool burst;
+};
+
+/**
+ * Screenshot writer
+ *
+ * A single screenshot is captured from the UI thread, by copying the frame
+ * currently displayed.
+ *
+ * In burst mode, every frame pushed to the frame sink during the burst
+ * duration is copied into a memory ring. The frames are written to disk (by
+ * the worker thread) only once the burst is complete, so that disk I/O and
+ * encoding do not compete with the capture.
+ *
+ * The frames are copied rather than referenced, so that the decoder frame pool
+ * is never exhausted. The ring buffers are preallocated at the start of a
+ * burst, and released once written. The number of frames in memory is bounded
+ * by SC_SCREENSHOT_MAX_MEMORY; the frames exceeding it are dropped (and
+ * counted).
+ *
+ * The frame sink is a no-op (without lock) outside of a burst. The worker
+ * thread is started on the first capture.
+ */
+struct sc_screenshot {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    char *dir;
+    enum sc_screenshot_format format;
+    sc_tick burst_duration;
+
+    sc_thread thread;
+    sc_mutex mutex;
+    sc_cond cond;
+
+    // Preallocated ring of frames to write
+    struct sc_screenshot_entry ring[SC_SCREENSHOT_MAX_FRAMES];
+    unsigned head;
+    unsigned count;
+
+    // Written with the mutex locked, read without lock by the frame sink
+    atomic_bool bursting;
+    sc_tick burst_deadline;
+    unsigned burst_captured;
+    unsigned burst_dropped;
+
+    bool stopped;
+
+    // Only accessed by the UI thread
+    bool thread_started;
+
+    // Only accessed by the worker thread
+    AVFrame *rgb_frame; // converted frame, for PNG encoding
+    unsigned next_index; // to generate unique file names
+};
+
+/**
+ * Initialize the screenshot writer
+ *
+ * \param dir the target directory
+ * \param format the output file format
+ * \param burst_duration the duration of a burst capture
+ */
+bool
+sc_screenshot_init(struct sc_screenshot *ss, const char *dir,
+                   enum sc_screenshot_format format, sc_tick burst_duration);
+
+/**
+ * Write the pending frames, stop the thread and release resources
+ */
+void
+sc_screenshot_destroy(struct sc_screenshot *ss);
+
+/**
+ * Capture a single frame (typically the frame currently displayed)
+ *
+ * The frame is copied, it is written asynchronously.
+ */
+bool
+sc_screenshot_capture(struct sc_screenshot *ss, const AVFrame *frame);
+
+/**
+ * Start a burst capture (every frame received during the burst duration)
+ *
+ * The current frame (if any) is captured as the first frame of the burst.
+ */
+void
+sc_screenshot_start_burst(struct sc_screenshot *ss, const AVFrame *frame);
+
+#endif
@@ -0,0 +1,231 @@
+#include "shm_sink.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "util/log.h"
+
+/** Downcast frame_sink to sc_shm_sink */
+#define DOWNCAST(SINK) container_of(SINK, struct sc_shm_sink, frame_sink)
+
+#define SC_SHM_ALIGN 64
+
+static inline size_t
+align_up(size_t value) {
+    return (value + SC_SHM_ALIGN - 1) & ~(size_t) (SC_SHM_ALIGN - 1);
+}
+
+static inline struct sc_shm_header *
+get_header(struct sc_shm_sink *ss) {
+    return (struct sc_shm_header *) ss->mem;
+}
+
+static inline uint8_t *
+get_slot(struct sc_shm_sink *ss, unsigned index) {
+    struct sc_shm_header *header = get_header(ss);
+    return ss->mem + header->slots_offset + (size_t) index * header->slot_size;
+}
+
+static void
+copy_plane(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+           int src_stride, size_t row_size, unsigned rows) {
+    assert(src_stride > 0);
+    if (dst_stride == (size_t) src_stride) {
+        memcpy(dst, src, dst_stride * (rows - 1) + row_size);
+        return;
+    }
+
+    for (unsigned i = 0; i < rows; ++i) {
+        memcpy(dst, src, row_size);
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+static bool
+sc_shm_sink_open(struct sc_shm_sink *ss, const AVCodecContext *ctx) {
+    assert(ctx->pix_fmt == AV_PIX_FMT_YUV420P);
+
+    if (ctx->width <= 0 || ctx->height <= 0) {
+        LOGE("Invalid video size: %dx%d", ctx->width, ctx->height);
+        return false;
+    }
+
+    // The planes are packed (linesize == width), so the frame size does not
+    // change on rotation
+    size_t w = ctx->width;
+    size_t h = ctx->height;
+    ss->frame_capacity = w * h + 2 * ((w + 1) / 2) * ((h + 1) / 2);
+
+    size_t slots_offset = align_up(sizeof(struct sc_shm_header));
+    size_t slot_size = align_up(sizeof(struct sc_shm_slot_header))
+                     + align_up(ss->frame_capacity);
+    if (slot_size > UINT32_MAX) {
+        LOGE("Video size too large for shared memory: %dx%d",
+             ctx->width, ctx->height);
+        return false;
+    }
+
+    ss->mem_size = slots_offset + SC_SHM_SINK_SLOTS * slot_size;
+
+    ss->fd = shm_open(ss->name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (ss->fd == -1) {
+        LOGE("Could not open shared memory %s: %s", ss->name, strerror(errno));
+        return false;
+    }
+
+    if (ftruncate(ss->fd, ss->mem_size)) {
+        LOGE("Could not resize shared memory %s: %s", ss->name,
+             strerror(errno));
+        goto error_unlink;
+    }
+
+    ss->mem = mmap(NULL, ss->mem_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   ss->fd, 0);
+    if (ss->mem == MAP_FAILED) {
+        LOGE("Could not mmap shared memory %s: %s", ss->name, strerror(errno));
+        goto error_unlink;
+    }
+
+    // The memory is zero-initialized by ftruncate()
+    struct sc_shm_header *header = get_header(ss);
+    header->version = SC_SHM_VERSION;
+    header->slot_count = SC_SHM_SINK_SLOTS;
+    header->slot_size = slot_size;
+    header->slots_offset = slots_offset;
+    atomic_init(&header->closed, 0);
+    atomic_init(&header->frame_index, 0);
+    // Write the magic last, so that a reader never sees a valid magic with an
+    // incomplete header
+    atomic_thread_fence(memory_order_release);
+    header->magic = SC_SHM_MAGIC;
+
+    ss->frame_index = 0;
+    ss->size_error_logged = false;
+
+    LOGI("Shared memory sink started: %s (%u slots of %" SC_PRIsizet
+         " bytes)", ss->name, SC_SHM_SINK_SLOTS, slot_size);
+
+    return true;
+
+error_unlink:
+    shm_unlink(ss->name);
+    close(ss->fd);
+
+    return false;
+}
+
+static void
+sc_shm_sink_close(struct sc_shm_sink *ss) {
+    struct sc_shm_header *header = get_header(ss);
+    atomic_store_explicit(&header->closed, 1, memory_order_release);
+
+    // Readers which already mapped the memory may continue to read it
+    shm_unlink(ss->name);
+    munmap(ss->mem, ss->mem_size);
+    close(ss->fd);
+}
+
+static bool
+sc_shm_sink_push(struct sc_shm_sink *ss, const AVFrame *frame) {
+    size_t w = frame->width;
+    size_t h = frame->height;
+    size_t cw = (w + 1) / 2;
+    size_t ch = (h + 1) / 2;
+    size_t frame_size = w * h + 2 * cw * ch;
+    if (frame_size > ss->frame_capacity) {
+        if (!ss->size_error_logged) {
+            LOGW("Frame %dx%d too large for shared memory, ignored",
+                 frame->width, frame->height);
+            ss->size_error_logged = true;
+        }
+        // Do not fail, the other sinks may still accept the frame
+        return true;
+    }
+
+    struct sc_shm_header *header = get_header(ss);
+
+    uint64_t index = ++ss->frame_index;
+    uint8_t *slot = get_slot(ss, index % SC_SHM_SINK_SLOTS);
+    struct sc_shm_slot_header *sh = (struct sc_shm_slot_header *) slot;
+
+    // Seqlock write: make the sequence odd before touching the slot
+    uint32_t seq = atomic_load_explicit(&sh->seq, memory_order_relaxed);
+    atomic_store_explicit(&sh->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    size_t y_offset = align_up(sizeof(*sh));
+    size_t u_offset = y_offset + w * h;
+    size_t v_offset = u_offset + cw * ch;
+
+    sh->format = SC_SHM_FORMAT_I420;
+    sh->width = w;
+    sh->height = h;
+    sh->linesize[0] = w;
+    sh->linesize[1] = cw;
+    sh->linesize[2] = cw;
+    sh->offset[0] = y_offset;
+    sh->offset[1] = u_offset;
+    sh->offset[2] = v_offset;
+    sh->pts = frame->pts;
+    sh->frame_index = index;
+
+    copy_plane(slot + y_offset, w, frame->data[0], frame->linesize[0], w, h);
+    copy_plane(slot + u_offset, cw, frame->data[1], frame->linesize[1], cw, ch);
+    copy_plane(slot + v_offset, cw, frame->data[2], frame->linesize[2], cw, ch);
+
+    atomic_store_explicit(&sh->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&header->frame_index, index, memory_order_release);
+
+    return true;
+}
+
+static bool
+sc_shm_frame_sink_open(struct sc_frame_sink *sink, const AVCodecContext *ctx) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    return sc_shm_sink_open(ss, ctx);
+}
+
+static void
+sc_shm_frame_sink_close(struct sc_frame_sink *sink) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    sc_shm_sink_close(ss);
+}
+
+static bool
+sc_shm_frame_sink_push(struct sc_frame_sink *sink, const AVFrame *frame) {
+    struct sc_shm_sink *ss = DOWNCAST(sink);
+    return sc_shm_sink_push(ss, frame);
+}
+
+bool
+sc_shm_sink_init(struct sc_shm_sink *ss, const char *name) {
+    // POSIX shared memory object names start with '/'
+    int r = asprintf(&ss->name, "%s%s", name[0] == '/' ? "" : "/", name);
+    if (r == -1) {
+        LOG_OOM();
+        return false;
+    }
+
+    static const struct sc_frame_sink_ops ops = {
+        .name = "shm",
+        .open = sc_shm_frame_sink_open,
+        .close = sc_shm_frame_sink_close,
+        .push = sc_shm_frame_sink_push,
+    };
+
+    ss->frame_sink.ops = &ops;
+
+    return true;
+}
+
+void
+sc_shm_sink_destroy(struct sc_shm_sink *ss) {
+    free(ss->name);
+}
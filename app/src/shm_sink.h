@@ -0,0 +1,81 @@
+#ifndef SC_SHM_SINK_H
+#define SC_SHM_SINK_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <libavcodec/avcodec.h>
+
+#include "trait/frame_sink.h"
+
+/*
+ * Shared memory layout (see doc/shm.md):
+ *
+ *     +--------------------+  0
+ *     | sc_shm_header      |
+ *     +--------------------+  slots_offset
+ *     | sc_shm_slot_header |
+ *     | Y plane            |
+ *     | U plane            |
+ *     | V plane            |
+ *     +--------------------+  slots_offset + slot_size
+ *     | (next slot)        |
+ *     :                    :
+ *
+ * Frame N (starting at 1) is written to slot (N % slot_count).
+ */
+
+#define SC_SHM_MAGIC 0x4d485343 // "CSHM" read as little-endian
+#define SC_SHM_VERSION 1
+#define SC_SHM_FORMAT_I420 0x30323449 // fourcc "I420"
+
+#define SC_SHM_SINK_SLOTS 3
+
+struct sc_shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t slots_offset;
+    // Set to 1 when the producer is closed
+    _Atomic uint32_t closed;
+    // Index of the last published frame (0 if none)
+    _Atomic uint64_t frame_index;
+};
+
+struct sc_shm_slot_header {
+    // Seqlock sequence: odd while the slot is being written
+    _Atomic uint32_t seq;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t linesize[3];
+    uint32_t offset[3]; // plane offsets, relative to the slot start
+    int64_t pts; // in microseconds
+    uint64_t frame_index;
+};
+
+struct sc_shm_sink {
+    struct sc_frame_sink frame_sink; // frame sink trait
+
+    char *name;
+    int fd;
+
+    uint8_t *mem;
+    size_t mem_size;
+    size_t frame_capacity; // max size of the planes of a single frame
+
+    uint64_t frame_index;
+    bool size_error_logged;
+};
+
+bool
+sc_shm_sink_init(struct sc_shm_sink *ss, const char *name);
+
+void
+sc_shm_sink_destroy(struct sc_shm_sink *ss);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef SC_AUDIO_OUTPUT_H
+#define SC_AUDIO_OUTPUT_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Audio output trait.
+ *
+ * Component able to play (or consume) audio samples should implement this
+ * trait.
+ *
+ * The samples are interleaved 32-bit floats (AUDIO_F32 / AV_SAMPLE_FMT_FLT).
+ * The audio output runs its own thread (or uses the one of the audio
+ * library), from which it pulls the samples to play on demand.
+ */
+struct sc_audio_output {
+    /**
+     * Set by the implementation on open(), to indicate the number of samples
+     * (per channel) which may be buffered by the output between the request
+     * of samples and their playback
+     */
+    uint32_t latency;
+
+    const struct sc_audio_output_ops *ops;
+};
+
+struct sc_audio_output_callbacks {
+    /**
+     * Called from the audio output thread to request exactly `samples`
+     * samples (per channel) to play
+     *
+     * This callback is mandatory.
+     */
+    void (*on_pull)(struct sc_audio_output *aout, uint8_t *data,
+                    uint32_t samples, void *userdata);
+};
+
+struct sc_audio_output_params {
+    // Device name (or file path) specific to the implementation (may be NULL)
+    const char *device;
+    uint32_t sample_rate;
+    uint8_t channels;
+    // Requested number of samples per output period (the implementation may
+    // use a different value)
+    uint16_t period;
+};
+
+struct sc_audio_output_ops {
+    /**
+     * Open the audio output
+     *
+     * The output must not request any samples before start() is called.
+     *
+     * This function is mandatory.
+     */
+    bool
+    (*open)(struct sc_audio_output *aout,
+            const struct sc_audio_output_params *params,
+            const struct sc_audio_output_callbacks *cbs, void *cbs_userdata);
+
+    /**
+     * Start requesting samples (via the on_pull() callback)
+     *
+     * This function is mandatory.
+     */
+    bool
+    (*start)(struct sc_audio_output *aout);
+
+    /**
+     * Stop (if started) and close the audio output
+     *
+     * Once this function returns, on_pull() is not called anymore.
+     *
+     * This function is mandatory.
+     */
+    void
+    (*close)(struct sc_audio_output *aout);
+};
+
+#endif
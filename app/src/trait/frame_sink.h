@@ -7,6 +7,9 @@
 #include <stdbool.h>
 #include <libavcodec/avcodec.h>
 
+// forward declarations
+struct sc_frame_source;
+
 /**
  * Frame sink trait.
  *
@@ -17,6 +20,14 @@ struct sc_frame_sink {
 };
 
 struct sc_frame_sink_ops {
+    /* Name of the sink, for logs */
+    const char *name;
+    /*
+     * If the sink forwards the frames to other sinks (adapter), return its
+     * frame source (optional)
+     */
+    struct sc_frame_source *(*get_frame_source)(struct sc_frame_sink *sink);
+
     /* The codec context is valid until the sink is closed */
     bool (*open)(struct sc_frame_sink *sink, const AVCodecContext *ctx);
     void (*close)(struct sc_frame_sink *sink);
@@ -1,5 +1,9 @@
 #include "frame_source.h"
 
+#include <inttypes.h>
+
+#include "util/log.h"
+
 void
 sc_frame_source_init(struct sc_frame_source *source) {
     source->sink_count = 0;
@@ -11,6 +15,7 @@ sc_frame_source_add_sink(struct sc_frame_source *source,
     assert(source->sink_count < SC_FRAME_SOURCE_MAX_SINKS);
     assert(sink);
     assert(sink->ops);
+    sc_sink_stats_reset(&source->stats[source->sink_count]);
     source->sinks[source->sink_count++] = sink;
 }
 
@@ -42,6 +47,17 @@ void
 sc_frame_source_sinks_close(struct sc_frame_source *source) {
     assert(source->sink_count);
     sc_frame_source_sinks_close_firsts(source, source->sink_count);
+
+    for (unsigned i = 0; i < source->sink_count; ++i) {
+        struct sc_sink_stats *stats = &source->stats[i];
+        if (stats->count) {
+            LOGD("Frame sink %u (%s): %" PRIu64 " pushes, avg %" PRItick
+                 " us, max %" PRItick " us", i, source->sinks[i]->ops->name,
+                 stats->count,
+                 SC_TICK_TO_US(stats->total / (sc_tick) stats->count),
+                 SC_TICK_TO_US(stats->max));
+        }
+    }
 }
 
 bool
@@ -50,10 +66,52 @@ sc_frame_source_sinks_push(struct sc_frame_source *source,
     assert(source->sink_count);
     for (unsigned i = 0; i < source->sink_count; ++i) {
         struct sc_frame_sink *sink = source->sinks[i];
-        if (!sink->ops->push(sink, frame)) {
+        sc_tick start = sc_tick_now();
+        bool ok = sink->ops->push(sink, frame);
+        sc_sink_stats_add(&source->stats[i], sc_tick_now() - start);
+        if (!ok) {
             return false;
         }
     }
 
     return true;
 }
+
+static bool
+sc_frame_sink_describe(struct sc_frame_sink *sink, struct sc_strbuf *buf) {
+    if (!sc_strbuf_append_str(buf, sink->ops->name)) {
+        return false;
+    }
+
+    if (sink->ops->get_frame_source) {
+        struct sc_frame_source *source = sink->ops->get_frame_source(sink);
+        return sc_strbuf_append_staticstr(buf, " -> ")
+            && sc_frame_source_describe(source, buf);
+    }
+
+    return true;
+}
+
+bool
+sc_frame_source_describe(const struct sc_frame_source *source,
+                         struct sc_strbuf *buf) {
+    if (!source->sink_count) {
+        return sc_strbuf_append_staticstr(buf, "(none)");
+    }
+
+    bool braces = source->sink_count > 1;
+    if (braces && !sc_strbuf_append_char(buf, '{')) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < source->sink_count; ++i) {
+        if (i && !sc_strbuf_append_staticstr(buf, ", ")) {
+            return false;
+        }
+        if (!sc_frame_sink_describe(source->sinks[i], buf)) {
+            return false;
+        }
+    }
+
+    return !braces || sc_strbuf_append_char(buf, '}');
+}
@@ -4,8 +4,10 @@
 #include "common.h"
 
 #include "frame_sink.h"
+#include "sink_stats.h"
+#include "util/strbuf.h"
 
-#define SC_FRAME_SOURCE_MAX_SINKS 2
+#define SC_FRAME_SOURCE_MAX_SINKS 5
 
 /**
  * Frame source trait
@@ -15,6 +17,9 @@
 struct sc_frame_source {
     struct sc_frame_sink *sinks[SC_FRAME_SOURCE_MAX_SINKS];
     unsigned sink_count;
+
+    // Push duration of each sink (on the source thread), logged on close
+    struct sc_sink_stats stats[SC_FRAME_SOURCE_MAX_SINKS];
 };
 
 void
@@ -35,4 +40,14 @@ bool
 sc_frame_source_sinks_push(struct sc_frame_source *source,
                            const AVFrame *frame);
 
+/**
+ * Append a description of the sinks (recursively, through adapters and
+ * decoders) to `buf`, for example "{decoder -> {screen, v4l2}, recorder}"
+ *
+ * Return false on allocation failure.
+ */
+bool
+sc_frame_source_describe(const struct sc_frame_source *source,
+                      struct sc_strbuf *buf);
+
 #endif
@@ -7,6 +7,10 @@
 #include <stdbool.h>
 #include <libavcodec/avcodec.h>
 
+// forward declarations
+struct sc_frame_source;
+struct sc_packet_source;
+
 /**
  * Packet sink trait.
  *
@@ -17,6 +21,19 @@ struct sc_packet_sink {
 };
 
 struct sc_packet_sink_ops {
+    /* Name of the sink, for logs */
+    const char *name;
+    /*
+     * If the sink forwards the packets to other sinks (adapter), return its
+     * packet source (optional)
+     */
+    struct sc_packet_source *(*get_packet_source)(struct sc_packet_sink *sink);
+    /*
+     * If the sink produces frames from the packets (decoder), return its frame
+     * source (optional)
+     */
+    struct sc_frame_source *(*get_frame_source)(struct sc_packet_sink *sink);
+
     /* The codec context is valid until the sink is closed */
     bool (*open)(struct sc_packet_sink *sink, AVCodecContext *ctx);
     void (*close)(struct sc_packet_sink *sink);
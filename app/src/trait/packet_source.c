@@ -1,5 +1,10 @@
 #include "packet_source.h"
 
+#include <inttypes.h>
+
+#include "frame_source.h"
+#include "util/log.h"
+
 void
 sc_packet_source_init(struct sc_packet_source *source) {
     source->sink_count = 0;
@@ -11,6 +16,7 @@ sc_packet_source_add_sink(struct sc_packet_source *source,
     assert(source->sink_count < SC_PACKET_SOURCE_MAX_SINKS);
     assert(sink);
     assert(sink->ops);
+    sc_sink_stats_reset(&source->stats[source->sink_count]);
     source->sinks[source->sink_count++] = sink;
 }
 
@@ -42,6 +48,17 @@ void
 sc_packet_source_sinks_close(struct sc_packet_source *source) {
     assert(source->sink_count);
     sc_packet_source_sinks_close_firsts(source, source->sink_count);
+
+    for (unsigned i = 0; i < source->sink_count; ++i) {
+        struct sc_sink_stats *stats = &source->stats[i];
+        if (stats->count) {
+            LOGD("Packet sink %u (%s): %" PRIu64 " pushes, avg %" PRItick
+                 " us, max %" PRItick " us", i, source->sinks[i]->ops->name,
+                 stats->count,
+                 SC_TICK_TO_US(stats->total / (sc_tick) stats->count),
+                 SC_TICK_TO_US(stats->max));
+        }
+    }
 }
 
 bool
@@ -50,7 +67,10 @@ sc_packet_source_sinks_push(struct sc_packet_source *source,
     assert(source->sink_count);
     for (unsigned i = 0; i < source->sink_count; ++i) {
         struct sc_packet_sink *sink = source->sinks[i];
-        if (!sink->ops->push(sink, packet)) {
+        sc_tick start = sc_tick_now();
+        bool ok = sink->ops->push(sink, packet);
+        sc_sink_stats_add(&source->stats[i], sc_tick_now() - start);
+        if (!ok) {
             return false;
         }
     }
@@ -68,3 +88,48 @@ sc_packet_source_sinks_disable(struct sc_packet_source *source) {
         }
     }
 }
+
+static bool
+sc_packet_sink_describe(struct sc_packet_sink *sink, struct sc_strbuf *buf) {
+    if (!sc_strbuf_append_str(buf, sink->ops->name)) {
+        return false;
+    }
+
+    if (sink->ops->get_packet_source) {
+        struct sc_packet_source *source = sink->ops->get_packet_source(sink);
+        return sc_strbuf_append_staticstr(buf, " -> ")
+            && sc_packet_source_describe(source, buf);
+    }
+
+    if (sink->ops->get_frame_source) {
+        struct sc_frame_source *source = sink->ops->get_frame_source(sink);
+        return sc_strbuf_append_staticstr(buf, " -> ")
+            && sc_frame_source_describe(source, buf);
+    }
+
+    return true;
+}
+
+bool
+sc_packet_source_describe(const struct sc_packet_source *source,
+                          struct sc_strbuf *buf) {
+    if (!source->sink_count) {
+        return sc_strbuf_append_staticstr(buf, "(none)");
+    }
+
+    bool braces = source->sink_count > 1;
+    if (braces && !sc_strbuf_append_char(buf, '{')) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < source->sink_count; ++i) {
+        if (i && !sc_strbuf_append_staticstr(buf, ", ")) {
+            return false;
+        }
+        if (!sc_packet_sink_describe(source->sinks[i], buf)) {
+            return false;
+        }
+    }
+
+    return !braces || sc_strbuf_append_char(buf, '}');
+}
@@ -4,8 +4,10 @@
 #include "common.h"
 
 #include "packet_sink.h"
+#include "sink_stats.h"
+#include "util/strbuf.h"
 
-#define SC_PACKET_SOURCE_MAX_SINKS 2
+#define SC_PACKET_SOURCE_MAX_SINKS 3
 
 /**
  * Packet source trait
@@ -15,6 +17,9 @@
 struct sc_packet_source {
     struct sc_packet_sink *sinks[SC_PACKET_SOURCE_MAX_SINKS];
     unsigned sink_count;
+
+    // Push duration of each sink (on the source thread), logged on close
+    struct sc_sink_stats stats[SC_PACKET_SOURCE_MAX_SINKS];
 };
 
 void
@@ -38,4 +43,14 @@ sc_packet_source_sinks_push(struct sc_packet_source *source,
 void
 sc_packet_source_sinks_disable(struct sc_packet_source *source);
 
+/**
+ * Append a description of the sinks (recursively, through adapters and
+ * decoders) to `buf`, for example "{decoder -> {screen, v4l2}, recorder}"
+ *
+ * Return false on allocation failure.
+ */
+bool
+sc_packet_source_describe(const struct sc_packet_source *source,
+                          struct sc_strbuf *buf);
+
 #endif
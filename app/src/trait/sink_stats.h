@@ -0,0 +1,35 @@
+#ifndef SC_SINK_STATS_H
+#define SC_SINK_STATS_H
+
+#include "common.h"
+
+#include <stdint.h>
+
+#include "util/tick.h"
+
+/**
+ * Time spent in the push() of a sink, measured by the source
+ */
+struct sc_sink_stats {
+    uint64_t count;
+    sc_tick total;
+    sc_tick max;
+};
+
+static inline void
+sc_sink_stats_reset(struct sc_sink_stats *stats) {
+    stats->count = 0;
+    stats->total = 0;
+    stats->max = 0;
+}
+
+static inline void
+sc_sink_stats_add(struct sc_sink_stats *stats, sc_tick duration) {
+    ++stats->count;
+    stats->total += duration;
+    if (duration > stats->max) {
+        stats->max = duration;
+    }
+}
+
+#endif
@@ -5,24 +5,40 @@
 #include <util/log.h>
 #include <util/memory.h>
 
+static uint32_t
+sc_audiobuf_next_pow2(uint32_t value) {
+    assert(value && value <= UINT32_C(1) << 31);
+    --value;
+    value |= value >> 1;
+    value |= value >> 2;
+    value |= value >> 4;
+    value |= value >> 8;
+    value |= value >> 16;
+    return value + 1;
+}
+
 bool
 sc_audiobuf_init(struct sc_audiobuf *buf, size_t sample_size,
                  uint32_t capacity) {
     assert(sample_size);
     assert(capacity);
 
-    // The actual capacity is (alloc_size - 1) so that head == tail is
-    // non-ambiguous
-    buf->alloc_size = capacity + 1;
+    // Since the cursors are free-running, head == tail is non-ambiguous even
+    // if the whole array is used
+    buf->alloc_size = sc_audiobuf_next_pow2(capacity);
     buf->data = sc_allocarray(buf->alloc_size, sample_size);
     if (!buf->data) {
         LOG_OOM();
         return false;
     }
 
+    buf->mask = buf->alloc_size - 1;
+    buf->capacity = capacity;
     buf->sample_size = sample_size;
     atomic_init(&buf->head, 0);
     atomic_init(&buf->tail, 0);
+    buf->cached_head = 0;
+    buf->cached_tail = 0;
 
     return true;
 }
@@ -42,10 +58,14 @@ sc_audiobuf_read(struct sc_audiobuf *buf, void *to_, uint32_t samples_count) {
     // memory_order_relaxed is sufficient
     uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
 
-    // The head cursor is updated after the data is written to the array
-    uint32_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    uint32_t can_read = buf->cached_head - tail;
+    if (can_read < samples_count) {
+        // The head cursor is updated after the data is written to the array
+        buf->cached_head = atomic_load_explicit(&buf->head,
+                                                memory_order_acquire);
+        can_read = buf->cached_head - tail;
+    }
 
-    uint32_t can_read = (buf->alloc_size + head - tail) % buf->alloc_size;
     if (!can_read) {
         return 0;
     }
@@ -54,12 +74,13 @@ sc_audiobuf_read(struct sc_audiobuf *buf, void *to_, uint32_t samples_count) {
     }
 
     if (to) {
-        uint32_t right_count = buf->alloc_size - tail;
+        uint32_t index = tail & buf->mask;
+        uint32_t right_count = buf->alloc_size - index;
         if (right_count > samples_count) {
             right_count = samples_count;
         }
         memcpy(to,
-               buf->data + (tail * buf->sample_size),
+               buf->data + (index * buf->sample_size),
                right_count * buf->sample_size);
 
         if (samples_count > right_count) {
@@ -70,12 +91,58 @@ sc_audiobuf_read(struct sc_audiobuf *buf, void *to_, uint32_t samples_count) {
         }
     }
 
-    uint32_t new_tail = (tail + samples_count) % buf->alloc_size;
+    uint32_t new_tail = tail + samples_count;
     atomic_store_explicit(&buf->tail, new_tail, memory_order_release);
 
     return samples_count;
 }
 
+static uint32_t
+sc_audiobuf_can_write(struct sc_audiobuf *buf, uint32_t head,
+                      uint32_t samples_count) {
+    uint32_t can_write = buf->capacity - (head - buf->cached_tail);
+    if (can_write < samples_count) {
+        // The tail cursor is updated after the data is consumed by the reader
+        buf->cached_tail = atomic_load_explicit(&buf->tail,
+                                                memory_order_acquire);
+        can_write = buf->capacity - (head - buf->cached_tail);
+    }
+    return can_write;
+}
+
+uint32_t
+sc_audiobuf_write_reserve(struct sc_audiobuf *buf, uint32_t samples_count,
+                          struct sc_audiobuf_region regions[2]) {
+    // Only the writer thread can write head, so memory_order_relaxed is
+    // sufficient
+    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+
+    // Reserve all the available space known from the cached tail, which is
+    // reloaded only if it is not sufficient for samples_count
+    uint32_t can_write = sc_audiobuf_can_write(buf, head, samples_count);
+
+    uint32_t index = head & buf->mask;
+    uint32_t right_count = buf->alloc_size - index;
+    if (right_count > can_write) {
+        right_count = can_write;
+    }
+
+    regions[0].data = buf->data + (index * buf->sample_size);
+    regions[0].samples_count = right_count;
+    regions[1].data = buf->data;
+    regions[1].samples_count = can_write - right_count;
+
+    return can_write;
+}
+
+void
+sc_audiobuf_write_commit(struct sc_audiobuf *buf, uint32_t samples_count) {
+    uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    uint32_t new_head = head + samples_count;
+    // The head cursor is updated after the data is written to the array
+    atomic_store_explicit(&buf->head, new_head, memory_order_release);
+}
+
 uint32_t
 sc_audiobuf_write(struct sc_audiobuf *buf, const void *from_,
                   uint32_t samples_count) {
@@ -85,10 +152,7 @@ sc_audiobuf_write(struct sc_audiobuf *buf, const void *from_,
     // sufficient
     uint32_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
 
-    // The tail cursor is updated after the data is consumed by the reader
-    uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
-
-    uint32_t can_write = (buf->alloc_size + tail - head - 1) % buf->alloc_size;
+    uint32_t can_write = sc_audiobuf_can_write(buf, head, samples_count);
     if (!can_write) {
         return 0;
     }
@@ -96,11 +160,12 @@ sc_audiobuf_write(struct sc_audiobuf *buf, const void *from_,
         samples_count = can_write;
     }
 
-    uint32_t right_count = buf->alloc_size - head;
+    uint32_t index = head & buf->mask;
+    uint32_t right_count = buf->alloc_size - index;
     if (right_count > samples_count) {
         right_count = samples_count;
     }
-    memcpy(buf->data + (head * buf->sample_size),
+    memcpy(buf->data + (index * buf->sample_size),
            from,
            right_count * buf->sample_size);
 
@@ -111,7 +176,7 @@ sc_audiobuf_write(struct sc_audiobuf *buf, const void *from_,
                left_count * buf->sample_size);
     }
 
-    uint32_t new_head = (head + samples_count) % buf->alloc_size;
+    uint32_t new_head = head + samples_count;
     atomic_store_explicit(&buf->head, new_head, memory_order_release);
 
     return samples_count;
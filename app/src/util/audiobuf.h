@@ -8,20 +8,53 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// Assumed size of a cache line, to avoid false sharing
+#define SC_AUDIOBUF_CACHE_LINE_SIZE 64
+
 /**
  * Wrapper around bytebuf to read and write samples
  *
  * Each sample takes sample_size bytes.
+ *
+ * It is a lock-free single-producer single-consumer ring buffer. The array
+ * size is a power of two, so that the cursors are wrapped by a mask. The
+ * cursors are free-running (they are only masked to access the array), so
+ * head - tail is the number of buffered samples.
+ *
+ * The writer and reader cursors live on separate cache lines, and each side
+ * keeps a cached copy of the remote cursor, refreshed only when the cached
+ * value does not allow to complete the request. This avoids bouncing the
+ * cache lines between the decoder thread and the audio callback thread.
  */
 struct sc_audiobuf {
     uint8_t *data;
-    uint32_t alloc_size; // in samples
+    uint32_t alloc_size; // in samples, power of two
+    uint32_t mask; // alloc_size - 1
+    uint32_t capacity; // in samples, at most alloc_size
     size_t sample_size;
 
+    // empty: tail == head
+    // full: head - tail == capacity
+
+    char pad_writer[SC_AUDIOBUF_CACHE_LINE_SIZE];
+    // Only written by the writer
     atomic_uint_least32_t head; // writer cursor, in samples
+    uint32_t cached_tail; // last tail value read by the writer
+
+    char pad_reader[SC_AUDIOBUF_CACHE_LINE_SIZE];
+    // Only written by the reader
     atomic_uint_least32_t tail; // reader cursor, in samples
-    // empty: tail == head
-    // full: ((tail + 1) % alloc_size) == head
+    uint32_t cached_head; // last head value read by the reader
+
+    char pad_end[SC_AUDIOBUF_CACHE_LINE_SIZE];
+};
+
+/**
+ * Contiguous region of the ring buffer
+ */
+struct sc_audiobuf_region {
+    uint8_t *data;
+    uint32_t samples_count;
 };
 
 static inline uint32_t
@@ -49,17 +82,46 @@ uint32_t
 sc_audiobuf_write(struct sc_audiobuf *buf, const void *from,
                   uint32_t samples_count);
 
+/**
+ * Reserve the available space to write samples in place
+ *
+ * The reader cursor is reloaded only if less than samples_count samples are
+ * known to be available, so the space returned may be smaller (if the buffer
+ * is full) or larger than samples_count.
+ *
+ * The space may be split into two contiguous regions if it wraps around the
+ * end of the ring buffer: regions[0] starts at the writer cursor, regions[1]
+ * (possibly empty) starts at the beginning of the array.
+ *
+ * The samples written in the regions are only visible to the reader once
+ * committed by sc_audiobuf_write_commit().
+ *
+ * Return the total number of samples that can be written.
+ */
+uint32_t
+sc_audiobuf_write_reserve(struct sc_audiobuf *buf, uint32_t samples_count,
+                          struct sc_audiobuf_region regions[2]);
+
+/**
+ * Publish the first samples_count samples written in the reserved regions
+ *
+ * samples_count must not exceed the value returned by the last call to
+ * sc_audiobuf_write_reserve().
+ */
+void
+sc_audiobuf_write_commit(struct sc_audiobuf *buf, uint32_t samples_count);
+
 static inline uint32_t
 sc_audiobuf_capacity(struct sc_audiobuf *buf) {
-    assert(buf->alloc_size);
-    return buf->alloc_size - 1;
+    assert(buf->capacity);
+    return buf->capacity;
 }
 
 static inline uint32_t
 sc_audiobuf_can_read(struct sc_audiobuf *buf) {
     uint32_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
     uint32_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
-    return (buf->alloc_size + head - tail) % buf->alloc_size;
+    return head - tail;
 }
 
 #endif
@@ -57,6 +57,11 @@ sc_read32be(const uint8_t *buf) {
     return ((uint32_t) buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
 }
 
+static inline uint32_t
+sc_read32le(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
 static inline uint64_t
 sc_read64be(const uint8_t *buf) {
     uint32_t msb = sc_read32be(buf);
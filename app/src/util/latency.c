@@ -0,0 +1,47 @@
+#include "latency.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+void
+sc_latency_init(struct sc_latency *latency) {
+    latency->head = 0;
+    latency->count = 0;
+}
+
+void
+sc_latency_add(struct sc_latency *latency, sc_tick value) {
+    latency->samples[latency->head] = value;
+    latency->head = (latency->head + 1) % SC_LATENCY_SAMPLES;
+    if (latency->count < SC_LATENCY_SAMPLES) {
+        ++latency->count;
+    }
+}
+
+static int
+compare_ticks(const void *a, const void *b) {
+    sc_tick ta = *(const sc_tick *) a;
+    sc_tick tb = *(const sc_tick *) b;
+    return (ta > tb) - (ta < tb);
+}
+
+void
+sc_latency_get_percentiles(const struct sc_latency *latency,
+                           const unsigned *pcts, sc_tick *out, unsigned n) {
+    assert(latency->count);
+
+    // The order of the samples does not matter
+    sc_tick sorted[SC_LATENCY_SAMPLES];
+    unsigned count = latency->count;
+    memcpy(sorted, latency->samples, count * sizeof(*sorted));
+    qsort(sorted, count, sizeof(*sorted), compare_ticks);
+
+    for (unsigned i = 0; i < n; ++i) {
+        assert(pcts[i] <= 100);
+        // Nearest-rank: the smallest value such that pcts[i]% of the samples
+        // are less than or equal to it
+        unsigned rank = (pcts[i] * count + 99) / 100;
+        out[i] = sorted[rank ? rank - 1 : 0];
+    }
+}
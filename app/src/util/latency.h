@@ -0,0 +1,44 @@
+#ifndef SC_LATENCY_H
+#define SC_LATENCY_H
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/tick.h"
+
+// Number of samples kept to compute the percentiles
+#define SC_LATENCY_SAMPLES 1024
+
+/**
+ * Window of the most recent latency samples, to compute percentiles
+ */
+struct sc_latency {
+    sc_tick samples[SC_LATENCY_SAMPLES];
+    unsigned head; // index of the next sample
+    unsigned count; // number of samples (count <= SC_LATENCY_SAMPLES)
+};
+
+void
+sc_latency_init(struct sc_latency *latency);
+
+/**
+ * Add a sample (the oldest sample is replaced if the window is full)
+ */
+void
+sc_latency_add(struct sc_latency *latency, sc_tick value);
+
+/**
+ * Compute several percentiles at once (the samples are sorted only once)
+ *
+ * Each percentile in `pcts` must be in [0, 100]. The result for `pcts[i]` is
+ * written to `out[i]` (nearest-rank method).
+ *
+ * It is an error to call this function if no sample has been added.
+ */
+void
+sc_latency_get_percentiles(const struct sc_latency *latency,
+                           const unsigned *pcts, sc_tick *out, unsigned n);
+
+#endif
@@ -136,8 +136,9 @@ net_socket(void) {
     return sock;
 }
 
-bool
-net_connect(sc_socket socket, uint32_t addr, uint16_t port) {
+static bool
+net_connect_internal(sc_socket socket, uint32_t addr, uint16_t port,
+                     bool log_errors) {
     sc_raw_socket raw_sock = unwrap(socket);
 
     SOCKADDR_IN sin;
@@ -146,13 +147,25 @@ net_connect(sc_socket socket, uint32_t addr, uint16_t port) {
     sin.sin_port = htons(port);
 
     if (connect(raw_sock, (SOCKADDR *) &sin, sizeof(sin)) == SOCKET_ERROR) {
-        net_perror("connect");
+        if (log_errors) {
+            net_perror("connect");
+        }
         return false;
     }
 
     return true;
 }
 
+bool
+net_connect(sc_socket socket, uint32_t addr, uint16_t port) {
+    return net_connect_internal(socket, addr, port, true);
+}
+
+bool
+net_try_connect(sc_socket socket, uint32_t addr, uint16_t port) {
+    return net_connect_internal(socket, addr, port, false);
+}
+
 bool
 net_listen(sc_socket server_socket, uint32_t addr, uint16_t port, int backlog) {
     sc_raw_socket raw_sock = unwrap(server_socket);
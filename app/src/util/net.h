@@ -53,6 +53,10 @@ net_socket(void);
 bool
 net_connect(sc_socket socket, uint32_t addr, uint16_t port);
 
+// Like net_connect(), but do not log errors (when a failure is expected)
+bool
+net_try_connect(sc_socket socket, uint32_t addr, uint16_t port);
+
 bool
 net_listen(sc_socket server_socket, uint32_t addr, uint16_t port, int backlog);
 
@@ -1,106 +1,324 @@
 #include "v4l2_sink.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
 
 #include "util/log.h"
-#include "util/str.h"
 
 /** Downcast frame_sink to sc_v4l2_sink */
 #define DOWNCAST(SINK) container_of(SINK, struct sc_v4l2_sink, frame_sink)
 
-static const AVRational SCRCPY_TIME_BASE = {1, 1000000}; // timestamps in us
-
-static const AVOutputFormat *
-find_muxer(const char *name) {
-#ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
-    void *opaque = NULL;
-#endif
-    const AVOutputFormat *oformat = NULL;
+static int
+xioctl(int fd, unsigned long request, void *arg) {
+    int r;
     do {
-#ifdef SCRCPY_LAVF_HAS_NEW_MUXER_ITERATOR_API
-        oformat = av_muxer_iterate(&opaque);
-#else
-        oformat = av_oformat_next(oformat);
-#endif
-        // until null or containing the requested name
-    } while (oformat && !sc_str_list_contains(oformat->name, ',', name));
-    return oformat;
+        r = ioctl(fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
 }
 
 static bool
-write_header(struct sc_v4l2_sink *vs, const AVPacket *packet) {
-    AVStream *ostream = vs->format_ctx->streams[0];
+write_all(int fd, const uint8_t *data, size_t len) {
+    while (len) {
+        ssize_t w = write(fd, data, len);
+        if (w == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += w;
+        len -= w;
+    }
+    return true;
+}
 
-    uint8_t *extradata = av_malloc(packet->size * sizeof(uint8_t));
-    if (!extradata) {
-        LOG_OOM();
+static inline uint32_t
+get_chroma_bytesperline(uint32_t bytesperline) {
+    return (bytesperline + 1) / 2;
+}
+
+static inline uint32_t
+get_chroma_height(uint32_t height) {
+    return (height + 1) / 2;
+}
+
+static size_t
+get_frame_size(uint32_t bytesperline, uint32_t height) {
+    size_t luma = (size_t) bytesperline * height;
+    size_t chroma = (size_t) get_chroma_bytesperline(bytesperline)
+                  * get_chroma_height(height);
+    return luma + 2 * chroma;
+}
+
+static void
+copy_plane(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+           int src_stride, size_t row_size, uint32_t rows) {
+    assert(src_stride > 0);
+    if (dst_stride == row_size && (size_t) src_stride == row_size) {
+        // Contiguous rows, copy the plane at once
+        memcpy(dst, src, row_size * rows);
+        return;
+    }
+
+    for (uint32_t i = 0; i < rows; ++i) {
+        memcpy(dst, src, row_size);
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+// Write the YUV planes of the frame to dst, using the negotiated I420 layout
+static void
+pack_frame(struct sc_v4l2_sink *vs, const AVFrame *frame, uint8_t *dst) {
+    uint32_t width = vs->size.width;
+    uint32_t height = vs->size.height;
+    uint32_t chroma_width = (width + 1) / 2;
+    uint32_t chroma_height = get_chroma_height(height);
+
+    size_t y_stride = vs->bytesperline;
+    size_t c_stride = get_chroma_bytesperline(vs->bytesperline);
+
+    uint8_t *y = dst;
+    uint8_t *u = y + y_stride * height;
+    uint8_t *v = u + c_stride * chroma_height;
+
+    copy_plane(y, y_stride, frame->data[0], frame->linesize[0], width, height);
+    copy_plane(u, c_stride, frame->data[1], frame->linesize[1], chroma_width,
+               chroma_height);
+    copy_plane(v, c_stride, frame->data[2], frame->linesize[2], chroma_width,
+               chroma_height);
+}
+
+static bool
+sc_v4l2_sink_set_format(struct sc_v4l2_sink *vs) {
+    struct v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (xioctl(vs->fd, VIDIOC_QUERYCAP, &cap)) {
+        if (errno != ENOTTY) {
+            LOGE("Could not query capabilities of %s: %s", vs->device_name,
+                 strerror(errno));
+            return false;
+        }
+
+        // Not a V4L2 device (e.g. a regular file or a pipe): write raw I420
+        // frames as is
+        LOGW("%s is not a V4L2 device, writing raw I420 frames",
+             vs->device_name);
+        vs->streaming = false;
+        vs->bytesperline = vs->size.width;
+        vs->sizeimage = get_frame_size(vs->bytesperline, vs->size.height);
+        return true;
+    }
+
+    uint32_t caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps
+                                                            : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_OUTPUT)) {
+        LOGE("%s is not a V4L2 video output device", vs->device_name);
         return false;
     }
 
-    // copy the first packet to the extra data
-    memcpy(extradata, packet->data, packet->size);
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    fmt.fmt.pix.width = vs->size.width;
+    fmt.fmt.pix.height = vs->size.height;
+    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUV420;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix.bytesperline = vs->size.width;
+    fmt.fmt.pix.sizeimage = get_frame_size(vs->size.width, vs->size.height);
+    fmt.fmt.pix.colorspace = V4L2_COLORSPACE_SRGB;
+
+    if (xioctl(vs->fd, VIDIOC_S_FMT, &fmt)) {
+        LOGE("Could not set format %ux%u YUV420 on %s: %s",
+             vs->size.width, vs->size.height, vs->device_name,
+             strerror(errno));
+        return false;
+    }
+
+    // The driver may adjust the requested format
+    if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_YUV420
+            || fmt.fmt.pix.width != vs->size.width
+            || fmt.fmt.pix.height != vs->size.height) {
+        LOGE("V4L2 device %s does not accept %ux%u YUV420 frames",
+             vs->device_name, vs->size.width, vs->size.height);
+        return false;
+    }
 
-    ostream->codecpar->extradata = extradata;
-    ostream->codecpar->extradata_size = packet->size;
+    vs->bytesperline = fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline
+                                                : vs->size.width;
+    if (vs->bytesperline < vs->size.width) {
+        LOGE("Invalid V4L2 bytesperline: %" PRIu32, vs->bytesperline);
+        return false;
+    }
 
-    int ret = avformat_write_header(vs->format_ctx, NULL);
-    if (ret < 0) {
-        LOGE("Failed to write header to %s", vs->device_name);
+    vs->sizeimage = get_frame_size(vs->bytesperline, vs->size.height);
+    if (fmt.fmt.pix.sizeimage && fmt.fmt.pix.sizeimage < vs->sizeimage) {
+        LOGE("Invalid V4L2 sizeimage: %" PRIu32, fmt.fmt.pix.sizeimage);
         return false;
     }
 
+    vs->streaming = caps & V4L2_CAP_STREAMING;
     return true;
 }
 
 static void
-rescale_packet(struct sc_v4l2_sink *vs, AVPacket *packet) {
-    AVStream *ostream = vs->format_ctx->streams[0];
-    av_packet_rescale_ts(packet, SCRCPY_TIME_BASE, ostream->time_base);
+sc_v4l2_sink_unmap_buffers(struct sc_v4l2_sink *vs) {
+    for (unsigned i = 0; i < vs->buffer_count; ++i) {
+        munmap(vs->buffers[i].start, vs->buffers[i].length);
+    }
+    vs->buffer_count = 0;
+
+    // Release the buffers (ignore errors, there is nothing more to do)
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = 0;
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    req.memory = V4L2_MEMORY_MMAP;
+    xioctl(vs->fd, VIDIOC_REQBUFS, &req);
 }
 
 static bool
-write_packet(struct sc_v4l2_sink *vs, AVPacket *packet) {
-    if (!vs->header_written) {
-        bool ok = write_header(vs, packet);
-        if (!ok) {
-            return false;
-        }
-        vs->header_written = true;
-        return true;
+sc_v4l2_sink_map_buffers(struct sc_v4l2_sink *vs) {
+    assert(vs->streaming);
+
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = SC_V4L2_SINK_MAX_BUFFERS;
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    req.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(vs->fd, VIDIOC_REQBUFS, &req)) {
+        LOGD("V4L2 mmap buffers not supported: %s", strerror(errno));
+        return false;
     }
 
-    rescale_packet(vs, packet);
+    if (req.count < 2) {
+        LOGD("Insufficient V4L2 buffers: %" PRIu32, req.count);
+        return false;
+    }
+
+    vs->buffer_count = 0;
+    unsigned count = MIN(req.count, SC_V4L2_SINK_MAX_BUFFERS);
+    for (unsigned i = 0; i < count; ++i) {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+
+        if (xioctl(vs->fd, VIDIOC_QUERYBUF, &buf)) {
+            LOGE("Could not query V4L2 buffer %u: %s", i, strerror(errno));
+            goto error;
+        }
+
+        if (buf.length < vs->sizeimage) {
+            LOGE("V4L2 buffer too small: %" PRIu32 " < %" SC_PRIsizet,
+                 buf.length, vs->sizeimage);
+            goto error;
+        }
 
-    bool ok = av_write_frame(vs->format_ctx, packet) >= 0;
+        void *start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, vs->fd, buf.m.offset);
+        if (start == MAP_FAILED) {
+            LOGE("Could not mmap V4L2 buffer %u: %s", i, strerror(errno));
+            goto error;
+        }
 
-    // Failing to write the last frame is not very serious, no future frame may
-    // depend on it, so the resulting file will still be valid
-    (void) ok;
+        vs->buffers[i].start = start;
+        vs->buffers[i].length = buf.length;
+        ++vs->buffer_count;
+    }
+
+    vs->buffers_queued = 0;
+    vs->stream_on = false;
 
     return true;
+
+error:
+    sc_v4l2_sink_unmap_buffers(vs);
+    return false;
 }
 
 static bool
-encode_and_write_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
-    int ret = avcodec_send_frame(vs->encoder_ctx, frame);
-    if (ret < 0 && ret != AVERROR(EAGAIN)) {
-        LOGE("Could not send v4l2 video frame: %d", ret);
+sc_v4l2_sink_queue_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (vs->buffers_queued < vs->buffer_count) {
+        // Some buffers have never been queued, use them first
+        buf.index = vs->buffers_queued;
+    } else if (xioctl(vs->fd, VIDIOC_DQBUF, &buf)) {
+        if (errno == EAGAIN) {
+            // All buffers are still owned by the driver, drop this frame
+            LOGV("No V4L2 buffer available, frame dropped");
+            return true;
+        }
+        LOGE("Could not dequeue V4L2 buffer: %s", strerror(errno));
         return false;
     }
 
-    AVPacket *packet = vs->packet;
-    ret = avcodec_receive_packet(vs->encoder_ctx, packet);
-    if (ret == 0) {
-        // A packet was received
+    assert(buf.index < vs->buffer_count);
+    pack_frame(vs, frame, vs->buffers[buf.index].start);
 
-        bool ok = write_packet(vs, packet);
-        av_packet_unref(packet);
-        if (!ok) {
-            LOGW("Could not send packet to v4l2 sink");
+    buf.bytesused = vs->sizeimage;
+    buf.field = V4L2_FIELD_NONE;
+    // PTS (written by the server) are expressed in microseconds
+    if (frame->pts != AV_NOPTS_VALUE) {
+        buf.timestamp.tv_sec = frame->pts / 1000000;
+        buf.timestamp.tv_usec = frame->pts % 1000000;
+    }
+
+    if (xioctl(vs->fd, VIDIOC_QBUF, &buf)) {
+        LOGE("Could not queue V4L2 buffer: %s", strerror(errno));
+        return false;
+    }
+
+    if (vs->buffers_queued < vs->buffer_count) {
+        ++vs->buffers_queued;
+    }
+
+    if (!vs->stream_on) {
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        if (xioctl(vs->fd, VIDIOC_STREAMON, &type)) {
+            LOGE("Could not start V4L2 streaming: %s", strerror(errno));
             return false;
         }
-    } else if (ret != AVERROR(EAGAIN)) {
-        LOGE("Could not receive v4l2 video packet: %d", ret);
+        vs->stream_on = true;
+    }
+
+    return true;
+}
+
+static bool
+sc_v4l2_sink_write_frame(struct sc_v4l2_sink *vs, const AVFrame *frame) {
+    if ((uint32_t) frame->width != vs->size.width
+            || (uint32_t) frame->height != vs->size.height) {
+        // V4L2 could not handle size change
+        if (!vs->size_mismatch_logged) {
+            LOGW("Frame size changed to %dx%d, not forwarded to %s (%ux%u)",
+                 frame->width, frame->height, vs->device_name,
+                 vs->size.width, vs->size.height);
+            vs->size_mismatch_logged = true;
+        }
+        return true;
+    }
+
+    if (vs->streaming) {
+        return sc_v4l2_sink_queue_frame(vs, frame);
+    }
+
+    pack_frame(vs, frame, vs->write_buf);
+    if (!write_all(vs->fd, vs->write_buf, vs->sizeimage)) {
+        LOGE("Could not write frame to %s: %s", vs->device_name,
+             strerror(errno));
         return false;
     }
 
@@ -128,7 +346,7 @@ run_v4l2_sink(void *data) {
 
         sc_frame_buffer_consume(&vs->fb, vs->frame);
 
-        bool ok = encode_and_write_frame(vs, vs->frame);
+        bool ok = sc_v4l2_sink_write_frame(vs, vs->frame);
         av_frame_unref(vs->frame);
         if (!ok) {
             LOGE("Could not send frame to v4l2 sink");
@@ -144,7 +362,15 @@ run_v4l2_sink(void *data) {
 static bool
 sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx) {
     assert(ctx->pix_fmt == AV_PIX_FMT_YUV420P);
-    (void) ctx;
+
+    if (ctx->width <= 0 || ctx->width > 0xFFFF
+            || ctx->height <= 0 || ctx->height > 0xFFFF) {
+        LOGE("Invalid video size: %dx%d", ctx->width, ctx->height);
+        return false;
+    }
+
+    vs->size.width = ctx->width;
+    vs->size.height = ctx->height;
 
     bool ok = sc_frame_buffer_init(&vs->fb);
     if (!ok) {
@@ -161,119 +387,73 @@ sc_v4l2_sink_open(struct sc_v4l2_sink *vs, const AVCodecContext *ctx) {
         goto error_mutex_destroy;
     }
 
-    const AVOutputFormat *format = find_muxer("v4l2");
-    if (!format) {
-        // Alternative name
-        format = find_muxer("video4linux2");
-    }
-    if (!format) {
-        LOGE("Could not find v4l2 muxer");
+    // Non-blocking, so that dequeuing a buffer never blocks the v4l2 thread
+    // (the frame is dropped instead)
+    vs->fd = open(vs->device_name, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (vs->fd == -1) {
+        LOGE("Failed to open output device: %s (%s)", vs->device_name,
+             strerror(errno));
         goto error_cond_destroy;
     }
 
-    const AVCodec *encoder = avcodec_find_encoder(AV_CODEC_ID_RAWVIDEO);
-    if (!encoder) {
-        LOGE("Raw video encoder not found");
-        return false;
-    }
-
-    vs->format_ctx = avformat_alloc_context();
-    if (!vs->format_ctx) {
-        LOG_OOM();
-        return false;
-    }
-
-    // contrary to the deprecated API (av_oformat_next()), av_muxer_iterate()
-    // returns (on purpose) a pointer-to-const, but AVFormatContext.oformat
-    // still expects a pointer-to-non-const (it has not be updated accordingly)
-    // <https://github.com/FFmpeg/FFmpeg/commit/0694d8702421e7aff1340038559c438b61bb30dd>
-    vs->format_ctx->oformat = (AVOutputFormat *) format;
-#ifdef SCRCPY_LAVF_HAS_AVFORMATCONTEXT_URL
-    vs->format_ctx->url = strdup(vs->device_name);
-    if (!vs->format_ctx->url) {
-        LOG_OOM();
-        goto error_avformat_free_context;
-    }
-#else
-    strncpy(vs->format_ctx->filename, vs->device_name,
-            sizeof(vs->format_ctx->filename));
-#endif
-
-    AVStream *ostream = avformat_new_stream(vs->format_ctx, encoder);
-    if (!ostream) {
-        LOG_OOM();
-        goto error_avformat_free_context;
-    }
-
-    int r = avcodec_parameters_from_context(ostream->codecpar, ctx);
-    if (r < 0) {
-        goto error_avformat_free_context;
-    }
-
-    // The codec is from the v4l2 encoder, not from the decoder
-    ostream->codecpar->codec_id = encoder->id;
-
-    int ret = avio_open(&vs->format_ctx->pb, vs->device_name, AVIO_FLAG_WRITE);
-    if (ret < 0) {
-        LOGE("Failed to open output device: %s", vs->device_name);
-        // ostream will be cleaned up during context cleaning
-        goto error_avformat_free_context;
+    ok = sc_v4l2_sink_set_format(vs);
+    if (!ok) {
+        goto error_close;
     }
 
-    vs->encoder_ctx = avcodec_alloc_context3(encoder);
-    if (!vs->encoder_ctx) {
-        LOG_OOM();
-        goto error_avio_close;
+    vs->buffer_count = 0;
+    if (vs->streaming && !sc_v4l2_sink_map_buffers(vs)) {
+        // Fallback to write()
+        vs->streaming = false;
     }
 
-    vs->encoder_ctx->width = ctx->width;
-    vs->encoder_ctx->height = ctx->height;
-    vs->encoder_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-    vs->encoder_ctx->time_base.num = 1;
-    vs->encoder_ctx->time_base.den = 1;
+    vs->write_buf = NULL;
+    if (!vs->streaming) {
+        // write() must write whole frames
+        int flags = fcntl(vs->fd, F_GETFL);
+        if (flags == -1 || fcntl(vs->fd, F_SETFL, flags & ~O_NONBLOCK)) {
+            LOGE("Could not set %s in blocking mode", vs->device_name);
+            goto error_close;
+        }
 
-    if (avcodec_open2(vs->encoder_ctx, encoder, NULL) < 0) {
-        LOGE("Could not open codec for v4l2");
-        goto error_avcodec_free_context;
+        vs->write_buf = malloc(vs->sizeimage);
+        if (!vs->write_buf) {
+            LOG_OOM();
+            goto error_close;
+        }
     }
 
     vs->frame = av_frame_alloc();
     if (!vs->frame) {
         LOG_OOM();
-        goto error_avcodec_free_context;
-    }
-
-    vs->packet = av_packet_alloc();
-    if (!vs->packet) {
-        LOG_OOM();
-        goto error_av_frame_free;
+        goto error_release_buffers;
     }
 
     vs->has_frame = false;
-    vs->header_written = false;
     vs->stopped = false;
+    vs->size_mismatch_logged = false;
 
     LOGD("Starting v4l2 thread");
     ok = sc_thread_create(&vs->thread, run_v4l2_sink, "scrcpy-v4l2", vs);
     if (!ok) {
         LOGE("Could not start v4l2 thread");
-        goto error_av_packet_free;
+        goto error_av_frame_free;
     }
 
-    LOGI("v4l2 sink started to device: %s", vs->device_name);
+    LOGI("v4l2 sink started to device: %s (%ux%u, %s)", vs->device_name,
+         vs->size.width, vs->size.height, vs->streaming ? "mmap" : "write");
 
     return true;
 
-error_av_packet_free:
-    av_packet_free(&vs->packet);
 error_av_frame_free:
     av_frame_free(&vs->frame);
-error_avcodec_free_context:
-    avcodec_free_context(&vs->encoder_ctx);
-error_avio_close:
-    avio_close(vs->format_ctx->pb);
-error_avformat_free_context:
-    avformat_free_context(vs->format_ctx);
+error_release_buffers:
+    if (vs->streaming) {
+        sc_v4l2_sink_unmap_buffers(vs);
+    }
+    free(vs->write_buf);
+error_close:
+    close(vs->fd);
 error_cond_destroy:
     sc_cond_destroy(&vs->cond);
 error_mutex_destroy:
@@ -293,11 +473,17 @@ sc_v4l2_sink_close(struct sc_v4l2_sink *vs) {
 
     sc_thread_join(&vs->thread, NULL);
 
-    av_packet_free(&vs->packet);
+    if (vs->streaming) {
+        if (vs->stream_on) {
+            enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+            xioctl(vs->fd, VIDIOC_STREAMOFF, &type);
+        }
+        sc_v4l2_sink_unmap_buffers(vs);
+    }
+    free(vs->write_buf);
+    close(vs->fd);
+
     av_frame_free(&vs->frame);
-    avcodec_free_context(&vs->encoder_ctx);
-    avio_close(vs->format_ctx->pb);
-    avformat_free_context(vs->format_ctx);
     sc_cond_destroy(&vs->cond);
     sc_mutex_destroy(&vs->mutex);
     sc_frame_buffer_destroy(&vs->fb);
@@ -348,6 +534,7 @@ sc_v4l2_sink_init(struct sc_v4l2_sink *vs, const char *device_name) {
     }
 
     static const struct sc_frame_sink_ops ops = {
+        .name = "v4l2",
         .open = sc_v4l2_frame_sink_open,
         .close = sc_v4l2_frame_sink_close,
         .push = sc_v4l2_frame_sink_push,
@@ -3,32 +3,54 @@
 
 #include "common.h"
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <libavcodec/avcodec.h>
-#include <libavformat/avformat.h>
 
 #include "coords.h"
 #include "trait/frame_sink.h"
 #include "frame_buffer.h"
-#include "util/tick.h"
+#include "util/thread.h"
+
+#define SC_V4L2_SINK_MAX_BUFFERS 4
+
+struct sc_v4l2_buffer {
+    uint8_t *start; // mmap'd memory
+    size_t length;
+};
 
 struct sc_v4l2_sink {
     struct sc_frame_sink frame_sink; // frame sink trait
 
     struct sc_frame_buffer fb;
-    AVFormatContext *format_ctx;
-    AVCodecContext *encoder_ctx;
 
     char *device_name;
+    int fd;
+
+    // Negotiated format (planar YUV 4:2:0, I420)
+    struct sc_size size;
+    uint32_t bytesperline; // of the Y plane
+    size_t sizeimage;
+
+    // Streaming I/O (mmap), if supported by the device
+    bool streaming;
+    bool stream_on;
+    struct sc_v4l2_buffer buffers[SC_V4L2_SINK_MAX_BUFFERS];
+    unsigned buffer_count;
+    unsigned buffers_queued; // buffers queued at least once (on start)
+
+    // Packed frame for write() I/O, if streaming is not available
+    uint8_t *write_buf;
 
     sc_thread thread;
     sc_mutex mutex;
     sc_cond cond;
     bool has_frame;
     bool stopped;
-    bool header_written;
+    bool size_mismatch_logged;
 
     AVFrame *frame;
-    AVPacket *packet;
 };
 
 bool
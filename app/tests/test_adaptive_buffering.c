@@ -0,0 +1,129 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "adaptive_buffering.h"
+
+// 1 sample per ms, to make the values easy to read
+#define RATE 1000
+
+static void
+push_window(struct sc_adaptive_buffering *ab, sc_tick start, sc_tick jitter) {
+    // 50 packets of 20ms, the first one delayed by the jitter
+    for (int i = 0; i < 50; ++i) {
+        sc_tick pts = start + SC_TICK_FROM_MS(i * 20);
+        sc_tick delay = i == 0 ? jitter : 0;
+        sc_adaptive_buffering_on_packet(ab, pts + SC_TICK_FROM_MS(5) + delay,
+                                        pts);
+    }
+}
+
+static void test_initial_target_clamped(void) {
+    struct sc_adaptive_buffering ab;
+
+    sc_adaptive_buffering_init(&ab, RATE, 20, 200, 10);
+    assert(ab.target == 20);
+
+    sc_adaptive_buffering_init(&ab, RATE, 20, 200, 500);
+    assert(ab.target == 200);
+
+    sc_adaptive_buffering_init(&ab, RATE, 20, 200, 50);
+    assert(ab.target == 50);
+}
+
+static void test_increase_on_underflow(void) {
+    struct sc_adaptive_buffering ab;
+    sc_adaptive_buffering_init(&ab, RATE, 20, 200, 50);
+
+    push_window(&ab, 0, SC_TICK_FROM_MS(80));
+    sc_adaptive_buffering_on_underflow(&ab, 30);
+
+    bool changed = sc_adaptive_buffering_update(&ab);
+    assert(changed);
+    // jitter (80) + margin (10)
+    assert(ab.target == 90);
+
+    // Another underflow with low jitter: step up
+    push_window(&ab, SC_TICK_FROM_SEC(1), 0);
+    sc_adaptive_buffering_on_underflow(&ab, 5);
+    changed = sc_adaptive_buffering_update(&ab);
+    assert(changed);
+    assert(ab.target == 100);
+}
+
+static void test_max_bound(void) {
+    struct sc_adaptive_buffering ab;
+    sc_adaptive_buffering_init(&ab, RATE, 20, 60, 50);
+
+    push_window(&ab, 0, SC_TICK_FROM_MS(300));
+    sc_adaptive_buffering_on_underflow(&ab, 100);
+
+    bool changed = sc_adaptive_buffering_update(&ab);
+    assert(changed);
+    assert(ab.target == 60);
+
+    push_window(&ab, SC_TICK_FROM_SEC(1), SC_TICK_FROM_MS(300));
+    sc_adaptive_buffering_on_underflow(&ab, 100);
+
+    changed = sc_adaptive_buffering_update(&ab);
+    assert(!changed);
+    assert(ab.target == 60);
+}
+
+static void test_decrease_when_stable(void) {
+    struct sc_adaptive_buffering ab;
+    sc_adaptive_buffering_init(&ab, RATE, 20, 200, 100);
+
+    sc_tick start = 0;
+    unsigned changes = 0;
+    for (int i = 0; i < 200; ++i) {
+        // Low jitter, no underflow
+        push_window(&ab, start, SC_TICK_FROM_MS(2));
+        start += SC_TICK_FROM_SEC(1);
+
+        uint32_t prev = ab.target;
+        if (sc_adaptive_buffering_update(&ab)) {
+            // Slow decrease
+            assert(ab.target < prev);
+            assert(prev - ab.target <= 5);
+            ++changes;
+        }
+
+        if (i < 4) {
+            // Not stable for long enough yet
+            assert(ab.target == 100);
+        }
+    }
+
+    assert(changes);
+    // Never below the min bound
+    assert(ab.target == 20);
+}
+
+static void test_decrease_limited_by_jitter(void) {
+    struct sc_adaptive_buffering ab;
+    sc_adaptive_buffering_init(&ab, RATE, 20, 200, 100);
+
+    sc_tick start = 0;
+    for (int i = 0; i < 200; ++i) {
+        push_window(&ab, start, SC_TICK_FROM_MS(40));
+        start += SC_TICK_FROM_SEC(1);
+        sc_adaptive_buffering_update(&ab);
+    }
+
+    // jitter (40) + margin (10)
+    assert(ab.target == 50);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_initial_target_clamped();
+    test_increase_on_underflow();
+    test_max_bound();
+    test_decrease_when_stable();
+    test_decrease_limited_by_jitter();
+
+    return 0;
+}
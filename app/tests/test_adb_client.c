@@ -0,0 +1,392 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adb/adb_client.h"
+#include "adb/adb_device.h"
+#include "adb/adb_parser.h"
+#include "util/binary.h"
+#include "util/net.h"
+#include "util/thread.h"
+
+#define FIRST_PORT 27200
+#define LAST_PORT 27299
+
+// Fake adb server, handling a single connection per test
+struct fake_server {
+    sc_socket server_socket;
+    uint16_t port;
+    sc_thread thread;
+    void (*handle)(sc_socket socket);
+};
+
+static struct fake_server fake;
+
+static void
+expect(sc_socket socket, const char *data) {
+    size_t len = strlen(data);
+    char buf[256];
+    assert(len < sizeof(buf));
+    ssize_t r = net_recv_all(socket, buf, len);
+    assert(r == (ssize_t) len);
+    (void) r;
+    assert(!memcmp(buf, data, len));
+}
+
+static void
+expect_request(sc_socket socket, const char *request) {
+    char header[5];
+    int r = snprintf(header, sizeof(header), "%04x",
+                     (unsigned) strlen(request));
+    assert(r == 4);
+    (void) r;
+    expect(socket, header);
+    expect(socket, request);
+}
+
+static void
+reply(sc_socket socket, const char *data) {
+    size_t len = strlen(data);
+    ssize_t w = net_send_all(socket, data, len);
+    assert(w == (ssize_t) len);
+    (void) w;
+}
+
+static int
+run_fake_server(void *data) {
+    (void) data;
+
+    sc_socket socket = net_accept(fake.server_socket);
+    assert(socket != SC_SOCKET_NONE);
+
+    fake.handle(socket);
+
+    net_close(socket);
+    return 0;
+}
+
+static void
+start_fake_server(void (*handle)(sc_socket socket)) {
+    fake.handle = handle;
+    bool ok = sc_thread_create(&fake.thread, run_fake_server, "fake-adb",
+                               NULL);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+join_fake_server(void) {
+    sc_thread_join(&fake.thread, NULL);
+}
+
+static void
+handle_version(sc_socket socket) {
+    expect_request(socket, "host:version");
+    reply(socket, "OKAY" "0004" "0029");
+}
+
+static void test_version(void) {
+    start_fake_server(handle_version);
+
+    uint32_t version;
+    bool ok = sc_adb_client_get_version(NULL, fake.port, &version);
+    assert(ok);
+    assert(version == 0x29);
+
+    join_fake_server();
+}
+
+static void test_server_not_running(void) {
+    // Nothing listens on this port (the fake server does not accept)
+    uint32_t version;
+    bool ok = sc_adb_client_get_version(NULL, fake.port == LAST_PORT
+                                                ? FIRST_PORT : LAST_PORT,
+                                        &version);
+    assert(!ok);
+}
+
+#define DEVICES \
+    "0123456789abcdef       device usb:2-1 product:MyProduct model:MyModel " \
+        "device:MyDevice transport_id:1\n" \
+    "192.168.1.1:5555       device product:MyWifiProduct model:MyWifiModel " \
+        "device:MyWifiDevice transport_id:2\n"
+
+static void
+handle_devices(sc_socket socket) {
+    expect_request(socket, "host:devices-l");
+    char header[9];
+    int r = snprintf(header, sizeof(header), "OKAY%04x",
+                     (unsigned) strlen(DEVICES));
+    assert(r == 8);
+    (void) r;
+    reply(socket, header);
+    reply(socket, DEVICES);
+}
+
+static void test_list_devices(void) {
+    start_fake_server(handle_devices);
+
+    char *list = sc_adb_client_list_devices(NULL, fake.port);
+    assert(list);
+    assert(!strcmp(list, DEVICES));
+
+    struct sc_vec_adb_devices vec = SC_VECTOR_INITIALIZER;
+    bool ok = sc_adb_parse_device_list(list, &vec);
+    assert(ok);
+    assert(vec.size == 2);
+    assert(!strcmp(vec.data[0].serial, "0123456789abcdef"));
+    assert(!strcmp(vec.data[0].state, "device"));
+    assert(!strcmp(vec.data[0].model, "MyModel"));
+    assert(!strcmp(vec.data[1].serial, "192.168.1.1:5555"));
+    assert(!strcmp(vec.data[1].model, "MyWifiModel"));
+
+    sc_adb_devices_destroy(&vec);
+    free(list);
+
+    join_fake_server();
+}
+
+static void
+handle_forward(sc_socket socket) {
+    expect_request(socket,
+                   "host-serial:abc:forward:tcp:1234;localabstract:scrcpy");
+    reply(socket, "OKAY" "OKAY");
+}
+
+static void test_forward(void) {
+    start_fake_server(handle_forward);
+
+    bool ok = sc_adb_client_forward(NULL, fake.port, "abc", "tcp:1234",
+                                    "localabstract:scrcpy");
+    assert(ok);
+
+    join_fake_server();
+}
+
+static void
+handle_forward_fail(sc_socket socket) {
+    expect_request(socket, "host-serial:abc:killforward:tcp:1234");
+    reply(socket, "FAIL" "0012" "listener not found");
+}
+
+static void test_forward_remove_fail(void) {
+    start_fake_server(handle_forward_fail);
+
+    bool ok = sc_adb_client_forward_remove(NULL, fake.port, "abc", "tcp:1234");
+    assert(!ok);
+
+    join_fake_server();
+}
+
+static void
+handle_reverse(sc_socket socket) {
+    expect_request(socket, "host:transport:abc");
+    reply(socket, "OKAY");
+    expect_request(socket, "reverse:forward:localabstract:scrcpy;tcp:1234");
+    reply(socket, "OKAY" "OKAY");
+}
+
+static void test_reverse(void) {
+    start_fake_server(handle_reverse);
+
+    bool ok = sc_adb_client_reverse(NULL, fake.port, "abc",
+                                    "localabstract:scrcpy", "tcp:1234");
+    assert(ok);
+
+    join_fake_server();
+}
+
+static void
+handle_shell(sc_socket socket) {
+    expect_request(socket, "host:transport:abc");
+    reply(socket, "OKAY");
+    expect_request(socket, "shell,v2,raw:getprop ro.build.version.sdk");
+    reply(socket, "OKAY");
+    // stdout, split in 2 packets, with stderr in between
+    ssize_t w = net_send_all(socket, "\x01\x01\0\0\0" "3", 6);
+    assert(w == 6);
+    w = net_send_all(socket, "\x02\x03\0\0\0" "err", 8);
+    assert(w == 8);
+    w = net_send_all(socket, "\x01\x02\0\0\0" "4\n", 7);
+    assert(w == 7);
+    // exit status 0
+    w = net_send_all(socket, "\x03\x01\0\0\0" "\0", 6);
+    assert(w == 6);
+    (void) w;
+}
+
+static void test_shell(void) {
+    start_fake_server(handle_shell);
+
+    char buf[128];
+    ssize_t r = sc_adb_client_shell(NULL, fake.port, "abc",
+                                    "getprop ro.build.version.sdk", buf,
+                                    sizeof(buf) - 1);
+    assert(r == 3);
+    buf[r] = '\0';
+    assert(!strcmp(buf, "34\n"));
+
+    join_fake_server();
+}
+
+static void
+handle_shell_fail(sc_socket socket) {
+    expect_request(socket, "host:transport:abc");
+    reply(socket, "OKAY");
+    expect_request(socket, "shell,v2,raw:ip route");
+    reply(socket, "OKAY");
+    ssize_t w = net_send_all(socket, "\x02\x0a\0\0\0" "not found\n", 15);
+    assert(w == 15);
+    // exit status 127
+    w = net_send_all(socket, "\x03\x01\0\0\0" "\x7f", 6);
+    assert(w == 6);
+    (void) w;
+}
+
+static void test_shell_fail(void) {
+    start_fake_server(handle_shell_fail);
+
+    char buf[128];
+    ssize_t r = sc_adb_client_shell(NULL, fake.port, "abc", "ip route", buf,
+                                    sizeof(buf) - 1);
+    assert(r == -1);
+
+    join_fake_server();
+}
+
+static void
+handle_shell_no_exit(sc_socket socket) {
+    expect_request(socket, "host:transport:abc");
+    reply(socket, "OKAY");
+    expect_request(socket, "shell,v2,raw:ip route");
+    reply(socket, "OKAY");
+    ssize_t w = net_send_all(socket, "\x01\x02\0\0\0" "ab", 7);
+    assert(w == 7);
+    (void) w;
+    // The connection is closed without exit packet
+}
+
+static void test_shell_no_exit(void) {
+    start_fake_server(handle_shell_no_exit);
+
+    char buf[128];
+    ssize_t r = sc_adb_client_shell(NULL, fake.port, "abc", "ip route", buf,
+                                    sizeof(buf) - 1);
+    assert(r == -1);
+
+    join_fake_server();
+}
+
+#define PUSH_FILE_SIZE (150 * 1024) // several DATA chunks
+
+static const char *push_file;
+
+static void
+handle_push(sc_socket socket) {
+    expect_request(socket, "host:transport:abc");
+    reply(socket, "OKAY");
+    expect_request(socket, "sync:");
+    reply(socket, "OKAY");
+
+    uint8_t header[8];
+    ssize_t r = net_recv_all(socket, header, sizeof(header));
+    assert(r == 8);
+    assert(!memcmp(header, "SEND", 4));
+
+    const char *expected = "/data/local/tmp/dir/push_file,33188";
+    uint32_t len = sc_read32le(&header[4]);
+    assert(len == strlen(expected));
+    expect(socket, expected);
+
+    uint8_t *data = malloc(64 * 1024);
+    assert(data);
+
+    size_t total = 0;
+    for (;;) {
+        r = net_recv_all(socket, header, sizeof(header));
+        assert(r == 8);
+        len = sc_read32le(&header[4]);
+        if (!memcmp(header, "DONE", 4)) {
+            break;
+        }
+        assert(!memcmp(header, "DATA", 4));
+        assert(len <= 64 * 1024);
+        r = net_recv_all(socket, data, len);
+        assert(r == (ssize_t) len);
+        for (uint32_t i = 0; i < len; ++i) {
+            assert(data[i] == (uint8_t) (total + i));
+        }
+        total += len;
+    }
+    assert(total == PUSH_FILE_SIZE);
+
+    free(data);
+
+    // OKAY with a 32-bit length 0
+    ssize_t w = net_send_all(socket, "OKAY\0\0\0\0", 8);
+    assert(w == 8);
+    (void) w;
+
+    r = net_recv_all(socket, header, sizeof(header));
+    assert(r == 8);
+    assert(!memcmp(header, "QUIT", 4));
+}
+
+static void test_push(void) {
+    push_file = "push_file";
+    FILE *f = fopen(push_file, "wb");
+    assert(f);
+    for (size_t i = 0; i < PUSH_FILE_SIZE; ++i) {
+        fputc((uint8_t) i, f);
+    }
+    fclose(f);
+
+    start_fake_server(handle_push);
+
+    // The remote path ends with '/': push into the directory
+    bool ok = sc_adb_client_push(NULL, fake.port, "abc", push_file,
+                                 "/data/local/tmp/dir/");
+    assert(ok);
+
+    join_fake_server();
+
+    remove(push_file);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+
+    fake.server_socket = net_socket();
+    assert(fake.server_socket != SC_SOCKET_NONE);
+
+    for (fake.port = FIRST_PORT; fake.port <= LAST_PORT; ++fake.port) {
+        ok = net_listen(fake.server_socket, IPV4_LOCALHOST, fake.port, 1);
+        if (ok) {
+            break;
+        }
+    }
+    assert(ok);
+
+    test_version();
+    test_server_not_running();
+    test_list_devices();
+    test_forward();
+    test_forward_remove_fail();
+    test_reverse();
+    test_shell();
+    test_shell_fail();
+    test_shell_no_exit();
+    test_push();
+
+    net_close(fake.server_socket);
+    net_cleanup();
+
+    return 0;
+}
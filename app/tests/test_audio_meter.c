@@ -0,0 +1,202 @@
+#include "common.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include "audio_meter.h"
+
+#define RATE 48000
+#define FRAME 960
+
+static bool
+near(double a, double b) {
+    return fabs(a - b) < 1e-4;
+}
+
+static double
+rms(const struct sc_audio_level *level, uint64_t samples) {
+    return sqrt(level->sum_squares / samples);
+}
+
+static void test_packed_float(void) {
+    struct sc_audio_meter meter;
+    sc_audio_meter_init(&meter);
+    bool ok = sc_audio_meter_configure(&meter, AV_SAMPLE_FMT_FLT, 2, RATE);
+    assert(ok);
+
+    // Left: constant 0.5, right: alternating +/-0.25 (odd count, to cover the
+    // remaining values after the vectorized loop)
+    float data[2 * 7];
+    for (int i = 0; i < 7; ++i) {
+        data[2 * i] = 0.5f;
+        data[2 * i + 1] = i % 2 ? -0.25f : 0.25f;
+    }
+    const uint8_t *planes[] = {(const uint8_t *) data};
+    sc_audio_meter_process(&meter, planes, 7);
+
+    assert(meter.interval_samples == 7);
+    assert(near(rms(&meter.interval[0], 7), 0.5));
+    assert(near(meter.interval[0].peak, 0.5));
+    assert(near(rms(&meter.interval[1], 7), 0.25));
+    assert(near(meter.interval[1].peak, 0.25));
+    assert(!meter.interval[0].clipped);
+    assert(!meter.interval[1].clipped);
+}
+
+static void test_planar_float_clipping(void) {
+    struct sc_audio_meter meter;
+    sc_audio_meter_init(&meter);
+    bool ok = sc_audio_meter_configure(&meter, AV_SAMPLE_FMT_FLTP, 2, RATE);
+    assert(ok);
+
+    float left[FRAME];
+    float right[FRAME];
+    for (int i = 0; i < FRAME; ++i) {
+        left[i] = i % 100 ? 0.1f : -1.f; // 10 clipped samples
+        right[i] = 0.f;
+    }
+    const uint8_t *planes[] = {(const uint8_t *) left, (const uint8_t *) right};
+
+    // 1 second, so that the interval is complete
+    for (int i = 0; i < RATE / FRAME; ++i) {
+        sc_audio_meter_process(&meter, planes, FRAME);
+    }
+
+    assert(!meter.interval_samples);
+    assert(meter.stats.samples == RATE);
+    assert(meter.stats.clipping_events == 1);
+    assert(meter.stats.levels[0].clipped == 10 * RATE / FRAME);
+    assert(near(meter.stats.levels[0].peak, 1.f));
+    assert(!meter.stats.levels[1].clipped);
+    assert(meter.stats.levels[1].peak == 0.f);
+    // The right channel is silent, but not the left one
+    assert(!meter.stats.silent_samples);
+    assert(!meter.silent);
+}
+
+static void test_packed_s16(void) {
+    struct sc_audio_meter meter;
+    sc_audio_meter_init(&meter);
+    bool ok = sc_audio_meter_configure(&meter, AV_SAMPLE_FMT_S16, 2, RATE);
+    assert(ok);
+
+    // More samples than a conversion chunk
+    static int16_t data[2 * 3000];
+    for (int i = 0; i < 3000; ++i) {
+        data[2 * i] = 16384; // 0.5
+        data[2 * i + 1] = -32768; // -1.0 (clipped)
+    }
+    const uint8_t *planes[] = {(const uint8_t *) data};
+    sc_audio_meter_process(&meter, planes, 3000);
+
+    assert(near(rms(&meter.interval[0], 3000), 0.5));
+    assert(near(meter.interval[0].peak, 0.5));
+    assert(!meter.interval[0].clipped);
+    assert(near(meter.interval[1].peak, 1.f));
+    assert(meter.interval[1].clipped == 3000);
+}
+
+static void test_planar_s32(void) {
+    struct sc_audio_meter meter;
+    sc_audio_meter_init(&meter);
+    bool ok = sc_audio_meter_configure(&meter, AV_SAMPLE_FMT_S32P, 1, RATE);
+    assert(ok);
+
+    static int32_t data[1500];
+    for (int i = 0; i < 1500; ++i) {
+        data[i] = i % 2 ? 1 << 29 : -(1 << 29); // +/-0.25
+    }
+    const uint8_t *planes[] = {(const uint8_t *) data};
+    sc_audio_meter_process(&meter, planes, 1500);
+
+    assert(near(rms(&meter.interval[0], 1500), 0.25));
+    assert(near(meter.interval[0].peak, 0.25));
+}
+
+static void test_unusual_channel_count(void) {
+    struct sc_audio_meter meter;
+    sc_audio_meter_init(&meter);
+    bool ok = sc_audio_meter_configure(&meter, AV_SAMPLE_FMT_FLT, 6, RATE);
+    assert(ok);
+
+    float data[6 * 100];
+    for (int i = 0; i < 100; ++i) {
+        for (int c = 0; c < 6; ++c) {
+            data[6 * i + c] = c * 0.1f;
+        }
+    }
+    const uint8_t *planes[] = {(const uint8_t *) data};
+    sc_audio_meter_process(&meter, planes, 100);
+
+    for (int c = 0; c < 6; ++c) {
+        assert(near(rms(&meter.interval[c], 100), c * 0.1));
+        assert(near(meter.interval[c].peak, c * 0.1));
+    }
+}
+
+static void test_unsupported_format(void) {
+    struct sc_audio_meter meter;
+    sc_audio_meter_init(&meter);
+    bool ok = sc_audio_meter_configure(&meter, AV_SAMPLE_FMT_DBL, 2, RATE);
+    assert(!ok);
+    assert(meter.format == AV_SAMPLE_FMT_NONE);
+}
+
+static void test_silence(void) {
+    struct sc_audio_meter meter;
+    sc_audio_meter_init(&meter);
+    bool ok = sc_audio_meter_configure(&meter, AV_SAMPLE_FMT_FLT, 2, RATE);
+    assert(ok);
+
+    // Below -60 dBFS
+    float quiet[2 * FRAME];
+    float loud[2 * FRAME];
+    for (int i = 0; i < 2 * FRAME; ++i) {
+        quiet[i] = 0.0005f;
+        loud[i] = 0.5f;
+    }
+    const uint8_t *quiet_planes[] = {(const uint8_t *) quiet};
+    const uint8_t *loud_planes[] = {(const uint8_t *) loud};
+
+    // Less than 1 second of silence is not reported
+    for (int i = 0; i < 40; ++i) {
+        sc_audio_meter_process(&meter, quiet_planes, FRAME);
+    }
+    assert(!meter.silent);
+    assert(!meter.stats.silence_events);
+
+    // 1.5 second
+    for (int i = 0; i < 35; ++i) {
+        sc_audio_meter_process(&meter, quiet_planes, FRAME);
+    }
+    assert(meter.silent);
+    assert(meter.stats.silence_events == 1);
+    assert(meter.stats.silent_samples == 75 * FRAME);
+
+    sc_audio_meter_process(&meter, loud_planes, FRAME);
+    assert(!meter.silent);
+    assert(!meter.silence_samples);
+
+    // A short silence again
+    for (int i = 0; i < 10; ++i) {
+        sc_audio_meter_process(&meter, quiet_planes, FRAME);
+    }
+    assert(!meter.silent);
+    assert(meter.stats.silence_events == 1);
+    assert(meter.stats.silent_samples == 85 * FRAME);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_packed_float();
+    test_planar_float_clipping();
+    test_packed_s16();
+    test_planar_s32();
+    test_unusual_channel_count();
+    test_unsupported_format();
+    test_silence();
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "audio_output_null.h"
+#include "util/thread.h"
+
+#define TEST_PERIOD 480 // 10ms at 48kHz
+#define TEST_PULLS 5
+
+static uint16_t
+read16le(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8);
+}
+
+static uint32_t
+read32le(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+struct test_consumer {
+    sc_mutex mutex;
+    sc_cond cond;
+    float next; // value of the next sample
+    unsigned pulls;
+};
+
+static void
+on_pull(struct sc_audio_output *aout, uint8_t *data, uint32_t samples,
+        void *userdata) {
+    (void) aout;
+    struct test_consumer *consumer = userdata;
+
+    assert(samples == TEST_PERIOD);
+
+    sc_mutex_lock(&consumer->mutex);
+    // Stereo: write the same value to both channels
+    float *out = (float *) data;
+    for (uint32_t i = 0; i < samples; ++i) {
+        out[2 * i] = consumer->next;
+        out[2 * i + 1] = -consumer->next;
+        consumer->next += 1;
+    }
+    ++consumer->pulls;
+    sc_cond_signal(&consumer->cond);
+    sc_mutex_unlock(&consumer->mutex);
+}
+
+static void test_audio_output_null_wav(void) {
+    char path[] = "/tmp/scrcpy_test_audio_output_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    struct test_consumer consumer = {
+        .next = 0,
+        .pulls = 0,
+    };
+    bool ok = sc_mutex_init(&consumer.mutex);
+    assert(ok);
+    ok = sc_cond_init(&consumer.cond);
+    assert(ok);
+
+    struct sc_audio_output_null null;
+    sc_audio_output_null_init(&null);
+    struct sc_audio_output *aout = &null.audio_output;
+
+    const struct sc_audio_output_params params = {
+        .device = path,
+        .sample_rate = 48000,
+        .channels = 2,
+        .period = TEST_PERIOD,
+    };
+    static const struct sc_audio_output_callbacks cbs = {
+        .on_pull = on_pull,
+    };
+
+    ok = aout->ops->open(aout, &params, &cbs, &consumer);
+    assert(ok);
+    assert(aout->latency == TEST_PERIOD);
+
+    ok = aout->ops->start(aout);
+    assert(ok);
+
+    sc_mutex_lock(&consumer.mutex);
+    while (consumer.pulls < TEST_PULLS) {
+        sc_cond_wait(&consumer.cond, &consumer.mutex);
+    }
+    sc_mutex_unlock(&consumer.mutex);
+
+    aout->ops->close(aout);
+
+    // No more pulls after close()
+    unsigned pulls = consumer.pulls;
+    assert(pulls >= TEST_PULLS);
+
+    FILE *file = fopen(path, "rb");
+    assert(file);
+    uint8_t header[58];
+    size_t r = fread(header, sizeof(header), 1, file);
+    assert(r == 1);
+
+    uint32_t data_size = pulls * TEST_PERIOD * 2 * sizeof(float);
+    assert(!memcmp(header, "RIFF", 4));
+    assert(read32le(&header[4]) == 50 + data_size);
+    assert(!memcmp(&header[8], "WAVE", 4));
+    assert(!memcmp(&header[12], "fmt ", 4));
+    assert(read16le(&header[20]) == 3); // IEEE float
+    assert(read16le(&header[22]) == 2);
+    assert(read32le(&header[24]) == 48000);
+    assert(read32le(&header[28]) == 48000 * 8);
+    assert(read16le(&header[32]) == 8);
+    assert(read16le(&header[34]) == 32);
+    assert(!memcmp(&header[38], "fact", 4));
+    assert(read32le(&header[46]) == pulls * TEST_PERIOD);
+    assert(!memcmp(&header[50], "data", 4));
+    assert(read32le(&header[54]) == data_size);
+
+    // The samples are written in order
+    float samples[TEST_PERIOD * 2];
+    for (unsigned i = 0; i < pulls; ++i) {
+        r = fread(samples, sizeof(samples), 1, file);
+        assert(r == 1);
+        for (unsigned j = 0; j < TEST_PERIOD; ++j) {
+            float expected = i * TEST_PERIOD + j;
+            assert(samples[2 * j] == expected);
+            assert(samples[2 * j + 1] == -expected);
+        }
+    }
+
+    // End of file
+    assert(fgetc(file) == EOF);
+    fclose(file);
+
+    unlink(path);
+    sc_cond_destroy(&consumer.cond);
+    sc_mutex_destroy(&consumer.mutex);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_audio_output_null_wav();
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "../bench/audio_sim.h"
+
+// The thresholds are loose: the exact values depend on the resampler
+// compensation, only the regulation behavior is checked
+
+static void
+run(const struct sc_audio_sim_params *params,
+    struct sc_audio_sim_stats *stats) {
+    bool ok = sc_audio_sim_run(params, NULL, NULL, stats);
+    assert(ok);
+    (void) ok;
+}
+
+static void test_deterministic(void) {
+    struct sc_audio_sim_params params = SC_AUDIO_SIM_PARAMS_DEFAULT;
+    params.duration = SC_TICK_FROM_SEC(10);
+    params.jitter = SC_TICK_FROM_MS(40);
+    params.drift_ppm = 2000;
+
+    struct sc_audio_sim_stats stats1;
+    struct sc_audio_sim_stats stats2;
+    run(&params, &stats1);
+    run(&params, &stats2);
+
+    assert(stats1.underflow_samples == stats2.underflow_samples);
+    assert(stats1.underflow_events == stats2.underflow_events);
+    assert(stats1.latency_avg == stats2.latency_avg);
+    assert(stats1.latency_min == stats2.latency_min);
+    assert(stats1.latency_max == stats2.latency_max);
+    assert(stats1.compensations == stats2.compensations);
+}
+
+static void test_ideal_link(void) {
+    struct sc_audio_sim_params params = SC_AUDIO_SIM_PARAMS_DEFAULT;
+    params.duration = SC_TICK_FROM_SEC(20);
+
+    struct sc_audio_sim_stats stats;
+    run(&params, &stats);
+
+    assert(!stats.underflow_samples);
+    // delay (5ms) + target buffering (50ms), within one frame (20ms)
+    assert(stats.latency_avg >= SC_TICK_FROM_MS(35));
+    assert(stats.latency_avg <= SC_TICK_FROM_MS(75));
+}
+
+static void test_device_faster(void) {
+    struct sc_audio_sim_params params = SC_AUDIO_SIM_PARAMS_DEFAULT;
+    params.duration = SC_TICK_FROM_SEC(60);
+    params.drift_ppm = 5000;
+
+    struct sc_audio_sim_stats stats;
+    run(&params, &stats);
+
+    // Without compensation, the latency would increase by 5ms per second
+    assert(stats.compensations);
+    assert(stats.latency_max <= SC_TICK_FROM_MS(150));
+}
+
+static void test_device_slower(void) {
+    struct sc_audio_sim_params params = SC_AUDIO_SIM_PARAMS_DEFAULT;
+    params.duration = SC_TICK_FROM_SEC(60);
+    params.drift_ppm = -5000;
+
+    struct sc_audio_sim_stats stats;
+    run(&params, &stats);
+
+    // Without compensation, the buffer would be drained after 10 seconds, then
+    // underflow continuously (5ms of silence per second)
+    assert(stats.compensations);
+    assert(stats.underflow_samples < 60 * 48000 * 5 / 1000 / 2);
+    assert(stats.latency_max <= SC_TICK_FROM_MS(100));
+}
+
+static void test_jitter_absorbed(void) {
+    struct sc_audio_sim_params params = SC_AUDIO_SIM_PARAMS_DEFAULT;
+    params.duration = SC_TICK_FROM_SEC(30);
+    params.jitter = SC_TICK_FROM_MS(30);
+
+    struct sc_audio_sim_stats stats;
+    run(&params, &stats);
+
+    // The jitter is lower than the target buffering (50ms)
+    assert(stats.underflow_events <= 2);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_deterministic();
+    test_ideal_link();
+    test_device_faster();
+    test_device_slower();
+    test_jitter_absorbed();
+
+    return 0;
+}
@@ -116,6 +116,121 @@ static void test_audiobuf_partial_read_write(void) {
     sc_audiobuf_destroy(&buf);
 }
 
+static void test_audiobuf_write_reserve(void) {
+    struct sc_audiobuf buf;
+    uint32_t data[10];
+
+    bool ok = sc_audiobuf_init(&buf, 4, 10);
+    assert(ok);
+
+    struct sc_audiobuf_region regions[2];
+    uint32_t n = sc_audiobuf_write_reserve(&buf, 1, regions);
+    assert(n == 10);
+    assert(regions[0].samples_count == 10);
+    assert(regions[1].samples_count == 0);
+
+    uint32_t samples[] = {1, 2, 3, 4, 5, 6, 7};
+    memcpy(regions[0].data, samples, sizeof(samples));
+
+    // Not visible until committed
+    assert(sc_audiobuf_can_read(&buf) == 0);
+
+    sc_audiobuf_write_commit(&buf, 7);
+    assert(sc_audiobuf_can_read(&buf) == 7);
+
+    uint32_t r = sc_audiobuf_read(&buf, data, 5);
+    assert(r == 5);
+
+    uint32_t samples2[] = {8, 9, 10, 11, 12, 13, 14, 15};
+    uint32_t w = sc_audiobuf_write(&buf, samples2, 8);
+    assert(w == 8);
+
+    r = sc_audiobuf_read(&buf, data, 8);
+    assert(r == 8);
+
+    // The free space wraps around the end of the array (alloc_size == 16)
+    n = sc_audiobuf_write_reserve(&buf, 1, regions);
+    assert(n == 8);
+    assert(regions[0].samples_count == 1);
+    assert(regions[1].samples_count == 7);
+    assert(regions[1].data == buf.data);
+
+    uint32_t right[] = {16};
+    uint32_t left[] = {17, 18, 19};
+    memcpy(regions[0].data, right, sizeof(right));
+    memcpy(regions[1].data, left, sizeof(left));
+    sc_audiobuf_write_commit(&buf, 4);
+
+    r = sc_audiobuf_read(&buf, data, 10);
+    assert(r == 6);
+    uint32_t expected[] = {14, 15, 16, 17, 18, 19};
+    assert(!memcmp(data, expected, 24));
+
+    sc_audiobuf_destroy(&buf);
+}
+
+static void test_audiobuf_write_reserve_cached_tail(void) {
+    struct sc_audiobuf buf;
+    uint32_t data[10] = {0};
+
+    bool ok = sc_audiobuf_init(&buf, 4, 10);
+    assert(ok);
+
+    uint32_t w = sc_audiobuf_write(&buf, data, 8);
+    assert(w == 8);
+
+    uint32_t r = sc_audiobuf_read(&buf, data, 6);
+    assert(r == 6);
+
+    // The space known from the cached tail is sufficient, it is not reloaded
+    struct sc_audiobuf_region regions[2];
+    uint32_t n = sc_audiobuf_write_reserve(&buf, 2, regions);
+    assert(n == 2);
+
+    // Not sufficient, the tail is reloaded
+    n = sc_audiobuf_write_reserve(&buf, 3, regions);
+    assert(n == 8);
+
+    sc_audiobuf_destroy(&buf);
+}
+
+static void test_audiobuf_cursor_overflow(void) {
+    struct sc_audiobuf buf;
+    uint32_t data[8];
+
+    bool ok = sc_audiobuf_init(&buf, 4, 8);
+    assert(ok);
+
+    // The cursors are free-running, make them overflow
+    uint32_t start = UINT32_MAX - 2;
+    atomic_store(&buf.head, start);
+    atomic_store(&buf.tail, start);
+    buf.cached_head = start;
+    buf.cached_tail = start;
+
+    uint32_t samples[] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint32_t w = sc_audiobuf_write(&buf, samples, 8);
+    assert(w == 8);
+    assert(sc_audiobuf_can_read(&buf) == 8);
+
+    w = sc_audiobuf_write(&buf, samples, 1);
+    assert(w == 0);
+
+    uint32_t r = sc_audiobuf_read(&buf, data, 5);
+    assert(r == 5);
+    assert(sc_audiobuf_can_read(&buf) == 3);
+
+    w = sc_audiobuf_write(&buf, samples, 8);
+    assert(w == 5);
+
+    r = sc_audiobuf_read(&buf, data, 8);
+    assert(r == 8);
+    uint32_t expected[] = {6, 7, 8, 1, 2, 3, 4, 5};
+    assert(!memcmp(data, expected, 32));
+
+    sc_audiobuf_destroy(&buf);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -123,6 +238,9 @@ int main(int argc, char *argv[]) {
     test_audiobuf_simple();
     test_audiobuf_boundaries();
     test_audiobuf_partial_read_write();
+    test_audiobuf_write_reserve();
+    test_audiobuf_write_reserve_cached_tail();
+    test_audiobuf_cursor_overflow();
 
     return 0;
 }
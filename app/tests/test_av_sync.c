@@ -0,0 +1,123 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "av_sync.h"
+
+static void test_no_audio_clock(void) {
+    struct sc_av_sync sync;
+    sc_av_sync_init(&sync);
+
+    sc_tick date;
+    bool ok = sc_av_sync_to_system_time(&sync, 1000, 0, &date);
+    assert(!ok);
+}
+
+static void test_audio_clock(void) {
+    struct sc_av_sync sync;
+    sc_av_sync_init(&sync);
+
+    // The audio with PTS 1000 is played at system date 51000
+    sc_av_sync_update_audio(&sync, 51000, 1000);
+
+    sc_tick date;
+    bool ok = sc_av_sync_to_system_time(&sync, 21000, 51000, &date);
+    assert(ok);
+    assert(date == 71000);
+
+    // Regular updates with the same offset
+    for (int i = 0; i < 100; ++i) {
+        sc_tick pts = 2000 + i * 5000;
+        sc_av_sync_update_audio(&sync, pts + 50000, pts);
+    }
+
+    ok = sc_av_sync_to_system_time(&sync, 1000000, 547000, &date);
+    assert(ok);
+    assert(date == 1050000);
+}
+
+static void test_audio_clock_smoothing(void) {
+    struct sc_av_sync sync;
+    sc_av_sync_init(&sync);
+
+    for (int i = 0; i < 100; ++i) {
+        sc_tick pts = i * 5000;
+        sc_av_sync_update_audio(&sync, pts + 50000, pts);
+    }
+
+    // A single late callback must not move the clock much
+    sc_av_sync_update_audio(&sync, 500000 + 50000 + 3200, 500000);
+
+    sc_tick date;
+    bool ok = sc_av_sync_to_system_time(&sync, 1000000, 547000, &date);
+    assert(ok);
+    assert(date > 1050000 && date < 1050000 + 200);
+}
+
+static void test_audio_stalled(void) {
+    struct sc_av_sync sync;
+    sc_av_sync_init(&sync);
+
+    sc_av_sync_update_audio(&sync, 51000, 1000);
+
+    sc_tick date;
+    bool ok = sc_av_sync_to_system_time(&sync, 21000,
+                                        51000 + SC_AV_SYNC_STALL_DELAY - 1,
+                                        &date);
+    assert(ok);
+
+    // Not updated for too long
+    ok = sc_av_sync_to_system_time(&sync, 21000,
+                                   51000 + SC_AV_SYNC_STALL_DELAY, &date);
+    assert(!ok);
+
+    sc_tick pts;
+    ok = sc_av_sync_get_audio_pts(&sync, 51000 + SC_AV_SYNC_STALL_DELAY, &pts);
+    assert(!ok);
+
+    // Resumed
+    sc_av_sync_update_audio(&sync, 1000000, 950000);
+    ok = sc_av_sync_to_system_time(&sync, 960000, 1000000, &date);
+    assert(ok);
+}
+
+static void test_audio_pts(void) {
+    struct sc_av_sync sync;
+    sc_av_sync_init(&sync);
+
+    sc_tick pts;
+    bool ok = sc_av_sync_get_audio_pts(&sync, 0, &pts);
+    assert(!ok);
+
+    for (int i = 0; i < 100; ++i) {
+        sc_tick t = i * 5000;
+        sc_av_sync_update_audio(&sync, t + 50000, t);
+    }
+
+    // A late callback is not smoothed: the audio heard at a given date is
+    // the one reported last
+    sc_av_sync_update_audio(&sync, 500000 + 50000 + 3200, 500000);
+
+    ok = sc_av_sync_get_audio_pts(&sync, 560000, &pts);
+    assert(ok);
+    assert(pts == 560000 - 53200);
+
+    // Whereas the clock used to present the frames is smoothed
+    sc_tick date;
+    ok = sc_av_sync_to_system_time(&sync, 506800, 560000, &date);
+    assert(ok);
+    assert(date > 556800 && date < 556800 + 200);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_no_audio_clock();
+    test_audio_clock();
+    test_audio_clock_smoothing();
+    test_audio_stalled();
+    test_audio_pts();
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "control_msg.h"
@@ -426,6 +427,222 @@ static void test_serialize_reset_video(void) {
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
 
+static void test_serialize_ping(void) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_PING,
+        .ping = {
+            .push_date = UINT64_C(0x0102030405060708),
+            .send_date = UINT64_C(0x1112131415161718),
+        },
+    };
+
+    uint8_t buf[SC_CONTROL_MSG_MAX_SIZE];
+    size_t size = sc_control_msg_serialize(&msg, buf);
+    assert(size == 17);
+
+    const uint8_t expected[] = {
+        SC_CONTROL_MSG_TYPE_PING,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // push date
+        0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, // send date
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_chunk(void) {
+    const uint8_t data[] = {0x01, 0x02, 0x03, 0x04, 0x05};
+
+    uint8_t buf[SC_CONTROL_MSG_CHUNK_HEADER_SIZE
+              + SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD];
+    memcpy(&buf[SC_CONTROL_MSG_CHUNK_HEADER_SIZE], data, sizeof(data));
+    size_t size = sc_control_msg_serialize_chunk_header(sizeof(data), true,
+                                                        buf);
+    assert(size == 9);
+
+    const uint8_t expected[] = {
+        SC_CONTROL_MSG_TYPE_CHUNK,
+        1, // last
+        0x00, 0x05, // length
+        0x01, 0x02, 0x03, 0x04, 0x05,
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_bulk_set_clipboard(void) {
+    // Larger than SC_CONTROL_MSG_MAX_SIZE
+    size_t text_len = 1 << 20;
+    char *text = malloc(text_len + 1);
+    assert(text);
+    memset(text, 'a', text_len);
+    text[text_len] = '\0';
+
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        .set_clipboard = {
+            .sequence = UINT64_C(0x0102030405060708),
+            .text = text,
+            .paste = true,
+        },
+    };
+
+    uint8_t header[SC_CONTROL_MSG_BULK_HEADER_MAX_SIZE];
+    const uint8_t *payload;
+    size_t payload_len;
+    size_t size = sc_control_msg_serialize_bulk(&msg, header, &payload,
+                                                &payload_len);
+    assert(size == 14);
+
+    const uint8_t expected[] = {
+        SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // sequence
+        1, // paste
+        0x00, 0x10, 0x00, 0x00, // text length
+    };
+    assert(!memcmp(header, expected, sizeof(expected)));
+
+    // The payload is not copied
+    assert(payload == (const uint8_t *) text);
+    assert(payload_len == text_len);
+
+    free(text);
+}
+
+static void test_serialize_bulk_start_app(void) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_START_APP,
+        .start_app = {
+            .name = "firefox",
+        },
+    };
+
+    uint8_t header[SC_CONTROL_MSG_BULK_HEADER_MAX_SIZE];
+    const uint8_t *payload;
+    size_t payload_len;
+    size_t size = sc_control_msg_serialize_bulk(&msg, header, &payload,
+                                                &payload_len);
+    assert(size == 2);
+    assert(header[0] == SC_CONTROL_MSG_TYPE_START_APP);
+    assert(header[1] == 7);
+    assert(payload_len == 7);
+    assert(!memcmp(payload, "firefox", 7));
+}
+
+static void test_bulk(void) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+    };
+    assert(sc_control_msg_is_bulk(&msg));
+
+    msg.type = SC_CONTROL_MSG_TYPE_START_APP;
+    assert(sc_control_msg_is_bulk(&msg));
+
+    msg.type = SC_CONTROL_MSG_TYPE_INJECT_TEXT;
+    assert(!sc_control_msg_is_bulk(&msg));
+
+    msg.type = SC_CONTROL_MSG_TYPE_INJECT_KEYCODE;
+    assert(!sc_control_msg_is_bulk(&msg));
+}
+
+static struct sc_control_msg
+create_touch_event(enum android_motionevent_action action, uint64_t pointer_id,
+                   int32_t x, int32_t y) {
+    return (struct sc_control_msg) {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = action,
+            .pointer_id = pointer_id,
+            .position = {
+                .point = {
+                    .x = x,
+                    .y = y,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .pressure = 1.0f,
+            .action_button = 0,
+            .buttons = AMOTION_EVENT_BUTTON_PRIMARY,
+        },
+    };
+}
+
+static struct sc_control_msg
+create_scroll_event(float hscroll, float vscroll) {
+    return (struct sc_control_msg) {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_SCROLL_EVENT,
+        .inject_scroll_event = {
+            .position = {
+                .point = {
+                    .x = 260,
+                    .y = 1026,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .hscroll = hscroll,
+            .vscroll = vscroll,
+            .buttons = 0,
+        },
+    };
+}
+
+static void test_merge_move(void) {
+    struct sc_control_msg prev =
+        create_touch_event(AMOTION_EVENT_ACTION_MOVE, 42, 100, 200);
+    struct sc_control_msg msg =
+        create_touch_event(AMOTION_EVENT_ACTION_MOVE, 42, 110, 230);
+
+    bool merged = sc_control_msg_merge(&prev, &msg);
+    assert(merged);
+    assert(prev.inject_touch_event.position.point.x == 110);
+    assert(prev.inject_touch_event.position.point.y == 230);
+
+    // Another pointer
+    msg = create_touch_event(AMOTION_EVENT_ACTION_MOVE, 43, 120, 240);
+    assert(!sc_control_msg_merge(&prev, &msg));
+
+    // Never merge DOWN/UP events
+    msg = create_touch_event(AMOTION_EVENT_ACTION_UP, 42, 120, 240);
+    assert(!sc_control_msg_merge(&prev, &msg));
+    assert(!sc_control_msg_is_droppable(&msg));
+    prev = create_touch_event(AMOTION_EVENT_ACTION_DOWN, 42, 100, 200);
+    msg = create_touch_event(AMOTION_EVENT_ACTION_MOVE, 42, 120, 240);
+    assert(!sc_control_msg_merge(&prev, &msg));
+    assert(prev.inject_touch_event.position.point.x == 100);
+}
+
+static void test_merge_scroll(void) {
+    struct sc_control_msg prev = create_scroll_event(0.25f, -0.5f);
+    struct sc_control_msg msg = create_scroll_event(0.25f, -0.25f);
+
+    bool merged = sc_control_msg_merge(&prev, &msg);
+    assert(merged);
+    assert(prev.inject_scroll_event.hscroll == 0.5f);
+    assert(prev.inject_scroll_event.vscroll == -0.75f);
+
+    // The accumulated value would not fit
+    msg = create_scroll_event(0.0f, -0.5f);
+    assert(!sc_control_msg_merge(&prev, &msg));
+    assert(prev.inject_scroll_event.vscroll == -0.75f);
+}
+
+static void test_merge_other(void) {
+    struct sc_control_msg prev = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_KEYCODE,
+        .inject_keycode = {
+            .action = AKEY_EVENT_ACTION_DOWN,
+            .keycode = AKEYCODE_ENTER,
+        },
+    };
+    struct sc_control_msg msg = prev;
+
+    assert(!sc_control_msg_merge(&prev, &msg));
+    assert(!sc_control_msg_is_droppable(&msg));
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -449,5 +666,13 @@ int main(int argc, char *argv[]) {
     test_serialize_uhid_destroy();
     test_serialize_open_hard_keyboard();
     test_serialize_reset_video();
+    test_serialize_ping();
+    test_serialize_chunk();
+    test_serialize_bulk_set_clipboard();
+    test_serialize_bulk_start_app();
+    test_bulk();
+    test_merge_move();
+    test_merge_scroll();
+    test_merge_other();
     return 0;
 }
@@ -0,0 +1,288 @@
+#include "common.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller.h"
+#include "util/binary.h"
+#include "util/net.h"
+
+#define FIRST_PORT 27300
+#define LAST_PORT 27399
+
+struct connection {
+    sc_socket server_socket;
+    sc_socket client_socket; // used by the controller
+    sc_socket socket; // accepted, to read what the controller sends
+};
+
+static void
+connection_open(struct connection *c) {
+    c->server_socket = net_socket();
+    assert(c->server_socket != SC_SOCKET_NONE);
+
+    bool ok = false;
+    uint16_t port;
+    for (port = FIRST_PORT; port <= LAST_PORT; ++port) {
+        ok = net_listen(c->server_socket, IPV4_LOCALHOST, port, 1);
+        if (ok) {
+            break;
+        }
+    }
+    assert(ok);
+
+    c->client_socket = net_socket();
+    assert(c->client_socket != SC_SOCKET_NONE);
+    ok = net_connect(c->client_socket, IPV4_LOCALHOST, port);
+    assert(ok);
+
+    c->socket = net_accept(c->server_socket);
+    assert(c->socket != SC_SOCKET_NONE);
+    (void) ok;
+}
+
+static void
+connection_close(struct connection *c) {
+    net_close(c->socket);
+    net_close(c->client_socket);
+    net_close(c->server_socket);
+}
+
+static void
+on_ended(struct sc_controller *controller, bool error, void *userdata) {
+    (void) controller;
+    (void) error;
+    (void) userdata;
+}
+
+static void
+init_controller(struct sc_controller *controller, struct connection *c) {
+    static const struct sc_controller_callbacks cbs = {
+        .on_ended = on_ended,
+    };
+
+    bool ok = sc_controller_init(controller, c->client_socket, &cbs, NULL);
+    assert(ok);
+    sc_controller_configure(controller, NULL, NULL, 0, false);
+    (void) ok;
+}
+
+static void
+start_controller(struct sc_controller *controller) {
+    bool ok = sc_controller_start(controller);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+stop_controller(struct sc_controller *controller, struct connection *c) {
+    sc_controller_stop(controller);
+    // Unblock the receiver
+    net_interrupt(c->client_socket);
+    sc_controller_join(controller);
+    sc_controller_destroy(controller);
+}
+
+static void
+recv_exact(sc_socket socket, uint8_t *buf, size_t len) {
+    ssize_t r = net_recv_all(socket, buf, len);
+    assert(r == (ssize_t) len);
+    (void) r;
+}
+
+static void
+push_keycode(struct sc_controller *controller, uint32_t keycode) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_KEYCODE,
+        .inject_keycode = {
+            .action = AKEY_EVENT_ACTION_DOWN,
+            .keycode = keycode,
+        },
+    };
+    bool ok = sc_controller_push_msg(controller, &msg);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+push_touch_down(struct sc_controller *controller) {
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT,
+        .inject_touch_event = {
+            .action = AMOTION_EVENT_ACTION_DOWN,
+            .pointer_id = 0,
+            .position = {
+                .point = {.x = 100, .y = 200},
+                .screen_size = {.width = 1080, .height = 1920},
+            },
+            .pressure = 1.0f,
+        },
+    };
+    bool ok = sc_controller_push_msg(controller, &msg);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+push_clipboard(struct sc_controller *controller, size_t len, bool paste) {
+    char *text = malloc(len + 1);
+    assert(text);
+    memset(text, 'x', len);
+    text[len] = '\0';
+
+    struct sc_control_msg msg = {
+        .type = SC_CONTROL_MSG_TYPE_SET_CLIPBOARD,
+        .set_clipboard = {
+            .sequence = SC_SEQUENCE_INVALID,
+            .text = text, // owned by the controller
+            .paste = paste,
+        },
+    };
+    bool ok = sc_controller_push_msg(controller, &msg);
+    assert(ok);
+    (void) ok;
+}
+
+static void
+expect_keycode(sc_socket socket, uint32_t keycode) {
+    uint8_t buf[14];
+    recv_exact(socket, buf, sizeof(buf));
+    assert(buf[0] == SC_CONTROL_MSG_TYPE_INJECT_KEYCODE);
+    assert(sc_read32be(&buf[2]) == keycode);
+}
+
+// Read a clipboard message, possibly split into chunks
+static void
+expect_clipboard(sc_socket socket, size_t len) {
+    size_t total = 14 + len;
+    uint8_t *data = malloc(total);
+    assert(data);
+
+    uint8_t type;
+    recv_exact(socket, &type, 1);
+    if (type == SC_CONTROL_MSG_TYPE_CHUNK) {
+        size_t offset = 0;
+        bool last;
+        do {
+            uint8_t header[3];
+            recv_exact(socket, header, sizeof(header));
+            last = header[0];
+            uint16_t chunk_len = sc_read16be(&header[1]);
+            assert(offset + chunk_len <= total);
+            recv_exact(socket, data + offset, chunk_len);
+            offset += chunk_len;
+            if (!last) {
+                // No other message between the chunks
+                recv_exact(socket, &type, 1);
+                assert(type == SC_CONTROL_MSG_TYPE_CHUNK);
+            }
+        } while (!last);
+        assert(offset == total);
+    } else {
+        data[0] = type;
+        recv_exact(socket, data + 1, total - 1);
+    }
+
+    assert(data[0] == SC_CONTROL_MSG_TYPE_SET_CLIPBOARD);
+    assert(sc_read32be(&data[10]) == len);
+    for (size_t i = 14; i < total; ++i) {
+        assert(data[i] == 'x');
+    }
+
+    free(data);
+}
+
+static void test_clipboard_order(size_t len) {
+    struct connection c;
+    connection_open(&c);
+
+    struct sc_controller controller;
+    init_controller(&controller, &c);
+    start_controller(&controller);
+
+    // Like the input manager when the keyboard does not support asynchronous
+    // paste: set the clipboard, then inject Ctrl+V
+    push_keycode(&controller, AKEYCODE_A);
+    push_clipboard(&controller, len, true);
+    push_keycode(&controller, AKEYCODE_CTRL_LEFT);
+    push_keycode(&controller, AKEYCODE_V);
+
+    expect_keycode(c.socket, AKEYCODE_A);
+    expect_clipboard(c.socket, len);
+    expect_keycode(c.socket, AKEYCODE_CTRL_LEFT);
+    expect_keycode(c.socket, AKEYCODE_V);
+
+    stop_controller(&controller, &c);
+    connection_close(&c);
+}
+
+static void test_clipboard_autosync_does_not_block_input(void) {
+    struct connection c;
+    connection_open(&c);
+
+    struct sc_controller controller;
+    init_controller(&controller, &c);
+
+    // Push before starting the controller, so that the touch event is
+    // pending while the clipboard is sent
+    size_t len = 100000;
+    push_clipboard(&controller, len, false);
+    push_touch_down(&controller);
+
+    start_controller(&controller);
+
+    // The touch event must be received before the end of the clipboard
+    bool touch_received = false;
+    size_t offset = 0;
+    bool last = false;
+    while (!last) {
+        uint8_t type;
+        recv_exact(c.socket, &type, 1);
+        if (type == SC_CONTROL_MSG_TYPE_INJECT_TOUCH_EVENT) {
+            assert(!touch_received);
+            uint8_t buf[31];
+            recv_exact(c.socket, buf, sizeof(buf));
+            assert(buf[0] == AMOTION_EVENT_ACTION_DOWN);
+            touch_received = true;
+        } else {
+            assert(type == SC_CONTROL_MSG_TYPE_CHUNK);
+            uint8_t header[3];
+            recv_exact(c.socket, header, sizeof(header));
+            last = header[0];
+            uint16_t chunk_len = sc_read16be(&header[1]);
+            assert(chunk_len <= SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD);
+            uint8_t data[SC_CONTROL_MSG_CHUNK_MAX_PAYLOAD];
+            recv_exact(c.socket, data, chunk_len);
+            if (!offset) {
+                assert(data[0] == SC_CONTROL_MSG_TYPE_SET_CLIPBOARD);
+            }
+            offset += chunk_len;
+        }
+    }
+
+    assert(touch_received);
+    assert(offset == 14 + len);
+
+    stop_controller(&controller, &c);
+    connection_close(&c);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    bool ok = net_init();
+    assert(ok);
+    (void) ok;
+
+    // Sent as a single message
+    test_clipboard_order(100);
+    // Sent by chunks
+    test_clipboard_order(100000);
+    test_clipboard_autosync_does_not_block_input();
+
+    net_cleanup();
+
+    return 0;
+}
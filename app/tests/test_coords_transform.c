@@ -0,0 +1,150 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "coords_transform.h"
+
+struct ref_params {
+    struct sc_size window_size;
+    struct sc_size drawable_size;
+    struct sc_point rect_pos;
+    struct sc_size rect_size;
+    struct sc_size content_size;
+    enum sc_orientation orientation;
+};
+
+// Reference implementation: each step computed separately
+static struct sc_point
+ref_window_to_frame(const struct ref_params *p, int32_t x, int32_t y) {
+    // HiDPI scale
+    x = (int64_t) x * p->drawable_size.width / p->window_size.width;
+    y = (int64_t) y * p->drawable_size.height / p->window_size.height;
+
+    int32_t w = p->content_size.width;
+    int32_t h = p->content_size.height;
+
+    // Content rectangle
+    x = (int64_t) (x - p->rect_pos.x) * w / p->rect_size.width;
+    y = (int64_t) (y - p->rect_pos.y) * h / p->rect_size.height;
+
+    // Orientation
+    struct sc_point result;
+    switch (p->orientation) {
+        case SC_ORIENTATION_0:
+            result.x = x;
+            result.y = y;
+            break;
+        case SC_ORIENTATION_90:
+            result.x = y;
+            result.y = w - x;
+            break;
+        case SC_ORIENTATION_180:
+            result.x = w - x;
+            result.y = h - y;
+            break;
+        case SC_ORIENTATION_270:
+            result.x = h - y;
+            result.y = x;
+            break;
+        case SC_ORIENTATION_FLIP_0:
+            result.x = w - x;
+            result.y = y;
+            break;
+        case SC_ORIENTATION_FLIP_90:
+            result.x = h - y;
+            result.y = w - x;
+            break;
+        case SC_ORIENTATION_FLIP_180:
+            result.x = x;
+            result.y = h - y;
+            break;
+        default:
+            assert(p->orientation == SC_ORIENTATION_FLIP_270);
+            result.x = y;
+            result.y = x;
+            break;
+    }
+
+    return result;
+}
+
+static void check_params(const struct ref_params *p) {
+    struct sc_coords_transform t;
+    sc_coords_transform_init(&t, p->window_size, p->drawable_size,
+                             p->rect_pos, p->rect_size, p->content_size,
+                             p->orientation);
+
+    // Include positions outside the window (the mouse may be captured while
+    // a button is pressed)
+    for (int32_t y = -50; y < p->window_size.height + 50; y += 7) {
+        for (int32_t x = -50; x < p->window_size.width + 50; x += 7) {
+            struct sc_point expected = ref_window_to_frame(p, x, y);
+            struct sc_point actual =
+                sc_coords_transform_window_to_frame(&t, x, y);
+            assert(actual.x == expected.x);
+            assert(actual.y == expected.y);
+        }
+    }
+}
+
+static void test_coords_transform_matches_reference(void) {
+    struct ref_params cases[] = {
+        {
+            // No HiDPI, optimal size
+            .window_size = {540, 960},
+            .drawable_size = {540, 960},
+            .rect_pos = {0, 0},
+            .rect_size = {540, 960},
+            .content_size = {1080, 1920},
+        },
+        {
+            // HiDPI scale 2, black borders on the sides
+            .window_size = {800, 600},
+            .drawable_size = {1600, 1200},
+            .rect_pos = {462, 0},
+            .rect_size = {675, 1200},
+            .content_size = {1080, 1920},
+        },
+        {
+            // Fractional HiDPI scale, black borders on top and bottom
+            .window_size = {1000, 700},
+            .drawable_size = {1250, 875},
+            .rect_pos = {0, 86},
+            .rect_size = {1250, 703},
+            .content_size = {1920, 1080},
+        },
+    };
+
+    for (size_t i = 0; i < ARRAY_LEN(cases); ++i) {
+        for (int o = SC_ORIENTATION_0; o <= SC_ORIENTATION_FLIP_270; ++o) {
+            struct ref_params p = cases[i];
+            p.orientation = o;
+            check_params(&p);
+        }
+    }
+}
+
+static void test_coords_transform_window_to_drawable(void) {
+    struct sc_coords_transform t;
+    sc_coords_transform_init(&t, (struct sc_size) {800, 600},
+                             (struct sc_size) {1600, 1200},
+                             (struct sc_point) {0, 0},
+                             (struct sc_size) {1600, 1200},
+                             (struct sc_size) {1600, 1200},
+                             SC_ORIENTATION_0);
+
+    int32_t x = 123;
+    int32_t y = 456;
+    sc_coords_transform_window_to_drawable(&t, &x, &y);
+    assert(x == 246);
+    assert(y == 912);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_coords_transform_matches_reference();
+    test_coords_transform_window_to_drawable();
+    return 0;
+}
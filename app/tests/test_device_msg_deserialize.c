@@ -19,10 +19,10 @@ static void test_deserialize_clipboard(void) {
     assert(r == 8);
 
     assert(msg.type == DEVICE_MSG_TYPE_CLIPBOARD);
-    assert(msg.clipboard.text);
-    assert(!strcmp("ABC", msg.clipboard.text));
-
-    sc_device_msg_destroy(&msg);
+    assert(msg.clipboard.length == 3);
+    assert(!memcmp("ABC", msg.clipboard.text, 3));
+    // The text is not copied
+    assert(msg.clipboard.text == (const char *) &input[5]);
 }
 
 static void test_deserialize_clipboard_big(void) {
@@ -40,11 +40,8 @@ static void test_deserialize_clipboard_big(void) {
     assert(r == DEVICE_MSG_MAX_SIZE);
 
     assert(msg.type == DEVICE_MSG_TYPE_CLIPBOARD);
-    assert(msg.clipboard.text);
-    assert(strlen(msg.clipboard.text) == DEVICE_MSG_TEXT_MAX_LENGTH);
+    assert(msg.clipboard.length == DEVICE_MSG_TEXT_MAX_LENGTH);
     assert(msg.clipboard.text[0] == 'a');
-
-    sc_device_msg_destroy(&msg);
 }
 
 static void test_deserialize_ack_set_clipboard(void) {
@@ -80,7 +77,54 @@ static void test_deserialize_uhid_output(void) {
     uint8_t expected[] = {1, 2, 3, 4, 5};
     assert(!memcmp(msg.uhid_output.data, expected, sizeof(expected)));
 
-    sc_device_msg_destroy(&msg);
+    // Incomplete message
+    r = sc_device_msg_deserialize(input, sizeof(input) - 1, &msg);
+    assert(r == 0);
+}
+
+static void test_deserialize_pong(void) {
+    const uint8_t input[] = {
+        DEVICE_MSG_TYPE_PONG,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, // push date
+        0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, // send date
+        0x00, 0x00, 0x01, 0x02, // device delay
+    };
+
+    struct sc_device_msg msg;
+    ssize_t r = sc_device_msg_deserialize(input, sizeof(input), &msg);
+    assert(r == 21);
+
+    assert(msg.type == DEVICE_MSG_TYPE_PONG);
+    assert(msg.pong.push_date == UINT64_C(0x0102030405060708));
+    assert(msg.pong.send_date == UINT64_C(0x1112131415161718));
+    assert(msg.pong.device_delay == 0x102);
+
+    // Incomplete message
+    r = sc_device_msg_deserialize(input, sizeof(input) - 1, &msg);
+    assert(r == 0);
+}
+
+static void test_deserialize_chunk(void) {
+    const uint8_t input[] = {
+        DEVICE_MSG_TYPE_CHUNK,
+        0x01, // last
+        0x00, 0x03, // size
+        0x41, 0x42, 0x43, // data
+    };
+
+    struct sc_device_msg msg;
+    ssize_t r = sc_device_msg_deserialize(input, sizeof(input), &msg);
+    assert(r == 7);
+
+    assert(msg.type == DEVICE_MSG_TYPE_CHUNK);
+    assert(msg.chunk.last);
+    assert(msg.chunk.size == 3);
+    // The data is not copied
+    assert(msg.chunk.data == &input[4]);
+
+    // Incomplete message
+    r = sc_device_msg_deserialize(input, sizeof(input) - 1, &msg);
+    assert(r == 0);
 }
 
 int main(int argc, char *argv[]) {
@@ -91,5 +135,7 @@ int main(int argc, char *argv[]) {
     test_deserialize_clipboard_big();
     test_deserialize_ack_set_clipboard();
     test_deserialize_uhid_output();
+    test_deserialize_pong();
+    test_deserialize_chunk();
     return 0;
 }
@@ -0,0 +1,110 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "input_prediction.h"
+
+static void test_input_prediction_cursor(void) {
+    struct sc_input_prediction ip;
+    sc_input_prediction_init(&ip);
+
+    // Without trail, only the last position is kept
+    sc_input_prediction_push(&ip, 10, 20, false, 0, 1000);
+    sc_input_prediction_push(&ip, 30, 40, false, 0, 2000);
+    assert(ip.count == 1);
+    assert(sc_input_prediction_get(&ip, 0)->x == 30);
+    assert(sc_input_prediction_get(&ip, 0)->y == 40);
+
+    // No frame received yet, so any frame acknowledges the position
+    bool acked = sc_input_prediction_on_frame(&ip, 0, 3000);
+    assert(acked);
+    assert(ip.count == 0);
+}
+
+static void test_input_prediction_trail(void) {
+    struct sc_input_prediction ip;
+    sc_input_prediction_init(&ip);
+
+    // Frame with PTS 100000 received at local date 5000
+    sc_input_prediction_on_frame(&ip, 100000, 5000);
+
+    for (int i = 0; i < SC_INPUT_PREDICTION_TRAIL_LENGTH + 4; ++i) {
+        // Estimated device dates: 101000, 102000, ...
+        sc_input_prediction_push(&ip, i, i, true, 0, 6000 + i * 1000);
+    }
+
+    // The oldest positions are dropped
+    assert(ip.count == SC_INPUT_PREDICTION_TRAIL_LENGTH);
+    assert(sc_input_prediction_get(&ip, 0)->x == 4);
+    assert(sc_input_prediction_get(&ip, 0)->device_date == 105000);
+
+    // A frame captured before the positions does not acknowledge them
+    bool acked = sc_input_prediction_on_frame(&ip, 104000, 30000);
+    assert(!acked);
+    assert(ip.count == SC_INPUT_PREDICTION_TRAIL_LENGTH);
+
+    // A later frame acknowledges the positions before its PTS
+    acked = sc_input_prediction_on_frame(&ip, 107500, 31000);
+    assert(acked);
+    assert(ip.count == SC_INPUT_PREDICTION_TRAIL_LENGTH - 3);
+    assert(sc_input_prediction_get(&ip, 0)->x == 7);
+
+    // The most recent position is the most opaque
+    sc_tick now = 31000;
+    unsigned last = ip.count - 1;
+    assert(sc_input_prediction_get_alpha(&ip, 0, now)
+            < sc_input_prediction_get_alpha(&ip, last, now));
+}
+
+static void test_input_prediction_round_trip(void) {
+    struct sc_input_prediction ip;
+    sc_input_prediction_init(&ip);
+
+    // Frame with PTS 100000 received at local date 5000
+    sc_input_prediction_on_frame(&ip, 100000, 5000);
+
+    // With a round-trip of 20000, estimated device date: 121000
+    sc_input_prediction_push(&ip, 1, 1, true, 20000, 6000);
+    assert(sc_input_prediction_get(&ip, 0)->device_date == 121000);
+
+    // A frame captured before the event reached the device does not
+    // acknowledge it, even if it is received after the event
+    bool acked = sc_input_prediction_on_frame(&ip, 110000, 16000);
+    assert(!acked);
+    assert(ip.count == 1);
+
+    acked = sc_input_prediction_on_frame(&ip, 121500, 27000);
+    assert(acked);
+    assert(ip.count == 0);
+}
+
+static void test_input_prediction_expire(void) {
+    struct sc_input_prediction ip;
+    sc_input_prediction_init(&ip);
+
+    sc_input_prediction_on_frame(&ip, 0, 0);
+    sc_input_prediction_push(&ip, 1, 1, true, 0, SC_TICK_FROM_MS(100));
+    sc_input_prediction_push(&ip, 2, 2, true, 0, SC_TICK_FROM_MS(300));
+
+    sc_tick now = SC_TICK_FROM_MS(100) + SC_INPUT_PREDICTION_MAX_AGE;
+    sc_input_prediction_expire(&ip, now);
+    assert(ip.count == 1);
+    assert(sc_input_prediction_get(&ip, 0)->x == 2);
+    assert(sc_input_prediction_get_alpha(&ip, 0, now) > 0);
+
+    now = SC_TICK_FROM_MS(300) + SC_INPUT_PREDICTION_MAX_AGE;
+    assert(sc_input_prediction_get_alpha(&ip, 0, now) == 0);
+    sc_input_prediction_expire(&ip, now);
+    assert(ip.count == 0);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_input_prediction_cursor();
+    test_input_prediction_trail();
+    test_input_prediction_round_trip();
+    test_input_prediction_expire();
+    return 0;
+}
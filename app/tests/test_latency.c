@@ -0,0 +1,71 @@
+#include "common.h"
+
+#include <assert.h>
+
+#include "util/latency.h"
+
+static void test_latency_percentiles(void) {
+    struct sc_latency latency;
+    sc_latency_init(&latency);
+
+    // Add 1..100 in a shuffled order
+    for (int i = 0; i < 100; ++i) {
+        sc_latency_add(&latency, (i * 37) % 100 + 1);
+    }
+
+    unsigned pcts[] = {0, 1, 50, 90, 99, 100};
+    sc_tick out[ARRAY_LEN(pcts)];
+    sc_latency_get_percentiles(&latency, pcts, out, ARRAY_LEN(pcts));
+
+    assert(out[0] == 1);
+    assert(out[1] == 1);
+    assert(out[2] == 50);
+    assert(out[3] == 90);
+    assert(out[4] == 99);
+    assert(out[5] == 100);
+}
+
+static void test_latency_single(void) {
+    struct sc_latency latency;
+    sc_latency_init(&latency);
+
+    sc_latency_add(&latency, 42);
+
+    unsigned pcts[] = {0, 50, 100};
+    sc_tick out[ARRAY_LEN(pcts)];
+    sc_latency_get_percentiles(&latency, pcts, out, ARRAY_LEN(pcts));
+
+    assert(out[0] == 42);
+    assert(out[1] == 42);
+    assert(out[2] == 42);
+}
+
+static void test_latency_window(void) {
+    struct sc_latency latency;
+    sc_latency_init(&latency);
+
+    // Old samples are replaced
+    for (int i = 0; i < SC_LATENCY_SAMPLES; ++i) {
+        sc_latency_add(&latency, 1000);
+    }
+    for (int i = 0; i < SC_LATENCY_SAMPLES; ++i) {
+        sc_latency_add(&latency, 5);
+    }
+
+    assert(latency.count == SC_LATENCY_SAMPLES);
+
+    unsigned pcts[] = {100};
+    sc_tick out[1];
+    sc_latency_get_percentiles(&latency, pcts, out, 1);
+    assert(out[0] == 5);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    test_latency_percentiles();
+    test_latency_single();
+    test_latency_window();
+    return 0;
+}
@@ -184,6 +184,38 @@ static void test_vecdeque_push_hole(void) {
     sc_vecdeque_destroy(&vdq);
 }
 
+static void test_vecdeque_getref(void) {
+    struct SC_VECDEQUE(int) vdq = SC_VECDEQUE_INITIALIZER;
+
+    bool ok = sc_vecdeque_reserve(&vdq, 10);
+    assert(ok);
+
+    for (int i = 0; i < 8; ++i) {
+        sc_vecdeque_push_noresize(&vdq, i);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        (void) sc_vecdeque_pop(&vdq);
+    }
+
+    // Wrap around the end of the internal array
+    for (int i = 8; i < 14; ++i) {
+        sc_vecdeque_push_noresize(&vdq, i);
+    }
+
+    assert(sc_vecdeque_size(&vdq) == 9);
+    for (size_t i = 0; i < 9; ++i) {
+        int *p = sc_vecdeque_getref(&vdq, i);
+        assert(*p == (int) i + 5);
+    }
+
+    // The item may be modified in place
+    *sc_vecdeque_getref(&vdq, 8) = 42;
+    assert(*sc_vecdeque_getref(&vdq, 8) == 42);
+
+    sc_vecdeque_destroy(&vdq);
+}
+
 int main(int argc, char *argv[]) {
     (void) argc;
     (void) argv;
@@ -192,6 +224,7 @@ int main(int argc, char *argv[]) {
     test_vecdeque_reserve();
     test_vecdeque_grow();
     test_vecdeque_push_hole();
+    test_vecdeque_getref();
 
     return 0;
 }
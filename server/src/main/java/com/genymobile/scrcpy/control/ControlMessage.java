@@ -25,6 +25,9 @@ public final class ControlMessage {
     public static final int TYPE_OPEN_HARD_KEYBOARD_SETTINGS = 15;
     public static final int TYPE_START_APP = 16;
     public static final int TYPE_RESET_VIDEO = 17;
+    public static final int TYPE_PING = 18;
+    // A piece of a serialized bulk message, reassembled by ControlMessageReader
+    public static final int TYPE_CHUNK = 19;
 
     public static final long SEQUENCE_INVALID = 0;
 
@@ -53,6 +56,9 @@ public final class ControlMessage {
     private boolean on;
     private int vendorId;
     private int productId;
+    private long pushDate; // client timestamp, echoed back
+    private long sendDate; // client timestamp, echoed back
+    private long receiveNanos; // System.nanoTime() on reception
 
     private ControlMessage() {
     }
@@ -166,6 +172,15 @@ public final class ControlMessage {
         return msg;
     }
 
+    public static ControlMessage createPing(long pushDate, long sendDate) {
+        ControlMessage msg = new ControlMessage();
+        msg.type = TYPE_PING;
+        msg.pushDate = pushDate;
+        msg.sendDate = sendDate;
+        msg.receiveNanos = System.nanoTime();
+        return msg;
+    }
+
     public int getType() {
         return type;
     }
@@ -249,4 +264,16 @@ public final class ControlMessage {
     public int getProductId() {
         return productId;
     }
+
+    public long getPushDate() {
+        return pushDate;
+    }
+
+    public long getSendDate() {
+        return sendDate;
+    }
+
+    public long getReceiveNanos() {
+        return receiveNanos;
+    }
 }
@@ -4,10 +4,12 @@ import com.genymobile.scrcpy.device.Position;
 import com.genymobile.scrcpy.util.Binary;
 
 import java.io.BufferedInputStream;
+import java.io.ByteArrayInputStream;
 import java.io.DataInputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
 
 public class ControlMessageReader {
 
@@ -16,14 +18,74 @@ public class ControlMessageReader {
     public static final int CLIPBOARD_TEXT_MAX_LENGTH = MESSAGE_MAX_SIZE - 14; // type: 1 byte; sequence: 8 bytes; paste flag: 1 byte; length: 4 bytes
     public static final int INJECT_TEXT_MAX_LENGTH = 300;
 
+    // Bulk messages (clipboard) are streamed by chunks, so they may be larger
+    private static final int BULK_MAX_SIZE = 1 << 24; // 16M
+
+    // The client sends the pending messages in batches of up to 64k
+    private static final int BUFFER_SIZE = 1 << 16;
+
     private final DataInputStream dis;
 
+    // Bulk message being received by chunks (real-time messages may be received in between)
+    private byte[] bulk = new byte[0];
+    private int bulkLength;
+
     public ControlMessageReader(InputStream rawInputStream) {
-        dis = new DataInputStream(new BufferedInputStream(rawInputStream));
+        this(new DataInputStream(new BufferedInputStream(rawInputStream, BUFFER_SIZE)));
+    }
+
+    private ControlMessageReader(DataInputStream dis) {
+        this.dis = dis;
     }
 
     public ControlMessage read() throws IOException {
-        int type = dis.readUnsignedByte();
+        for (;;) {
+            int type = dis.readUnsignedByte();
+            if (type != ControlMessage.TYPE_CHUNK) {
+                return parse(type);
+            }
+
+            ControlMessage msg = parseChunk();
+            if (msg != null) {
+                return msg;
+            }
+            // The bulk message is not complete yet, read the next message
+        }
+    }
+
+    private ControlMessage parseChunk() throws IOException {
+        boolean last = dis.readUnsignedByte() != 0;
+        int len = dis.readUnsignedShort();
+        if (bulkLength + len > BULK_MAX_SIZE) {
+            throw new ControlProtocolException("Bulk message too large");
+        }
+
+        if (bulkLength + len > bulk.length) {
+            // Grow exponentially, to append chunks in amortized constant time
+            int capacity = Math.min(Math.max(bulkLength + len, bulk.length * 2), BULK_MAX_SIZE);
+            bulk = Arrays.copyOf(bulk, capacity);
+        }
+
+        // Assemble the chunks directly in place
+        dis.readFully(bulk, bulkLength, len);
+        bulkLength += len;
+        if (!last) {
+            return null;
+        }
+
+        DataInputStream bulkInput = new DataInputStream(new ByteArrayInputStream(bulk, 0, bulkLength));
+        // Release the memory once parsed, a bulk message may be huge
+        bulk = new byte[0];
+        bulkLength = 0;
+
+        int type = bulkInput.readUnsignedByte();
+        if (type == ControlMessage.TYPE_CHUNK) {
+            throw new ControlProtocolException("Nested chunk");
+        }
+        return new ControlMessageReader(bulkInput).parse(type);
+    }
+
+    private ControlMessage parse(int type) throws IOException {
         switch (type) {
             case ControlMessage.TYPE_INJECT_KEYCODE:
                 return parseInjectKeycode();
@@ -56,6 +118,8 @@ public class ControlMessageReader {
                 return parseUhidDestroy();
             case ControlMessage.TYPE_START_APP:
                 return parseStartApp();
+            case ControlMessage.TYPE_PING:
+                return parsePing();
             default:
                 throw new ControlProtocolException("Unknown event type: " + type);
         }
@@ -165,6 +229,12 @@ public class ControlMessageReader {
         return ControlMessage.createStartApp(name);
     }
 
+    private ControlMessage parsePing() throws IOException {
+        long pushDate = dis.readLong();
+        long sendDate = dis.readLong();
+        return ControlMessage.createPing(pushDate, sendDate);
+    }
+
     private Position parsePosition() throws IOException {
         int x = dis.readInt();
         int y = dis.readInt();
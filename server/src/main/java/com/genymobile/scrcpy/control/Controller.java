@@ -307,6 +307,9 @@ public class Controller implements AsyncProcessor, VirtualDisplayListener {
             case ControlMessage.TYPE_RESET_VIDEO:
                 resetVideo();
                 break;
+            case ControlMessage.TYPE_PING:
+                sender.send(DeviceMessage.createPong(msg.getPushDate(), msg.getSendDate(), msg.getReceiveNanos()));
+                break;
             default:
                 // do nothing
         }
@@ -5,12 +5,19 @@ public final class DeviceMessage {
     public static final int TYPE_CLIPBOARD = 0;
     public static final int TYPE_ACK_CLIPBOARD = 1;
     public static final int TYPE_UHID_OUTPUT = 2;
+    public static final int TYPE_PONG = 3;
+    // A piece of a serialized bulk message, reassembled by the client
+    public static final int TYPE_CHUNK = 4;
 
     private int type;
     private String text;
     private long sequence;
     private int id;
     private byte[] data;
+    private long pushDate;
+    private long sendDate;
+    private long receiveNanos;
+    private boolean last;
 
     private DeviceMessage() {
     }
@@ -37,6 +44,23 @@ public final class DeviceMessage {
         return event;
     }
 
+    public static DeviceMessage createPong(long pushDate, long sendDate, long receiveNanos) {
+        DeviceMessage event = new DeviceMessage();
+        event.type = TYPE_PONG;
+        event.pushDate = pushDate;
+        event.sendDate = sendDate;
+        event.receiveNanos = receiveNanos;
+        return event;
+    }
+
+    public static DeviceMessage createChunk(byte[] data, boolean last) {
+        DeviceMessage event = new DeviceMessage();
+        event.type = TYPE_CHUNK;
+        event.data = data;
+        event.last = last;
+        return event;
+    }
+
     public int getType() {
         return type;
     }
@@ -56,4 +80,20 @@ public final class DeviceMessage {
     public byte[] getData() {
         return data;
     }
+
+    public long getPushDate() {
+        return pushDate;
+    }
+
+    public long getSendDate() {
+        return sendDate;
+    }
+
+    public long getReceiveNanos() {
+        return receiveNanos;
+    }
+
+    public boolean isLast() {
+        return last;
+    }
 }
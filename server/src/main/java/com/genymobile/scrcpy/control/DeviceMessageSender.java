@@ -3,6 +3,9 @@ package com.genymobile.scrcpy.control;
 import com.genymobile.scrcpy.util.Ln;
 
 import java.io.IOException;
+import java.util.ArrayDeque;
+import java.util.Arrays;
+import java.util.Queue;
 import java.util.concurrent.ArrayBlockingQueue;
 import java.util.concurrent.BlockingQueue;
 
@@ -13,6 +16,11 @@ public final class DeviceMessageSender {
     private Thread thread;
     private final BlockingQueue<DeviceMessage> queue = new ArrayBlockingQueue<>(16);
 
+    // Only accessed by the sender thread
+    private final Queue<DeviceMessage> pendingBulk = new ArrayDeque<>();
+    private byte[] bulk; // serialized bulk message being sent by chunks
+    private int bulkOffset;
+
     public DeviceMessageSender(ControlChannel controlChannel) {
         this.controlChannel = controlChannel;
     }
@@ -23,10 +31,45 @@ public final class DeviceMessageSender {
         }
     }
 
+    private static boolean isBulk(DeviceMessage msg) {
+        // The clipboard may be large, it must not delay the other messages
+        return msg.getType() == DeviceMessage.TYPE_CLIPBOARD;
+    }
+
     private void loop() throws IOException, InterruptedException {
         while (!Thread.currentThread().isInterrupted()) {
-            DeviceMessage msg = queue.take();
-            controlChannel.send(msg);
+            // Block only if there is no bulk message to send
+            boolean bulkPending = bulk != null || !pendingBulk.isEmpty();
+            DeviceMessage msg = bulkPending ? queue.poll() : queue.take();
+            if (msg != null) {
+                if (isBulk(msg)) {
+                    pendingBulk.add(msg);
+                } else {
+                    controlChannel.send(msg);
+                }
+                // Send all pending messages before the next chunk
+                continue;
+            }
+
+            sendBulkChunk();
+        }
+    }
+
+    private void sendBulkChunk() throws IOException {
+        if (bulk == null) {
+            bulk = DeviceMessageWriter.serialize(pendingBulk.remove());
+            bulkOffset = 0;
+        }
+
+        int len = Math.min(bulk.length - bulkOffset, DeviceMessageWriter.CHUNK_MAX_PAYLOAD);
+        boolean last = bulkOffset + len == bulk.length;
+        byte[] chunk = Arrays.copyOfRange(bulk, bulkOffset, bulkOffset + len);
+        controlChannel.send(DeviceMessage.createChunk(chunk, last));
+
+        if (last) {
+            bulk = null;
+        } else {
+            bulkOffset += len;
         }
     }
 
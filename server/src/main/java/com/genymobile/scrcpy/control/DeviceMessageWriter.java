@@ -3,6 +3,7 @@ package com.genymobile.scrcpy.control;
 import com.genymobile.scrcpy.util.StringUtils;
 
 import java.io.BufferedOutputStream;
+import java.io.ByteArrayOutputStream;
 import java.io.DataOutputStream;
 import java.io.IOException;
 import java.io.OutputStream;
@@ -10,8 +11,11 @@ import java.nio.charset.StandardCharsets;
 
 public class DeviceMessageWriter {
 
-    private static final int MESSAGE_MAX_SIZE = 1 << 18; // 256k
-    public static final int CLIPBOARD_TEXT_MAX_LENGTH = MESSAGE_MAX_SIZE - 5; // type: 1 byte; length: 4 bytes
+    // Clipboard messages are streamed by chunks, so they may be large
+    private static final int BULK_MAX_SIZE = 1 << 24; // 16M
+    public static final int CLIPBOARD_TEXT_MAX_LENGTH = BULK_MAX_SIZE - 5; // type: 1 byte; length: 4 bytes
+
+    public static final int CHUNK_MAX_PAYLOAD = 1 << 12; // 4k
 
     private final DataOutputStream dos;
 
@@ -20,6 +24,17 @@ public class DeviceMessageWriter {
     }
 
     public void write(DeviceMessage msg) throws IOException {
+        write(dos, msg);
+        dos.flush();
+    }
+
+    public static byte[] serialize(DeviceMessage msg) throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        write(new DataOutputStream(bos), msg);
+        return bos.toByteArray();
+    }
+
+    private static void write(DataOutputStream dos, DeviceMessage msg) throws IOException {
         int type = msg.getType();
         dos.writeByte(type);
         switch (type) {
@@ -39,9 +54,22 @@ public class DeviceMessageWriter {
                 dos.writeShort(data.length);
                 dos.write(data);
                 break;
+            case DeviceMessage.TYPE_PONG:
+                dos.writeLong(msg.getPushDate());
+                dos.writeLong(msg.getSendDate());
+                // Time spent on the device, in microseconds
+                long deviceDelayUs = (System.nanoTime() - msg.getReceiveNanos()) / 1000;
+                dos.writeInt((int) Math.min(deviceDelayUs, Integer.MAX_VALUE));
+                break;
+            case DeviceMessage.TYPE_CHUNK:
+                byte[] chunk = msg.getData();
+                assert chunk.length <= CHUNK_MAX_PAYLOAD;
+                dos.writeByte(msg.isLast() ? 1 : 0);
+                dos.writeShort(chunk.length);
+                dos.write(chunk);
+                break;
             default:
                 throw new ControlProtocolException("Unknown event type: " + type);
         }
-        dos.flush();
     }
 }
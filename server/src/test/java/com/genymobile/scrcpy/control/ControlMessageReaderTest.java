@@ -253,6 +253,97 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(-1, bis.read()); // EOS
     }
 
+    @Test
+    public void testParseChunkedSetClipboardEvent() throws IOException {
+        ByteArrayOutputStream msgBos = new ByteArrayOutputStream();
+        DataOutputStream msgDos = new DataOutputStream(msgBos);
+        msgDos.writeByte(ControlMessage.TYPE_SET_CLIPBOARD);
+        msgDos.writeLong(0x0102030405060708L); // sequence
+        msgDos.writeByte(0); // paste
+        byte[] text = "chunked text".getBytes(StandardCharsets.UTF_8);
+        msgDos.writeInt(text.length);
+        msgDos.write(text);
+        byte[] serialized = msgBos.toByteArray();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+
+        // first chunk
+        dos.writeByte(ControlMessage.TYPE_CHUNK);
+        dos.writeByte(0); // not last
+        dos.writeShort(10);
+        dos.write(serialized, 0, 10);
+
+        // real-time message in between
+        dos.writeByte(ControlMessage.TYPE_INJECT_KEYCODE);
+        dos.writeByte(KeyEvent.ACTION_UP);
+        dos.writeInt(KeyEvent.KEYCODE_ENTER);
+        dos.writeInt(0); // repeat
+        dos.writeInt(0); // meta state
+
+        // last chunk
+        dos.writeByte(ControlMessage.TYPE_CHUNK);
+        dos.writeByte(1); // last
+        dos.writeShort(serialized.length - 10);
+        dos.write(serialized, 10, serialized.length - 10);
+
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_INJECT_KEYCODE, event.getType());
+        Assert.assertEquals(KeyEvent.KEYCODE_ENTER, event.getKeycode());
+
+        event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_SET_CLIPBOARD, event.getType());
+        Assert.assertEquals(0x0102030405060708L, event.getSequence());
+        Assert.assertEquals("chunked text", event.getText());
+        Assert.assertFalse(event.getPaste());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
+    @Test
+    public void testParseHugeChunkedSetClipboardEvent() throws IOException {
+        // Larger than the max size of a single message
+        byte[] rawText = new byte[1 << 20];
+        Arrays.fill(rawText, (byte) 'a');
+
+        ByteArrayOutputStream msgBos = new ByteArrayOutputStream();
+        DataOutputStream msgDos = new DataOutputStream(msgBos);
+        msgDos.writeByte(ControlMessage.TYPE_SET_CLIPBOARD);
+        msgDos.writeLong(0x0102030405060708L); // sequence
+        msgDos.writeByte(1); // paste
+        msgDos.writeInt(rawText.length);
+        msgDos.write(rawText);
+        byte[] serialized = msgBos.toByteArray();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        int chunkSize = 1 << 12;
+        for (int offset = 0; offset < serialized.length; offset += chunkSize) {
+            int len = Math.min(chunkSize, serialized.length - offset);
+            dos.writeByte(ControlMessage.TYPE_CHUNK);
+            dos.writeByte(offset + len == serialized.length ? 1 : 0);
+            dos.writeShort(len);
+            dos.write(serialized, offset, len);
+        }
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_SET_CLIPBOARD, event.getType());
+        Assert.assertEquals(0x0102030405060708L, event.getSequence());
+        Assert.assertEquals(new String(rawText, StandardCharsets.UTF_8), event.getText());
+        Assert.assertTrue(event.getPaste());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
     @Test
     public void testParseBigSetClipboardEvent() throws IOException {
         ByteArrayOutputStream bos = new ByteArrayOutputStream();
@@ -422,6 +513,26 @@ public class ControlMessageReaderTest {
         Assert.assertEquals(-1, bis.read()); // EOS
     }
 
+    @Test
+    public void testParsePing() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlMessage.TYPE_PING);
+        dos.writeLong(0x0102030405060708L);
+        dos.writeLong(0x1112131415161718L);
+        byte[] packet = bos.toByteArray();
+
+        ByteArrayInputStream bis = new ByteArrayInputStream(packet);
+        ControlMessageReader reader = new ControlMessageReader(bis);
+
+        ControlMessage event = reader.read();
+        Assert.assertEquals(ControlMessage.TYPE_PING, event.getType());
+        Assert.assertEquals(0x0102030405060708L, event.getPushDate());
+        Assert.assertEquals(0x1112131415161718L, event.getSendDate());
+
+        Assert.assertEquals(-1, bis.read()); // EOS
+    }
+
     @Test
     public void testMultiEvents() throws IOException {
         ByteArrayOutputStream bos = new ByteArrayOutputStream();
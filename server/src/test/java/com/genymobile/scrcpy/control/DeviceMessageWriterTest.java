@@ -6,6 +6,7 @@ import org.junit.Test;
 import java.io.ByteArrayOutputStream;
 import java.io.DataOutputStream;
 import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.nio.charset.StandardCharsets;
 
 public class DeviceMessageWriterTest {
@@ -72,4 +73,44 @@ public class DeviceMessageWriterTest {
 
         Assert.assertArrayEquals(expected, actual);
     }
+
+    @Test
+    public void testSerializePong() throws IOException {
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DeviceMessageWriter writer = new DeviceMessageWriter(bos);
+
+        DeviceMessage msg = DeviceMessage.createPong(0x0102030405060708L, 0x1112131415161718L, System.nanoTime());
+        writer.write(msg);
+
+        ByteBuffer actual = ByteBuffer.wrap(bos.toByteArray());
+        Assert.assertEquals(21, actual.remaining());
+        Assert.assertEquals(DeviceMessage.TYPE_PONG, actual.get());
+        Assert.assertEquals(0x0102030405060708L, actual.getLong());
+        Assert.assertEquals(0x1112131415161718L, actual.getLong());
+        // The device delay depends on the time, just check it is valid
+        Assert.assertTrue(actual.getInt() >= 0);
+    }
+
+    @Test
+    public void testSerializeChunk() throws IOException {
+        byte[] data = {1, 2, 3, 4, 5};
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(DeviceMessage.TYPE_CHUNK);
+        dos.writeByte(1); // last
+        dos.writeShort(data.length);
+        dos.write(data);
+        byte[] expected = bos.toByteArray();
+
+        bos = new ByteArrayOutputStream();
+        DeviceMessageWriter writer = new DeviceMessageWriter(bos);
+
+        DeviceMessage msg = DeviceMessage.createChunk(data, true);
+        writer.write(msg);
+
+        byte[] actual = bos.toByteArray();
+
+        Assert.assertArrayEquals(expected, actual);
+    }
 }